@@ -46,6 +46,7 @@
 #include <alljoyn/MessageReceiver.h>
 #include <alljoyn/ProxyBusObject.h>
 
+#include "DaemonConfig.h"
 #include "DaemonRouter.h"
 #include "AllJoynObj.h"
 #include "TransportList.h"
@@ -56,6 +57,7 @@
 #include "EndpointHelper.h"
 #include "ns/IpNameService.h"
 #include "AllJoynPeerObj.h"
+#include "PeerState.h"
 
 #define QCC_MODULE "ALLJOYN_OBJ"
 
@@ -91,6 +93,7 @@ AllJoynObj::AllJoynObj(Bus& bus, BusController* busController) :
     lostAdvNameSignal(NULL),
     sessionLostSignal(NULL),
     mpSessionChangedSignal(NULL),
+    sessionlessCatchupCompleteSignal(NULL),
     mpSessionJoinedSignal(NULL),
     guid(bus.GetInternal().GetGlobalGUID()),
     exchangeNamesSignal(NULL),
@@ -98,6 +101,9 @@ AllJoynObj::AllJoynObj(Bus& bus, BusController* busController) :
     timer("NameReaper"),
     isStopping(false),
     busController(busController)
+#ifndef NDEBUG
+    , joinSessionDebug(*this)
+#endif
 {
 }
 
@@ -152,6 +158,7 @@ QStatus AllJoynObj::Init()
     lostAdvNameSignal = alljoynIntf->GetMember("LostAdvertisedName");
     sessionLostSignal = alljoynIntf->GetMember("SessionLost");
     mpSessionChangedSignal = alljoynIntf->GetMember("MPSessionChanged");
+    sessionlessCatchupCompleteSignal = alljoynIntf->GetMember("SessionlessCatchupComplete");
 
     const InterfaceDescription* busSessionIntf = bus.GetInterface(org::alljoyn::Bus::Peer::Session::InterfaceName);
     if (!busSessionIntf) {
@@ -220,6 +227,30 @@ QStatus AllJoynObj::Init()
     }
 
 
+    /* Bound the number of threads handling JoinSession and AttachSession requests */
+    uint32_t maxJoinThreads = DaemonConfig::Access()->Get("limit@max_join_session_threads", MAX_JOIN_SESSION_THREADS_DEFAULT);
+    joinSessionThreadsLock.Lock(MUTEX_CONTEXT);
+    joinPool.maxThreads = maxJoinThreads ? maxJoinThreads : 1;
+    attachPool.maxThreads = joinPool.maxThreads;
+    joinSessionThreadsLock.Unlock(MUTEX_CONTEXT);
+
+#ifndef NDEBUG
+    /* Report the JoinSession and AttachSession queue statistics on the debug object */
+    if (ER_OK == status) {
+        status = debug::AllJoynDebugObj::GetAllJoynDebugObj()->AddDebugInterface(&joinSessionDebug,
+                                                                                 "org.alljoyn.Bus.Debug.Session",
+                                                                                 NULL, 0,
+                                                                                 joinSessionDebug);
+        if (status != ER_OK) {
+            QCC_LogError(status, ("Failed to add org.alljoyn.Bus.Debug.Session"));
+        }
+    }
+#endif
+
+    /* Size the serial number window used to detect replayed messages */
+    uint32_t serialWindow = DaemonConfig::Access()->Get("limit@serial_window", _PeerState::DEFAULT_SERIAL_WINDOW);
+    bus.GetInternal().GetPeerStateTable()->SetSerialWindowSize(serialWindow);
+
     /* Register a name table listener */
     router.AddBusNameListener(this);
 
@@ -243,15 +274,28 @@ QStatus AllJoynObj::Init()
 
 QStatus AllJoynObj::Stop()
 {
-    /* Stop any outstanding JoinSessionThreads */
+    /* Stop any outstanding JoinSessionThreads and take the requests they have not started */
+    deque<JoinSessionRequest> dropped;
     joinSessionThreadsLock.Lock(MUTEX_CONTEXT);
     isStopping = true;
+    dropped.swap(joinPool.queue);
+    dropped.insert(dropped.end(), attachPool.queue.begin(), attachPool.queue.end());
+    attachPool.queue.clear();
     vector<JoinSessionThread*>::iterator it = joinSessionThreads.begin();
     while (it != joinSessionThreads.end()) {
         (*it)->Stop();
         ++it;
     }
     joinSessionThreadsLock.Unlock(MUTEX_CONTEXT);
+
+    /* Fail the requests that were never started so the callers are not left waiting */
+    while (!dropped.empty()) {
+        QStatus status = MethodReply(dropped.front().msg, ER_BUS_STOPPING);
+        if (status != ER_OK) {
+            QCC_DbgPrintf(("Failed to reply to queued %s request (%s)", dropped.front().msg->GetMemberName(), QCC_StatusText(status)));
+        }
+        dropped.pop_front();
+    }
     return ER_OK;
 }
 
@@ -462,15 +506,118 @@ void AllJoynObj::UnbindSessionPort(const InterfaceDescription::Member* member, M
 
 ThreadReturn STDCALL AllJoynObj::JoinSessionThread::Run(void* arg)
 {
-    if (isJoin) {
-        QCC_DbgTrace(("JoinSessionThread::RunJoin()"));
-        return RunJoin();
-    } else {
-        QCC_DbgTrace(("JoinSessionThread::RunAttach()"));
-        return RunAttach();
+    JoinSessionPool& pool = isJoin ? ajObj.joinPool : ajObj.attachPool;
+
+    ajObj.joinSessionThreadsLock.Lock(MUTEX_CONTEXT);
+    while (!ajObj.isStopping && pool.Next(msg, GetTimestamp64())) {
+        ajObj.joinSessionThreadsLock.Unlock(MUTEX_CONTEXT);
+        if (isJoin) {
+            QCC_DbgTrace(("JoinSessionThread::RunJoin()"));
+            RunJoin();
+        } else {
+            QCC_DbgTrace(("JoinSessionThread::RunAttach()"));
+            RunAttach();
+        }
+        ajObj.joinSessionThreadsLock.Lock(MUTEX_CONTEXT);
+    }
+    --pool.threads;
+    ajObj.joinSessionThreadsLock.Unlock(MUTEX_CONTEXT);
+    return 0;
+}
+
+bool AllJoynObj::JoinSessionPool::Next(Message& msg, uint64_t now)
+{
+    if (queue.empty()) {
+        return false;
+    }
+    JoinSessionRequest& next = queue.front();
+    msg = next.msg;
+    uint32_t waitMs = static_cast<uint32_t>(now - next.queued);
+    totalWaitMs += waitMs;
+    maxWaitMs = (waitMs > maxWaitMs) ? waitMs : maxWaitMs;
+    ++handled;
+    queue.pop_front();
+    return true;
+}
+
+void AllJoynObj::QueueJoinSessionRequest(Message& msg, bool isJoin)
+{
+    JoinSessionPool& pool = isJoin ? joinPool : attachPool;
+
+    joinSessionThreadsLock.Lock(MUTEX_CONTEXT);
+    if (!isStopping) {
+        pool.queue.push_back(JoinSessionRequest(msg, GetTimestamp64()));
+        if (pool.queue.size() > pool.maxQueued) {
+            pool.maxQueued = pool.queue.size();
+            QCC_DbgPrintf(("%s request queue depth %u", isJoin ? "JoinSession" : "AttachSession", (unsigned int)pool.maxQueued));
+        }
+        /*
+         * Start a thread if there are fewer than the maximum. Threads that are already running
+         * pick up the request when they are done with their current one.
+         */
+        if (pool.threads < pool.maxThreads) {
+            JoinSessionThread* jst = new JoinSessionThread(*this, isJoin);
+            QStatus status = jst->Start(NULL, jst);
+            if (status == ER_OK) {
+                joinSessionThreads.push_back(jst);
+                ++pool.threads;
+                pool.peakThreads = (pool.threads > pool.peakThreads) ? pool.threads : pool.peakThreads;
+            } else {
+                QCC_LogError(status, ("%s: Failed to start JoinSessionThread", isJoin ? "Join" : "Attach"));
+                delete jst;
+            }
+        }
+    }
+    joinSessionThreadsLock.Unlock(MUTEX_CONTEXT);
+}
+
+void AllJoynObj::GetJoinSessionStats(bool isJoin, JoinSessionStats& stats)
+{
+    JoinSessionPool& pool = isJoin ? joinPool : attachPool;
+
+    joinSessionThreadsLock.Lock(MUTEX_CONTEXT);
+    stats.queued = pool.queue.size();
+    stats.maxQueued = pool.maxQueued;
+    stats.threads = pool.threads;
+    stats.maxThreads = pool.maxThreads;
+    stats.peakThreads = pool.peakThreads;
+    stats.handled = pool.handled;
+    stats.avgWaitMs = pool.handled ? static_cast<uint32_t>(pool.totalWaitMs / pool.handled) : 0;
+    stats.maxWaitMs = pool.maxWaitMs;
+    joinSessionThreadsLock.Unlock(MUTEX_CONTEXT);
+}
+
+#ifndef NDEBUG
+QStatus AllJoynObj::JoinSessionDebug::Get(const char* propName, MsgArg& val) const
+{
+    bool isJoin = (strcmp(propName, "JoinSessionStats") == 0);
+    if (!isJoin && (strcmp(propName, "AttachSessionStats") != 0)) {
+        return ER_BUS_NO_SUCH_PROPERTY;
     }
+    JoinSessionStats stats;
+    ajObj.GetJoinSessionStats(isJoin, stats);
+    return val.Set("(uuuuuuu)",
+                   static_cast<uint32_t>(stats.queued),
+                   static_cast<uint32_t>(stats.maxQueued),
+                   static_cast<uint32_t>(stats.threads),
+                   static_cast<uint32_t>(stats.maxThreads),
+                   static_cast<uint32_t>(stats.peakThreads),
+                   stats.handled,
+                   stats.maxWaitMs);
 }
 
+void AllJoynObj::JoinSessionDebug::GetProperyInfo(const Info*& info, size_t& infoSize)
+{
+    /* Each property is (queued, maxQueued, threads, maxThreads, peakThreads, handled, maxWaitMs) */
+    static const Info stats[] = {
+        { "JoinSessionStats",   "(uuuuuuu)", PROP_ACCESS_READ },
+        { "AttachSessionStats", "(uuuuuuu)", PROP_ACCESS_READ }
+    };
+    info = stats;
+    infoSize = ArraySize(stats);
+}
+#endif
+
 ThreadReturn STDCALL AllJoynObj::JoinSessionThread::RunJoin()
 {
     uint32_t replyCode = ALLJOYN_JOINSESSION_REPLY_SUCCESS;
@@ -1093,33 +1240,13 @@ void AllJoynObj::JoinSessionThread::ThreadExit(Thread* thread)
 void AllJoynObj::JoinSession(const InterfaceDescription::Member* member, Message& msg)
 {
     /* Handle JoinSession on another thread since JoinThread can block waiting for NameOwnerChanged */
-    joinSessionThreadsLock.Lock(MUTEX_CONTEXT);
-    if (!isStopping) {
-        JoinSessionThread* jst = new JoinSessionThread(*this, msg, true);
-        QStatus status = jst->Start(NULL, jst);
-        if (status == ER_OK) {
-            joinSessionThreads.push_back(jst);
-        } else {
-            QCC_LogError(status, ("Join: Failed to start JoinSessionThread"));
-        }
-    }
-    joinSessionThreadsLock.Unlock(MUTEX_CONTEXT);
+    QueueJoinSessionRequest(msg, true);
 }
 
 void AllJoynObj::AttachSession(const InterfaceDescription::Member* member, Message& msg)
 {
     /* Handle AttachSession on another thread since AttachSession can block when connecting through an intermediate node */
-    joinSessionThreadsLock.Lock(MUTEX_CONTEXT);
-    if (!isStopping) {
-        JoinSessionThread* jst = new JoinSessionThread(*this, msg, false);
-        QStatus status = jst->Start(NULL, jst);
-        if (status == ER_OK) {
-            joinSessionThreads.push_back(jst);
-        } else {
-            QCC_LogError(status, ("Attach: Failed to start JoinSessionThread"));
-        }
-    }
-    joinSessionThreadsLock.Unlock(MUTEX_CONTEXT);
+    QueueJoinSessionRequest(msg, false);
 }
 
 void AllJoynObj::LeaveSession(const InterfaceDescription::Member* member, Message& msg)
@@ -1999,6 +2126,15 @@ void AllJoynObj::SendMPSessionChanged(SessionId sessionId, const char* name, boo
     }
 }
 
+void AllJoynObj::SendSessionlessCatchupComplete(const char* dest)
+{
+    QCC_DbgPrintf(("Sending SessionlessCatchupComplete to %s", dest));
+    QStatus status = Signal(dest, 0, *sessionlessCatchupCompleteSignal, NULL, 0);
+    if (status != ER_OK) {
+        QCC_LogError(status, ("Failed to send SessionlessCatchupComplete to %s", dest));
+    }
+}
+
 QStatus AllJoynObj::SendGetSessionInfo(const char* creatorName,
                                        SessionPort sessionPort,
                                        const SessionOpts& opts,
@@ -23,6 +23,7 @@
 #define _ALLJOYN_ALLJOYNOBJ_H
 
 #include <qcc/platform.h>
+#include <deque>
 #include <vector>
 #include <map>
 
@@ -38,6 +39,7 @@
 #include <alljoyn/BusObject.h>
 #include <alljoyn/Message.h>
 
+#include "AllJoynDebugObj.h"
 #include "Bus.h"
 #include "NameTable.h"
 #include "RemoteEndpoint.h"
@@ -305,6 +307,16 @@ class AllJoynObj : public BusObject, public NameListener, public TransportListen
      */
     void SetAdvNameAlias(const qcc::String& guid, const TransportMask mask, const qcc::String& advName);
 
+    /**
+     * Send the SessionlessCatchupComplete signal to a locally attached endpoint.
+     *
+     * This method is used by SessionlessObj to tell a client that the sessionless signals it asked
+     * to re-receive from remote daemons have all been delivered or could not be fetched.
+     *
+     * @param dest    Unique name of the local endpoint that asked to re-receive sessionless signals.
+     */
+    void SendSessionlessCatchupComplete(const char* dest);
+
     /**
      * Handle event that the application/process is suspending on OS like WinRT.
      * On Windows RT, an application is suspended when it becomes invisible after about
@@ -466,6 +478,34 @@ class AllJoynObj : public BusObject, public NameListener, public TransportListen
      */
     DaemonRouter& GetDaemonRouter() { return router; }
 
+    /**
+     * Default maximum number of threads handling JoinSession requests and of threads handling
+     * AttachSession requests.
+     */
+    static const uint32_t MAX_JOIN_SESSION_THREADS_DEFAULT = 16;
+
+    /**
+     * Statistics for the JoinSession or AttachSession request queue.
+     */
+    struct JoinSessionStats {
+        size_t queued;          /**< Number of requests waiting for a thread */
+        size_t maxQueued;       /**< Largest number of requests that have been waiting for a thread */
+        size_t threads;         /**< Number of threads handling requests */
+        size_t maxThreads;      /**< Maximum number of threads handling requests */
+        size_t peakThreads;     /**< Largest number of threads that have handled requests at once */
+        uint32_t handled;       /**< Number of requests that have been handled */
+        uint32_t avgWaitMs;     /**< Average time requests waited for a thread */
+        uint32_t maxWaitMs;     /**< Longest time a request waited for a thread */
+    };
+
+    /**
+     * Get statistics for the JoinSession or AttachSession request queue.
+     *
+     * @param isJoin      true for JoinSession requests, false for AttachSession requests.
+     * @param[out] stats  Returns the statistics.
+     */
+    void GetJoinSessionStats(bool isJoin, JoinSessionStats& stats);
+
   private:
     Bus& bus;                             /**< The bus */
     DaemonRouter& router;                 /**< The router */
@@ -477,6 +517,7 @@ class AllJoynObj : public BusObject, public NameListener, public TransportListen
     const InterfaceDescription::Member* lostAdvNameSignal; /**< org.alljoyn.Bus.LostAdvertisdName signal */
     const InterfaceDescription::Member* sessionLostSignal; /**< org.alljoyn.Bus.SessionLost signal */
     const InterfaceDescription::Member* mpSessionChangedSignal;  /**< org.alljoyn.Bus.MPSessionChanged signal */
+    const InterfaceDescription::Member* sessionlessCatchupCompleteSignal;  /**< org.alljoyn.Bus.SessionlessCatchupComplete signal */
     const InterfaceDescription::Member* mpSessionJoinedSignal;  /**< org.alljoyn.Bus.JoinSession signal */
 
     /** Map of open connectSpecs to local endpoint name(s) that require the connection. */
@@ -574,13 +615,17 @@ class AllJoynObj : public BusObject, public NameListener, public TransportListen
      */
     void AlarmTriggered(const qcc::Alarm& alarm, QStatus reason);
 
-    /** JoinSessionThread handles a JoinSession request from a local client on a separate thread */
+    /**
+     * JoinSessionThread handles JoinSession requests from local clients or AttachSession requests
+     * from remote daemons on a separate thread. It handles queued requests until there are none it
+     * can handle and then exits.
+     */
     class JoinSessionThread : public qcc::Thread, public qcc::ThreadListener {
       public:
-        JoinSessionThread(AllJoynObj& ajObj, const Message& msg, bool isJoin) :
+        JoinSessionThread(AllJoynObj& ajObj, bool isJoin) :
             qcc::Thread(qcc::String("JoinS-") + qcc::U32ToString(qcc::IncrementAndFetch(&jstCount))),
             ajObj(ajObj),
-            msg(msg),
+            msg(ajObj.bus),
             isJoin(isJoin) { }
 
         void ThreadExit(Thread* thread);
@@ -598,10 +643,74 @@ class AllJoynObj : public BusObject, public NameListener, public TransportListen
         bool isJoin;
     };
 
-    std::vector<JoinSessionThread*> joinSessionThreads;  /**< List of outstanding join session requests */
-    qcc::Mutex joinSessionThreadsLock;                   /**< Lock that protects joinSessionThreads */
+    /** A JoinSession or AttachSession request waiting for a JoinSessionThread */
+    struct JoinSessionRequest {
+        JoinSessionRequest(const Message& msg, uint64_t queued) : msg(msg), queued(queued) { }
+        Message msg;
+        uint64_t queued;        /**< Time the request was queued */
+    };
+
+    /**
+     * Queue of requests handled in order by a bounded number of JoinSessionThreads.
+     */
+    struct JoinSessionPool {
+        JoinSessionPool() : threads(0), maxThreads(MAX_JOIN_SESSION_THREADS_DEFAULT), peakThreads(0), maxQueued(0), handled(0), totalWaitMs(0), maxWaitMs(0) { }
+
+        /**
+         * Take the oldest queued request.
+         *
+         * @param[out] msg   Returns the request message.
+         * @param now        The current time.
+         *
+         * @return  true if a request was taken.
+         */
+        bool Next(Message& msg, uint64_t now);
+
+        std::deque<JoinSessionRequest> queue;   /**< Requests waiting for a thread */
+        size_t threads;                         /**< Number of threads handling requests */
+        size_t maxThreads;                      /**< Maximum number of threads handling requests */
+        size_t peakThreads;                     /**< Most threads handling requests at once */
+        size_t maxQueued;                       /**< Most requests waiting for a thread at once */
+        uint32_t handled;                       /**< Number of requests taken by a thread */
+        uint64_t totalWaitMs;                   /**< Total time requests waited for a thread */
+        uint32_t maxWaitMs;                     /**< Longest time a request waited for a thread */
+    };
+
+    /**
+     * Queue a JoinSession or AttachSession request and start a thread to handle it if needed.
+     *
+     * @param msg     The request.
+     * @param isJoin  true for a JoinSession request, false for an AttachSession request.
+     */
+    void QueueJoinSessionRequest(Message& msg, bool isJoin);
+
+#ifndef NDEBUG
+    /**
+     * Reports the JoinSession and AttachSession request queue statistics as the JoinSessionStats
+     * and AttachSessionStats properties of org.alljoyn.Bus.Debug.Session.
+     */
+    class JoinSessionDebug : public debug::AllJoynDebugObjAddon, public debug::AllJoynDebugObj::Properties {
+      public:
+        JoinSessionDebug(AllJoynObj& ajObj) : ajObj(ajObj) { }
+
+        QStatus Get(const char* propName, MsgArg& val) const;
+
+        void GetProperyInfo(const Info*& info, size_t& infoSize);
+
+      private:
+        AllJoynObj& ajObj;
+    };
+#endif
+
+    JoinSessionPool joinPool;                            /**< JoinSession requests */
+    JoinSessionPool attachPool;                          /**< AttachSession requests */
+    std::vector<JoinSessionThread*> joinSessionThreads;  /**< List of JoinSessionThreads */
+    qcc::Mutex joinSessionThreadsLock;                   /**< Lock that protects joinSessionThreads and the pools */
     bool isStopping;                                     /**< True while waiting for threads to exit */
     BusController* busController;                        /**< BusController that created this BusObject */
+#ifndef NDEBUG
+    JoinSessionDebug joinSessionDebug;                   /**< Debug interface reporting the pool statistics */
+#endif
 
     /**
      * Acquire AllJoynObj locks.
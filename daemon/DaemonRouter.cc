@@ -48,7 +48,7 @@ using namespace qcc;
 namespace ajn {
 
 
-DaemonRouter::DaemonRouter() : ruleTable(), nameTable(), busController(NULL)
+DaemonRouter::DaemonRouter() : ruleTable(), nameTable(), busController(NULL), routeGeneration(0)
 {
 }
 
@@ -110,13 +110,27 @@ QStatus DaemonRouter::PushMessage(Message& msg, BusEndpoint& origSender)
      * updated before queuing the message on a remote endpoint.
      */
     if (origSender == localEndpoint) {
-        localEndpoint->UpdateSerialNumber(msg);
+        status = localEndpoint->UpdateSerialNumber(msg);
+        if (status != ER_OK) {
+            return status;
+        }
     }
 
     bool destinationEmpty = destination[0] == '\0';
     if (!destinationEmpty) {
-        nameTable.Lock();
-        BusEndpoint destEndpoint = nameTable.FindEndpoint(destination);
+        /*
+         * Senders mostly talk to the same few destinations so try the sender's route cache before
+         * looking up the destination. Looking up the destination does not lock the name table.
+         */
+        uint32_t generation = GetRouteGeneration();
+        BusEndpoint destEndpoint;
+        if (!sender->GetCachedRoute(destination, generation, destEndpoint)) {
+            qcc::String destName(destination);
+            destEndpoint = nameTable.FindEndpoint(destName);
+            if (destEndpoint->IsValid()) {
+                sender->CacheRoute(destName, generation, destEndpoint);
+            }
+        }
         if (destEndpoint->IsValid()) {
             /* If this message is coming from a bus-to-bus ep, make sure the receiver is willing to receive it */
             if (!((sender->GetEndpointType() == ENDPOINT_TYPE_BUS2BUS) && !destEndpoint->AllowRemoteMessages())) {
@@ -134,9 +148,7 @@ QStatus DaemonRouter::PushMessage(Message& msg, BusEndpoint& origSender)
                     BusEndpoint busEndpoint = BusEndpoint::cast(localEndpoint);
                     PushMessage(msg, busEndpoint);
                 } else {
-                    nameTable.Unlock();
                     status = SendThroughEndpoint(msg, destEndpoint, sessionId);
-                    nameTable.Lock();
                 }
             } else {
                 QCC_DbgPrintf(("Blocking message from %s to %s (serial=%d) because receiver does not allow remote messages",
@@ -155,9 +167,7 @@ QStatus DaemonRouter::PushMessage(Message& msg, BusEndpoint& origSender)
             if ((ER_OK != status) && (ER_BUS_ENDPOINT_CLOSING != status)) {
                 QCC_LogError(status, ("BusEndpoint::PushMessage failed"));
             }
-            nameTable.Unlock();
         } else {
-            nameTable.Unlock();
             if ((msg->GetFlags() & ALLJOYN_FLAG_AUTO_START) &&
                 (sender->GetEndpointType() != ENDPOINT_TYPE_BUS2BUS) &&
                 (sender->GetEndpointType() != ENDPOINT_TYPE_NULL)) {
@@ -185,32 +195,20 @@ QStatus DaemonRouter::PushMessage(Message& msg, BusEndpoint& origSender)
          * The message has an empty destination field and no session is specified so this is a
          * regular broadcast message.
          */
-        nameTable.Lock();
-        ruleTable.Lock();
-        RuleIterator it = ruleTable.Begin();
-        while (it != ruleTable.End()) {
-            if (it->second.IsMatch(msg)) {
-                BusEndpoint dest = it->first;
-                QCC_DbgPrintf(("Routing %s (%d) to %s", msg->Description().c_str(), msg->GetCallSerial(), dest->GetUniqueName().c_str()));
-                /*
-                 * If the message originated locally or the destination allows remote messages
-                 * forward the message, otherwise silently ignore it.
-                 */
-                if (!((sender->GetEndpointType() == ENDPOINT_TYPE_BUS2BUS) && !dest->AllowRemoteMessages())) {
-                    ruleTable.Unlock();
-                    nameTable.Unlock();
-                    QStatus tStatus = SendThroughEndpoint(msg, dest, sessionId);
-                    status = (status == ER_OK) ? tStatus : status;
-                    nameTable.Lock();
-                    ruleTable.Lock();
-                }
-                it = ruleTable.AdvanceToNextEndpoint(dest);
-            } else {
-                ++it;
+        set<BusEndpoint> matches;
+        ruleTable.GetMatchingEndpoints(msg, matches);
+        for (set<BusEndpoint>::iterator it = matches.begin(); it != matches.end(); ++it) {
+            BusEndpoint dest = *it;
+            QCC_DbgPrintf(("Routing %s (%d) to %s", msg->Description().c_str(), msg->GetCallSerial(), dest->GetUniqueName().c_str()));
+            /*
+             * If the message originated locally or the destination allows remote messages
+             * forward the message, otherwise silently ignore it.
+             */
+            if (!((sender->GetEndpointType() == ENDPOINT_TYPE_BUS2BUS) && !dest->AllowRemoteMessages())) {
+                QStatus tStatus = SendThroughEndpoint(msg, dest, sessionId);
+                status = (status == ER_OK) ? tStatus : status;
             }
         }
-        ruleTable.Unlock();
-        nameTable.Unlock();
 
         if (msg->IsSessionless()) {
             /* Give "locally generated" sessionless message to SessionlessObj */
@@ -235,13 +233,13 @@ QStatus DaemonRouter::PushMessage(Message& msg, BusEndpoint& origSender)
              * message header (0).
              */
             if ((sessionId == 0) && (::strcmp("DetachSession", msg->GetMemberName()) == 0) && (::strcmp(org::alljoyn::Daemon::InterfaceName, msg->GetInterface()) == 0)) {
-                /* Clone the message since this message is unmarshalled by the LocalEndpoint too
-                 * and the process of unmarshalling is not thread-safe.
+                /* This message is unmarshalled by the LocalEndpoint too and the process of
+                 * unmarshalling is not thread-safe so peek at the session id in the body instead.
                  */
-                Message clone = Message(msg, true);
-                QStatus status = clone->UnmarshalArgs("us");
+                MsgArg arg;
+                QStatus status = (::strcmp("us", msg->GetSignature()) == 0) ? msg->PeekArg(0, arg) : ER_BUS_SIGNATURE_MISMATCH;
                 if (status == ER_OK) {
-                    sessionId = clone->GetArg(0)->v_uint32;
+                    sessionId = arg.v_uint32;
                 } else {
                     QCC_LogError(status, ("Failed to unmarshal args for DetachSession message"));
                 }
@@ -326,12 +324,9 @@ BusEndpoint DaemonRouter::FindEndpoint(const qcc::String& busName)
     BusEndpoint ep = nameTable.FindEndpoint(busName);
     if (!ep->IsValid()) {
         m_b2bEndpointsLock.Lock(MUTEX_CONTEXT);
-        for (set<RemoteEndpoint>::const_iterator it = m_b2bEndpoints.begin(); it != m_b2bEndpoints.end(); ++it) {
-            if ((*it)->GetUniqueName() == busName) {
-                RemoteEndpoint rep = *it;
-                ep = BusEndpoint::cast(rep);
-                break;
-            }
+        map<qcc::String, RemoteEndpoint>::iterator it = m_b2bNames.find(busName);
+        if (it != m_b2bNames.end()) {
+            ep = BusEndpoint::cast(it->second);
         }
         m_b2bEndpointsLock.Unlock(MUTEX_CONTEXT);
     }
@@ -378,6 +373,7 @@ QStatus DaemonRouter::RegisterEndpoint(BusEndpoint& endpoint)
         /* Add to list of bus-to-bus endpoints */
         m_b2bEndpointsLock.Lock(MUTEX_CONTEXT);
         m_b2bEndpoints.insert(busToBusEndpoint);
+        m_b2bNames[busToBusEndpoint->GetUniqueName()] = busToBusEndpoint;
         m_b2bEndpointsLock.Unlock(MUTEX_CONTEXT);
     } else {
         /* Bus-to-client endpoints appear directly on the bus */
@@ -409,14 +405,10 @@ void DaemonRouter::UnregisterEndpoint(const qcc::String& epName, EndpointType ep
 
         /* Remove the bus2bus endpoint from the list */
         m_b2bEndpointsLock.Lock(MUTEX_CONTEXT);
-        set<RemoteEndpoint>::iterator it = m_b2bEndpoints.begin();
-        while (it != m_b2bEndpoints.end()) {
-            RemoteEndpoint rep = *it;
-            if (rep == busToBusEndpoint) {
-                m_b2bEndpoints.erase(it);
-                break;
-            }
-            ++it;
+        m_b2bEndpoints.erase(busToBusEndpoint);
+        map<qcc::String, RemoteEndpoint>::iterator it = m_b2bNames.find(busToBusEndpoint->GetUniqueName());
+        if ((it != m_b2bNames.end()) && (it->second == busToBusEndpoint)) {
+            m_b2bNames.erase(it);
         }
         m_b2bEndpointsLock.Unlock(MUTEX_CONTEXT);
 
@@ -439,6 +431,14 @@ void DaemonRouter::UnregisterEndpoint(const qcc::String& epName, EndpointType ep
         RemoveAllRules(endpoint);
         PermissionMgr::CleanPermissionCache(endpoint);
     }
+    /*
+     * Invalidate cached routes to the endpoint and drop the endpoint's own cached routes, which
+     * may refer back to the endpoint itself.
+     */
+    IncrementAndFetch(&routeGeneration);
+    endpoint->ClearRouteCache();
+    ReleaseCachedRoutes(endpoint);
+
     /*
      * If the local endpoint is being deregistered this indicates the router is being shut down.
      */
@@ -447,6 +447,24 @@ void DaemonRouter::UnregisterEndpoint(const qcc::String& epName, EndpointType ep
     }
 }
 
+void DaemonRouter::ReleaseCachedRoutes(BusEndpoint& endpoint)
+{
+    /*
+     * The generation change already stops every sender using its cached routes to the endpoint,
+     * senders release stale routes when they next send a message.  Senders that have gone quiet
+     * would keep the endpoint alive with its socket and buffers so the senders that cached a
+     * route to the endpoint release them now.  Other cached routes are not touched.
+     */
+    set<qcc::String> cachers;
+    endpoint->TakeRouteCachers(cachers);
+    for (set<qcc::String>::iterator it = cachers.begin(); it != cachers.end(); ++it) {
+        BusEndpoint sender = FindEndpoint(*it);
+        if (sender->IsValid()) {
+            sender->ReleaseCachedRoutes(endpoint);
+        }
+    }
+}
+
 QStatus DaemonRouter::AddSessionRoute(SessionId id, BusEndpoint& srcEp, RemoteEndpoint* srcB2bEp, BusEndpoint& destEp, RemoteEndpoint& destB2bEp, SessionOpts* optsHint)
 {
     QCC_DbgTrace(("DaemonRouter::AddSessionRoute(%u, %s, %s, %s, %s, %s)", id, srcEp->GetUniqueName().c_str(), srcB2bEp ? (*srcB2bEp)->GetUniqueName().c_str() : "<none>", destEp->GetUniqueName().c_str(), destB2bEp->GetUniqueName().c_str(), optsHint ? "opts" : "NULL"));
@@ -501,6 +519,7 @@ QStatus DaemonRouter::AddSessionRoute(SessionId id, BusEndpoint& srcEp, RemoteEn
             sessionCastSet.insert(SessionCastEntry(id, destEp->GetUniqueName(), none, srcEp));
         }
         sessionCastSetLock.Unlock(MUTEX_CONTEXT);
+        IncrementAndFetch(&routeGeneration);
     }
     return status;
 }
@@ -541,6 +560,7 @@ QStatus DaemonRouter::RemoveSessionRoute(SessionId id, BusEndpoint& srcEp, BusEn
             sessionCastSet.erase(it2);
         }
         sessionCastSetLock.Unlock(MUTEX_CONTEXT);
+        IncrementAndFetch(&routeGeneration);
     }
     return status;
 }
@@ -564,6 +584,7 @@ void DaemonRouter::RemoveSessionRoutes(const char* src, SessionId id)
         }
     }
     sessionCastSetLock.Unlock(MUTEX_CONTEXT);
+    IncrementAndFetch(&routeGeneration);
 }
 
 }
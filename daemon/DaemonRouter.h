@@ -24,6 +24,9 @@
 
 #include <qcc/platform.h>
 
+#include <map>
+#include <set>
+
 #include <qcc/Thread.h>
 
 #include "Transport.h"
@@ -358,7 +361,24 @@ class DaemonRouter : public Router {
     BusController* busController;   /**< The bus controller used with this router */
 
     std::set<RemoteEndpoint> m_b2bEndpoints; /**< Collection of Bus-to-bus endpoints */
-    qcc::Mutex m_b2bEndpointsLock;           /**< Lock that protects m_b2bEndpoints */
+    std::map<qcc::String, RemoteEndpoint> m_b2bNames; /**< Bus-to-bus endpoints by unique name */
+    qcc::Mutex m_b2bEndpointsLock;           /**< Lock that protects m_b2bEndpoints and m_b2bNames */
+
+    volatile int32_t routeGeneration;        /**< Incremented when endpoints or session routes are removed or added */
+
+    /**
+     * Get the generation the destinations cached by the senders' route caches must match. This
+     * changes whenever the name table routes or the router's endpoints and session routes change.
+     */
+    uint32_t GetRouteGeneration() const { return nameTable.GetRouteGeneration() + routeGeneration; }
+
+    /**
+     * Release the routes to an endpoint that is going away from the route caches of the
+     * endpoints that cached them.
+     *
+     * @param endpoint   The endpoint that is going away.
+     */
+    void ReleaseCachedRoutes(BusEndpoint& endpoint);
 
     /** Session multicast destination map */
     struct SessionCastEntry {
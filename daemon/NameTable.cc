@@ -24,11 +24,13 @@
 #include <qcc/platform.h>
 
 #include <assert.h>
+#include <algorithm>
 
 #include <qcc/Debug.h>
 #include <qcc/Logger.h>
 #include <qcc/String.h>
 #include <qcc/StringUtil.h>
+#include <qcc/atomic.h>
 
 #include "NameTable.h"
 #include "VirtualEndpoint.h"
@@ -64,6 +66,7 @@ void NameTable::AddUniqueName(BusEndpoint& endpoint)
     QCC_DbgPrintf(("Add unique name %s", uniqueName.c_str()));
     lock.Lock(MUTEX_CONTEXT);
     uniqueNames[uniqueName] = endpoint;
+    UpdateRoute(uniqueName);
     lock.Unlock(MUTEX_CONTEXT);
 
     /* Notify listeners */
@@ -124,6 +127,14 @@ void NameTable::RemoveUniqueName(const qcc::String& uniqueName)
         if (it != uniqueNames.end()) {
             uniqueNames.erase(it);
             QCC_DbgPrintf(("Removed ep=%s from name table", uniqueName.c_str()));
+            /* Aliases that could not be released no longer route to the endpoint */
+            vector<qcc::String> changed(1, uniqueName);
+            for (ait = aliasNames.begin(); ait != aliasNames.end(); ++ait) {
+                if (ait->second.front().endpointName == uniqueName) {
+                    changed.push_back(ait->first);
+                }
+            }
+            UpdateRoutes(changed);
         }
 
         lock.Unlock(MUTEX_CONTEXT);
@@ -187,6 +198,9 @@ QStatus NameTable::AddAlias(const qcc::String& aliasName,
                 origOwner = &vit->second->GetUniqueName();
             }
         }
+        if (newOwner) {
+            UpdateRoute(aliasName);
+        }
         lock.Unlock(MUTEX_CONTEXT);
 
         if (listener) {
@@ -227,7 +241,7 @@ void NameTable::RemoveAlias(const qcc::String& aliasName,
             /* Remove primary */
             if (queue.size() > 1) {
                 queue.pop_front();
-                BusEndpoint ep = FindEndpoint(queue[0].endpointName);
+                BusEndpoint ep = ResolveEndpoint(queue[0].endpointName);
                 if (ep->IsValid()) {
                     newOwner = queue[0].endpointName;
                 }
@@ -240,6 +254,7 @@ void NameTable::RemoveAlias(const qcc::String& aliasName,
                 }
                 aliasNames.erase(it);
             }
+            UpdateRoute(aliasNameCopy);
             oldOwner = ownerName;
             disposition = DBUS_RELEASE_NAME_REPLY_RELEASED;
         } else {
@@ -261,10 +276,80 @@ void NameTable::RemoveAlias(const qcc::String& aliasName,
 }
 
 BusEndpoint NameTable::FindEndpoint(const qcc::String& busName) const
+{
+    BusEndpoint ep;
+    CopyOnWrite<RouteMap>::Reader routeMap(GetRoutes(busName));
+    RouteMap::const_iterator it = routeMap->find(busName);
+    if (it != routeMap->end()) {
+        ep = it->second;
+    }
+    return ep;
+}
+
+void NameTable::ApplyRoute(CopyOnWrite<RouteMap>& shard, RouteMap*& routeMap, const qcc::String& busName)
+{
+    BusEndpoint ep = ResolveEndpoint(busName);
+    const RouteMap& current = routeMap ? *routeMap : shard.Current();
+    RouteMap::const_iterator it = current.find(busName);
+    bool routed = (it != current.end());
+    if (ep->IsValid() ? (!routed || (it->second != ep)) : routed) {
+        if (!routeMap) {
+            routeMap = &shard.BeginUpdate();
+        }
+        if (ep->IsValid()) {
+            (*routeMap)[busName] = ep;
+        } else {
+            routeMap->erase(busName);
+        }
+    }
+}
+
+void NameTable::PublishRoutes(CopyOnWrite<RouteMap>& shard)
+{
+    shard.Publish();
+    /* Don't keep endpoints that have gone away alive in old copies of the shard */
+    shard.Trim();
+    IncrementAndFetch(&routeGeneration);
+}
+
+void NameTable::UpdateRoute(const qcc::String& busName)
+{
+    CopyOnWrite<RouteMap>& shard = GetRoutes(busName);
+    RouteMap* routeMap = NULL;
+    ApplyRoute(shard, routeMap, busName);
+    if (routeMap) {
+        PublishRoutes(shard);
+    }
+}
+
+void NameTable::UpdateRoutes(const std::vector<qcc::String>& busNames)
+{
+    /* Sort the names by shard so each shard is copied and published once */
+    vector<pair<size_t, size_t> > byShard;
+    byShard.reserve(busNames.size());
+    for (size_t i = 0; i < busNames.size(); ++i) {
+        byShard.push_back(pair<size_t, size_t>(GetShard(busNames[i]), i));
+    }
+    sort(byShard.begin(), byShard.end());
+    size_t i = 0;
+    while (i < byShard.size()) {
+        size_t shardIndex = byShard[i].first;
+        CopyOnWrite<RouteMap>& shard = routes[shardIndex];
+        RouteMap* routeMap = NULL;
+        while ((i < byShard.size()) && (byShard[i].first == shardIndex)) {
+            ApplyRoute(shard, routeMap, busNames[byShard[i].second]);
+            ++i;
+        }
+        if (routeMap) {
+            PublishRoutes(shard);
+        }
+    }
+}
+
+BusEndpoint NameTable::ResolveEndpoint(const qcc::String& busName) const
 {
     BusEndpoint ep;
 
-    lock.Lock(MUTEX_CONTEXT);
     if (busName[0] == ':') {
         std::tr1::unordered_map<qcc::String, BusEndpoint, Hash, Equal>::const_iterator it = uniqueNames.find(busName);
         if (it != uniqueNames.end()) {
@@ -274,7 +359,7 @@ BusEndpoint NameTable::FindEndpoint(const qcc::String& busName) const
         std::tr1::unordered_map<qcc::String, deque<NameQueueEntry>, Hash, Equal>::const_iterator it = aliasNames.find(busName);
         if (it != aliasNames.end()) {
             assert(!it->second.empty());
-            ep = FindEndpoint(it->second[0].endpointName);
+            ep = ResolveEndpoint(it->second[0].endpointName);
         }
         /* Fallback to virtual (remote) aliases if a suitable local one cannot be found */
         if (!ep->IsValid()) {
@@ -285,7 +370,6 @@ BusEndpoint NameTable::FindEndpoint(const qcc::String& busName) const
             }
         }
     }
-    lock.Unlock(MUTEX_CONTEXT);
     return ep;
 }
 
@@ -320,7 +404,7 @@ void NameTable::GetUniqueNamesAndAliases(vector<pair<qcc::String, vector<qcc::St
     std::tr1::unordered_map<qcc::String, deque<NameQueueEntry>, Hash, Equal>::const_iterator ait = aliasNames.begin();
     while (ait != aliasNames.end()) {
         if (!ait->second.empty()) {
-            BusEndpoint ep = FindEndpoint(ait->second.front().endpointName);
+            BusEndpoint ep = ResolveEndpoint(ait->second.front().endpointName);
             if (ep->IsValid()) {
                 epMap.insert(pair<BusEndpoint, qcc::String>(ep, ait->first));
             }
@@ -380,11 +464,13 @@ void NameTable::GetQueuedNames(const qcc::String& busName, std::vector<qcc::Stri
 void NameTable::RemoveVirtualAliases(const qcc::String& epName)
 {
     lock.Lock(MUTEX_CONTEXT);
-    BusEndpoint tempEp = FindEndpoint(epName);
+    BusEndpoint tempEp = ResolveEndpoint(epName);
     VirtualEndpoint ep = VirtualEndpoint::cast(tempEp);
 
     QCC_DbgTrace(("NameTable::RemoveVirtualAliases(%s)", ep->IsValid() ? ep->GetUniqueName().c_str() : "<none>"));
 
+    vector<qcc::String> removed;
+    vector<qcc::String> released;
     if (ep->IsValid()) {
         map<qcc::StringMapKey, VirtualEndpoint>::iterator vit = virtualAliasNames.begin();
         while (vit != virtualAliasNames.end()) {
@@ -392,17 +478,21 @@ void NameTable::RemoveVirtualAliases(const qcc::String& epName)
                 String alias = vit->first.c_str();
                 virtualAliasNames.erase(vit++);
                 if (aliasNames.find(alias) == aliasNames.end()) {
-                    lock.Unlock(MUTEX_CONTEXT);
-                    CallListeners(alias, &epName, NULL);
-                    lock.Lock(MUTEX_CONTEXT);
-                    vit = virtualAliasNames.upper_bound(alias);
+                    released.push_back(alias);
                 }
+                removed.push_back(alias);
             } else {
                 ++vit;
             }
         }
+        UpdateRoutes(removed);
     }
     lock.Unlock(MUTEX_CONTEXT);
+
+    /* Notify listeners of the names that no longer have an owner */
+    for (size_t i = 0; i < released.size(); ++i) {
+        CallListeners(released[i], &epName, NULL);
+    }
 }
 
 bool NameTable::SetVirtualAlias(const qcc::String& alias,
@@ -447,6 +537,7 @@ bool NameTable::SetVirtualAlias(const qcc::String& alias,
         madeChange = true;
         virtualAliasNames.erase(StringMapKey(alias));
     }
+    UpdateRoute(alias);
 
     String oldName = oldOwner->IsValid() ? oldOwner->GetUniqueName() : "";
     String newName = newOwner ? (*newOwner)->GetUniqueName() : "";
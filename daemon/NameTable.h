@@ -36,6 +36,7 @@
 #include <alljoyn/Status.h>
 
 #include "BusEndpoint.h"
+#include "CopyOnWrite.h"
 #include "VirtualEndpoint.h"
 
 #include <qcc/STLContainer.h>
@@ -67,7 +68,7 @@ class NameTable {
     /**
      * Constructor
      */
-    NameTable() : uniqueId(0), uniquePrefix(":1.") { }
+    NameTable() : uniqueId(0), uniquePrefix(":1."), routeGeneration(0) { }
 
     /**
      * Set the GUID of the bus.
@@ -171,7 +172,10 @@ class NameTable {
     void RemoveVirtualAliases(const qcc::String& uniqueName);
 
     /**
-     * Find an endpoint for a given unique or alias bus name.
+     * Find an endpoint for a given unique or alias bus name. This does not take the name table
+     * lock so it can be called for every message that is routed. Bus names are looked up as
+     * strings rather than interned handles because the router gets the destination as a string
+     * from the message header, so it takes one string lookup either way.
      *
      * @param busName   Name of bus.
      * @return  Returns the endpoint if it was found or an invalid endpoint if not found
@@ -200,6 +204,14 @@ class NameTable {
      */
     void GetQueuedNames(const qcc::String& busName, std::vector<qcc::String>& names);
 
+    /**
+     * Get the route generation. The generation changes after the endpoint returned by
+     * FindEndpoint() changes for any bus name.
+     *
+     * @return  The route generation.
+     */
+    uint32_t GetRouteGeneration() const { return routeGeneration; }
+
     /**
      * Lock table.
      */
@@ -241,6 +253,74 @@ class NameTable {
     std::set<ProtectedNameListener> listeners;                         /**< Listeners regsitered with name table */
     std::map<qcc::StringMapKey, VirtualEndpoint> virtualAliasNames;    /**< map of virtual aliases to virtual endpts */
 
+    /**
+     * Type definition for a map from bus names to the endpoints messages for the name are routed to.
+     */
+    typedef std::tr1::unordered_map<qcc::String, BusEndpoint, Hash, Equal> RouteMap;
+
+    /**
+     * Number of route shards, a power of 2. A name change copies one shard so more shards make
+     * name changes cheaper.
+     */
+    static const size_t NUM_ROUTE_SHARDS = 64;
+
+    /**
+     * The endpoint for each bus name as resolved from the tables above. This is split into shards
+     * that are copied when a name changes so FindEndpoint() does not need to take the lock.
+     */
+    mutable CopyOnWrite<RouteMap> routes[NUM_ROUTE_SHARDS];
+
+    volatile int32_t routeGeneration;   /**< Incremented after a route is changed */
+
+    static size_t GetShard(const qcc::String& busName) {
+        return (Hash()(busName) >> 4) & (NUM_ROUTE_SHARDS - 1);
+    }
+
+    CopyOnWrite<RouteMap>& GetRoutes(const qcc::String& busName) const {
+        return routes[GetShard(busName)];
+    }
+
+    /**
+     * Resolve the endpoint for a bus name from the name tables. Must be called with the lock held.
+     *
+     * @param busName   Name of bus.
+     * @return  Returns the endpoint if it was found or an invalid endpoint if not found
+     */
+    BusEndpoint ResolveEndpoint(const qcc::String& busName) const;
+
+    /**
+     * Update the route for a bus name after the name tables have changed. Must be called with the
+     * lock held.
+     *
+     * @param busName   Name of bus.
+     */
+    void UpdateRoute(const qcc::String& busName);
+
+    /**
+     * Update the routes for several bus names after the name tables have changed. Each shard is
+     * copied and published at most once. Must be called with the lock held.
+     *
+     * @param busNames   Names of buses.
+     */
+    void UpdateRoutes(const std::vector<qcc::String>& busNames);
+
+    /**
+     * Apply the route for a bus name to a shard. The shard is copied by the first route that
+     * changes it. Must be called with the lock held.
+     *
+     * @param shard      The shard holding the route for the bus name.
+     * @param routeMap   The copy of the shard being updated or NULL if it has not been copied yet.
+     * @param busName    Name of bus.
+     */
+    void ApplyRoute(CopyOnWrite<RouteMap>& shard, RouteMap*& routeMap, const qcc::String& busName);
+
+    /**
+     * Publish a shard updated by ApplyRoute(). Must be called with the lock held.
+     *
+     * @param shard      The shard.
+     */
+    void PublishRoutes(CopyOnWrite<RouteMap>& shard);
+
     /**
      * Helper used to call the listners
      *
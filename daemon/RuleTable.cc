@@ -145,7 +145,8 @@ QStatus RuleTable::AddRule(BusEndpoint& endpoint, const Rule& rule)
 {
     QCC_DbgPrintf(("AddRule for endpoint %s\n  %s", endpoint->GetUniqueName().c_str(), rule.ToString().c_str()));
     Lock();
-    rules.insert(std::pair<BusEndpoint, Rule>(endpoint, rule));
+    RuleIterator it = rules.insert(std::pair<BusEndpoint, Rule>(endpoint, rule));
+    IndexRule(it);
     Unlock();
     return ER_OK;
 }
@@ -158,6 +159,7 @@ QStatus RuleTable::RemoveRule(BusEndpoint& endpoint, Rule& rule)
     std::pair<RuleIterator, RuleIterator> range = rules.equal_range(endpoint);
     while (range.first != range.second) {
         if (range.first->second == rule) {
+            UnindexRule(range.first);
             rules.erase(range.first);
             break;
         }
@@ -172,10 +174,148 @@ QStatus RuleTable::RemoveAllRules(BusEndpoint& endpoint)
     Lock();
     std::pair<RuleIterator, RuleIterator> range = rules.equal_range(endpoint);
     if (range.first != rules.end()) {
+        for (RuleIterator it = range.first; it != range.second; ++it) {
+            UnindexRule(it);
+        }
         rules.erase(range.first, range.second);
     }
     Unlock();
     return ER_OK;
 }
 
+void RuleTable::GetMatchingEndpoints(const Message& msg, std::set<BusEndpoint>& matches)
+{
+    Lock();
+    uint32_t ifaceId = Lookup(msg->GetInterface());
+    uint32_t memberId = Lookup(msg->GetMemberName());
+    uint32_t pathId = Lookup(msg->GetObjectPath());
+
+    /*
+     * A rule is indexed under exactly one key so each of the buckets below holds a
+     * disjoint set of rules. Buckets for strings that no rule references cannot exist.
+     */
+    if ((ifaceId != UNKNOWN_ID) && (memberId != UNKNOWN_ID)) {
+        std::tr1::unordered_map<uint64_t, RuleBucket>::const_iterator bit = memberIndex.find(MemberKey(ifaceId, memberId));
+        if (bit != memberIndex.end()) {
+            MatchBucket(bit->second, msg, matches);
+        }
+    }
+    if ((ifaceId != UNKNOWN_ID) && (ifaceId != EMPTY_ID) && (memberId != EMPTY_ID)) {
+        std::tr1::unordered_map<uint64_t, RuleBucket>::const_iterator bit = memberIndex.find(MemberKey(ifaceId, EMPTY_ID));
+        if (bit != memberIndex.end()) {
+            MatchBucket(bit->second, msg, matches);
+        }
+    }
+    if ((memberId != UNKNOWN_ID) && (memberId != EMPTY_ID) && (ifaceId != EMPTY_ID)) {
+        std::tr1::unordered_map<uint64_t, RuleBucket>::const_iterator bit = memberIndex.find(MemberKey(EMPTY_ID, memberId));
+        if (bit != memberIndex.end()) {
+            MatchBucket(bit->second, msg, matches);
+        }
+    }
+    if ((pathId != UNKNOWN_ID) && (pathId != EMPTY_ID)) {
+        std::tr1::unordered_map<uint32_t, RuleBucket>::const_iterator bit = pathIndex.find(pathId);
+        if (bit != pathIndex.end()) {
+            MatchBucket(bit->second, msg, matches);
+        }
+    }
+    MatchBucket(wildcardRules, msg, matches);
+    Unlock();
+}
+
+void RuleTable::MatchBucket(const RuleBucket& bucket, const Message& msg, std::set<BusEndpoint>& matches)
+{
+    for (RuleBucket::const_iterator it = bucket.begin(); it != bucket.end(); ++it) {
+        RuleIterator rit = *it;
+        /* An endpoint only needs to match one rule */
+        if ((matches.find(rit->first) == matches.end()) && rit->second.IsMatch(msg)) {
+            matches.insert(rit->first);
+        }
+    }
+}
+
+uint32_t RuleTable::Intern(const qcc::String& str)
+{
+    if (str.empty()) {
+        return EMPTY_ID;
+    }
+    InternEntry& entry = interned[StringMapKey(str)];
+    if (entry.refs++ == 0) {
+        entry.id = nextInternId++;
+        /* Skip over the reserved ids if the counter ever wraps */
+        if ((nextInternId == UNKNOWN_ID) || (nextInternId == EMPTY_ID)) {
+            nextInternId = EMPTY_ID + 1;
+        }
+    }
+    return entry.id;
+}
+
+void RuleTable::Release(const qcc::String& str)
+{
+    if (!str.empty()) {
+        std::tr1::unordered_map<StringMapKey, InternEntry, Hash, Equal>::iterator it = interned.find(StringMapKey(str.c_str()));
+        if ((it != interned.end()) && (--it->second.refs == 0)) {
+            interned.erase(it);
+        }
+    }
+}
+
+uint32_t RuleTable::Lookup(const char* str) const
+{
+    if (!str || (str[0] == '\0')) {
+        return EMPTY_ID;
+    }
+    std::tr1::unordered_map<StringMapKey, InternEntry, Hash, Equal>::const_iterator it = interned.find(StringMapKey(str));
+    return (it == interned.end()) ? UNKNOWN_ID : it->second.id;
+}
+
+void RuleTable::IndexRule(RuleIterator it)
+{
+    const Rule& rule = it->second;
+    if (!rule.iface.empty() || !rule.member.empty()) {
+        uint32_t ifaceId = Intern(rule.iface);
+        uint32_t memberId = Intern(rule.member);
+        memberIndex[MemberKey(ifaceId, memberId)].push_back(it);
+    } else if (!rule.path.empty()) {
+        pathIndex[Intern(rule.path)].push_back(it);
+    } else {
+        wildcardRules.push_back(it);
+    }
+}
+
+void RuleTable::UnindexRule(RuleIterator it)
+{
+    const Rule& rule = it->second;
+    RuleBucket* bucket = &wildcardRules;
+    std::tr1::unordered_map<uint64_t, RuleBucket>::iterator mit = memberIndex.end();
+    std::tr1::unordered_map<uint32_t, RuleBucket>::iterator pit = pathIndex.end();
+
+    if (!rule.iface.empty() || !rule.member.empty()) {
+        mit = memberIndex.find(MemberKey(Lookup(rule.iface.c_str()), Lookup(rule.member.c_str())));
+        bucket = (mit == memberIndex.end()) ? NULL : &mit->second;
+        Release(rule.iface);
+        Release(rule.member);
+    } else if (!rule.path.empty()) {
+        pit = pathIndex.find(Lookup(rule.path.c_str()));
+        bucket = (pit == pathIndex.end()) ? NULL : &pit->second;
+        Release(rule.path);
+    }
+    if (bucket) {
+        for (RuleBucket::iterator bit = bucket->begin(); bit != bucket->end(); ++bit) {
+            if (*bit == it) {
+                *bit = bucket->back();
+                bucket->pop_back();
+                break;
+            }
+        }
+        /* Drop empty buckets so the index does not grow with rule churn */
+        if (bucket->empty()) {
+            if (mit != memberIndex.end()) {
+                memberIndex.erase(mit);
+            } else if (pit != pathIndex.end()) {
+                pathIndex.erase(pit);
+            }
+        }
+    }
+}
+
 }
@@ -26,9 +26,13 @@
 
 #include <qcc/platform.h>
 
+#include <cstring>
 #include <map>
+#include <set>
+#include <vector>
 
 #include <qcc/String.h>
+#include <qcc/StringMapKey.h>
 #include <qcc/Mutex.h>
 
 #include <alljoyn/Message.h>
@@ -37,6 +41,8 @@
 
 #include <alljoyn/Status.h>
 
+#include <qcc/STLContainer.h>
+
 namespace ajn {
 
 /**
@@ -115,6 +121,11 @@ typedef std::multimap<BusEndpoint, Rule>::iterator RuleIterator;
 class RuleTable {
   public:
 
+    /**
+     * Constructor
+     */
+    RuleTable() : nextInternId(1) { }
+
     /**
      * Add a rule for an endpoint.
      *
@@ -202,9 +213,101 @@ class RuleTable {
         return ret;
     }
 
+    /**
+     * Find all endpoints that have at least one rule matching a message.
+     * Only the rules indexed under the message's interface, member and object path
+     * plus the rules that specify none of these are checked against the message.
+     * The rule table lock is obtained internally.
+     *
+     * @param msg       Message to match.
+     * @param matches   [OUT] Endpoints with one or more rules that match msg.
+     */
+    void GetMatchingEndpoints(const Message& msg, std::set<BusEndpoint>& matches);
+
   private:
+
+    /** Interned id used for empty (wildcard) rule fields */
+    static const uint32_t EMPTY_ID = 0;
+
+    /** Interned id returned for a string that is not referenced by any rule */
+    static const uint32_t UNKNOWN_ID = 0xFFFFFFFF;
+
+    /** Interned string table entry */
+    struct InternEntry {
+        uint32_t id;      /**< Interned id */
+        uint32_t refs;    /**< Number of indexed rules referencing the string */
+        InternEntry() : id(EMPTY_ID), refs(0) { }
+    };
+
+    struct Hash {
+        inline size_t operator()(const qcc::StringMapKey& k) const {
+            return qcc::hash_string(k.c_str());
+        }
+    };
+
+    struct Equal {
+        inline bool operator()(const qcc::StringMapKey& k1, const qcc::StringMapKey& k2) const {
+            return ::strcmp(k1.c_str(), k2.c_str()) == 0;
+        }
+    };
+
+    /** Bucket of rules that share an index key */
+    typedef std::vector<RuleIterator> RuleBucket;
+
+    /**
+     * Key for the interface/member index.
+     */
+    static uint64_t MemberKey(uint32_t ifaceId, uint32_t memberId) {
+        return (static_cast<uint64_t>(ifaceId) << 32) | memberId;
+    }
+
+    /**
+     * Intern a rule field, adding a reference to it.
+     *
+     * @param str   Rule field.
+     * @return  Interned id or EMPTY_ID if str is empty.
+     */
+    uint32_t Intern(const qcc::String& str);
+
+    /**
+     * Release a reference to an interned rule field.
+     *
+     * @param str   Rule field previously passed to Intern.
+     */
+    void Release(const qcc::String& str);
+
+    /**
+     * Get the interned id of a message field without interning it.
+     *
+     * @param str   Message field.
+     * @return  Interned id, EMPTY_ID if str is empty or UNKNOWN_ID if no rule references str.
+     */
+    uint32_t Lookup(const char* str) const;
+
+    /**
+     * Add a rule to the index.
+     */
+    void IndexRule(RuleIterator it);
+
+    /**
+     * Remove a rule from the index.
+     */
+    void UnindexRule(RuleIterator it);
+
+    /**
+     * Check the rules in a bucket against a message.
+     */
+    void MatchBucket(const RuleBucket& bucket, const Message& msg, std::set<BusEndpoint>& matches);
+
     qcc::Mutex lock;                            /**< Lock protecting rule table */
     std::multimap<BusEndpoint, Rule> rules;    /**< Rule table */
+
+    std::tr1::unordered_map<qcc::StringMapKey, InternEntry, Hash, Equal> interned;  /**< Interned rule fields */
+    uint32_t nextInternId;                                                         /**< Next interned id */
+
+    std::tr1::unordered_map<uint64_t, RuleBucket> memberIndex;   /**< Rules with an interface and/or member keyed by MemberKey */
+    std::tr1::unordered_map<uint32_t, RuleBucket> pathIndex;     /**< Rules with only an object path keyed by path id */
+    RuleBucket wildcardRules;                                    /**< Rules with no interface, member or path */
 };
 
 }
@@ -76,9 +76,13 @@ SessionlessObj::SessionlessObj(Bus& bus, BusController* busController) :
     requestRangeSignal(NULL),
     timer("sessionless"),
     messageMap(),
+    keyMap(),
+    serialMap(),
     ruleCountMap(),
     changeIdMap(),
     lock(),
+    workPending(false),
+    expiryAlarmTime(0),
     nextChangeId(0),
     lastAdvChangeId(-1),
     isDiscoveryStarted(false),
@@ -243,6 +247,7 @@ void SessionlessObj::AddRule(const qcc::String& epName, Rule& rule)
     QCC_DbgTrace(("SessionlessObj::AddRule(%s, ...)", epName.c_str()));
 
     if (rule.sessionless == Rule::SESSIONLESS_TRUE) {
+        vector<String> completed;
         lock.Lock();
         map<String, uint32_t>::iterator it = ruleCountMap.find(epName);
         if (it == ruleCountMap.end()) {
@@ -257,6 +262,9 @@ void SessionlessObj::AddRule(const qcc::String& epName, Rule& rule)
                 lock.Unlock();
                 RereceiveMessages(epName, "");
                 lock.Lock();
+            } else {
+                /* No sessionless signals have been received from remote daemons so there is nothing to catch up */
+                completed.push_back(epName);
             }
         } else {
             it->second++;
@@ -272,6 +280,8 @@ void SessionlessObj::AddRule(const qcc::String& epName, Rule& rule)
             }
         }
         lock.Unlock();
+
+        SendCatchupComplete(completed);
     }
 }
 
@@ -285,6 +295,7 @@ void SessionlessObj::RemoveRule(const qcc::String& epName, Rule& rule)
         if (it != ruleCountMap.end()) {
             if (--it->second == 0) {
                 ruleCountMap.erase(it);
+                catchupCountMap.erase(epName);
             }
         }
 
@@ -309,21 +320,77 @@ QStatus SessionlessObj::PushMessage(Message& msg)
         return ER_FAIL;
     }
 
-    /* Put the message in the map and kick the worker */
+    /* Put the message in the map replacing any earlier message with the same key and kick the worker */
     MessageMapKey key(msg->GetSender(), msg->GetInterface(), msg->GetMemberName(), msg->GetObjectPath());
     lock.Lock();
-    pair<uint32_t, Message> val(nextChangeId++, msg);
-    map<MessageMapKey, pair<uint32_t, Message> >::iterator it = messageMap.find(key);
-    if (it == messageMap.end()) {
-        messageMap.insert(pair<MessageMapKey, pair<uint32_t, Message> >(key, val));
-    } else {
-        it->second = val;
+    map<MessageMapKey, uint32_t>::iterator it = keyMap.find(key);
+    if (it != keyMap.end()) {
+        EraseMessage(messageMap.find(it->second));
+    }
+    StoreMessage(key, msg);
+    lock.Unlock();
+
+    return ScheduleWork();
+}
+
+void SessionlessObj::StoreMessage(const MessageMapKey& key, Message& msg)
+{
+    uint32_t changeId = nextChangeId++;
+    uint32_t tilExpire;
+    uint64_t expires = 0;
+    msg->IsExpired(&tilExpire);
+    if (tilExpire != ::numeric_limits<uint32_t>::max()) {
+        expires = GetTimestamp64() + tilExpire;
+        expiryQueue.push(ExpiryEntry(expires, changeId));
+    }
+    messageMap.insert(pair<uint32_t, StoredMessage>(changeId, StoredMessage(key, msg, expires)));
+    keyMap[key] = changeId;
+    serialMap[pair<uint32_t, String>(msg->GetCallSerial(), msg->GetSender())] = changeId;
+
+    /*
+     * Entries for messages that have been replaced or cancelled stay in the expiry queue until
+     * they reach the top so rebuild the queue if it gets much bigger than the map.
+     */
+    if (expiryQueue.size() > (2 * messageMap.size() + 64)) {
+        std::priority_queue<ExpiryEntry, std::vector<ExpiryEntry>, std::greater<ExpiryEntry> > queue;
+        for (map<uint32_t, StoredMessage>::const_iterator mit = messageMap.begin(); mit != messageMap.end(); ++mit) {
+            if (mit->second.expires) {
+                queue.push(ExpiryEntry(mit->second.expires, mit->first));
+            }
+        }
+        std::swap(expiryQueue, queue);
+    }
+}
+
+void SessionlessObj::EraseMessage(map<uint32_t, StoredMessage>::iterator it)
+{
+    keyMap.erase(it->second.key);
+    map<pair<uint32_t, String>, uint32_t>::iterator sit = serialMap.find(pair<uint32_t, String>(it->second.msg->GetCallSerial(), it->second.msg->GetSender()));
+    if ((sit != serialMap.end()) && (sit->second == it->first)) {
+        serialMap.erase(sit);
     }
+    messageMap.erase(it);
+}
+
+QStatus SessionlessObj::ScheduleWork()
+{
+    QStatus status = ER_OK;
+
+    lock.Lock();
+    bool schedule = !workPending;
+    workPending = true;
     lock.Unlock();
-    uint32_t zero = 0;
-    SessionlessObj* slObj = this;
-    QStatus status = timer.AddAlarm(Alarm(zero, slObj));
 
+    if (schedule) {
+        uint32_t zero = 0;
+        SessionlessObj* slObj = this;
+        status = timer.AddAlarm(Alarm(zero, slObj));
+        if (status != ER_OK) {
+            lock.Lock();
+            workPending = false;
+            lock.Unlock();
+        }
+    }
     return status;
 }
 
@@ -373,30 +440,30 @@ QStatus SessionlessObj::CancelMessage(const qcc::String& sender, uint32_t serial
     QCC_DbgTrace(("SessionlessObj::CancelMessage(%s, 0x%x)", sender.c_str(), serialNum));
 
     lock.Lock();
-    map<MessageMapKey, pair<uint32_t, Message> >::iterator it = messageMap.begin();
-    while (it != messageMap.end()) {
-        if (it->second.second->GetCallSerial() == serialNum) {
-            if (it->second.second->IsExpired()) {
-                messageMap.erase(it);
-                messageErased = true;
-            } else if (sender == it->second.second->GetSender()) {
-                messageMap.erase(it);
-                messageErased = true;
-                status = ER_OK;
-            } else {
-                status = ER_BUS_NOT_ALLOWED;
-            }
-            break;
+    /* Look for the sender's message with this serial number or else any sender's */
+    map<pair<uint32_t, String>, uint32_t>::iterator sit = serialMap.find(pair<uint32_t, String>(serialNum, sender));
+    if (sit == serialMap.end()) {
+        sit = serialMap.lower_bound(pair<uint32_t, String>(serialNum, String()));
+    }
+    if ((sit != serialMap.end()) && (sit->first.first == serialNum)) {
+        map<uint32_t, StoredMessage>::iterator it = messageMap.find(sit->second);
+        assert(it != messageMap.end());
+        if (it->second.msg->IsExpired()) {
+            EraseMessage(it);
+            messageErased = true;
+        } else if (sender == it->second.msg->GetSender()) {
+            EraseMessage(it);
+            messageErased = true;
+            status = ER_OK;
+        } else {
+            status = ER_BUS_NOT_ALLOWED;
         }
-        ++it;
     }
     lock.Unlock();
 
     /* Alert the advertiser worker */
     if (messageErased) {
-        uint32_t zero = 0;
-        SessionlessObj* slObj = this;
-        status = timer.AddAlarm(Alarm(zero, slObj));
+        status = ScheduleWork();
     }
 
     return status;
@@ -406,53 +473,45 @@ QStatus SessionlessObj::RereceiveMessages(const qcc::String& sender, const qcc::
 {
     QStatus status = ER_OK;
     QCC_DbgTrace(("SessionlessObj::RereceiveMessages(%s, %s)", sender.c_str(), guid.c_str()));
-    uint64_t now = GetTimestamp64();
-    const uint64_t timeoutValue = 18000;
+    vector<pair<String, TransportMask> > advNames;
 
+    /*
+     * Queue a catchup for each remote daemon. If a session with the remote daemon is already in
+     * progress the catchup is started when that session is done, otherwise start it now.
+     */
     lock.Lock();
-
+    uint32_t queued = 0;
     map<String, ChangeIdEntry>::iterator it = guid.empty() ? changeIdMap.begin() : changeIdMap.find(guid);
-    while ((status == ER_OK) && (it != changeIdMap.end())) {
-        String lastGuid = it->first;
-
-        /* Wait for inProgress to be false */
-        while ((it != changeIdMap.end()) && it->second.inProgress && (GetTimestamp64() < (now + timeoutValue))) {
-            lock.Unlock();
-            qcc::Sleep(5);
-            lock.Lock();
-            it = changeIdMap.lower_bound(lastGuid);
-            if (it != changeIdMap.end()) {
-                lastGuid = it->first;
-            }
-        }
-
-        /* Process this guid */
-        if (GetTimestamp64() >= (now + timeoutValue)) {
-            status = ER_TIMEOUT;
-        } else if (it != changeIdMap.end()) {
-            assert(!it->second.inProgress);
-
-            /* Add new catchup state */
-            uint32_t beginState = it->second.changeId - (numeric_limits<uint32_t>::max() >> 1);
-            it->second.catchupList.push(CatchupState(sender, it->first, beginState, 0));
-
-            /* Trigger an artificial FoundAdvertisedName to get the sessions rolling */
-            String advName = it->second.advName;
-            lock.Unlock();
-            HandleFoundAdvertisedName(advName.c_str(), it->second.transport, true);
-            lock.Lock();
-            it = changeIdMap.lower_bound(lastGuid);
+    while (it != changeIdMap.end()) {
+        /* The range to catch up is set when the catchup is started */
+        it->second.catchupList.push(CatchupState(sender, it->first, 0, 0));
+        ++queued;
+        if (!it->second.inProgress) {
+            advNames.push_back(pair<String, TransportMask>(it->second.advName, it->second.transport));
         }
 
         /* Continue with other guids if guid is empty. (empty means all) */
         if (!guid.empty()) {
             break;
-        } else if ((it != changeIdMap.end()) && (it->first == lastGuid)) {
-            ++it;
         }
+        ++it;
+    }
+    if (queued > 0) {
+        catchupCountMap[sender] += queued;
     }
     lock.Unlock();
 
+    /* There are no remote daemons to catch up with */
+    if (queued == 0) {
+        SendCatchupComplete(vector<String>(1, sender));
+    }
+
+    /* Trigger an artificial FoundAdvertisedName to get the sessions rolling */
+    for (size_t i = 0; i < advNames.size(); ++i) {
+        QStatus tStatus = HandleFoundAdvertisedName(advNames[i].first.c_str(), advNames[i].second, true);
+        status = (status == ER_OK) ? tStatus : status;
+    }
+
     return status;
 }
 
@@ -522,6 +581,7 @@ QStatus SessionlessObj::HandleFoundAdvertisedName(const char* name, TransportMas
     QCC_DbgPrintf(("Found sessionless adv: guid=%s, changeId=%d", guid.c_str(), changeId));
 
     /* Join session if we need signals from this advertiser and we aren't already getting them */
+    vector<String> completed;
     lock.Lock();
     map<String, ChangeIdEntry>::iterator it = changeIdMap.find(guid);
     bool updateChangeIdMap = (it == changeIdMap.end()) || IS_GREATER(uint32_t, changeId, it->second.changeId);
@@ -546,6 +606,10 @@ QStatus SessionlessObj::HandleFoundAdvertisedName(const char* name, TransportMas
             } else {
                 QCC_LogError(status, ("JoinSessionAsync failed"));
                 delete ctx;
+                /* Nothing is left to start the catchups queued for this remote daemon */
+                if (it != changeIdMap.end()) {
+                    AbandonCatchups(it->second, completed);
+                }
             }
         } else {
             /* Join already in progress so update advName */
@@ -556,6 +620,8 @@ QStatus SessionlessObj::HandleFoundAdvertisedName(const char* name, TransportMas
         }
     }
     lock.Unlock();
+
+    SendCatchupComplete(completed);
     return status;
 }
 
@@ -579,26 +645,66 @@ void SessionlessObj::SessionLostSignalHandler(const InterfaceDescription::Member
 
 void SessionlessObj::DoSessionLost(uint32_t sessionId)
 {
+    vector<String> completed;
+    String advName;
+    TransportMask transport = 0;
+    bool catchUp = false;
+
     /* Cleanup catchupMap */
     lock.Lock();
     map<uint32_t, CatchupState>::iterator it = catchupMap.find(sessionId);
     if (it != catchupMap.end()) {
         String guid = it->second.guid;
+        if (CatchupDone(it->second.sender)) {
+            completed.push_back(it->second.sender);
+        }
         catchupMap.erase(it);
         map<String, ChangeIdEntry>::iterator cit = changeIdMap.find(guid);
         if (cit != changeIdMap.end()) {
             /* Reset inProgress */
             cit->second.inProgress = false;
-            /* Retrigger FoundAdvName in case a real one occured during the catchup */
-            String advName = cit->second.advName;
-            TransportMask transport = cit->second.transport;
-            lock.Unlock();
-            HandleFoundAdvertisedName(advName.c_str(), transport, false);
-        } else {
-            lock.Unlock();
+            /*
+             * Retrigger FoundAdvName in case a real one occured during the catchup or to start the
+             * next catchup queued by RereceiveMessages.
+             */
+            advName = cit->second.advName;
+            transport = cit->second.transport;
+            catchUp = !cit->second.catchupList.empty();
         }
-    } else {
-        lock.Unlock();
+    }
+    lock.Unlock();
+
+    /* The range of this catchup has been routed to the client by the time its session is lost */
+    SendCatchupComplete(completed);
+    if (!advName.empty()) {
+        HandleFoundAdvertisedName(advName.c_str(), transport, catchUp);
+    }
+}
+
+bool SessionlessObj::CatchupDone(const qcc::String& sender)
+{
+    map<String, uint32_t>::iterator it = catchupCountMap.find(sender);
+    if ((it != catchupCountMap.end()) && (--it->second == 0)) {
+        catchupCountMap.erase(it);
+        return true;
+    }
+    return false;
+}
+
+void SessionlessObj::AbandonCatchups(ChangeIdEntry& entry, vector<String>& completed)
+{
+    while (!entry.catchupList.empty()) {
+        if (CatchupDone(entry.catchupList.front().sender)) {
+            completed.push_back(entry.catchupList.front().sender);
+        }
+        entry.catchupList.pop();
+    }
+}
+
+void SessionlessObj::SendCatchupComplete(const vector<String>& completed)
+{
+    for (size_t i = 0; i < completed.size(); ++i) {
+        busController->GetAllJoynObj().SendSessionlessCatchupComplete(completed[i].c_str());
     }
 }
 
@@ -640,49 +746,55 @@ void SessionlessObj::HandleRangeRequest(Message& msg, uint32_t fromChangeId, uin
     /* Enable concurrency since PushMessage could block */
     bus.EnableConcurrentCallbacks();
 
-    /* Send all messages in messageMap in range [fromChangeId, toChangeId) */
+    /*
+     * Send all messages in messageMap in range [fromChangeId, toChangeId). If the range wraps
+     * around send the messages from fromChangeId to the end of the map and then the messages from
+     * the start of the map up to toChangeId.
+     */
     lock.Lock();
-    map<MessageMapKey, pair<uint32_t, Message> >::iterator it = messageMap.begin();
-    uint32_t rangeLen = toChangeId - fromChangeId;
-    while (it != messageMap.end()) {
-        if (IN_WINDOW(uint32_t, fromChangeId, rangeLen, it->second.first)) {
-            MessageMapKey key = it->first;
-            if (it->second.second->IsExpired()) {
-                /* Remove expired message without sending */
-                messageMap.erase(++it);
-                messageErased = true;
-            } else {
-                /* Send message */
-                lock.Unlock();
-                router.LockNameTable();
-                BusEndpoint ep = router.FindEndpoint(msg->GetSender());
-                if (ep->IsValid()) {
-                    router.UnlockNameTable();
-                    if (ep->GetEndpointType() == ENDPOINT_TYPE_VIRTUAL) {
-                        status = VirtualEndpoint::cast(ep)->PushMessage(it->second.second, msg->GetSessionId());
-                    } else {
-                        status = ep->PushMessage(it->second.second);
-                    }
+    map<uint32_t, StoredMessage>::iterator it = messageMap.lower_bound(fromChangeId);
+    bool wrapped = false;
+    for (;;) {
+        if ((it == messageMap.end()) && !wrapped && (toChangeId < fromChangeId)) {
+            it = messageMap.begin();
+            wrapped = true;
+        }
+        if ((it == messageMap.end()) || ((wrapped || (fromChangeId <= toChangeId)) && (it->first >= toChangeId))) {
+            break;
+        }
+        if (it->second.msg->IsExpired()) {
+            /* Remove expired message without sending */
+            EraseMessage(it++);
+            messageErased = true;
+        } else {
+            /* Send message */
+            uint32_t changeId = it->first;
+            Message slMsg = it->second.msg;
+            lock.Unlock();
+            router.LockNameTable();
+            BusEndpoint ep = router.FindEndpoint(msg->GetSender());
+            if (ep->IsValid()) {
+                router.UnlockNameTable();
+                if (ep->GetEndpointType() == ENDPOINT_TYPE_VIRTUAL) {
+                    status = VirtualEndpoint::cast(ep)->PushMessage(slMsg, msg->GetSessionId());
                 } else {
-                    router.UnlockNameTable();
+                    status = ep->PushMessage(slMsg);
                 }
-                lock.Lock();
-                it = messageMap.upper_bound(key);
+            } else {
+                router.UnlockNameTable();
             }
             if (status != ER_OK) {
                 QCC_LogError(status, ("Failed to push sessionless signal to %s", msg->GetDestination()));
             }
-        } else {
-            ++it;
+            lock.Lock();
+            it = messageMap.upper_bound(changeId);
         }
     }
     lock.Unlock();
 
     /* Alert the advertiser worker */
     if (messageErased) {
-        uint32_t zero = 0;
-        SessionlessObj* slObj = this;
-        status = timer.AddAlarm(Alarm(zero, slObj));
+        status = ScheduleWork();
     }
 
     /* Close the session */
@@ -701,21 +813,45 @@ void SessionlessObj::AlarmTriggered(const Alarm& alarm, QStatus reason)
 
     if (reason == ER_OK) {
         uint32_t tilExpire = ::numeric_limits<uint32_t>::max();
-        uint32_t expire;
         uint32_t maxChangeId = 0;
-        bool mapIsEmpty = true;
 
-        /* Purge the messageMap of expired messages */
         lock.Lock();
-        map<MessageMapKey, pair<uint32_t, Message> >::iterator it = messageMap.begin();
-        while (it != messageMap.end()) {
-            if (it->second.second->IsExpired(&expire)) {
-                messageMap.erase(it++);
-            } else {
-                maxChangeId = max(maxChangeId, it->second.first);
-                tilExpire = min(tilExpire, expire);
-                mapIsEmpty = false;
-                ++it;
+        workPending = false;
+        uint64_t now = GetTimestamp64();
+        if (now >= expiryAlarmTime) {
+            expiryAlarmTime = 0;
+        }
+
+        /* Purge the messageMap of messages that have expired */
+        while (!expiryQueue.empty() && (expiryQueue.top().first <= now)) {
+            ExpiryEntry entry = expiryQueue.top();
+            expiryQueue.pop();
+            map<uint32_t, StoredMessage>::iterator it = messageMap.find(entry.second);
+            if ((it != messageMap.end()) && (it->second.expires == entry.first)) {
+                uint32_t expire;
+                if (it->second.msg->IsExpired(&expire)) {
+                    EraseMessage(it);
+                } else {
+                    /* Message timestamps are only accurate to the millisecond */
+                    it->second.expires = now + expire;
+                    expiryQueue.push(ExpiryEntry(it->second.expires, it->first));
+                }
+            }
+        }
+
+        /* The latest change id is the last one before nextChangeId allowing for wrap around */
+        bool mapIsEmpty = messageMap.empty();
+        if (!mapIsEmpty) {
+            map<uint32_t, StoredMessage>::iterator it = messageMap.lower_bound(nextChangeId);
+            maxChangeId = (it == messageMap.begin()) ? messageMap.rbegin()->first : (--it)->first;
+        }
+
+        /* Set an alarm for the next expiry unless there is one already set for an earlier time */
+        if (!expiryQueue.empty()) {
+            uint64_t expires = expiryQueue.top().first;
+            if ((expiryAlarmTime == 0) || (expires < expiryAlarmTime)) {
+                expiryAlarmTime = expires;
+                tilExpire = (expires > now) ? static_cast<uint32_t>(expires - now) : 0;
             }
         }
         lock.Unlock();
@@ -786,6 +922,7 @@ void SessionlessObj::JoinSessionCB(QStatus status, SessionId id, const SessionOp
     }
 
     /* Send out RequestSignals or RequestRange message if join was successful. Otherwise retry. */
+    vector<String> completed;
     lock.Lock();
     map<String, ChangeIdEntry>::iterator cit = changeIdMap.find(guid);
     if (cit != changeIdMap.end()) {
@@ -817,12 +954,13 @@ void SessionlessObj::JoinSessionCB(QStatus status, SessionId id, const SessionOp
                     isCatchup = true;
                     catchup = cit->second.catchupList.front();
                     cit->second.catchupList.pop();
+                    catchup.changeId = cit->second.changeId - (numeric_limits<uint32_t>::max() >> 1);
+                    /* Put catchup on catchupMap before the session can be lost */
+                    catchupMap[id] = catchup;
                 } else {
                     /* This session cant be used for catchup because remote side doesn't support it */
                     /* Just clear the catchupList and move on as if it was the non-catchup case */
-                    while (!cit->second.catchupList.empty()) {
-                        cit->second.catchupList.pop();
-                    }
+                    AbandonCatchups(cit->second, completed);
                     cit->second.inProgress = false;
                     bus.LeaveSession(id);
                     DoSessionLost(id);
@@ -839,14 +977,19 @@ void SessionlessObj::JoinSessionCB(QStatus status, SessionId id, const SessionOp
                 } else {
                     QCC_LogError(tStatus, ("JoinSessionAsync to %s failed", ctx2->second.c_str()));
                     delete ctx2;
+                    cit->second.inProgress = false;
+                    AbandonCatchups(cit->second, completed);
                 }
             } else {
                 cit->second.inProgress = false;
+                AbandonCatchups(cit->second, completed);
                 QCC_LogError(status, ("Exhausted joinSession retries to %s", advName.c_str()));
             }
         }
         lock.Unlock();
 
+        SendCatchupComplete(completed);
+
         if (status == ER_OK) {
             /* Add/replace sessionless adv name for remote daemon */
             String guid = advName.substr(::strlen(WellKnownName) + 2, qcc::GUID128::SHORT_SIZE);
@@ -854,22 +997,16 @@ void SessionlessObj::JoinSessionCB(QStatus status, SessionId id, const SessionOp
 
             /* Send the signal if join was successful */
             if (isCatchup) {
-                /* Put catchup on catchupMap */
-                catchupMap[id] = catchup;
-
                 MsgArg args[2];
                 args[0].Set("u", catchup.changeId);
                 args[1].Set("u", requestChangeId);
                 QCC_DbgPrintf(("Sending RequestRange (from=%d, to=%d) to %s\n", catchup.changeId, requestChangeId, advName.c_str()));
                 status = Signal(advName.c_str(), id, *requestRangeSignal, args, ArraySize(args));
                 if (status != ER_OK) {
-                    catchupMap.erase(id);
                     QCC_LogError(status, ("RequestRange to %s failed", advName.c_str()));
-                    /* Reset inProgress */
-                    cit = changeIdMap.find(guid);
-                    if (cit != changeIdMap.end()) {
-                        cit->second.inProgress = false;
-                    }
+                    bus.LeaveSession(id);
+                    /* Reset inProgress and start the next catchup if there is one */
+                    DoSessionLost(id);
                 }
             } else {
                 MsgArg args[1];
@@ -23,9 +23,12 @@
 
 #include <qcc/platform.h>
 
+#include <functional>
 #include <map>
 #include <set>
 #include <queue>
+#include <utility>
+#include <vector>
 
 #include <qcc/String.h>
 #include <qcc/Timer.h>
@@ -203,7 +206,8 @@ class SessionlessObj : public BusObject, public SessionListener, public SessionP
 
     /**
      * Trigger (re)reception of sessionless signals from a single or from all
-     * remote daemons.
+     * remote daemons. The sender is sent org.alljoyn.Bus.SessionlessCatchupComplete
+     * once all of the catchups have finished.
      *
      * @param sender    Unique name of client that is requesting to re-receive sessionless messages.
      * @param guid      GUID of remote host that sender wants to re-receive messages from or empty for all remote hosts
@@ -248,6 +252,13 @@ class SessionlessObj : public BusObject, public SessionListener, public SessionP
      */
     void DoSessionLost(uint32_t sessionId);
 
+    /**
+     * Schedule the worker to update the advertisement unless it is already scheduled.
+     *
+     * @return ER_OK if successful.
+     */
+    QStatus ScheduleWork();
+
     Bus& bus;                             /**< The bus */
     BusController* busController;         /**< BusController that created this BusObject */
     DaemonRouter& router;                 /**< The router */
@@ -274,8 +285,41 @@ class SessionlessObj : public BusObject, public SessionListener, public SessionP
         }
     };
 
-    /** Storage for sessionless messages waiting to be delivered */
-    std::map<MessageMapKey, std::pair<uint32_t, Message> > messageMap;
+    /** A sessionless message waiting to be delivered */
+    struct StoredMessage {
+        StoredMessage(const MessageMapKey& key, Message& msg, uint64_t expires) : key(key), msg(msg), expires(expires) { }
+        MessageMapKey key;
+        Message msg;
+        uint64_t expires;       /**< Time the message expires or 0 if it does not expire */
+    };
+
+    /** Storage for sessionless messages waiting to be delivered indexed by change id */
+    std::map<uint32_t, StoredMessage> messageMap;
+
+    /** Change id of the stored message for each sender, interface, member and object path */
+    std::map<MessageMapKey, uint32_t> keyMap;
+
+    /** Change id of the stored message for each serial number and sender */
+    std::map<std::pair<uint32_t, qcc::String>, uint32_t> serialMap;
+
+    /** Expiry times and change ids of stored messages, earliest first. Entries are removed lazily. */
+    typedef std::pair<uint64_t, uint32_t> ExpiryEntry;
+    std::priority_queue<ExpiryEntry, std::vector<ExpiryEntry>, std::greater<ExpiryEntry> > expiryQueue;
+
+    /**
+     * Store a message. Must be called with the lock held.
+     *
+     * @param key   Key of the message.
+     * @param msg   The message.
+     */
+    void StoreMessage(const MessageMapKey& key, Message& msg);
+
+    /**
+     * Remove a stored message from messageMap and its indices. Must be called with the lock held.
+     *
+     * @param it   Position of the message in messageMap.
+     */
+    void EraseMessage(std::map<uint32_t, StoredMessage>::iterator it);
 
     /** Count the number of rules (per endpoint) that specify sesionless=TRUE */
     std::map<qcc::String, uint32_t> ruleCountMap;
@@ -307,7 +351,35 @@ class SessionlessObj : public BusObject, public SessionListener, public SessionP
     /** Map remote guid to ChangeIdEntry */
     std::map<qcc::String, ChangeIdEntry> changeIdMap;
 
+    /** Number of catchups queued or in progress for each client that asked to re-receive signals */
+    std::map<qcc::String, uint32_t> catchupCountMap;
+
+    /**
+     * Account for a catchup that finished or was given up on. Must be called with the lock held.
+     *
+     * @param sender   Unique name of the client the catchup was for.
+     * @return true if this was the last catchup of the client.
+     */
+    bool CatchupDone(const qcc::String& sender);
+
+    /**
+     * Give up on the catchups queued for a remote daemon. Must be called with the lock held.
+     *
+     * @param entry       ChangeIdEntry of the remote daemon.
+     * @param completed   Unique names of clients that have no catchups left are added to this.
+     */
+    void AbandonCatchups(ChangeIdEntry& entry, std::vector<qcc::String>& completed);
+
+    /**
+     * Tell clients that their catchups are complete. Must be called without the lock held.
+     *
+     * @param completed   Unique names of clients that have no catchups left.
+     */
+    void SendCatchupComplete(const std::vector<qcc::String>& completed);
+
     qcc::Mutex lock;            /**< Mutex that protects messageMap this obj's data structures */
+    bool workPending;           /**< True when the worker has been scheduled to run */
+    uint64_t expiryAlarmTime;   /**< Time of the earliest expiry alarm or 0 if there is none */
     uint32_t nextChangeId;      /**< Change id assoc with next pushed signal */
     uint32_t lastAdvChangeId;   /**< Last advertised change id */
     qcc::String lastAdvName;    /**< Last advertised name */
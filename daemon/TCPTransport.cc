@@ -40,6 +40,19 @@
 #include "ns/IpNameService.h"
 #include "TCPTransport.h"
 
+#if defined(QCC_OS_GROUP_POSIX)
+#include "ScatterGatherList.h"
+#endif
+
+#if defined(QCC_OS_LINUX)
+#include <errno.h>
+#include <fcntl.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/epoll.h>
+#include <sys/socket.h>
+#endif
+
 /*
  * How the transport fits into the system
  * ======================================
@@ -268,9 +281,12 @@
  * which we call a "listen spec".  Our StartListen() will create a Socket, bind
  * the socket to the address and port provided and save the new socket on a list
  * of "listenFds." It will then Alert() the already running server accept loop
- * thread -- see TCPTransport::Run().  Each time through the server accept
- * loop, Run() will examine the list of listenFds and will associate an Event
- * with the corresponding socketFd and wait for connection requests.
+ * thread -- see TCPTransport::Run().  When the list of listenFds has changed,
+ * Run() will associate an Event with each socketFd and wait for connection
+ * requests.  On Linux the listenFds are instead kept in an epoll set that
+ * StartListen() and StopListen() update, and Run() always waits on the epoll
+ * fd.  Each time a listenFd becomes readable Run() accepts all of the
+ * connections waiting on it.
  *
  * There is a complementary call to stop listening on addresses.  Since the
  * server accept loop is depending on the associated sockets, StopListen must
@@ -282,26 +298,29 @@
  * that an endpoint is not brought up immediately, but an authentication step
  * must be performed.  The server accept loop starts this process by placing the
  * new TCPEndpoint on an authList, or list of authenticating endpoints.
- * It then calls the endpoint Authenticate() method which spins up an
- * authentication thread and returns immediately.  This process transfers the
- * responsibility for the connection and its resources to the authentication
- * thread.  Authentication can succeed, fail, or take to long and be aborted.
- *
- * If authentication succeeds, the authentication thread calls back into the
- * TCPTransport's Authenticated() method.  Along with indicating that
- * authentication has completed successfully, this transfers ownership of the
- * TCPEndpoint back to the TCPTransport from the authentication
- * thread.  At this time, the TCPEndpoint is Start()ed which spins up
- * the transmit and receive threads and enables Message routing across the
- * transport.
- *
- * If the authentication fails, the authentication thread simply sets a the
- * TCPEndpoint state to FAILED and exits.  The server accept loop looks at
- * authenticating endpoints (those on the authList)each time through its loop.
- * If an endpoint has failed authentication, and its thread has actually gone
- * away (or more precisely is at least going away in such a way that it will
- * never touch the endpoint data structure again).  This means that the endpoint
- * can be deleted.
+ * It then calls the endpoint Authenticate() method which adds the endpoint
+ * stream to the IODispatch and returns immediately.  There is no thread per
+ * authenticating connection.  Each time authentication bytes arrive, an
+ * IODispatch read callback advances the authentication as far as the bytes
+ * allow without blocking.  The few steps that may block (calls out to the
+ * auth listener and key store) are run on a small fixed pool of threads, the
+ * m_authTimer.  This process transfers the responsibility for the connection
+ * and its resources to the authentication.  Authentication can succeed, fail,
+ * or take to long and be aborted.
+ *
+ * If authentication succeeds, the endpoint calls back into the TCPTransport's
+ * Authenticated() method.  Along with indicating that authentication has
+ * completed successfully, this transfers ownership of the TCPEndpoint back to
+ * the TCPTransport from the authentication.  At this time, the TCPEndpoint is
+ * Start()ed which spins up the transmit and receive threads and enables
+ * Message routing across the transport.
+ *
+ * If the authentication fails, the endpoint simply sets the TCPEndpoint state
+ * to FAILED once its stream has left the IODispatch.  The server accept loop
+ * looks at authenticating endpoints (those on the authList) each time through
+ * its loop.  If an endpoint has failed authentication, no callback will ever
+ * touch the endpoint data structure again.  This means that the endpoint can
+ * be deleted.
  *
  * If the authentication takes "too long" we assume that a denial of service
  * attack in in progress.  We call AuthStop() on such an endpoint which will most
@@ -339,8 +358,8 @@
  * succeeds, the endpoint is Start()ed which will spin up the rx and tx threads that
  * start Message routing across the link.  The endpoint is left on the endpoint list
  * in this case.  If authentication fails, the endpoint is removed from the active
- * list.  This is thread-safe since there is no authentication thread running because
- * the authentication was done in the context of the thread calling Connect() which
+ * list.  This is thread-safe since there is no authentication running in the
+ * IODispatch because the authentication was done in the context of the thread calling Connect() which
  * is the one deleting the endpoint; and no rx or tx thread is spun up if the
  * authentication fails.
  *
@@ -349,9 +368,9 @@
  *
  *   1) Threads that may be running in the server accept loop with associated Events
  *      and their dependent socketFds stored in the listenFds list.
- *   2) Threads that may be running authentication with associated endpoint objects,
- *      streams and SocketFds.  These threads are accessible through endpoint objects
- *      stored on the authList.
+ *   2) IODispatch callbacks and auth timer threads that may be running
+ *      authentication with associated endpoint objects, streams and SocketFds.
+ *      These are accessible through endpoint objects stored on the authList.
  *   3) Threads that may be running the rx and tx loops in endpoints which are up and
  *      running, transporting routable Messages through the system.
  *
@@ -389,6 +408,50 @@ const uint32_t TCP_LINK_TIMEOUT_PROBE_ATTEMPTS       = 1;
 const uint32_t TCP_LINK_TIMEOUT_PROBE_RESPONSE_DELAY = 10;
 const uint32_t TCP_LINK_TIMEOUT_MIN_LINK_TIMEOUT     = 40;
 
+#if defined(QCC_OS_LINUX)
+namespace qcc {
+extern QStatus GetSockAddr(const sockaddr_storage* addrBuf, socklen_t addrSize, IPAddress& addr, uint16_t& port);
+}
+
+/*
+ * Maximum number of ready listen fds collected from the epoll set per wakeup
+ */
+const int MAX_LISTEN_EVENTS = 16;
+
+/*
+ * Accept a connection on a non-blocking listen fd with a single accept4() call
+ * that also makes the new socket non-blocking and close-on-exec, instead of
+ * accept() followed by fcntl() calls.  Returns ER_WOULDBLOCK when there are no
+ * more connections waiting.
+ */
+static QStatus AcceptNonBlocking(SocketFd listenFd, IPAddress& remoteAddr, uint16_t& remotePort, SocketFd& newSock)
+{
+    struct sockaddr_storage addr;
+    socklen_t addrLen;
+    int ret;
+
+    do {
+        addrLen = sizeof(addr);
+        ret = accept4(static_cast<int>(listenFd), reinterpret_cast<struct sockaddr*>(&addr), &addrLen, SOCK_NONBLOCK | SOCK_CLOEXEC);
+    } while ((ret < 0) && (errno == EINTR));
+
+    if (ret < 0) {
+        if ((errno == EAGAIN) || (errno == EWOULDBLOCK)) {
+            return ER_WOULDBLOCK;
+        }
+        QCC_LogError(ER_OS_ERROR, ("AcceptNonBlocking(): accept4() failed: %s", strerror(errno)));
+        return ER_OS_ERROR;
+    }
+    QStatus status = qcc::GetSockAddr(&addr, addrLen, remoteAddr, remotePort);
+    if (status != ER_OK) {
+        close(ret);
+        return status;
+    }
+    newSock = static_cast<SocketFd>(ret);
+    return ER_OK;
+}
+#endif
+
 namespace ajn {
 
 /**
@@ -400,25 +463,26 @@ const char* TCPTransport::TransportName = "tcp";
  * An endpoint class to handle the details of authenticating a connection in a
  * way that avoids denial of service attacks.
  */
-class _TCPEndpoint : public _RemoteEndpoint {
+class _TCPEndpoint : public _RemoteEndpoint, public qcc::AlarmListener {
   public:
     /**
-     * There are three threads that can be running around in this data
-     * structure.  An auth thread is run before the endpoint is started in order
-     * to handle the security stuff that must be taken care of before messages
-     * can start passing.  This enum reflects the states of the authentication
-     * process and the state can be found in m_authState.  Once authentication
-     * is complete, the auth thread must go away, but it must also be joined,
-     * which is indicated by the AUTH_DONE state.  The other threads are the
-     * endpoint RX and TX threads, which are dealt with by the EndpointState.
+     * Authentication is run before the endpoint is started in order to handle
+     * the security stuff that must be taken care of before messages can start
+     * passing.  It is driven by IODispatch read callbacks on the endpoint
+     * stream, and the few steps that may block are run on the transport's
+     * auth timer.  This enum reflects the states of the authentication process
+     * and the state can be found in m_authState.  Once authentication is
+     * complete, there must be no callback still running in the endpoint,
+     * which is indicated by the AUTH_DONE state.  The endpoint RX and TX
+     * callbacks are dealt with by the EndpointState.
      */
     enum AuthState {
         AUTH_ILLEGAL = 0,
-        AUTH_INITIALIZED,    /**< This endpoint structure has been allocated but no auth thread has been run */
-        AUTH_AUTHENTICATING, /**< We have spun up an authentication thread and it has begun running our user function */
-        AUTH_FAILED,         /**< The authentication has failed and the authentication thread is exiting immidiately */
-        AUTH_SUCCEEDED,      /**< The auth process (Establish) has succeeded and the connection is ready to be started */
-        AUTH_DONE,           /**< The auth thread has been successfully shut down and joined */
+        AUTH_INITIALIZED,    /**< This endpoint structure has been allocated but authentication has not started */
+        AUTH_AUTHENTICATING, /**< Authentication is being driven by read callbacks on the endpoint stream */
+        AUTH_FAILED,         /**< The authentication has failed and the stream has been removed from the IODispatch */
+        AUTH_SUCCEEDED,      /**< The auth process has succeeded and the connection is ready to be started */
+        AUTH_DONE,           /**< The auth process has been joined */
     };
 
     /**
@@ -467,11 +531,21 @@ class _TCPEndpoint : public _RemoteEndpoint {
         m_authState(AUTH_INITIALIZED),
         m_epState(EP_INITIALIZED),
         m_tStart(qcc::Timespec(0)),
-        m_authThread(this),
+        m_authPending(false),
+        m_authStatus(ER_WOULDBLOCK),
+        m_authBusy(false),
+        m_authDispatching(false),
+        m_untrustedClient(false),
+        m_gotNul(false),
         m_stream(sock),
         m_ipAddr(ipAddr),
         m_port(port),
-        m_wasSuddenDisconnect(!incoming) { }
+        m_wasSuddenDisconnect(!incoming)
+    {
+        DaemonConfig* config = DaemonConfig::Access();
+        SetTxQueueLimits(config->Get("tcp/limit@tx_queue_high_watermark", TCPTransport::ALLJOYN_TX_QUEUE_HIGH_WATERMARK_TCP_DEFAULT),
+                         config->Get("tcp/limit@tx_queue_low_watermark", TCPTransport::ALLJOYN_TX_QUEUE_LOW_WATERMARK_TCP_DEFAULT));
+    }
 
     virtual ~_TCPEndpoint() { }
 
@@ -558,33 +632,85 @@ class _TCPEndpoint : public _RemoteEndpoint {
     }
 
     /*
-     * Return true if the auth thread is STARTED, RUNNING or STOPPING.  A true
-     * response means the authentication thread is in a state that indicates
-     * a possibility it might touch the endpoint data structure.  This means
-     * don't delete the endpoint if this method returns true.  This method
-     * indicates nothing about endpoint rx and tx thread state.
+     * Called by the transport when it takes over the endpoint after a
+     * successful authentication, just before it starts the endpoint.  From
+     * then on read callbacks are handled by the RemoteEndpoint.  Returns false
+     * if the authentication was stopped after it succeeded.
      */
-    bool IsAuthThreadRunning(void)
+    bool AuthHandoff(void)
     {
-        return m_authThread.IsRunning();
+        m_authLock.Lock(MUTEX_CONTEXT);
+        bool ok = (m_authStatus == ER_OK);
+        if (ok) {
+            m_authPending = false;
+            /* From here on the endpoint exit callback releases the untrusted client count */
+            m_untrustedClient = false;
+        }
+        m_authLock.Unlock(MUTEX_CONTEXT);
+        return ok;
     }
 
-  private:
-    class AuthThread : public qcc::Thread {
-      public:
-        AuthThread(_TCPEndpoint* ep) : Thread("auth"), m_endpoint(ep)  { }
-      private:
-        virtual qcc::ThreadReturn STDCALL Run(void* arg);
+#if defined(QCC_OS_GROUP_POSIX)
+  protected:
+    /*
+     * Queued messages are written to the socket with a single sendmsg().
+     */
+    bool SupportsGatheredWrites() const { return true; }
 
-        _TCPEndpoint* m_endpoint;
-    };
+    QStatus PushBytesGathered(const TxBuffer* bufs, size_t numBufs, size_t& numSent)
+    {
+        qcc::ScatterGatherList sg;
+        for (size_t i = 0; i < numBufs; ++i) {
+            sg.AddBuffer(bufs[i].buf, bufs[i].len);
+        }
+        sg.SetDataSize(sg.MaxDataSize());
+        return qcc::SendSG(m_stream.GetSocketFd(), sg, numSent);
+    }
+#endif
+
+  protected:
+    /*
+     * Until the endpoint is handed off to the transport the stream callbacks
+     * drive authentication.
+     */
+    QStatus ReadCallback(qcc::Source& source, bool isTimedOut)
+    {
+        if (m_authPending) {
+            return AuthReadCallback();
+        } else {
+            return _RemoteEndpoint::ReadCallback(source, isTimedOut);
+        }
+    }
+
+    void ExitCallback()
+    {
+        if (m_authPending) {
+            AuthExitCallback();
+        } else {
+            _RemoteEndpoint::ExitCallback();
+        }
+    }
+
+  private:
+    QStatus AuthReadCallback(void);
+    void AuthExitCallback(void);
+    void AlarmTriggered(const qcc::Alarm& alarm, QStatus reason);
+    void AuthStep(void);
+    void AuthStepDone(QStatus status);
+    void AuthFinish(void);
 
     TCPTransport* m_transport;        /**< The server holding the connection */
     volatile SideState m_sideState;   /**< Is this an active or passive connection */
     volatile AuthState m_authState;   /**< The state of the endpoint authentication process */
     volatile EndpointState m_epState; /**< The state of the endpoint authentication process */
     qcc::Timespec m_tStart;           /**< Timestamp indicating when the authentication process started */
-    AuthThread m_authThread;          /**< Thread used to do blocking calls during startup */
+    volatile bool m_authPending;      /**< True until the endpoint is handed off to the transport */
+    qcc::Mutex m_authLock;            /**< Mutex that protects the authentication state below */
+    QStatus m_authStatus;             /**< Result of the authentication or ER_WOULDBLOCK while it is in progress */
+    bool m_authBusy;                  /**< True while an authentication step is running */
+    bool m_authDispatching;           /**< True while the stream is registered with the IODispatch for authentication */
+    bool m_untrustedClient;           /**< True while a succeeded authentication holds an untrusted client count */
+    bool m_gotNul;                    /**< True once the initial nul byte has been read */
     qcc::SocketStream m_stream;       /**< Stream used by authentication code */
     qcc::IPAddress m_ipAddr;          /**< Remote IP address. */
     uint16_t m_port;                  /**< Remote port. */
@@ -594,203 +720,274 @@ class _TCPEndpoint : public _RemoteEndpoint {
 QStatus _TCPEndpoint::Authenticate(void)
 {
     QCC_DbgTrace(("TCPEndpoint::Authenticate()"));
+
+    /* Initialized the features for this endpoint */
+    GetFeatures().isBusToBus = false;
+    GetFeatures().handlePassing = false;
+
+    /*
+     * Since the TCPTransport allows untrusted clients, it must implement
+     * UntrustedClientStart and UntrustedClientExit.  As a part of establishing
+     * the connection, the endpoint can call the Transport's
+     * UntrustedClientStart method if it is an untrusted client, so the
+     * transport MUST call SetListener before starting.  Note: This is only
+     * required on the accepting end i.e. for incoming endpoints.
+     */
+    SetListener(m_transport);
+
+    DaemonRouter& router = reinterpret_cast<DaemonRouter&>(m_transport->m_bus.GetInternal().GetRouter());
+    AuthListener* authListener = router.GetBusController()->GetAuthListener();
+    QStatus status;
+    if (authListener) {
+        status = EstablishBegin("ALLJOYN_PIN_KEYX ANONYMOUS", authListener);
+    } else {
+        status = EstablishBegin("ANONYMOUS");
+    }
+
     /*
-     * Start the authentication thread.
+     * Authentication is driven by read callbacks on the stream from here on.
+     * Nothing is running in the endpoint until the first callback so if the
+     * stream cannot be registered the server accept loop can just pitch the
+     * connection.
      */
-    QStatus status = m_authThread.Start(this);
+    if (status == ER_OK) {
+        m_authPending = true;
+        m_authState = AUTH_AUTHENTICATING;
+        m_authDispatching = true;
+        status = StartDispatch();
+    }
     if (status != ER_OK) {
+        m_authPending = false;
+        m_authDispatching = false;
+        EstablishCancel();
         m_authState = AUTH_FAILED;
     }
     return status;
 }
 
-void _TCPEndpoint::AuthStop(void)
+QStatus _TCPEndpoint::AuthReadCallback(void)
 {
-    QCC_DbgTrace(("TCPEndpoint::AuthStop()"));
-
     /*
-     * Ask the auth thread to stop executing.  The only ways out of the thread
-     * run function will set the state to either AUTH_SUCCEEDED or AUTH_FAILED.
-     * There is a very small chance that we will send a stop to the thread after
-     * it has successfully authenticated, but we expect that this will result in
-     * an AUTH_FAILED state for the vast majority of cases.  In this case, we
-     * notice that the thread failed the next time through the main server run
-     * loop, join the thread via AuthJoin below and delete the endpoint.  Note
-     * that this is a lazy cleanup of the endpoint.
+     * Read callbacks are one-shot, the callback is only enabled again once
+     * the step it started has finished.  The first byte of the stream and the
+     * steps of the authentication conversation that cannot block are run right
+     * here on the IODispatch thread.  Steps that call out to an authentication
+     * listener (and possibly the user) are handed to the transport's small
+     * pool of auth threads so they cannot hold up the dispatcher.
      */
-    m_authThread.Stop();
+    m_authLock.Lock(MUTEX_CONTEXT);
+    if ((m_authStatus != ER_WOULDBLOCK) || m_authBusy) {
+        m_authLock.Unlock(MUTEX_CONTEXT);
+        return ER_OK;
+    }
+    m_authBusy = true;
+    bool mayBlock = m_gotNul && EstablishMayBlock();
+    m_authLock.Unlock(MUTEX_CONTEXT);
+
+    if (mayBlock) {
+        uint32_t zero = 0;
+        qcc::AlarmListener* listener = this;
+        QStatus status = m_transport->m_authTimer.AddAlarm(qcc::Alarm(zero, listener));
+        if (status != ER_OK) {
+            QCC_LogError(status, ("TCPEndpoint::AuthReadCallback(): Failed to queue authentication step"));
+            AuthStepDone(status);
+        }
+    } else {
+        AuthStep();
+    }
+    return ER_OK;
 }
 
-void _TCPEndpoint::AuthJoin(void)
+void _TCPEndpoint::AlarmTriggered(const qcc::Alarm& alarm, QStatus reason)
 {
-    QCC_DbgTrace(("TCPEndpoint::AuthJoin()"));
-
-    /*
-     * Join the auth thread to stop executing.  All threads must be joined in
-     * order to communicate their return status.  The auth thread is no exception.
-     * This is done in a lazy fashion from the main server accept loop, where we
-     * cleanup every time through the loop.
-     */
-    m_authThread.Join();
+    if (reason == ER_OK) {
+        AuthStep();
+    } else {
+        AuthStepDone(reason);
+    }
 }
 
-void* _TCPEndpoint::AuthThread::Run(void* arg)
+void _TCPEndpoint::AuthStep(void)
 {
-    QCC_DbgTrace(("TCPEndpoint::AuthThread::Run()"));
+    QStatus status = ER_OK;
 
-    m_endpoint->m_authState = AUTH_AUTHENTICATING;
+    if (!m_gotNul) {
+        /*
+         * Eat the first byte of the stream.  This is required to be zero by
+         * the DBus protocol.  It is used in the Unix socket implementation to
+         * carry out-of-band capabilities, but is discarded here.
+         */
+        uint8_t byte;
+        size_t nbytes;
+        status = m_stream.PullBytes(&byte, 1, nbytes, 0);
+        if (status == ER_TIMEOUT) {
+            status = ER_WOULDBLOCK;
+        } else if ((status != ER_OK) || (nbytes != 1) || (byte != 0)) {
+            status = (status == ER_OK) ? ER_BUS_ESTABLISH_FAILED : status;
+            QCC_LogError(status, ("Failed to read first byte from stream"));
+        } else {
+            m_gotNul = true;
+        }
+    }
+    if (status == ER_OK) {
+        qcc::String authName;
+        status = EstablishAdvance(authName);
+        if ((status != ER_OK) && (status != ER_WOULDBLOCK)) {
+            QCC_LogError(status, ("Failed to establish TCP endpoint"));
+        }
+    }
+    AuthStepDone(status);
+}
 
-    /*
-     * We're running an authentication process here and we are cooperating with
-     * the main server thread.  This thread is running in an object that is
-     * allocated on the heap, and the server is managing these objects so we
-     * need to coordinate getting all of this cleaned up.
-     *
-     * There is a state variable that only we write.  The server thread only
-     * reads this variable, so there are no data sharing issues.  If there is an
-     * authentication failure, this thread sets that state variable to
-     * AUTH_FAILED and then exits.  The server holds a list of currently
-     * authenticating connections and will look for AUTH_FAILED connections when
-     * it runs its Accept loop.  If it finds one, it will AuthJoin() this
-     * thread.  Since we set AUTH_FAILED immediately before exiting, there will
-     * be no problem having the server block waiting for the Join() to complete.
-     * We fail authentication here and let the server clean up after us, lazily.
-     *
-     * If we succeed in the authentication process, we set the state variable
-     * to AUTH_SUCEEDED and then call back into the server telling it that we are
-     * up and running.  It needs to take us off of the list of authenticating
-     * connections and put us on the list of running connections.  This thread
-     * will quickly go away and will be replaced by the RX and TX threads of
-     * the running RemoteEndpoint.
-     *
-     * If we are running an authentication process, we are probably ultimately
-     * blocked on a socket.  We expect that if the server is asked to shut
-     * down, it will run through its list of authenticating connections and
-     * AuthStop() each one.  That will cause a thread Stop() which should unblock
-     * all of the reads and return an error which will eventually pop out here
-     * with an authentication failure.
-     *
-     * Finally, if the server decides we've spent too much time here and we are
-     * actually a denial of service attack, it can close us down by doing an
-     * AuthStop() on the authenticating endpoint.  This will do a thread Stop()
-     * on the auth thread of the endpoint which will pop out of here as an
-     * authentication failure as well.  The only ways out of this method must be
-     * with state = AUTH_FAILED or state = AUTH_SUCCEEDED.
-     */
-    uint8_t byte;
-    size_t nbytes;
+void _TCPEndpoint::AuthStepDone(QStatus status)
+{
+    IODispatch& iodispatch = m_transport->m_bus.GetInternal().GetIODispatch();
+    bool rearm = false;
+    bool stop = false;
+    bool finish = false;
+
+    m_authLock.Lock(MUTEX_CONTEXT);
+    m_authBusy = false;
+    if (m_authStatus == ER_WOULDBLOCK) {
+        if (status == ER_WOULDBLOCK) {
+            rearm = true;
+        } else {
+            m_authStatus = status;
+            /*
+             * A failed authentication removes the stream from the IODispatch
+             * and finishes in the exit callback, a successful one keeps the
+             * stream registered for the endpoint and finishes now.
+             */
+            if (status == ER_OK) {
+                m_untrustedClient = IsIncomingConnection() && !IsTrusted() && !GetFeatures().isBusToBus;
+                finish = true;
+            } else {
+                stop = true;
+            }
+        }
+    }
+    if (!m_authDispatching) {
+        /* The exit callback happened while the step was running */
+        finish = true;
+    }
+    m_authLock.Unlock(MUTEX_CONTEXT);
 
-    /*
-     * Eat the first byte of the stream.  This is required to be zero by the
-     * DBus protocol.  It is used in the Unix socket implementation to carry
-     * out-of-band capabilities, but is discarded here.  We do this here since
-     * it involves a read that can block.
-     */
-    QStatus status = m_endpoint->m_stream.PullBytes(&byte, 1, nbytes);
-    if ((status != ER_OK) || (nbytes != 1) || (byte != 0)) {
-        m_endpoint->m_stream.Close();
-        QCC_LogError(status, ("Failed to read first byte from stream"));
+    if (rearm) {
+        iodispatch.EnableReadCallback(&m_stream);
+    }
+    if (stop) {
+        iodispatch.StopStream(&m_stream);
+    }
+    if (finish) {
+        AuthFinish();
+    }
+}
 
-        /*
-         * Management of the resources used by the authentication thread is done
-         * in one place, by the server Accept loop.  The authentication thread
-         * writes its state into the connection and the server Accept loop reads
-         * this state.  As soon as we set this state to AUTH_FAILED, we are
-         * telling the Accept loop that we are done with the conn data
-         * structure.  That thread is then free to do anything it wants with the
-         * connection, including deleting it, so we are not allowed to touch
-         * conn after setting this state.
-         *
-         * In addition to releasing responsibility for the conn data structure,
-         * when we set the state to AUTH_SUCCEEDED we are telling the server
-         * accept loop that we are exiting now and so it can Join() on us (the
-         * authentication thread) without being worried about blocking since the
-         * next thing we do is exit.
-         */
-        m_endpoint->m_authState = AUTH_FAILED;
-        return (void*)ER_FAIL;
+void _TCPEndpoint::AuthExitCallback(void)
+{
+    m_authLock.Lock(MUTEX_CONTEXT);
+    m_authDispatching = false;
+    if ((m_authStatus == ER_WOULDBLOCK) || (m_authStatus == ER_OK)) {
+        m_authStatus = ER_BUS_STOPPING;
     }
+    bool finish = !m_authBusy;
+    m_authLock.Unlock(MUTEX_CONTEXT);
 
-    /* Initialized the features for this endpoint */
-    m_endpoint->GetFeatures().isBusToBus = false;
-    m_endpoint->GetFeatures().isBusToBus = false;
-    m_endpoint->GetFeatures().handlePassing = false;
-
-    /* Run the actual connection authentication code. */
-    qcc::String authName;
-    qcc::String redirection;
-    DaemonRouter& router = reinterpret_cast<DaemonRouter&>(m_endpoint->m_transport->m_bus.GetInternal().GetRouter());
-    AuthListener* authListener = router.GetBusController()->GetAuthListener();
-    /* Since the TCPTransport allows untrusted clients, it must implement UntrustedClientStart and
-     * UntrustedClientExit.
-     * As a part of Establish, the endpoint can call the Transport's UntrustedClientStart method if
-     * it is an untrusted client, so the transport MUST call m_endpoint->SetListener before calling Establish
-     * Note: This is only required on the accepting end i.e. for incoming endpoints.
-     */
-    m_endpoint->SetListener(m_endpoint->m_transport);
-    if (authListener) {
-        status = m_endpoint->Establish("ALLJOYN_PIN_KEYX ANONYMOUS", authName, redirection, authListener);
-    } else {
-        status = m_endpoint->Establish("ANONYMOUS", authName, redirection, authListener);
+    if (finish) {
+        AuthFinish();
     }
-    if (status != ER_OK) {
-        m_endpoint->m_stream.Close();
-        QCC_LogError(status, ("Failed to establish TCP endpoint"));
+}
 
+void _TCPEndpoint::AuthFinish(void)
+{
+    /*
+     * Management of the resources used by the authentication is done in one
+     * place, by the server Accept loop.  The authentication callbacks write
+     * their state into the connection and the server Accept loop reads this
+     * state.  As soon as we set this state to AUTH_FAILED or AUTH_SUCCEEDED,
+     * we are telling the Accept loop that we are done with the conn data
+     * structure.  That thread is then free to do anything it wants with the
+     * connection, including deleting it, so we are not allowed to touch conn
+     * after setting this state.
+     */
+    TCPTransport* transport = m_transport;
+    if (m_authStatus == ER_OK) {
+        m_authState = AUTH_SUCCEEDED;
+    } else {
         /*
-         * Management of the resources used by the authentication thread is done
-         * in one place, by the server Accept loop.  The authentication thread
-         * writes its state into the connection and the server Accept loop reads
-         * this state.  As soon as we set this state to AUTH_FAILED, we are
-         * telling the Accept loop that we are done with the conn data
-         * structure.  That thread is then free to do anything it wants with the
-         * connection, including deleting it, so we are not allowed to touch
-         * conn after setting this state.
-         *
-         * In addition to releasing responsibility for the conn data structure,
-         * when we set the state to AUTH_SUCCEEDED we are telling the server
-         * accept loop that we are exiting now and so it can Join() on us (the
-         * authentication thread) without being worried about blocking since the
-         * next thing we do is exit.
+         * An authentication that succeeded may still be stopped before it is
+         * handed off, the count taken by UntrustedClientStart() when it was
+         * established must then be given back here.
          */
-        m_endpoint->m_authState = AUTH_FAILED;
-        return (void*)status;
+        if (m_untrustedClient) {
+            m_untrustedClient = false;
+            transport->UntrustedClientExit();
+        }
+        EstablishCancel();
+        m_stream.Close();
+        m_authState = AUTH_FAILED;
     }
 
     /*
-     * Tell the transport that the authentication has succeeded and that it can
-     * now bring the connection up.
+     * Wake up the server accept loop so that it deals with us immediately.
+     */
+    transport->Alert();
+}
+
+void _TCPEndpoint::AuthStop(void)
+{
+    QCC_DbgTrace(("TCPEndpoint::AuthStop()"));
+
+    /*
+     * Ask the authentication to stop.  The stream is removed from the
+     * IODispatch and the exit callback sets the state to AUTH_FAILED once no
+     * step of the authentication is running.  There is a very small chance
+     * that we will stop an authentication just after it succeeded, but as
+     * long as the endpoint has not been handed off to the transport this
+     * still results in an AUTH_FAILED state.  We notice that the
+     * authentication failed the next time through the main server run loop,
+     * AuthJoin below and delete the endpoint.  Note that this is a lazy
+     * cleanup of the endpoint.
      */
-    TCPEndpoint tcpEp = TCPEndpoint::wrap(m_endpoint);
-    m_endpoint->m_transport->Authenticated(tcpEp);
+    m_authLock.Lock(MUTEX_CONTEXT);
+    bool stop = m_authPending && m_authDispatching;
+    if (stop && ((m_authStatus == ER_WOULDBLOCK) || (m_authStatus == ER_OK))) {
+        m_authStatus = ER_BUS_STOPPING;
+    }
+    m_authLock.Unlock(MUTEX_CONTEXT);
 
-    QCC_DbgTrace(("TCPEndpoint::AuthThread::Run(): Returning"));
+    if (stop) {
+        m_transport->m_bus.GetInternal().GetIODispatch().StopStream(&m_stream);
+    }
+}
+
+void _TCPEndpoint::AuthJoin(void)
+{
+    QCC_DbgTrace(("TCPEndpoint::AuthJoin()"));
 
     /*
-     * We are now done with the authentication process.  We have succeeded doing
-     * the authentication and we may or may not have succeeded in starting the
-     * endpoint TX and RX threads depending on what happened down in
-     * Authenticated().  What concerns us here is that we are done with this
-     * thread (the authentication thread) and we are about to exit.  Before
-     * exiting, we must tell server accept loop that we are done with this data
-     * structure.  As soon as we set this state to AUTH_SUCCEEDED that thread is
-     * then free to do anything it wants with the connection, including deleting
-     * it, so we are not allowed to touch conn after setting this state.
-     *
-     * In addition to releasing responsibility for the conn data structure, when
-     * we set the state to AUTH_SUCCEEDED we are telling the server accept loop
-     * that we are exiting now and so it can Join() the authentication thread
-     * without being worried about blocking since the next thing we do is exit.
+     * Wait until there is nothing running in the endpoint on behalf of the
+     * authentication.  This is done in a lazy fashion from the main server
+     * accept loop, where we cleanup every time through the loop, so it
+     * normally returns right away.
      */
-    m_endpoint->m_authState = AUTH_SUCCEEDED;
-    return (void*)status;
+    while (true) {
+        m_authLock.Lock(MUTEX_CONTEXT);
+        bool running = m_authBusy || (m_authDispatching && (m_authStatus != ER_OK));
+        m_authLock.Unlock(MUTEX_CONTEXT);
+        if (!running) {
+            break;
+        }
+        qcc::Sleep(5);
+    }
 }
 
 TCPTransport::TCPTransport(BusAttachment& bus)
     : Thread("TCPTransport"), m_bus(bus), m_stopping(false), m_listener(0),
+    m_authTimer("TCPTransportAuth", true, ALLJOYN_AUTH_THREADS_TCP_DEFAULT),
     m_foundCallback(m_listener),
     m_isAdvertising(false), m_isDiscovering(false), m_isListening(false),
-    m_isNsEnabled(false), m_reload(false),
+    m_isNsEnabled(false), m_reload(false), m_listenFdsGeneration(0),
     m_listenPort(0), m_nsReleaseCount(0),
     m_maxUntrustedClients(0), m_numUntrustedClients(0)
 {
@@ -800,6 +997,20 @@ TCPTransport::TCPTransport(BusAttachment& bus)
      * router.  This is assumed elsewhere.
      */
     assert(m_bus.GetInternal().GetRouter().IsDaemon());
+
+#if defined(QCC_OS_LINUX)
+    /*
+     * The listen fds are kept in an epoll set that is only changed when a
+     * listener is started or stopped.  The server accept loop waits on the
+     * epoll fd itself, which becomes readable when any listen fd is.
+     */
+    m_listenEpollFd = epoll_create(1);
+    if (m_listenEpollFd < 0) {
+        QCC_LogError(ER_OS_ERROR, ("TCPTransport::TCPTransport(): epoll_create() failed: %s", strerror(errno)));
+    } else {
+        fcntl(m_listenEpollFd, F_SETFD, FD_CLOEXEC);
+    }
+#endif
 }
 
 TCPTransport::~TCPTransport()
@@ -807,27 +1018,35 @@ TCPTransport::~TCPTransport()
     QCC_DbgTrace(("TCPTransport::~TCPTransport()"));
     Stop();
     Join();
+#if defined(QCC_OS_LINUX)
+    if (m_listenEpollFd >= 0) {
+        close(m_listenEpollFd);
+    }
+#endif
 }
 
 void TCPTransport::Authenticated(TCPEndpoint& conn)
 {
     QCC_DbgTrace(("TCPTransport::Authenticated()"));
     /*
-     * If the transport is stopping, dont start the Tx and RxThreads.
+     * If the transport is stopping, dont start the endpoint.  The stream is
+     * still registered with the IODispatch for the authentication so it must
+     * be stopped, the endpoint is then scavenged like a failed authenticator.
      */
     if (m_stopping == true) {
+        conn->AuthStop();
         return;
     }
     /*
-     * If Authenticated() is being called, it is as a result of the
-     * authentication thread telling us that it has succeeded.  What we need to
-     * do here is to try and Start() the endpoint which will spin up its TX and
-     * RX threads and register the endpoint with the daemon router.  As soon as
-     * we call Start(), we are transferring responsibility for error reporting
-     * through endpoint ThreadExit() function.  This will percolate out our
-     * EndpointExit function.  It will expect to find <conn> on the endpoint
-     * list so we move it from the authList to the endpointList before calling
-     * Start.
+     * If Authenticated() is being called, it is as a result of the server
+     * accept loop noticing that the authentication has succeeded.  What we
+     * need to do here is to try and Start() the endpoint which will enable
+     * its RX and TX callbacks and register the endpoint with the daemon
+     * router.  As soon as we call Start(), we are transferring responsibility
+     * for error reporting through endpoint ExitCallback() function.  This will
+     * percolate out our EndpointExit function.  It will expect to find <conn>
+     * on the endpoint list so we move it from the authList to the endpointList
+     * before calling Start.
      */
     m_endpointListLock.Lock(MUTEX_CONTEXT);
 
@@ -835,15 +1054,27 @@ void TCPTransport::Authenticated(TCPEndpoint& conn)
     assert(i != m_authList.end() && "TCPTransport::Authenticated(): Conn not on m_authList");
 
     /*
-     * Note here that we have not yet marked the authState as AUTH_SUCCEEDED so
-     * this is a point in time where the authState can be AUTH_AUTHENTICATING
-     * and the endpoint can be on the endpointList and not the authList.
+     * The authentication may have been stopped since it succeeded.  If so,
+     * leave it on the authList to be scavenged as a failed authenticator.
      */
+    if (!conn->AuthHandoff()) {
+        m_endpointListLock.Unlock(MUTEX_CONTEXT);
+        return;
+    }
     m_authList.erase(i);
     m_endpointList.insert(conn);
 
     m_endpointListLock.Unlock(MUTEX_CONTEXT);
 
+    /*
+     * The authentication promised not to touch the state after setting
+     * AUTH_SUCCEEEDED and has been handed off, so we can safely change the
+     * state here since we now own the conn.  We do this through a method call
+     * to enable this single special case where we are allowed to set the
+     * state.
+     */
+    conn->SetAuthDone();
+
     conn->SetListener(this);
 
     conn->SetEpStarting();
@@ -934,6 +1165,15 @@ QStatus TCPTransport::Start()
                                           new CallbackImpl<FoundCallback, void, const qcc::String&, const qcc::String&, std::vector<qcc::String>&, uint8_t>
                                               (&m_foundCallback, &FoundCallback::Found));
 
+    /*
+     * Start the threads that run the authentication steps that may block.
+     */
+    QStatus status = m_authTimer.Start();
+    if (status != ER_OK) {
+        QCC_LogError(status, ("TCPTransport::Start(): Failed to start auth timer"));
+        return status;
+    }
+
     /*
      * Start the server accept loop through the thread base class.  This will
      * close or open the IsRunning() gate we use to control access to our
@@ -984,17 +1224,23 @@ QStatus TCPTransport::Stop(void)
     }
 
     /*
-     * Ask any authenticating endpoints to shut down and exit their threads.  By its
-     * presence on the m_authList, we know that the endpoint is authenticating and
-     * the authentication thread has responsibility for dealing with the endpoint
-     * data structure.  We call Stop() to stop that thread from running.  The
-     * endpoint Rx and Tx threads will not be running yet.
+     * Ask any authenticating endpoints to shut down.  By its presence on the
+     * m_authList, we know that the endpoint is authenticating and the
+     * authentication has responsibility for dealing with the endpoint data
+     * structure.  We call AuthStop() to take its stream out of the IODispatch.
+     * The endpoint Rx and Tx threads will not be running yet.
      */
     for (set<TCPEndpoint>::iterator i = m_authList.begin(); i != m_authList.end(); ++i) {
         TCPEndpoint ep = *i;
         ep->AuthStop();
     }
 
+    /*
+     * Authentication steps that are waiting to run on the auth timer fail
+     * when it stops.
+     */
+    m_authTimer.Stop();
+
     /*
      * Ask any running endpoints to shut down and exit their threads.  By its
      * presence on the m_endpointList, we know that authentication is compete and
@@ -1025,6 +1271,7 @@ QStatus TCPTransport::Join(void)
     if (status != ER_OK) {
         return status;
     }
+    m_authTimer.Join();
 
     /*
      * Tell the IP name service instance that we will no longer be making calls
@@ -1047,9 +1294,9 @@ QStatus TCPTransport::Join(void)
      * running in those endpoints actually stop running.
      *
      * Since Stop() is a request to stop, and this is what has ultimately been
-     * done to both authentication threads and Rx and Tx threads, it is possible
+     * done to both authentications and Rx and Tx threads, it is possible
      * that a thread is actually running after the call to Stop().  If that
-     * thead happens to be an authenticating endpoint, it is possible that an
+     * thead happens to be authenticating an endpoint, it is possible that an
      * authentication actually completes after Stop() is called.  This will move
      * a connection from the m_authList to the m_endpointList, so we need to
      * make sure we wait for all of the connections on the m_authList to go away
@@ -1058,15 +1305,17 @@ QStatus TCPTransport::Join(void)
     m_endpointListLock.Lock(MUTEX_CONTEXT);
 
     /*
-     * Any authenticating endpoints have been asked to shut down and exit their
-     * authentication threads in a previously required Stop().  We need to
-     * Join() all of these auth threads here.
+     * Any authenticating endpoints have been asked to shut down in a
+     * previously required Stop().  An authentication may have succeeded since
+     * then without being started, so stop them again and then wait for them
+     * here.
      */
     set<TCPEndpoint>::iterator it = m_authList.begin();
     while (it != m_authList.end()) {
         TCPEndpoint ep = *it;
         m_authList.erase(it);
         m_endpointListLock.Unlock(MUTEX_CONTEXT);
+        ep->AuthStop();
         ep->AuthJoin();
         m_endpointListLock.Lock(MUTEX_CONTEXT);
         it = m_authList.upper_bound(ep);
@@ -1077,7 +1326,7 @@ QStatus TCPTransport::Join(void)
      * Any running endpoints have been asked it their threads in a previously
      * required Stop().  We need to Join() all of thesse threads here.  This
      * Join() will wait on the endpoint rx and tx threads to exit as opposed to
-     * the joining of the auth thread we did above.
+     * the joining of the authentication we did above.
      */
     it = m_endpointList.begin();
     while (it != m_endpointList.end()) {
@@ -1366,10 +1615,10 @@ void TCPTransport::ManageEndpoints(Timespec tTimeout)
 
         if (authState == _TCPEndpoint::AUTH_FAILED) {
             /*
-             * The endpoint has failed authentication and the auth thread is
-             * gone or is going away.  Since it has failed there is no way this
-             * endpoint is going to be started so we can get rid of it as soon
-             * as we Join() the (failed) authentication thread.
+             * The endpoint has failed authentication and its stream has been
+             * removed from the IODispatch.  Since it has failed there is no way
+             * this endpoint is going to be started so we can get rid of it as
+             * soon as we AuthJoin() the (failed) authentication.
              */
             QCC_DbgHLPrintf(("TCPTransport::ManageEndpoints(): Scavenging failed authenticator"));
             m_authList.erase(i);
@@ -1380,31 +1629,44 @@ void TCPTransport::ManageEndpoints(Timespec tTimeout)
             continue;
         }
 
+        if (authState == _TCPEndpoint::AUTH_SUCCEEDED) {
+            /*
+             * The endpoint has succeeded authentication.  Authenticated()
+             * takes the endpoint over from the authentication, sets AUTH_DONE
+             * and starts the endpoint which moves it to the endpointList.  If
+             * the authentication was stopped in the meantime the endpoint is
+             * left here and scavenged once it reaches AUTH_FAILED.
+             */
+            m_endpointListLock.Unlock(MUTEX_CONTEXT);
+            ep->AuthJoin();
+            Authenticated(ep);
+            m_endpointListLock.Lock(MUTEX_CONTEXT);
+            i = m_authList.upper_bound(ep);
+            continue;
+        }
+
         Timespec tNow;
         GetTimeNow(&tNow);
 
-        if (ep->GetStartTime() + tTimeout < tNow) {
+        if ((authState == _TCPEndpoint::AUTH_AUTHENTICATING) && (ep->GetStartTime() + tTimeout < tNow)) {
             /*
              * This endpoint is taking too long to authenticate.  Stop the
-             * authentication process.  The auth thread is still running, so we
-             * can't just delete the connection, we need to let it stop in its
-             * own time.  What that thread will do is to set AUTH_FAILED and
-             * exit.  we will then clean it up the next time through this loop.
-             * In the hope that the thread can exit and we can catch its exit
-             * here and now, we take our thread off the OS ready list (Sleep)
-             * and let the other thread run before looping back.
+             * authentication process.  A step of the authentication may still
+             * be running, so we can't just delete the connection, we need to
+             * let it stop in its own time.  What the authentication will do is
+             * to set AUTH_FAILED once its stream has been removed from the
+             * IODispatch and we will then clean it up the next time through
+             * this loop.
              */
             QCC_DbgHLPrintf(("TCPTransport::ManageEndpoints(): Scavenging slow authenticator"));
             ep->AuthStop();
-            qcc::Sleep(1);
         }
         ++i;
     }
 
     /*
      * We've handled the authList, so now run through the list of connections on
-     * the endpointList and cleanup any that are no longer running or Join()
-     * authentication threads that have successfully completed.
+     * the endpointList and cleanup any that are no longer running.
      */
     i = m_endpointList.begin();
     while (i != m_endpointList.end()) {
@@ -1420,28 +1682,8 @@ void TCPTransport::ManageEndpoints(Timespec tTimeout)
             continue;
         }
 
-        _TCPEndpoint::AuthState authState = ep->GetAuthState();
         _TCPEndpoint::EndpointState endpointState = ep->GetEpState();
 
-        if (authState == _TCPEndpoint::AUTH_SUCCEEDED) {
-            /*
-             * The endpoint has succeeded authentication and the auth thread is
-             * gone or is going away.  Take this opportunity to join the auth
-             * thread.  Since the auth thread promised not to touch the state
-             * after setting AUTH_SUCCEEEDED, we can safely change the state
-             * here since we now own the conn.  We do this through a method call
-             * to enable this single special case where we are allowed to set
-             * the state.
-             */
-            QCC_DbgHLPrintf(("TCPTransport::ManageEndpoints(): Scavenging failed authenticator"));
-            m_endpointListLock.Unlock(MUTEX_CONTEXT);
-            ep->AuthJoin();
-            ep->SetAuthDone();
-            m_endpointListLock.Lock(MUTEX_CONTEXT);
-            i = m_endpointList.upper_bound(ep);
-            continue;
-        }
-
         /*
          * There are two possibilities for the disposition of the RX and
          * TX threads.  First, they were never successfully started.  In
@@ -1466,7 +1708,7 @@ void TCPTransport::ManageEndpoints(Timespec tTimeout)
          * the endpoint threads, remove the endpoint from the
          * endpoint list and delete it.  Note that we are calling
          * the endpoint Join() to join the TX and RX threads and not
-         * the endpoint AuthJoin() to join the auth thread.
+         * the endpoint AuthJoin() to join the authentication.
          */
         if (endpointState == _TCPEndpoint::EP_STOPPING) {
             m_endpointList.erase(i);
@@ -1516,40 +1758,55 @@ void* TCPTransport::Run(void* arg)
 
     QStatus status = ER_OK;
 
-    while (!IsStopping()) {
+    /*
+     * The set of events we wait on is built once and only rebuilt when the
+     * set of listen fds changes, not each time through the loop.  On Linux the
+     * listen fds are kept in an epoll set by DoStartListen() and DoStopListen()
+     * so we always wait on the same two events: the stop event and the epoll
+     * fd, which becomes readable when any of the listen fds is.
+     */
+    vector<Event*> checkEvents, signaledEvents;
+    vector<SocketFd> readyFds;
+    checkEvents.push_back(&stopEvent);
+#if defined(QCC_OS_LINUX)
+    Event listenEvent(m_listenEpollFd, Event::IO_READ, false);
+    checkEvents.push_back(&listenEvent);
+#else
+    m_listenFdsLock.Lock(MUTEX_CONTEXT);
+    uint32_t listenFdsGeneration = m_listenFdsGeneration - 1;
+    m_listenFdsLock.Unlock(MUTEX_CONTEXT);
+#endif
 
-        /*
-         * We did an Acquire on the name service in our Start() method which
-         * ultimately caused this thread to run.  If we were the first transport
-         * to Acquire() the name service, it will have done a Start() to crank
-         * up its own run thread.  Just because we did that Start() before we
-         * did our Start(), it does not necessarily mean that thread will come
-         * up and run before us.  If we happen to come up before our name service
-         * we'll hang around until it starts to run.  After all, nobody is going
-         * to attempt to connect until we advertise something, and we need the
-         * name service to advertise.
-         */
-        if (IpNameService::Instance().Started() == false) {
-            QCC_DbgTrace(("TCPTransport::Run(): Wait for IP name service"));
-            qcc::Sleep(1);
-            continue;
-        }
+    while (!IsStopping()) {
 
         /*
-         * Each time through the loop we create a set of events to wait on.
-         * We need to wait on the stop event and all of the SocketFds of the
-         * addresses and ports we are listening on.  If the list changes, the
-         * code that does the change Alert()s this thread and we wake up and
-         * re-evaluate the list of SocketFds.
-         * Set reload to true to indicate that the set of events has been reloaded.
+         * There are no listen fds until a DoStartListen() that requires the IP
+         * name service to be started, so there is no need to wait for the name
+         * service here; nobody is going to attempt to connect until we listen
+         * and advertise.
+         *
+         * If the set of listen fds has changed, the code that does the change
+         * Alert()s this thread and we wake up and re-evaluate the set of
+         * SocketFds.  Set reload to true to indicate that the set of events
+         * has been reloaded and no stopped listen fd will be used again.
          */
         m_listenFdsLock.Lock(MUTEX_CONTEXT);
-        m_reload = true;
-        vector<Event*> checkEvents, signaledEvents;
-        checkEvents.push_back(&stopEvent);
-        for (list<pair<qcc::String, SocketFd> >::const_iterator i = m_listenFds.begin(); i != m_listenFds.end(); ++i) {
-            checkEvents.push_back(new Event(i->second, Event::IO_READ, false));
+#if !defined(QCC_OS_LINUX)
+        if (listenFdsGeneration != m_listenFdsGeneration) {
+            for (vector<Event*>::iterator i = checkEvents.begin(); i != checkEvents.end(); ++i) {
+                if (*i != &stopEvent) {
+                    delete *i;
+                }
+            }
+            checkEvents.clear();
+            checkEvents.push_back(&stopEvent);
+            for (list<pair<qcc::String, SocketFd> >::const_iterator i = m_listenFds.begin(); i != m_listenFds.end(); ++i) {
+                checkEvents.push_back(new Event(i->second, Event::IO_READ, false));
+            }
+            listenFdsGeneration = m_listenFdsGeneration;
         }
+#endif
+        m_reload = true;
         m_listenFdsLock.Unlock(MUTEX_CONTEXT);
 
         /*
@@ -1564,6 +1821,13 @@ void* TCPTransport::Run(void* arg)
             break;
         }
 
+        /*
+         * In order to rationalize management of resources, we manage the
+         * various lists in one place on one thread.  This thread is a
+         * convenient victim, so we do it here.
+         */
+        ManageEndpoints(tTimeout);
+
         /*
          * We're back from our Wait() so one of three things has happened.  Our
          * thread has been asked to Stop(), our thread has been Alert()ed, or
@@ -1576,14 +1840,8 @@ void* TCPTransport::Run(void* arg)
          * above.  An alert means that a request to start or stop listening
          * on a given address and port has been queued up for us.
          */
+        readyFds.clear();
         for (vector<Event*>::iterator i = signaledEvents.begin(); i != signaledEvents.end(); ++i) {
-            /*
-             * In order to rationalize management of resources, we manage the
-             * various lists in one place on one thread.  This thread is a
-             * convenient victim, so we do it here.
-             */
-            ManageEndpoints(tTimeout);
-
             /*
              * Reset an existing Alert() or Stop().  If it's an alert, we
              * will deal with looking for the incoming listen requests at
@@ -1595,18 +1853,36 @@ void* TCPTransport::Run(void* arg)
                 continue;
             }
 
+#if defined(QCC_OS_LINUX)
+            /*
+             * The epoll fd is readable so find out which of the listen fds
+             * have connections waiting.
+             */
+            struct epoll_event events[MAX_LISTEN_EVENTS];
+            int n = epoll_wait(m_listenEpollFd, events, MAX_LISTEN_EVENTS, 0);
+            for (int j = 0; j < n; ++j) {
+                readyFds.push_back(events[j].data.fd);
+            }
+#else
+            readyFds.push_back((*i)->GetFD());
+#endif
+        }
+
+        for (vector<SocketFd>::iterator i = readyFds.begin(); i != readyFds.end(); ++i) {
             /*
-             * Since the current event is not the stop event, it must reflect at
-             * least one of the SocketFds we are waiting on for incoming
-             * connections.  Go ahead and Accept() the new connection on the
-             * current SocketFd.
+             * Accept() all of the connections waiting on the current SocketFd
+             * before going back to wait.
              */
             IPAddress remoteAddr;
             uint16_t remotePort;
             SocketFd newSock;
 
             while (true) {
-                status = Accept((*i)->GetFD(), remoteAddr, remotePort, newSock);
+#if defined(QCC_OS_LINUX)
+                status = AcceptNonBlocking(*i, remoteAddr, remotePort, newSock);
+#else
+                status = Accept(*i, remoteAddr, remotePort, newSock);
+#endif
                 if (status != ER_OK) {
                     break;
                 }
@@ -1635,11 +1911,11 @@ void* TCPTransport::Run(void* arg)
                     /*
                      * By putting the connection on the m_authList, we are
                      * transferring responsibility for the connection to the
-                     * Authentication thread.  Therefore, we must check that the
-                     * thread actually started running to ensure the handoff
-                     * worked.  If it didn't we need to deal with the connection
-                     * here.  Since there are no threads running we can just
-                     * pitch the connection.
+                     * authentication.  Therefore, we must check that the
+                     * stream was actually added to the IODispatch to ensure
+                     * the handoff worked.  If it didn't we need to deal with
+                     * the connection here.  Since no callbacks are running we
+                     * can just pitch the connection.
                      */
                     std::pair<std::set<TCPEndpoint>::iterator, bool> ins = m_authList.insert(conn);
                     status = conn->Authenticate();
@@ -1668,18 +1944,15 @@ void* TCPTransport::Run(void* arg)
             }
         }
 
-        /*
-         * We're going to loop back and create a new list of checkEvents that
-         * reflect the current state, so we need to delete the checkEvents we
-         * created on this iteration.
-         */
-        for (vector<Event*>::iterator i = checkEvents.begin(); i != checkEvents.end(); ++i) {
-            if (*i != &stopEvent) {
-                delete *i;
-            }
-        }
+    }
 
+#if !defined(QCC_OS_LINUX)
+    for (vector<Event*>::iterator i = checkEvents.begin(); i != checkEvents.end(); ++i) {
+        if (*i != &stopEvent) {
+            delete *i;
+        }
     }
+#endif
 
     /*
      * If we're stopping, it is our responsibility to clean up the list of FDs
@@ -1695,6 +1968,7 @@ void* TCPTransport::Run(void* arg)
         qcc::Close(i->second);
     }
     m_listenFds.clear();
+    ++m_listenFdsGeneration;
     m_listenFdsLock.Unlock(MUTEX_CONTEXT);
 
     QCC_DbgPrintf(("TCPTransport::Run is exiting status=%s", QCC_StatusText(status)));
@@ -3227,7 +3501,21 @@ QStatus TCPTransport::DoStartListen(qcc::String& normSpec)
         status = qcc::Listen(listenFd, MAX_LISTEN_CONNECTIONS);
         if (status == ER_OK) {
             QCC_DbgPrintf(("TCPTransport::DoStartListen(): Listening on %s/%d", argMap["r4addr"].c_str(), listenPort));
-            m_listenFds.push_back(pair<qcc::String, SocketFd>(normSpec, listenFd));
+#if defined(QCC_OS_LINUX)
+            struct epoll_event ev;
+            memset(&ev, 0, sizeof(ev));
+            ev.events = EPOLLIN;
+            ev.data.fd = listenFd;
+            if (epoll_ctl(m_listenEpollFd, EPOLL_CTL_ADD, listenFd, &ev) < 0) {
+                status = ER_OS_ERROR;
+                QCC_LogError(status, ("TCPTransport::DoStartListen(): epoll_ctl() failed: %s", strerror(errno)));
+                qcc::Close(listenFd);
+            }
+#endif
+            if (status == ER_OK) {
+                m_listenFds.push_back(pair<qcc::String, SocketFd>(normSpec, listenFd));
+                ++m_listenFdsGeneration;
+            }
         } else {
             QCC_LogError(status, ("TCPTransport::DoStartListen(): Listen failed"));
         }
@@ -3444,6 +3732,11 @@ void TCPTransport::DoStopListen(qcc::String& normSpec)
         if (i->first == normSpec) {
             stopFd = i->second;
             m_listenFds.erase(i);
+            ++m_listenFdsGeneration;
+#if defined(QCC_OS_LINUX)
+            struct epoll_event ev;
+            epoll_ctl(m_listenEpollFd, EPOLL_CTL_DEL, stopFd, &ev);
+#endif
             found = true;
             break;
         }
@@ -37,6 +37,7 @@
 #include <qcc/Thread.h>
 #include <qcc/Socket.h>
 #include <qcc/SocketStream.h>
+#include <qcc/Timer.h>
 #include <qcc/time.h>
 
 #include <alljoyn/TransportMask.h>
@@ -295,6 +296,7 @@ class TCPTransport : public Transport, public _RemoteEndpoint::EndpointListener,
     std::set<TCPEndpoint> m_endpointList;                          /**< List of active endpoints */
     std::set<Thread*> m_activeEndpointsThreadList;                 /**< List of threads starting up active endpoints */
     qcc::Mutex m_endpointListLock;                                 /**< Mutex that protects the endpoint and auth lists */
+    qcc::Timer m_authTimer;                                        /**< Runs the authentication steps that may block */
 
     std::list<std::pair<qcc::String, qcc::SocketFd> > m_listenFds; /**< File descriptors the transport is listening on */
     qcc::Mutex m_listenFdsLock;                                    /**< Mutex that protects m_listenFds */
@@ -443,6 +445,10 @@ class TCPTransport : public Transport, public _RemoteEndpoint::EndpointListener,
      * @internal
      * @brief Authentication complete notificiation.
      *
+     * Called from an IODispatch callback or an auth timer thread when the
+     * authentication of conn succeeds.  If the endpoint cannot be handed off
+     * yet it is left on the m_authList and started by ManageEndpoints().
+     *
      * @param conn Reference to the TCPEndpoint that completed authentication.
      */
     void Authenticated(TCPEndpoint& conn);
@@ -487,6 +493,16 @@ class TCPTransport : public Transport, public _RemoteEndpoint::EndpointListener,
      */
     static const uint32_t ALLJOYN_AUTH_TIMEOUT_DEFAULT = 30000;
 
+    /**
+     * @brief The number of threads that run authentication steps that may
+     * block.
+     *
+     * Authenticating connections do not have threads of their own.  They are
+     * driven by IODispatch read callbacks, and only the steps that call out to
+     * an auth listener or the key store are run on this many threads.
+     */
+    static const uint32_t ALLJOYN_AUTH_THREADS_TCP_DEFAULT = 4;
+
     /**
      * @brief The default value for the maximum number of authenticating
      * connections.
@@ -530,6 +546,23 @@ class TCPTransport : public Transport, public _RemoteEndpoint::EndpointListener,
      * This is to limit the amount of resources being used by untrusted clients.
      */
     static const uint32_t ALLJOYN_MAX_UNTRUSTED_CLIENTS_DEFAULT = 0;
+
+    /**
+     * @brief The default number of bytes queued for transmission on a TCP
+     * endpoint at which ordinary pushes start to block.
+     *
+     * To override this value, change the limit, "tx_queue_high_watermark".
+     * Method replies and control messages are never blocked by this limit.
+     */
+    static const uint32_t ALLJOYN_TX_QUEUE_HIGH_WATERMARK_TCP_DEFAULT = 128 * 1024;
+
+    /**
+     * @brief The default number of queued bytes at which blocked pushes on a
+     * TCP endpoint are allowed to continue.
+     *
+     * To override this value, change the limit, "tx_queue_low_watermark".
+     */
+    static const uint32_t ALLJOYN_TX_QUEUE_LOW_WATERMARK_TCP_DEFAULT = 64 * 1024;
     /*
      * The Android Compatibility Test Suite (CTS) is used by Google to enforce a
      * common idea of what it means to be Android.  One of their tests is to
@@ -638,6 +671,10 @@ class TCPTransport : public Transport, public _RemoteEndpoint::EndpointListener,
     bool m_isListening;
     bool m_isNsEnabled;
     bool m_reload;             /**< Flag used for synchronization of DoStopListen with the Run thread */
+    uint32_t m_listenFdsGeneration; /**< Incremented each time m_listenFds changes */
+#if defined(QCC_OS_LINUX)
+    int m_listenEpollFd;       /**< epoll set of the listen fds, kept in step with m_listenFds */
+#endif
 
     uint16_t m_listenPort;     /**< If m_isListening, is the port on which we are listening */
 
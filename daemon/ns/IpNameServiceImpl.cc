@@ -32,6 +32,13 @@
 #include <iphlpapi.h>
 #endif
 
+#if defined(QCC_OS_LINUX)
+#include <errno.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#endif
+
 #include <qcc/Debug.h>
 #include <qcc/Event.h>
 #include <qcc/Socket.h>
@@ -47,6 +54,13 @@
 
 using namespace std;
 
+#if defined(QCC_OS_LINUX)
+namespace qcc {
+extern QStatus MakeSockAddr(const IPAddress& addr, uint16_t port, struct sockaddr_storage* addrBuf, socklen_t& addrSize);
+extern QStatus GetSockAddr(const sockaddr_storage* addrBuf, socklen_t addrSize, IPAddress& addr, uint16_t& port);
+}
+#endif
+
 namespace ajn {
 
 // ============================================================================
@@ -348,7 +362,7 @@ const char* IpNameServiceImpl::IPV6_ALLJOYN_MULTICAST_GROUP = "ff02::13a";
 // We require an actual character match and do not consider an empty string
 // something that can match or be matched.
 //
-bool IpNameServiceImplWildcardMatch(qcc::String str, qcc::String pat)
+bool IpNameServiceImplWildcardMatch(const qcc::String& str, const qcc::String& pat)
 {
     size_t patsize = pat.size();
     size_t strsize = str.size();
@@ -445,13 +459,48 @@ bool IpNameServiceImplWildcardMatch(qcc::String str, qcc::String pat)
     return true;
 }
 
+bool IpNameServiceImplMatchAny(const set<qcc::String>& names, const qcc::String& pat)
+{
+    //
+    // Zero length strings are unmatchable.
+    //
+    if (pat.size() == 0 || names.empty()) {
+        return false;
+    }
+
+    //
+    // Without wildcards a name can only match itself.
+    //
+    size_t wild = pat.find_first_of("*?");
+    if (wild == qcc::String::npos) {
+        return names.find(pat) != names.end();
+    }
+
+    //
+    // Any name the pattern matches starts with the characters before the
+    // first wildcard, and the names sharing that prefix are next to each other
+    // in the sorted set.
+    //
+    qcc::String prefix = pat.substr(0, wild);
+    for (set<qcc::String>::const_iterator i = names.lower_bound(prefix); i != names.end(); ++i) {
+        if (i->compare(0, prefix.size(), prefix) != 0) {
+            break;
+        }
+        if (IpNameServiceImplWildcardMatch(*i, pat) == false) {
+            return true;
+        }
+    }
+    return false;
+}
+
 IpNameServiceImpl::IpNameServiceImpl()
     : Thread("IpNameServiceImpl"), m_state(IMPL_SHUTDOWN), m_isProcSuspending(false),
     m_terminal(false), m_protect_callback(false), m_timer(0), m_tDuration(DEFAULT_DURATION),
     m_tRetransmit(RETRANSMIT_TIME), m_tQuestion(QUESTION_TIME),
     m_modulus(QUESTION_MODULUS), m_retries(NUMBER_RETRIES),
     m_loopback(false), m_enableIPv4(false), m_enableIPv6(false),
-    m_wakeEvent(), m_forceLazyUpdate(false),
+    m_wakeEvent(), m_forceLazyUpdate(false), m_isAtCacheId(0),
+    m_statsWakeups(0), m_statsReceived(0), m_statsSent(0), m_statsSendCalls(0),
     m_enabled(false), m_doEnable(false), m_doDisable(false),
     m_ipv4QuietSockFd(-1), m_ipv6QuietSockFd(-1)
 {
@@ -1405,6 +1454,16 @@ QStatus IpNameServiceImpl::Enable(TransportMask transportMask,
     m_reliableIPv6Port[i] = reliableIPv6Port;
     m_unreliableIPv6Port[i] = reliableIPv6Port;
 
+    //
+    // The ports are written into every is-at message we send, so the cached
+    // messages are now out of date.  The cache is shared with the main thread.
+    //
+    // printf("%s: m_mutex.Lock()\n", __FUNCTION__);
+    m_mutex.Lock();
+    ClearIsAtCache();
+    // printf("%s: m_mutex.Unlock()\n", __FUNCTION__);
+    m_mutex.Unlock();
+
     //
     // We might be wanting to disable the name service depending on whether we
     // end up disabling the last of the enabled ports.
@@ -1586,11 +1645,20 @@ void IpNameServiceImpl::SetCriticalParameters(
     uint32_t modulus,
     uint32_t retries)
 {
+    // printf("%s: m_mutex.Lock()\n", __FUNCTION__);
+    m_mutex.Lock();
     m_tDuration = tDuration;
     m_tRetransmit = tRetransmit;
     m_tQuestion = tQuestion;
     m_modulus = modulus;
     m_retries = retries;
+
+    //
+    // The duration is the timer of every is-at message we send.
+    //
+    ClearIsAtCache();
+    // printf("%s: m_mutex.Unlock()\n", __FUNCTION__);
+    m_mutex.Unlock();
 }
 
 QStatus IpNameServiceImpl::SetCallback(TransportMask transportMask,
@@ -1717,16 +1785,16 @@ QStatus IpNameServiceImpl::AdvertiseName(TransportMask transportMask, vector<qcc
     //
     // Make a note to ourselves which services we are advertising so we can
     // respond to protocol questions in the future.  Only allow one entry per
-    // name.  We keep separate lists of quietly advertised names and actively
+    // name.  We keep separate sets of quietly advertised names and actively
     // advertised names since it makes it easy to decide which names go in
-    // periodic keep-alive advertisements.
+    // periodic keep-alive advertisements.  The sets are sorted so we can
+    // easily distinguish a change in the content of the advertised names
+    // versus a change in the order of the names, and so that questions can be
+    // answered by looking at the names sharing a prefix.
     //
     if (quietly) {
         for (uint32_t i = 0; i < wkn.size(); ++i) {
-            list<qcc::String>::iterator j = find(m_advertised_quietly[transportIndex].begin(), m_advertised_quietly[transportIndex].end(), wkn[i]);
-            if (j == m_advertised_quietly[transportIndex].end()) {
-                m_advertised_quietly[transportIndex].push_back(wkn[i]);
-            } else {
+            if (m_advertised_quietly[transportIndex].insert(wkn[i]).second == false) {
                 //
                 // Nothing has changed, so don't bother.
                 //
@@ -1735,14 +1803,13 @@ QStatus IpNameServiceImpl::AdvertiseName(TransportMask transportMask, vector<qcc
                 m_mutex.Unlock();
                 return ER_OK;
             }
-        }
 
-        //
-        // Keep the list sorted so we can easily distinguish a change in
-        // the content of the advertised names versus a change in the order of the
-        // names.
-        //
-        m_advertised_quietly[transportIndex].sort();
+            //
+            // The quietly advertised names go out in answers to questions, so
+            // the cached answers are now out of date.
+            //
+            ClearIsAtCache();
+        }
 
         //
         // Since we are advertising quietly, we need to quetly return without
@@ -1754,10 +1821,7 @@ QStatus IpNameServiceImpl::AdvertiseName(TransportMask transportMask, vector<qcc
         return ER_OK;
     } else {
         for (uint32_t i = 0; i < wkn.size(); ++i) {
-            list<qcc::String>::iterator j = find(m_advertised[transportIndex].begin(), m_advertised[transportIndex].end(), wkn[i]);
-            if (j == m_advertised[transportIndex].end()) {
-                m_advertised[transportIndex].push_back(wkn[i]);
-            } else {
+            if (m_advertised[transportIndex].insert(wkn[i]).second == false) {
                 //
                 // Nothing has changed, so don't bother.
                 //
@@ -1767,15 +1831,9 @@ QStatus IpNameServiceImpl::AdvertiseName(TransportMask transportMask, vector<qcc
                 m_mutex.Unlock();
                 return ER_OK;
             }
+            ClearIsAtCache();
         }
 
-        //
-        // Keep the list sorted so we can easily distinguish a change in
-        // the content of the advertised names versus a change in the order of the
-        // names.
-        //
-        m_advertised[transportIndex].sort();
-
         //
         // If the advertisement retransmission timer is cleared, then set us
         // up to retransmit.  This has to be done with the mutex locked since
@@ -2046,19 +2104,20 @@ QStatus IpNameServiceImpl::CancelAdvertiseName(TransportMask transportMask, vect
     // variable <changed> drives this network operation and so <changed> is not
     // set in the quietly advertised list even though the list was changed.
     //
+    bool changedQuietly = false;
     for (uint32_t i = 0; i < wkn.size(); ++i) {
-        list<qcc::String>::iterator j = find(m_advertised[transportIndex].begin(), m_advertised[transportIndex].end(), wkn[i]);
-        if (j != m_advertised[transportIndex].end()) {
-            m_advertised[transportIndex].erase(j);
+        if (m_advertised[transportIndex].erase(wkn[i])) {
             changed = true;
         }
-
-        list<qcc::String>::iterator k = find(m_advertised_quietly[transportIndex].begin(), m_advertised_quietly[transportIndex].end(), wkn[i]);
-        if (k != m_advertised_quietly[transportIndex].end()) {
-            m_advertised_quietly[transportIndex].erase(k);
+        if (m_advertised_quietly[transportIndex].erase(wkn[i])) {
+            changedQuietly = true;
         }
     }
 
+    if (changed || changedQuietly) {
+        ClearIsAtCache();
+    }
+
     //
     // If we have no more advertisements, there is no need to repeatedly state
     // this so turn off the retransmit timer.  The main thread is playing with
@@ -2418,18 +2477,40 @@ void IpNameServiceImpl::SendProtocolMessage(
     uint32_t nsVersion, msgVersion;
     header.GetVersion(nsVersion, msgVersion);
 
-    size_t size = header.GetSerializedSize();
-
-    if (size > NS_MESSAGE_MAX) {
-        QCC_LogError(ER_FAIL, ("SendProtocolMessage: Message (%d bytes) is longer than NS_MESSAGE_MAX (%d bytes)",
-                               size, NS_MESSAGE_MAX));
-        return;
+    //
+    // If this is one of the is-at messages we keep around, it may already have
+    // been serialized with the addresses of this interface.  If not, serialize
+    // it now and keep the bytes for the next time it goes out this interface.
+    //
+    vector<uint8_t> serialized;
+    vector<uint8_t>* packet = &serialized;
+    map<pair<uint32_t, uint32_t>, vector<uint8_t> >::iterator it = m_isAtPackets.end();
+    if (header.GetCacheId()) {
+        it = m_isAtPackets.find(make_pair(header.GetCacheId(), interfaceIndex));
     }
 
-    uint8_t* buffer = new uint8_t[size];
-    header.Serialize(buffer);
+    if (it != m_isAtPackets.end()) {
+        packet = &it->second;
+    } else {
+        size_t size = header.GetSerializedSize();
 
-    size_t sent;
+        if (size > NS_MESSAGE_MAX) {
+            QCC_LogError(ER_FAIL, ("SendProtocolMessage: Message (%d bytes) is longer than NS_MESSAGE_MAX (%d bytes)",
+                                   size, NS_MESSAGE_MAX));
+            return;
+        }
+
+        serialized.resize(size);
+        header.Serialize(&serialized[0]);
+
+        if (header.GetCacheId()) {
+            packet = &m_isAtPackets[make_pair(header.GetCacheId(), interfaceIndex)];
+            packet->swap(serialized);
+        }
+    }
+
+    uint8_t* buffer = &(*packet)[0];
+    size_t size = packet->size();
 
     //
     // We have the concept of a quiet advertisement which means that we don't
@@ -2479,9 +2560,9 @@ void IpNameServiceImpl::SendProtocolMessage(
             QCC_DbgHLPrintf(("IpNameServiceImpl::SendProtocolMessage(): Sending quietly to \"%s\" over \"%s\"", destination.ToString().c_str(), m_liveInterfaces[interfaceIndex].m_interfaceName.c_str()));
 
             if (family == qcc::QCC_AF_INET) {
-                status = qcc::SendTo(m_ipv4QuietSockFd, destination, MULTICAST_PORT, buffer, size, sent);
+                status = SendPacket(m_ipv4QuietSockFd, destination, MULTICAST_PORT, buffer, size);
             } else {
-                status = qcc::SendTo(m_ipv6QuietSockFd, destination, MULTICAST_PORT, buffer, size, sent);
+                status = SendPacket(m_ipv6QuietSockFd, destination, MULTICAST_PORT, buffer, size);
             }
         }
 
@@ -2489,7 +2570,6 @@ void IpNameServiceImpl::SendProtocolMessage(
             QCC_LogError(status, ("IpNameServiceImpl::SendProtocolMessage(): Error quietly sending to \"%s\"", destination.ToString().c_str()));
         }
 
-        delete [] buffer;
         return;
     }
 
@@ -2516,7 +2596,7 @@ void IpNameServiceImpl::SendProtocolMessage(
                 qcc::IPAddress ipv4SiteAdminMulticast(IPV4_MULTICAST_GROUP);
                 QCC_DbgHLPrintf(("IpNameServiceImpl::SendProtocolMessage():  Sending actively to \"%s\" over \"%s\"",
                                  ipv4SiteAdminMulticast.ToString().c_str(), m_liveInterfaces[interfaceIndex].m_interfaceName.c_str()));
-                QStatus status = qcc::SendTo(sockFd, ipv4SiteAdminMulticast, MULTICAST_PORT, buffer, size, sent);
+                QStatus status = SendPacket(sockFd, ipv4SiteAdminMulticast, MULTICAST_PORT, buffer, size);
                 if (status != ER_OK) {
                     QCC_LogError(status, ("IpNameServiceImpl::SendProtocolMessage():  Error sending to IPv4 Site Administered multicast group"));
                 }
@@ -2526,7 +2606,7 @@ void IpNameServiceImpl::SendProtocolMessage(
             qcc::IPAddress ipv4LocalMulticast(IPV4_ALLJOYN_MULTICAST_GROUP);
             QCC_DbgHLPrintf(("IpNameServiceImpl::SendProtocolMessage():  Sending actively to \"%s\" over \"%s\"",
                              ipv4LocalMulticast.ToString().c_str(), m_liveInterfaces[interfaceIndex].m_interfaceName.c_str()));
-            QStatus status = qcc::SendTo(sockFd, ipv4LocalMulticast, MULTICAST_PORT, buffer, size, sent);
+            QStatus status = SendPacket(sockFd, ipv4LocalMulticast, MULTICAST_PORT, buffer, size);
             if (status != ER_OK) {
                 QCC_LogError(status, ("IpNameServiceImpl::SendProtocolMessage():  Error sending to IPv4 Local Network Control Block multicast group"));
             }
@@ -2574,7 +2654,7 @@ void IpNameServiceImpl::SendProtocolMessage(
                 qcc::IPAddress ipv4Broadcast(addr);
                 QCC_DbgHLPrintf(("IpNameServiceImpl::SendProtocolMessage():  Sending actively to \"%s\" over \"%s\"",
                                  ipv4Broadcast.ToString().c_str(), m_liveInterfaces[interfaceIndex].m_interfaceName.c_str()));
-                QStatus status = qcc::SendTo(sockFd, ipv4Broadcast, BROADCAST_PORT, buffer, size, sent);
+                QStatus status = SendPacket(sockFd, ipv4Broadcast, BROADCAST_PORT, buffer, size);
                 if (status != ER_OK) {
                     QCC_LogError(ER_FAIL, ("IpNameServiceImpl::SendProtocolMessage():  Error sending to IPv4 (broadcast)"));
                 }
@@ -2593,7 +2673,7 @@ void IpNameServiceImpl::SendProtocolMessage(
                 qcc::IPAddress ipv6SiteAdmin(IPV6_MULTICAST_GROUP);
                 QCC_DbgHLPrintf(("IpNameServiceImpl::SendProtocolMessage():  Sending actively to \"%s\" over \"%s\"",
                                  ipv6SiteAdmin.ToString().c_str(), m_liveInterfaces[interfaceIndex].m_interfaceName.c_str()));
-                QStatus status = qcc::SendTo(sockFd, ipv6SiteAdmin, MULTICAST_PORT, buffer, size, sent);
+                QStatus status = SendPacket(sockFd, ipv6SiteAdmin, MULTICAST_PORT, buffer, size);
                 if (status != ER_OK) {
                     QCC_LogError(status, ("IpNameServiceImpl::SendProtocolMessage():  Error sending to IPv6 Site Administered multicast group "));
                 }
@@ -2604,14 +2684,12 @@ void IpNameServiceImpl::SendProtocolMessage(
             qcc::IPAddress ipv6AllJoyn(IPV6_ALLJOYN_MULTICAST_GROUP);
             QCC_DbgHLPrintf(("IpNameServiceImpl::SendProtocolMessage():  Sending actively to \"%s\" over \"%s\"",
                              ipv6AllJoyn.ToString().c_str(), m_liveInterfaces[interfaceIndex].m_interfaceName.c_str()));
-            QStatus status = qcc::SendTo(sockFd, ipv6AllJoyn, MULTICAST_PORT, buffer, size, sent);
+            QStatus status = SendPacket(sockFd, ipv6AllJoyn, MULTICAST_PORT, buffer, size);
             if (status != ER_OK) {
                 QCC_LogError(status, ("IpNameServiceImpl::SendProtocolMessage():  Error sending to IPv6 Link-Local Scope multicast group "));
             }
         }
     }
-
-    delete [] buffer;
 }
 
 bool IpNameServiceImpl::InterfaceRequested(uint32_t transportIndex, uint32_t liveIndex)
@@ -2996,7 +3074,12 @@ void IpNameServiceImpl::SendOutboundMessageQuietly(Header& header)
             // that will correspond to the interface we are sending the message out
             // of.
             //
-            for (uint8_t j = 0; j < header.GetNumberAnswers(); ++j) {
+            // If we have already serialized this message for this interface, the
+            // addresses are already written into the bytes we kept and there is
+            // nothing to rewrite.
+            //
+            bool cached = header.GetCacheId() && m_isAtPackets.find(make_pair(header.GetCacheId(), i)) != m_isAtPackets.end();
+            for (uint8_t j = 0; cached == false && j < header.GetNumberAnswers(); ++j) {
                 QCC_DbgPrintf(("IpNameServiceImpl::SendOutboundMessageQuietly(): Rewrite answer %d.", j));
 
                 IsAt* isAt;
@@ -3226,7 +3309,12 @@ void IpNameServiceImpl::SendOutboundMessageActively(Header& header)
         // message was going out over.  Question (who-has) messages don't have any
         // address information so we don't have to touch them.
         //
-        for (uint8_t j = 0; j < header.GetNumberAnswers(); ++j) {
+        // If we have already serialized this message for this interface, the
+        // addresses are already written into the bytes we kept and there is
+        // nothing to rewrite.
+        //
+        bool cached = header.GetCacheId() && m_isAtPackets.find(make_pair(header.GetCacheId(), i)) != m_isAtPackets.end();
+        for (uint8_t j = 0; cached == false && j < header.GetNumberAnswers(); ++j) {
             QCC_DbgPrintf(("IpNameServiceImpl::SendOutboundMessageActively(): Rewrite answer %d.", j));
 
             IsAt* isAt;
@@ -3259,44 +3347,300 @@ void IpNameServiceImpl::SendOutboundMessages(void)
     //
     while (m_outbound.size() && (m_state == IMPL_RUNNING || m_terminal)) {
 
-        QCC_DbgPrintf(("IpNameServiceImpl::SendOutboundMessages(): m_outbound.size() == %d.", m_outbound.size()));
-
         //
-        // Pull a message off of the outbound queue.  What we get is a
-        // header object that will tie together a number of "question"
-        // (who-has) objects and a number of "answer" (is-at) objects.
+        // On dense networks, where hundreds of daemons may be announcing at
+        // once, we can find quite a few messages waiting here.  Rather than
+        // going to the network once per message per destination, we take a
+        // few of the queued messages and let SendPacket() collect the
+        // resulting datagrams so they go out in as few system calls as
+        // possible when we flush them below.
         //
-        Header header = m_outbound.front();
+        uint32_t sent = 0;
+        while (sent < SEND_MESSAGES_MAX && m_outbound.size() && (m_state == IMPL_RUNNING || m_terminal)) {
 
-        //
-        // We have the concept of quiet advertisements that imply quiet
-        // (unicast) responses.  If we have a quiet response, we know because a
-        // destination address will have been set in the header.
-        //
-        if (header.DestinationSet()) {
-            SendOutboundMessageQuietly(header);
-        } else {
-            SendOutboundMessageActively(header);
+            QCC_DbgPrintf(("IpNameServiceImpl::SendOutboundMessages(): m_outbound.size() == %d.", m_outbound.size()));
+
+            //
+            // Pull a message off of the outbound queue.  What we get is a
+            // header object that will tie together a number of "question"
+            // (who-has) objects and a number of "answer" (is-at) objects.
+            //
+            Header header = m_outbound.front();
+
+            //
+            // We have the concept of quiet advertisements that imply quiet
+            // (unicast) responses.  If we have a quiet response, we know because a
+            // destination address will have been set in the header.
+            //
+            if (header.DestinationSet()) {
+                SendOutboundMessageQuietly(header);
+            } else {
+                SendOutboundMessageActively(header);
+            }
+
+            //
+            // The current message has been sent to any and all of interfaces that
+            // make sense, so we can discard it and loop back for another.
+            //
+            m_outbound.pop_front();
+            ++sent;
         }
 
-        //
-        // The current message has been sent to any and all of interfaces that
-        // make sense, so we can discard it and loop back for another.
-        //
-        m_outbound.pop_front();
+        FlushPackets();
 
+        //
         // This is to limit the number of name service messages that
         // can be sent out on the network for any given amount of time; which
         // is good for preventing our users from trying to advertise zillions
-        // of names and flooding the net.
+        // of names and flooding the net.  We pause once per batch rather than
+        // once per message, so the jittered pause is scaled by the number of
+        // messages in the batch to keep the average rate per message.
         //
         m_mutex.Unlock();
-        qcc::Sleep(rand() % 128);
+        qcc::Sleep(rand() % (128 * sent));
         m_mutex.Lock();
 
     }
 }
 
+QStatus IpNameServiceImpl::SendPacket(
+    qcc::SocketFd sockFd,
+    const qcc::IPAddress& destination,
+    uint16_t port,
+    const uint8_t* buffer,
+    size_t size)
+{
+#if defined(QCC_OS_LINUX)
+    //
+    // Linux lets us hand a whole array of datagrams to the kernel with one
+    // sendmmsg() call, so we just copy the datagram into the next free slot
+    // of the batch and send it along with the others in FlushPackets().  If
+    // the batch is full, make room first.
+    //
+    assert(size <= NS_MESSAGE_MAX && "IpNameServiceImpl::SendPacket(): Datagram too large");
+
+    if (m_sendBatch.size() == SEND_BATCH_MAX) {
+        FlushPackets();
+    }
+
+    if (m_sendBuffers.empty()) {
+        m_sendBuffers.resize(SEND_BATCH_MAX * NS_MESSAGE_MAX);
+    }
+
+    BatchedPacket packet;
+    packet.m_sockFd = sockFd;
+    packet.m_destination = destination;
+    packet.m_port = port;
+    packet.m_size = size;
+    memcpy(&m_sendBuffers[m_sendBatch.size() * NS_MESSAGE_MAX], buffer, size);
+    m_sendBatch.push_back(packet);
+    return ER_OK;
+#else
+    //
+    // Everywhere else datagrams go out one at a time as they are handed to us.
+    //
+    size_t sent;
+    QStatus status = qcc::SendTo(sockFd, destination, port, buffer, size, sent);
+    if (status == ER_OK) {
+        ++m_statsSent;
+    }
+    ++m_statsSendCalls;
+    return status;
+#endif
+}
+
+void IpNameServiceImpl::FlushPackets(void)
+{
+#if defined(QCC_OS_LINUX)
+    QCC_DbgPrintf(("IpNameServiceImpl::FlushPackets(): %d datagrams", m_sendBatch.size()));
+
+    struct mmsghdr msgs[SEND_BATCH_MAX];
+    struct iovec iovs[SEND_BATCH_MAX];
+    struct sockaddr_storage addrs[SEND_BATCH_MAX];
+    bool flushed[SEND_BATCH_MAX];
+    memset(flushed, 0, sizeof(flushed));
+
+    //
+    // SendOutboundMessageActively() walks the live interfaces for every
+    // message, so the datagrams for any one socket are interleaved with those
+    // for the others in the batch.  Gather all of the datagrams queued on a
+    // socket, in the order they were queued, and hand them to the kernel in one
+    // go before moving on to the next socket.
+    //
+    for (uint32_t first = 0; first < m_sendBatch.size(); ++first) {
+        if (flushed[first]) {
+            continue;
+        }
+        qcc::SocketFd sockFd = m_sendBatch[first].m_sockFd;
+
+        uint32_t n = 0;
+        for (uint32_t i = first; i < m_sendBatch.size(); ++i) {
+            if (flushed[i] || m_sendBatch[i].m_sockFd != sockFd) {
+                continue;
+            }
+            flushed[i] = true;
+
+            socklen_t addrLen = sizeof(addrs[n]);
+            QStatus status = qcc::MakeSockAddr(m_sendBatch[i].m_destination, m_sendBatch[i].m_port, &addrs[n], addrLen);
+            if (status != ER_OK) {
+                QCC_LogError(status, ("IpNameServiceImpl::FlushPackets(): Bad destination \"%s\"", m_sendBatch[i].m_destination.ToString().c_str()));
+                continue;
+            }
+            iovs[n].iov_base = &m_sendBuffers[i * NS_MESSAGE_MAX];
+            iovs[n].iov_len = m_sendBatch[i].m_size;
+            memset(&msgs[n], 0, sizeof(msgs[n]));
+            msgs[n].msg_hdr.msg_name = &addrs[n];
+            msgs[n].msg_hdr.msg_namelen = addrLen;
+            msgs[n].msg_hdr.msg_iov = &iovs[n];
+            msgs[n].msg_hdr.msg_iovlen = 1;
+            ++n;
+        }
+
+        //
+        // If the kernel takes only part of the datagrams, we hand it the rest;
+        // if it refuses a datagram outright, we log it and move on to the next
+        // one as we would have done sending them one at a time.
+        //
+        uint32_t done = 0;
+        while (done < n) {
+            int ret = sendmmsg(sockFd, &msgs[done], n - done, 0);
+            ++m_statsSendCalls;
+            if (ret < 0) {
+                if (errno == EINTR) {
+                    continue;
+                }
+                QCC_LogError(ER_OS_ERROR, ("IpNameServiceImpl::FlushPackets(): sendmmsg(%d, ...) failed: %d - %s", sockFd, errno, strerror(errno)));
+                ++done;
+            } else {
+                done += ret;
+                m_statsSent += ret;
+            }
+        }
+    }
+
+    m_sendBatch.clear();
+#endif
+}
+
+uint32_t IpNameServiceImpl::ReceivePackets(qcc::SocketFd sockFd)
+{
+    if (m_recvBuffers.empty()) {
+        m_recvBuffers.resize(RECV_BATCH_MAX * NS_MESSAGE_MAX);
+    }
+
+    uint32_t nReceived = 0;
+
+#if defined(QCC_OS_LINUX)
+    //
+    // Pull everything that is waiting on the socket into the receive pool a
+    // batch at a time with recvmmsg().  We stop when the socket has nothing
+    // more for us, or when we have handled RECV_WAKEUP_MAX datagrams so that a
+    // flood on one network cannot keep us from the others or from our timer.
+    //
+    struct mmsghdr msgs[RECV_BATCH_MAX];
+    struct iovec iovs[RECV_BATCH_MAX];
+    struct sockaddr_storage addrs[RECV_BATCH_MAX];
+
+    while (nReceived < RECV_WAKEUP_MAX) {
+        for (uint32_t i = 0; i < RECV_BATCH_MAX; ++i) {
+            iovs[i].iov_base = &m_recvBuffers[i * NS_MESSAGE_MAX];
+            iovs[i].iov_len = NS_MESSAGE_MAX;
+            memset(&msgs[i], 0, sizeof(msgs[i]));
+            msgs[i].msg_hdr.msg_name = &addrs[i];
+            msgs[i].msg_hdr.msg_namelen = sizeof(addrs[i]);
+            msgs[i].msg_hdr.msg_iov = &iovs[i];
+            msgs[i].msg_hdr.msg_iovlen = 1;
+        }
+
+        QCC_DbgPrintf(("IpNameServiceImpl::ReceivePackets(): Call recvmmsg()"));
+
+        int ret = recvmmsg(sockFd, msgs, RECV_BATCH_MAX, MSG_DONTWAIT, NULL);
+        if (ret < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+
+            //
+            // Running out of datagrams is the normal way out of this loop.  As
+            // with qcc::RecvFrom() errors on other platforms, anything else
+            // gets a short sleep so that a persistent error cannot turn into
+            // a loop sucking up all available CPU.
+            //
+            if (errno != EAGAIN && errno != EWOULDBLOCK) {
+                QCC_LogError(ER_OS_ERROR, ("IpNameServiceImpl::ReceivePackets(): recvmmsg(%d, ...): Failed: %d - %s", sockFd, errno, strerror(errno)));
+                qcc::Sleep(1);
+            }
+            break;
+        }
+
+        for (int i = 0; i < ret; ++i) {
+            qcc::IPAddress address;
+            uint16_t port;
+            QStatus status = qcc::GetSockAddr(&addrs[i], msgs[i].msg_hdr.msg_namelen, address, port);
+            if (status != ER_OK) {
+                QCC_LogError(status, ("IpNameServiceImpl::ReceivePackets(): Unexpected source address"));
+                continue;
+            }
+
+            QCC_DbgHLPrintf(("IpNameServiceImpl::ReceivePackets(): Got IPNS message from \"%s\"", address.ToString().c_str()));
+
+            //
+            // We got a message over the multicast channel.  Deal with it.
+            //
+            HandleProtocolMessage(&m_recvBuffers[i * NS_MESSAGE_MAX], msgs[i].msg_len, address);
+        }
+
+        nReceived += ret;
+
+        if (ret < static_cast<int>(RECV_BATCH_MAX)) {
+            break;
+        }
+    }
+#else
+    QCC_DbgPrintf(("IpNameServiceImpl::ReceivePackets(): Call qcc::RecvFrom()"));
+
+    qcc::IPAddress address;
+    uint16_t port;
+    size_t nbytes;
+
+    QStatus status = qcc::RecvFrom(sockFd, address, port, &m_recvBuffers[0], NS_MESSAGE_MAX, nbytes);
+    if (status != ER_OK) {
+        //
+        // We have a RecvFrom error.  We want to avoid states where
+        // we get repeated read errors and just end up in an
+        // infinite loop getting errors sucking up all available
+        // CPU, so we make sure we sleep for at least a short time
+        // after detecting the error.
+        //
+        // Our basic strategy is to hope that this is a transient
+        // error, or one that will be recovered at the next lazy
+        // update.  We don't want to blindly force a lazy update
+        // or we may get into an infinite lazy update loop, so
+        // the worst that can happen is that we introduce a short
+        // delay here in our handler whenever we detect an error.
+        //
+        // On Windows ER_WOULBLOCK can be expected because it takes
+        // an initial call to recv to determine if the socket is readable.
+        //
+        if (status != ER_WOULDBLOCK) {
+            QCC_LogError(status, ("IpNameServiceImpl::ReceivePackets(): qcc::RecvFrom(%d, ...): Failed", sockFd));
+            qcc::Sleep(1);
+        }
+        return 0;
+    }
+
+    QCC_DbgHLPrintf(("IpNameServiceImpl::ReceivePackets(): Got IPNS message from \"%s\"", address.ToString().c_str()));
+
+    //
+    // We got a message over the multicast channel.  Deal with it.
+    //
+    HandleProtocolMessage(&m_recvBuffers[0], nbytes, address);
+    nReceived = 1;
+#endif
+
+    return nReceived;
+}
+
 void* IpNameServiceImpl::Run(void* arg)
 {
     QCC_DbgPrintf(("IpNameServiceImpl::Run()"));
@@ -3323,9 +3667,6 @@ void* IpNameServiceImpl::Run(void* arg)
     // everything here.  Because it is easier to manage the process in one
     // place, we have all messages gonig through this thread.
     //
-    size_t bufsize = NS_MESSAGE_MAX;
-    uint8_t* buffer = new uint8_t[bufsize];
-
     //
     // Instantiate an event that fires after one second, and once per second
     // thereafter.  Used to drive protocol maintenance functions, especially
@@ -3419,6 +3760,7 @@ void* IpNameServiceImpl::Run(void* arg)
 
             QCC_DbgPrintf(("IpNameServiceImpl::Run(): LazyUpdateInterfaces()"));
             LazyUpdateInterfaces();
+            UpdateIsAtInterfaces();
             tLastLazyUpdate = tNow;
             m_forceLazyUpdate = false;
         }
@@ -3485,8 +3827,12 @@ void* IpNameServiceImpl::Run(void* arg)
         }
 
         //
-        // Loop over the events for which we expect something has happened
+        // Loop over the events for which we expect something has happened.
+        // We keep count of the datagrams we handle from readable sockets so
+        // the debug statistics can tell how many arrive per wakeup.
         //
+        uint32_t nReceived = 0;
+        bool socketFired = false;
         for (vector<qcc::Event*>::iterator i = signaledEvents.begin(); i != signaledEvents.end(); ++i) {
             if (*i == &stopEvent) {
                 QCC_DbgPrintf(("IpNameServiceImpl::Run(): Stop event fired"));
@@ -3534,6 +3880,20 @@ void* IpNameServiceImpl::Run(void* arg)
                 //
 
                 DoPeriodicMaintenance();
+
+                //
+                // Once a second is also a good time to report how the socket
+                // loop has been doing.
+                //
+                if (m_statsWakeups || m_statsSendCalls) {
+                    QCC_DbgPrintf(("IpNameServiceImpl::Run(): Received %d packets in %d wakeups (%d per wakeup), sent %d packets in %d calls",
+                                   m_statsReceived, m_statsWakeups, m_statsWakeups ? m_statsReceived / m_statsWakeups : 0,
+                                   m_statsSent, m_statsSendCalls));
+                    m_statsWakeups = 0;
+                    m_statsReceived = 0;
+                    m_statsSent = 0;
+                    m_statsSendCalls = 0;
+                }
             } else if (*i == &m_wakeEvent) {
                 QCC_DbgPrintf(("IpNameServiceImpl::Run(): Wake event fired"));
                 //
@@ -3548,52 +3908,20 @@ void* IpNameServiceImpl::Run(void* arg)
                 QCC_DbgPrintf(("IpNameServiceImpl::Run(): Socket event fired"));
                 //
                 // This must be activity on one of our multicast listener sockets.
+                // Handle everything that is waiting on it.
                 //
-                qcc::SocketFd sockFd = (*i)->GetFD();
-
-                QCC_DbgPrintf(("IpNameServiceImpl::Run(): Call qcc::RecvFrom()"));
-
-                qcc::IPAddress address;
-                uint16_t port;
-                size_t nbytes;
-
-                QStatus status = qcc::RecvFrom(sockFd, address, port, buffer, bufsize, nbytes);
-                if (status != ER_OK) {
-                    //
-                    // We have a RecvFrom error.  We want to avoid states where
-                    // we get repeated read errors and just end up in an
-                    // infinite loop getting errors sucking up all available
-                    // CPU, so we make sure we sleep for at least a short time
-                    // after detecting the error.
-                    //
-                    // Our basic strategy is to hope that this is a transient
-                    // error, or one that will be recovered at the next lazy
-                    // update.  We don't want to blindly force a lazy update
-                    // or we may get into an infinite lazy update loop, so
-                    // the worst that can happen is that we introduce a short
-                    // delay here in our handler whenever we detect an error.
-                    //
-                    // On Windows ER_WOULBLOCK can be expected because it takes
-                    // an initial call to recv to determine if the socket is readable.
-                    //
-                    if (status != ER_WOULDBLOCK) {
-                        QCC_LogError(status, ("IpNameServiceImpl::Run(): qcc::RecvFrom(%d, ...): Failed", sockFd));
-                        qcc::Sleep(1);
-                    }
-                    continue;
-                }
-
-                QCC_DbgHLPrintf(("IpNameServiceImpl::Run(): Got IPNS message from \"%s\"", address.ToString().c_str()));
-
-                //
-                // We got a message over the multicast channel.  Deal with it.
-                //
-                HandleProtocolMessage(buffer, nbytes, address);
+                nReceived += ReceivePackets((*i)->GetFD());
+                socketFired = true;
             }
         }
+
+        if (socketFired) {
+            QCC_DbgPrintf(("IpNameServiceImpl::Run(): Handled %d packets in this wakeup", nReceived));
+            ++m_statsWakeups;
+            m_statsReceived += nReceived;
+        }
     }
 
-    delete [] buffer;
     return 0;
 }
 
@@ -3645,6 +3973,56 @@ void IpNameServiceImpl::Retry(void)
     }
 }
 
+//
+// The is-at messages we build for a transport differ by message version and by
+// whether or not the quietly advertised names are included, so that is how we
+// find them again.
+//
+static uint32_t IsAtHeadersIndex(uint32_t transportIndex, uint32_t msgVersion, bool quietly)
+{
+    return (transportIndex << 2) | (msgVersion << 1) | (quietly ? 1 : 0);
+}
+
+void IpNameServiceImpl::ClearIsAtCache(void)
+{
+    QCC_DbgPrintf(("IpNameServiceImpl::ClearIsAtCache()"));
+
+    //
+    // Messages already on the outbound queue keep their cache identifiers, but
+    // since identifiers are never reused they will simply not be found and
+    // will be rewritten and serialized the old fashioned way.
+    //
+    m_isAtHeaders.clear();
+    m_isAtPackets.clear();
+}
+
+void IpNameServiceImpl::UpdateIsAtInterfaces(void)
+{
+    QCC_DbgPrintf(("IpNameServiceImpl::UpdateIsAtInterfaces()"));
+
+    //
+    // LazyUpdateInterfaces() tears down and rebuilds the live interfaces every
+    // time through, but most of the time it finds exactly the interfaces it
+    // had before.  The serialized messages depend only on the interface
+    // addresses and on their position in the list, so as long as those stay
+    // the same, the bytes we have already written out are still good.
+    //
+    vector<qcc::String> interfaces;
+    for (uint32_t i = 0; i < m_liveInterfaces.size(); ++i) {
+        if (m_liveInterfaces[i].m_sockFd == -1) {
+            interfaces.push_back("");
+        } else {
+            interfaces.push_back(m_liveInterfaces[i].m_interfaceName + " " + m_liveInterfaces[i].m_address.ToString());
+        }
+    }
+
+    if (interfaces != m_isAtInterfaces) {
+        QCC_DbgPrintf(("IpNameServiceImpl::UpdateIsAtInterfaces(): Live interfaces changed"));
+        m_isAtPackets.clear();
+        m_isAtInterfaces.swap(interfaces);
+    }
+}
+
 void IpNameServiceImpl::Retransmit(uint32_t transportIndex, bool exiting, bool quietly, qcc::IPAddress destination)
 {
     QCC_DbgPrintf(("IpNameServiceImpl::Retransmit()"));
@@ -3699,160 +4077,173 @@ void IpNameServiceImpl::Retransmit(uint32_t transportIndex, bool exiting, bool q
     //
     if (transportIndex == IndexFromBit(TRANSPORT_TCP) && quietly == false) {
         //
-        // Keep track of how many messages we actually send in order to get all of
-        // the advertisements out.
-        //
-        uint32_t nSent = 0;
-
-        //
-        // The header will tie the whole protocol message together.  By setting the
-        // timer, we are asking for everyone who hears the message to remember the
-        // advertisements for that number of seconds.  If we are exiting, then we
-        // set the timer to zero, which means that the name is no longer valid.
-        //
-        Header header;
-
-        //
-        // We understand all messages from version zero to version one, and we
-        // are sending a version zero message.  The whole point of sending a
-        // version zero message is that can be understood by down-level code
-        // so we can't use the new versioning scheme.
+        // Building the messages means walking all of the advertised names, so
+        // unless we are exiting (which changes the timer) we keep the messages
+        // we build until the advertisements change and just queue them again.
+        // Each kept message gets its own cache identifier so that the bytes
+        // serialized for an interface can be reused as well.
         //
-        header.SetVersion(0, 0);
+        vector<Header> built;
+        vector<Header>& headers = exiting ? built : m_isAtHeaders[IsAtHeadersIndex(transportIndex, 0, false)];
 
-        header.SetTimer(exiting ? 0 : m_tDuration);
-
-        IsAt isAt;
-        isAt.SetVersion(0, 0);
-
-        //
-        // We don't actually send the transport mask in version zero packets
-        // but we make a note to ourselves to let us know on behalf of what
-        // transport we will be sending.
-        //
-        isAt.SetTransportMask(MaskFromIndex(transportIndex));
+        if (headers.empty()) {
+            //
+            // Keep track of how many messages we actually send in order to get all of
+            // the advertisements out.
+            //
+            uint32_t nSent = 0;
 
-        //
-        // The Complete Flag tells the other side that the message it recieves
-        // contains the complete list of well-known names advertised by the
-        // source.  We don't know that we fit them all in yet, so this must be
-        // initialized to false.
-        //
-        isAt.SetCompleteFlag(false);
+            //
+            // The header will tie the whole protocol message together.  By setting the
+            // timer, we are asking for everyone who hears the message to remember the
+            // advertisements for that number of seconds.  If we are exiting, then we
+            // set the timer to zero, which means that the name is no longer valid.
+            //
+            Header header;
 
-        //
-        // We have to use some sneaky way to tell an in-the know version one
-        // client that the packet is from a version one client and that is
-        // through the setting of the UDP flag.  TCP transports are the only
-        // possibility for version zero packets and it always sets the TCP
-        // flag, of course.
-        //
-        isAt.SetTcpFlag(true);
-        isAt.SetUdpFlag(true);
+            //
+            // We understand all messages from version zero to version one, and we
+            // are sending a version zero message.  The whole point of sending a
+            // version zero message is that can be understood by down-level code
+            // so we can't use the new versioning scheme.
+            //
+            header.SetVersion(0, 0);
 
-        isAt.SetGuid(m_guid);
+            header.SetTimer(exiting ? 0 : m_tDuration);
 
-        //
-        // The only possibility in version zero is that the port is the IPv4
-        // reliable port.
-        //
-        isAt.SetPort(m_reliableIPv4Port[transportIndex]);
+            IsAt isAt;
+            isAt.SetVersion(0, 0);
 
-        QCC_DbgPrintf(("IpNameServiceImpl::Retransmit(): Loop through advertised names"));
+            //
+            // We don't actually send the transport mask in version zero packets
+            // but we make a note to ourselves to let us know on behalf of what
+            // transport we will be sending.
+            //
+            isAt.SetTransportMask(MaskFromIndex(transportIndex));
 
-        //
-        // Loop through the list of names we are advertising, constructing as many
-        // protocol messages as it takes to get our list of advertisements out.
-        //
-        // Note that the number of packets that can go out in any given amount of
-        // time is effectively throttled in SendProtocolMessage() by a random delay.
-        // A user can consume all available resources here by flooding us with
-        // advertisements but she will only be shooting herself in the foot.
-        //
-        for (list<qcc::String>::iterator i = m_advertised[transportIndex].begin(); i != m_advertised[transportIndex].end(); ++i) {
-            QCC_DbgPrintf(("IpNameServiceImpl::Retransmit(): Accumulating \"%s\"", (*i).c_str()));
+            //
+            // The Complete Flag tells the other side that the message it recieves
+            // contains the complete list of well-known names advertised by the
+            // source.  We don't know that we fit them all in yet, so this must be
+            // initialized to false.
+            //
+            isAt.SetCompleteFlag(false);
 
             //
-            // It is possible that we have accumulated more advertisements than will
-            // fit in a UDP IpNameServiceImpl packet.  A name service is-at message is going
-            // to consist of a header and its answer section, which is made from an
-            // IsAt object.  We first ask both of these objects to return their size
-            // so we know how much space is committed already.  Note that we ask the
-            // header for its max possible size since the header may be modified to
-            // add actual IPv4 and IPv6 addresses when it is sent.
+            // We have to use some sneaky way to tell an in-the know version one
+            // client that the packet is from a version one client and that is
+            // through the setting of the UDP flag.  TCP transports are the only
+            // possibility for version zero packets and it always sets the TCP
+            // flag, of course.
             //
-            size_t currentSize = header.GetSerializedSize() + isAt.GetSerializedSize();
+            isAt.SetTcpFlag(true);
+            isAt.SetUdpFlag(true);
+
+            isAt.SetGuid(m_guid);
 
             //
-            // This isn't terribly elegant, but we don't know the IP address(es)
-            // over which the message will be sent.  These are added in the loop
-            // that actually does the packet sends, with the interface addresses
-            // dynamically added onto the message.  We have no clue here if an IPv4
-            // or IPv6 or both flavors of address will exist on a given interface,
-            // nor how many interfaces there are.  All we can do here is to assume
-            // the worst case for the size (both exist) and add the 20 bytes (four
-            // for IPv4, sixteen for IPv6) that the addresses may consume in the
-            // final packet.
+            // The only possibility in version zero is that the port is the IPv4
+            // reliable port.
             //
-            currentSize += 20;
+            isAt.SetPort(m_reliableIPv4Port[transportIndex]);
 
+            QCC_DbgPrintf(("IpNameServiceImpl::Retransmit(): Loop through advertised names"));
+
+            //
+            // Loop through the list of names we are advertising, constructing as many
+            // protocol messages as it takes to get our list of advertisements out.
             //
-            // We cheat a little in order to avoid a string copy and use our
-            // knowledge that names are stored as a byte count followed by the
-            // string bytes.  If the current name won't fit into the currently
-            // assembled message, we need to flush the current message and start
-            // again.
+            // Note that the number of packets that can go out in any given amount of
+            // time is effectively throttled in SendProtocolMessage() by a random delay.
+            // A user can consume all available resources here by flooding us with
+            // advertisements but she will only be shooting herself in the foot.
             //
-            if (currentSize + 1 + (*i).size() > NS_MESSAGE_MAX) {
-                QCC_DbgPrintf(("IpNameServiceImpl::Retransmit(): Message is full"));
+            for (set<qcc::String>::const_iterator i = m_advertised[transportIndex].begin(); i != m_advertised[transportIndex].end(); ++i) {
+                QCC_DbgPrintf(("IpNameServiceImpl::Retransmit(): Accumulating \"%s\"", (*i).c_str()));
+
                 //
-                // The current message cannot hold another name.  We need to send it
-                // out before continuing.
+                // It is possible that we have accumulated more advertisements than will
+                // fit in a UDP IpNameServiceImpl packet.  A name service is-at message is going
+                // to consist of a header and its answer section, which is made from an
+                // IsAt object.  We first ask both of these objects to return their size
+                // so we know how much space is committed already.  Note that we ask the
+                // header for its max possible size since the header may be modified to
+                // add actual IPv4 and IPv6 addresses when it is sent.
                 //
-                QCC_DbgPrintf(("IpNameServiceImpl::Retransmit(): Sending partial list"));
-                header.AddAnswer(isAt);
-
-                if (quietly) {
-                    header.SetDestination(destination);
-                } else {
-                    header.ClearDestination();
-                }
+                size_t currentSize = header.GetSerializedSize() + isAt.GetSerializedSize();
 
-                QueueProtocolMessage(header);
-                ++nSent;
+                //
+                // This isn't terribly elegant, but we don't know the IP address(es)
+                // over which the message will be sent.  These are added in the loop
+                // that actually does the packet sends, with the interface addresses
+                // dynamically added onto the message.  We have no clue here if an IPv4
+                // or IPv6 or both flavors of address will exist on a given interface,
+                // nor how many interfaces there are.  All we can do here is to assume
+                // the worst case for the size (both exist) and add the 20 bytes (four
+                // for IPv4, sixteen for IPv6) that the addresses may consume in the
+                // final packet.
+                //
+                currentSize += 20;
 
                 //
-                // The full message is now on the way out.  Now, we remove all of
-                // the entries in the IsAt object, reset the header, which clears
-                // out the existing is-at, and start accumulating new names again.
+                // We cheat a little in order to avoid a string copy and use our
+                // knowledge that names are stored as a byte count followed by the
+                // string bytes.  If the current name won't fit into the currently
+                // assembled message, we need to flush the current message and start
+                // again.
                 //
-                QCC_DbgPrintf(("IpNameServiceImpl::Retransmit(): Resetting current list"));
-                header.Reset();
-                isAt.Reset();
-                isAt.AddName(*i);
-            } else {
-                QCC_DbgPrintf(("IpNameServiceImpl::Retransmit(): Message has room.  Adding \"%s\"", (*i).c_str()));
-                isAt.AddName(*i);
+                if (currentSize + 1 + (*i).size() > NS_MESSAGE_MAX) {
+                    QCC_DbgPrintf(("IpNameServiceImpl::Retransmit(): Message is full"));
+                    //
+                    // The current message cannot hold another name.  We need to send it
+                    // out before continuing.
+                    //
+                    QCC_DbgPrintf(("IpNameServiceImpl::Retransmit(): Sending partial list"));
+                    header.AddAnswer(isAt);
+
+                    header.SetCacheId(exiting ? 0 : ++m_isAtCacheId);
+                    headers.push_back(header);
+                    ++nSent;
+
+                    //
+                    // The full message is now on the way out.  Now, we remove all of
+                    // the entries in the IsAt object, reset the header, which clears
+                    // out the existing is-at, and start accumulating new names again.
+                    //
+                    QCC_DbgPrintf(("IpNameServiceImpl::Retransmit(): Resetting current list"));
+                    header.Reset();
+                    isAt.Reset();
+                    isAt.AddName(*i);
+                } else {
+                    QCC_DbgPrintf(("IpNameServiceImpl::Retransmit(): Message has room.  Adding \"%s\"", (*i).c_str()));
+                    isAt.AddName(*i);
+                }
             }
-        }
 
-        //
-        // We most likely have a partially full message waiting to go out.  If we
-        // haven't sent a message, then the one message holds all of the names that
-        // are being advertised.  In this case, we set the complete flag to indicate
-        // that this packet describes the full extent of advertised well known
-        // names.
-        //
-        if (nSent == 0) {
-            QCC_DbgPrintf(("IpNameServiceImpl::Retransmit(): Single complete message "));
-            isAt.SetCompleteFlag(true);
-        }
+            //
+            // We most likely have a partially full message waiting to go out.  If we
+            // haven't sent a message, then the one message holds all of the names that
+            // are being advertised.  In this case, we set the complete flag to indicate
+            // that this packet describes the full extent of advertised well known
+            // names.
+            //
+            if (nSent == 0) {
+                QCC_DbgPrintf(("IpNameServiceImpl::Retransmit(): Single complete message "));
+                isAt.SetCompleteFlag(true);
+            }
 
-        QCC_DbgPrintf(("IpNameServiceImpl::Retransmit(): Sending final version zero message "));
-        header.AddAnswer(isAt);
+            QCC_DbgPrintf(("IpNameServiceImpl::Retransmit(): Sending final version zero message "));
+            header.AddAnswer(isAt);
 
-        header.ClearDestination();
-        QueueProtocolMessage(header);
+            header.SetCacheId(exiting ? 0 : ++m_isAtCacheId);
+            headers.push_back(header);
+        }
+
+        for (uint32_t i = 0; i < headers.size(); ++i) {
+            Header header = headers[i];
+            header.ClearDestination();
+            QueueProtocolMessage(header);
+        }
     }
 
     //
@@ -3860,198 +4251,203 @@ void IpNameServiceImpl::Retransmit(uint32_t transportIndex, bool exiting, bool q
     //
     {
         //
-        // Keep track of how many messages we actually send in order to get all of
-        // the advertisements out.
-        //
-        uint32_t nSent = 0;
-
-        //
-        // The header will tie the whole protocol message together.  By setting the
-        // timer, we are asking for everyone who hears the message to remember the
-        // advertisements for that number of seconds.  If we are exiting, then we
-        // set the timer to zero, which means that the name is no longer valid.
+        // As with version zero, keep the messages we build unless we are
+        // exiting.  Answers to questions about quietly advertised names carry
+        // the quiet names as well, so those are kept separately.
         //
-        Header header;
+        vector<Header> built;
+        vector<Header>& headers = exiting ? built : m_isAtHeaders[IsAtHeadersIndex(transportIndex, 1, quietly)];
 
-        //
-        // We understand all messages from version zero to version one, and we
-        // are sending a version one message;
-        //
-        header.SetVersion(1, 1);
-
-        header.SetTimer(exiting ? 0 : m_tDuration);
-
-        //
-        // The underlying protocol is capable of identifying both TCP and UDP
-        // services.  Right now, the only possibility is TCP.
-        //
-        IsAt isAt;
-
-        //
-        // We understand all messages from version zero to version one, and we
-        // are sending a version one message;
-        //
-        isAt.SetVersion(1, 1);
-
-        //
-        // We don't know if this is going to be a complete and final list yet,
-        // but we do know which transport we are doing this on behalf of.
-        //
-        isAt.SetCompleteFlag(false);
-        isAt.SetTransportMask(MaskFromIndex(transportIndex));
+        if (headers.empty()) {
+            //
+            // Keep track of how many messages we actually send in order to get all of
+            // the advertisements out.
+            //
+            uint32_t nSent = 0;
 
-        //
-        // Version one allows us to provide four possible endpoints.  The address
-        // will be rewritten on the way out with the address of the appropriate
-        // interface.
-        //
-        if (m_reliableIPv4Port[transportIndex]) {
-            isAt.SetReliableIPv4("", m_reliableIPv4Port[transportIndex]);
-        }
-        if (m_unreliableIPv4Port[transportIndex]) {
-            isAt.SetUnreliableIPv4("", m_unreliableIPv4Port[transportIndex]);
-        }
-        if (m_reliableIPv6Port[transportIndex]) {
-            isAt.SetReliableIPv6("", m_reliableIPv6Port[transportIndex]);
-        }
-        if (m_unreliableIPv6Port[transportIndex]) {
-            isAt.SetUnreliableIPv6("", m_unreliableIPv6Port[transportIndex]);
-        }
+            //
+            // The header will tie the whole protocol message together.  By setting the
+            // timer, we are asking for everyone who hears the message to remember the
+            // advertisements for that number of seconds.  If we are exiting, then we
+            // set the timer to zero, which means that the name is no longer valid.
+            //
+            Header header;
 
-        isAt.SetGuid(m_guid);
+            //
+            // We understand all messages from version zero to version one, and we
+            // are sending a version one message;
+            //
+            header.SetVersion(1, 1);
 
-        QCC_DbgPrintf(("IpNameServiceImpl::Retransmit(): Loop through advertised names"));
+            header.SetTimer(exiting ? 0 : m_tDuration);
 
-        //
-        // Loop through the list of names we are advertising, constructing as many
-        // protocol messages as it takes to get our list of advertisements out.
-        //
-        // Note that the number of packets that can go out in any given amount of
-        // time is effectively throttled in SendProtocolMessage() by a random delay.
-        // A user can consume all available resources here by flooding us with
-        // advertisements but she will only be shooting herself in the foot.
-        //
-        for (list<qcc::String>::iterator i = m_advertised[transportIndex].begin(); i != m_advertised[transportIndex].end(); ++i) {
-            QCC_DbgPrintf(("IpNameServiceImpl::Retransmit(): Accumulating \"%s\"", (*i).c_str()));
+            //
+            // The underlying protocol is capable of identifying both TCP and UDP
+            // services.  Right now, the only possibility is TCP.
+            //
+            IsAt isAt;
 
             //
-            // It is possible that we have accumulated more advertisements than will
-            // fit in a UDP IpNameServiceImpl packet.  A name service is-at message is going
-            // to consist of a header and its answer section, which is made from an
-            // IsAt object.  We first ask both of these objects to return their size
-            // so we know how much space is committed already.  Note that we ask the
-            // header for its max possible size since the header may be modified to
-            // add actual IPv4 and IPv6 addresses when it is sent.
+            // We understand all messages from version zero to version one, and we
+            // are sending a version one message;
             //
-            size_t currentSize = header.GetSerializedSize() + isAt.GetSerializedSize();
+            isAt.SetVersion(1, 1);
 
             //
-            // This isn't terribly elegant, but we don't know the IP address(es)
-            // over which the message will be sent.  These are added in the loop
-            // that actually does the packet sends, with the interface addresses
-            // dynamically added onto the message.  We have no clue here if an IPv4
-            // or IPv6 or both flavors of address will exist on a given interface,
-            // nor how many interfaces there are.  All we can do here is to assume
-            // the worst case for the size (both exist) and add the 20 bytes (four
-            // for IPv4, sixteen for IPv6) that the addresses may consume in the
-            // final packet.
+            // We don't know if this is going to be a complete and final list yet,
+            // but we do know which transport we are doing this on behalf of.
             //
-            currentSize += 20;
+            isAt.SetCompleteFlag(false);
+            isAt.SetTransportMask(MaskFromIndex(transportIndex));
 
             //
-            // We cheat a little in order to avoid a string copy and use our
-            // knowledge that names are stored as a byte count followed by the
-            // string bytes.  If the current name won't fit into the currently
-            // assembled message, we need to flush the current message and start
-            // again.
+            // Version one allows us to provide four possible endpoints.  The address
+            // will be rewritten on the way out with the address of the appropriate
+            // interface.
             //
-            if (currentSize + 1 + (*i).size() > NS_MESSAGE_MAX) {
-                QCC_DbgPrintf(("IpNameServiceImpl::Retransmit(): Message is full"));
-                //
-                // The current message cannot hold another name.  We need to send it
-                // out before continuing.
-                //
-                QCC_DbgPrintf(("IpNameServiceImpl::Retransmit(): Sending partial list"));
-                header.AddAnswer(isAt);
+            if (m_reliableIPv4Port[transportIndex]) {
+                isAt.SetReliableIPv4("", m_reliableIPv4Port[transportIndex]);
+            }
+            if (m_unreliableIPv4Port[transportIndex]) {
+                isAt.SetUnreliableIPv4("", m_unreliableIPv4Port[transportIndex]);
+            }
+            if (m_reliableIPv6Port[transportIndex]) {
+                isAt.SetReliableIPv6("", m_reliableIPv6Port[transportIndex]);
+            }
+            if (m_unreliableIPv6Port[transportIndex]) {
+                isAt.SetUnreliableIPv6("", m_unreliableIPv6Port[transportIndex]);
+            }
 
-                if (quietly) {
-                    header.SetDestination(destination);
-                } else {
-                    header.ClearDestination();
-                }
+            isAt.SetGuid(m_guid);
 
-                QueueProtocolMessage(header);
-                ++nSent;
+            QCC_DbgPrintf(("IpNameServiceImpl::Retransmit(): Loop through advertised names"));
+
+            //
+            // Loop through the list of names we are advertising, constructing as many
+            // protocol messages as it takes to get our list of advertisements out.
+            //
+            // Note that the number of packets that can go out in any given amount of
+            // time is effectively throttled in SendProtocolMessage() by a random delay.
+            // A user can consume all available resources here by flooding us with
+            // advertisements but she will only be shooting herself in the foot.
+            //
+            for (set<qcc::String>::const_iterator i = m_advertised[transportIndex].begin(); i != m_advertised[transportIndex].end(); ++i) {
+                QCC_DbgPrintf(("IpNameServiceImpl::Retransmit(): Accumulating \"%s\"", (*i).c_str()));
 
                 //
-                // The full message is now on the way out.  Now, we remove all of
-                // the entries in the IsAt object, reset the header, which clears
-                // out the existing is-at, and start accumulating new names again.
+                // It is possible that we have accumulated more advertisements than will
+                // fit in a UDP IpNameServiceImpl packet.  A name service is-at message is going
+                // to consist of a header and its answer section, which is made from an
+                // IsAt object.  We first ask both of these objects to return their size
+                // so we know how much space is committed already.  Note that we ask the
+                // header for its max possible size since the header may be modified to
+                // add actual IPv4 and IPv6 addresses when it is sent.
                 //
-                QCC_DbgPrintf(("IpNameServiceImpl::Retransmit(): Resetting current list"));
-                header.Reset();
-                isAt.Reset();
-                isAt.AddName(*i);
-            } else {
-                QCC_DbgPrintf(("IpNameServiceImpl::Retransmit(): Message has room.  Adding \"%s\"", (*i).c_str()));
-                isAt.AddName(*i);
-            }
-        }
-
-        if (quietly) {
-            for (list<qcc::String>::iterator i = m_advertised_quietly[transportIndex].begin(); i != m_advertised_quietly[transportIndex].end(); ++i) {
-                QCC_DbgPrintf(("IpNameServiceImpl::Retransmit(): Accumulating (quiet) \"%s\"", (*i).c_str()));
-
                 size_t currentSize = header.GetSerializedSize() + isAt.GetSerializedSize();
+
+                //
+                // This isn't terribly elegant, but we don't know the IP address(es)
+                // over which the message will be sent.  These are added in the loop
+                // that actually does the packet sends, with the interface addresses
+                // dynamically added onto the message.  We have no clue here if an IPv4
+                // or IPv6 or both flavors of address will exist on a given interface,
+                // nor how many interfaces there are.  All we can do here is to assume
+                // the worst case for the size (both exist) and add the 20 bytes (four
+                // for IPv4, sixteen for IPv6) that the addresses may consume in the
+                // final packet.
+                //
                 currentSize += 20;
 
+                //
+                // We cheat a little in order to avoid a string copy and use our
+                // knowledge that names are stored as a byte count followed by the
+                // string bytes.  If the current name won't fit into the currently
+                // assembled message, we need to flush the current message and start
+                // again.
+                //
                 if (currentSize + 1 + (*i).size() > NS_MESSAGE_MAX) {
                     QCC_DbgPrintf(("IpNameServiceImpl::Retransmit(): Message is full"));
+                    //
+                    // The current message cannot hold another name.  We need to send it
+                    // out before continuing.
+                    //
                     QCC_DbgPrintf(("IpNameServiceImpl::Retransmit(): Sending partial list"));
                     header.AddAnswer(isAt);
 
-                    if (quietly) {
-                        header.SetDestination(destination);
-                    } else {
-                        header.ClearDestination();
-                    }
-
-                    QueueProtocolMessage(header);
+                    header.SetCacheId(exiting ? 0 : ++m_isAtCacheId);
+                    headers.push_back(header);
                     ++nSent;
 
+                    //
+                    // The full message is now on the way out.  Now, we remove all of
+                    // the entries in the IsAt object, reset the header, which clears
+                    // out the existing is-at, and start accumulating new names again.
+                    //
                     QCC_DbgPrintf(("IpNameServiceImpl::Retransmit(): Resetting current list"));
                     header.Reset();
                     isAt.Reset();
                     isAt.AddName(*i);
                 } else {
-                    QCC_DbgPrintf(("IpNameServiceImpl::Retransmit(): Message has room.  Adding (quiet) \"%s\"", (*i).c_str()));
+                    QCC_DbgPrintf(("IpNameServiceImpl::Retransmit(): Message has room.  Adding \"%s\"", (*i).c_str()));
                     isAt.AddName(*i);
                 }
             }
-        }
 
-        //
-        // We most likely have a partially full message waiting to go out.  If we
-        // haven't sent a message, then the one message holds all of the names that
-        // are being advertised.  In this case, we set the complete flag to indicate
-        // that this packet describes the full extent of advertised well known
-        // names.
-        //
-        if (nSent == 0) {
-            QCC_DbgPrintf(("IpNameServiceImpl::Retransmit(): Single complete message "));
-            isAt.SetCompleteFlag(true);
-        }
+            if (quietly) {
+                for (set<qcc::String>::const_iterator i = m_advertised_quietly[transportIndex].begin(); i != m_advertised_quietly[transportIndex].end(); ++i) {
+                    QCC_DbgPrintf(("IpNameServiceImpl::Retransmit(): Accumulating (quiet) \"%s\"", (*i).c_str()));
 
-        QCC_DbgPrintf(("IpNameServiceImpl::Retransmit(): Sending final message "));
-        header.AddAnswer(isAt);
+                    size_t currentSize = header.GetSerializedSize() + isAt.GetSerializedSize();
+                    currentSize += 20;
 
-        if (quietly) {
-            header.SetDestination(destination);
-        } else {
-            header.ClearDestination();
+                    if (currentSize + 1 + (*i).size() > NS_MESSAGE_MAX) {
+                        QCC_DbgPrintf(("IpNameServiceImpl::Retransmit(): Message is full"));
+                        QCC_DbgPrintf(("IpNameServiceImpl::Retransmit(): Sending partial list"));
+                        header.AddAnswer(isAt);
+
+                        header.SetCacheId(exiting ? 0 : ++m_isAtCacheId);
+                        headers.push_back(header);
+                        ++nSent;
+
+                        QCC_DbgPrintf(("IpNameServiceImpl::Retransmit(): Resetting current list"));
+                        header.Reset();
+                        isAt.Reset();
+                        isAt.AddName(*i);
+                    } else {
+                        QCC_DbgPrintf(("IpNameServiceImpl::Retransmit(): Message has room.  Adding (quiet) \"%s\"", (*i).c_str()));
+                        isAt.AddName(*i);
+                    }
+                }
+            }
+
+            //
+            // We most likely have a partially full message waiting to go out.  If we
+            // haven't sent a message, then the one message holds all of the names that
+            // are being advertised.  In this case, we set the complete flag to indicate
+            // that this packet describes the full extent of advertised well known
+            // names.
+            //
+            if (nSent == 0) {
+                QCC_DbgPrintf(("IpNameServiceImpl::Retransmit(): Single complete message "));
+                isAt.SetCompleteFlag(true);
+            }
+
+            QCC_DbgPrintf(("IpNameServiceImpl::Retransmit(): Sending final message "));
+            header.AddAnswer(isAt);
+
+            header.SetCacheId(exiting ? 0 : ++m_isAtCacheId);
+            headers.push_back(header);
         }
 
-        QueueProtocolMessage(header);
+        for (uint32_t i = 0; i < headers.size(); ++i) {
+            Header header = headers[i];
+            if (quietly) {
+                header.SetDestination(destination);
+            } else {
+                header.ClearDestination();
+            }
+            QueueProtocolMessage(header);
+        }
     }
 
     // printf("%s: m_mutex.Unlock()\n", __FUNCTION__);
@@ -4148,42 +4544,22 @@ void IpNameServiceImpl::HandleProtocolQuestion(WhoHas whoHas, qcc::IPAddress add
             }
 
             //
-            // check to see if this name on the list of names we actively advertise.
+            // Check to see if this name is on the set of names we actively
+            // advertise.  The requested name comes in from the WhoHas message
+            // and we allow wildcards there.
             //
-            for (list<qcc::String>::iterator j = m_advertised[index].begin(); j != m_advertised[index].end(); ++j) {
-
-                //
-                // The requested name comes in from the WhoHas message and we
-                // allow wildcards there.
-                //
-                if (IpNameServiceImplWildcardMatch((*j), wkn)) {
-                    QCC_DbgPrintf(("IpNameServiceImpl::HandleProtocolQuestion(): request for %s does not match my %s",
-                                   wkn.c_str(), (*j).c_str()));
-                    continue;
-                } else {
-                    respond = true;
-                    break;
-                }
+            if (!respond && IpNameServiceImplMatchAny(m_advertised[index], wkn)) {
+                respond = true;
             }
 
             //
-            // Check to see if this name on the list of names we quietly advertise.
+            // Check to see if this name is on the set of names we quietly advertise.
             //
-            for (list<qcc::String>::iterator j = m_advertised_quietly[index].begin(); j != m_advertised_quietly[index].end(); ++j) {
-
-                //
-                // The requested name comes in from the WhoHas message and we
-                // allow wildcards there.
-                //
-                if (IpNameServiceImplWildcardMatch((*j), wkn)) {
-                    QCC_DbgPrintf(("IpNameServiceImpl::HandleProtocolQuestion(): request for %s does not match my %s",
-                                   wkn.c_str(), (*j).c_str()));
-                    continue;
-                } else {
-                    respond = true;
-                    respondQuietly = true;
-                    break;
-                }
+            if (IpNameServiceImplMatchAny(m_advertised_quietly[index], wkn)) {
+                QCC_DbgPrintf(("IpNameServiceImpl::HandleProtocolQuestion(): request for %s matches a quiet advertisement", wkn.c_str()));
+                respond = true;
+                respondQuietly = true;
+                break;
             }
         }
 
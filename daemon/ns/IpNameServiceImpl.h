@@ -28,6 +28,8 @@
 
 #include <vector>
 #include <list>
+#include <map>
+#include <set>
 
 #include <qcc/String.h>
 #include <qcc/Thread.h>
@@ -44,6 +46,35 @@
 
 namespace ajn {
 
+/**
+ * @internal
+ * @brief Match a name against a pattern that supports '*' and '?' only.
+ *
+ * @param str The name to match.
+ * @param pat The pattern, for example a name from a who-has question.
+ *
+ * @return false if the name matches the pattern, true if there is a
+ *     difference (in the sense of strcmp).
+ */
+bool IpNameServiceImplWildcardMatch(const qcc::String& str, const qcc::String& pat);
+
+/**
+ * @internal
+ * @brief Find out whether any of a sorted set of names matches a pattern.
+ *
+ * Only the names that start with the literal prefix of the pattern (the
+ * characters before its first wildcard) are compared with the pattern, and a
+ * pattern without wildcards is a single lookup.  Answering a who-has question
+ * costs a lookup plus the names sharing the prefix, not a comparison with
+ * every advertised name.
+ *
+ * @param names The names to look through.
+ * @param pat   The pattern, for example a name from a who-has question.
+ *
+ * @return true if at least one of the names matches the pattern.
+ */
+bool IpNameServiceImplMatchAny(const std::set<qcc::String>& names, const qcc::String& pat);
+
 /**
  * @brief API to provide an implementation dependent IP (Layer 3) Name Service
  * for AllJoyn.
@@ -140,6 +171,32 @@ class IpNameServiceImpl : public qcc::Thread {
      */
     static const uint32_t LAZY_UPDATE_MAX_INTERVAL = 15;
 
+    /**
+     * The maximum number of datagrams received from a socket with a single
+     * system call, which is also the number of buffers in the receive pool.
+     */
+    static const uint32_t RECV_BATCH_MAX = 32;
+
+    /**
+     * The maximum number of datagrams handled from a single socket per wakeup
+     * so that a flood on one network cannot starve the others or the timer.
+     */
+    static const uint32_t RECV_WAKEUP_MAX = 256;
+
+    /**
+     * The maximum number of datagrams held in the send batch.  A full batch
+     * is flushed with one system call for each socket it holds datagrams for.
+     */
+    static const uint32_t SEND_BATCH_MAX = 64;
+
+    /**
+     * The maximum number of queued messages sent between two pauses.  The
+     * pause grows with the number of messages sent so the rate at which
+     * messages go out on the network stays what it was when we paused after
+     * every message.
+     */
+    static const uint32_t SEND_MESSAGES_MAX = 4;
+
     /**
      * @brief The time value indicating an advertisement is valid forever.
      */
@@ -1002,16 +1059,16 @@ class IpNameServiceImpl : public qcc::Thread {
     Callback<void, const qcc::String&, const qcc::String&, std::vector<qcc::String>&, uint8_t>* m_callback[N_TRANSPORTS];
 
     /**
-     * @internal @brief A vector of list of all of the names that the various
-     * transports have actively advertised.
+     * @internal @brief A vector of sorted sets of all of the names that the
+     * various transports have actively advertised.
      */
-    std::list<qcc::String> m_advertised[N_TRANSPORTS];
+    std::set<qcc::String> m_advertised[N_TRANSPORTS];
 
     /**
-     * @internal @brief A vector of list of all of the names that the various
-     * transports have quietly advertised.
+     * @internal @brief A vector of sorted sets of all of the names that the
+     * various transports have quietly advertised.
      */
-    std::list<qcc::String> m_advertised_quietly[N_TRANSPORTS];
+    std::set<qcc::String> m_advertised_quietly[N_TRANSPORTS];
 
     /**
      * @internal
@@ -1182,6 +1239,127 @@ class IpNameServiceImpl : public qcc::Thread {
      */
     std::list<Header> m_outbound;
 
+    /**
+     * @internal
+     * @brief The is-at messages built from the advertised names, indexed by
+     * transport index, message version and whether or not the quietly
+     * advertised names are included.  Kept until the advertisements, the
+     * ports or the advertisement duration change.
+     */
+    std::map<uint32_t, std::vector<Header> > m_isAtHeaders;
+
+    /**
+     * @internal
+     * @brief The serialized is-at messages with the addresses of a live
+     * interface written in, indexed by the cache identifier of the message and
+     * the index of the live interface.  Kept until the is-at messages or the
+     * live interfaces change.
+     */
+    std::map<std::pair<uint32_t, uint32_t>, std::vector<uint8_t> > m_isAtPackets;
+
+    /**
+     * @internal
+     * @brief The last cache identifier given to an is-at message.
+     */
+    uint32_t m_isAtCacheId;
+
+    /**
+     * @internal
+     * @brief The names and addresses of the live interfaces the serialized
+     * is-at messages were written for.
+     */
+    std::vector<qcc::String> m_isAtInterfaces;
+
+    /**
+     * @internal
+     * @brief Forget the built and serialized is-at messages.  Called with
+     * m_mutex locked whenever the advertised names, the ports or the
+     * advertisement duration change.
+     */
+    void ClearIsAtCache(void);
+
+    /**
+     * @internal
+     * @brief Forget the serialized is-at messages if the live interfaces found
+     * by the last lazy update differ from the ones they were written for.
+     */
+    void UpdateIsAtInterfaces(void);
+
+    /**
+     * @internal
+     * @brief A datagram waiting in the send batch.  Its bytes are held in the
+     * slot of m_sendBuffers with the same index.
+     */
+    class BatchedPacket {
+      public:
+        qcc::SocketFd m_sockFd;        /**< The socket to send the datagram on */
+        qcc::IPAddress m_destination;  /**< The address to send the datagram to */
+        uint16_t m_port;               /**< The port to send the datagram to */
+        size_t m_size;                 /**< The number of bytes in the datagram */
+    };
+
+    /**
+     * @internal
+     * @brief Datagrams queued by SendPacket() and not yet flushed.
+     */
+    std::vector<BatchedPacket> m_sendBatch;
+
+    /**
+     * @internal
+     * @brief SEND_BATCH_MAX buffers of NS_MESSAGE_MAX bytes holding the
+     * datagrams in m_sendBatch.
+     */
+    std::vector<uint8_t> m_sendBuffers;
+
+    /**
+     * @internal
+     * @brief RECV_BATCH_MAX buffers of NS_MESSAGE_MAX bytes reused for every
+     * datagram received by the main thread.
+     */
+    std::vector<uint8_t> m_recvBuffers;
+
+    /**
+     * @internal
+     * @brief Debug statistics for the main loop: wakeups with readable
+     * sockets, datagrams received, datagrams sent and the system calls used
+     * to send them.
+     */
+    uint32_t m_statsWakeups;
+    uint32_t m_statsReceived;
+    uint32_t m_statsSent;
+    uint32_t m_statsSendCalls;
+
+    /**
+     * @internal
+     * @brief Send a datagram.  Where the platform allows, the datagram is
+     * copied into the send batch and goes out with the others queued on the
+     * same socket when FlushPackets() is called.  Must be called with m_mutex
+     * locked.
+     *
+     * @return ER_OK if the datagram was sent or queued.
+     */
+    QStatus SendPacket(qcc::SocketFd sockFd, const qcc::IPAddress& destination, uint16_t port,
+                       const uint8_t* buffer, size_t size);
+
+    /**
+     * @internal
+     * @brief Send the datagrams queued by SendPacket(), one system call per
+     * socket with the datagrams for each socket in the order they were queued.
+     * Must be called with m_mutex locked.
+     */
+    void FlushPackets(void);
+
+    /**
+     * @internal
+     * @brief Receive and handle the datagrams waiting on a socket.  Where the
+     * platform allows, everything waiting (up to RECV_WAKEUP_MAX datagrams) is
+     * received in batches into the receive buffer pool; otherwise a single
+     * datagram is received.
+     *
+     * @return The number of datagrams handled.
+     */
+    uint32_t ReceivePackets(qcc::SocketFd sockFd);
+
 #if defined(QCC_OS_GROUP_WINDOWS)
     /**
      * @internal @brief A socket to hold to keep winsock initialized
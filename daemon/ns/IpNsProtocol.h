@@ -1670,6 +1670,29 @@ class Header : public ProtocolElement {
      */
     uint32_t GetRetryTick(void) { return m_tick; }
 
+    /**
+     * @internal
+     * @brief Set the identifier of the serialized copies of this message kept
+     * by the name service so the same bytes can be sent again without building
+     * and serializing the message.  Zero means the message is not cached.  This
+     * is not a perfect place for this information, but it is a very convenient
+     * place.  This information is not part of the wire protocol.
+     *
+     * @param cacheId The identifier of the cached copies of this message.
+     */
+    void SetCacheId(uint32_t cacheId) { m_cacheId = cacheId; }
+
+    /**
+     * @internal
+     * @brief Get the identifier of the serialized copies of this message kept
+     * by the name service.  This is not a perfect place for this information,
+     * but it is a very convenient place.  This information is not part of the
+     * wire protocol.
+     *
+     * @return The identifier of the cached copies of this message or zero.
+     */
+    uint32_t GetCacheId(void) { return m_cacheId; }
+
     /**
      * @internal
      * @brief Set the wire protocol version that the object will use.
@@ -1934,6 +1957,7 @@ class Header : public ProtocolElement {
     bool m_destinationSet;
     uint32_t m_retries;
     uint32_t m_tick;
+    uint32_t m_cacheId;
     std::vector<WhoHas> m_questions;
     std::vector<IsAt> m_answers;
 };
@@ -32,9 +32,11 @@
 #include <alljoyn/BusAttachment.h>
 
 #include "BusInternal.h"
+#include "DaemonConfig.h"
 #include "RemoteEndpoint.h"
 #include "Router.h"
 #include "DaemonTransport.h"
+#include "ScatterGatherList.h"
 
 #define QCC_MODULE "ALLJOYN"
 
@@ -63,6 +65,9 @@ class _DaemonEndpoint : public _RemoteEndpoint {
         processId(-1),
         stream(sock)
     {
+        DaemonConfig* config = DaemonConfig::Access();
+        SetTxQueueLimits(config->Get("unix/limit@tx_queue_high_watermark", 128 * 1024),
+                         config->Get("unix/limit@tx_queue_low_watermark", 64 * 1024));
     }
 
     ~_DaemonEndpoint() { }
@@ -116,6 +121,22 @@ class _DaemonEndpoint : public _RemoteEndpoint {
      */
     bool SupportsUnixIDs() const { return true; }
 
+  protected:
+    /*
+     * Queued messages are written to the socket with a single sendmsg().
+     */
+    bool SupportsGatheredWrites() const { return true; }
+
+    QStatus PushBytesGathered(const TxBuffer* bufs, size_t numBufs, size_t& numSent)
+    {
+        ScatterGatherList sg;
+        for (size_t i = 0; i < numBufs; ++i) {
+            sg.AddBuffer(bufs[i].buf, bufs[i].len);
+        }
+        sg.SetDataSize(sg.MaxDataSize());
+        return SendSG(stream.GetSocketFd(), sg, numSent);
+    }
+
   private:
     uint32_t userId;
     uint32_t groupId;
@@ -71,7 +71,11 @@ static QStatus SendSGCommon(SocketFd sockfd, struct sockaddr_storage* addr, sock
     QCC_DbgTrace(("SendSGCommon(sockfd = %d, *addr, addrLen, sg[%u:%u/%u], sent = <>)",
                   sockfd, sg.Size(), sg.DataSize(), sg.MaxDataSize()));
 
-    iov = new struct iovec[sg.Size()];
+    /*
+     * We will usually avoid the memory allocation
+     */
+    struct iovec iovAuto[16];
+    iov = sg.Size() <= ArraySize(iovAuto) ? iovAuto : new struct iovec[sg.Size()];
     for (index = 0, iter = sg.Begin(); iter != sg.End(); ++index, ++iter) {
         iov[index].iov_base = iter->buf;
         iov[index].iov_len = iter->len;
@@ -88,12 +92,19 @@ static QStatus SendSGCommon(SocketFd sockfd, struct sockaddr_storage* addr, sock
 
     ret = sendmsg(static_cast<int>(sockfd), &msg, MSG_NOSIGNAL);
     if (ret == -1) {
-        status = ER_OS_ERROR;
-        QCC_LogError(status, ("SendSGCommon (sockfd = %u): %d - %s", sockfd, errno, strerror(errno)));
+        if ((errno == EAGAIN) || (errno == EWOULDBLOCK)) {
+            status = ER_WOULDBLOCK;
+            sent = 0;
+        } else {
+            status = ER_OS_ERROR;
+            QCC_LogError(status, ("SendSGCommon (sockfd = %u): %d - %s", sockfd, errno, strerror(errno)));
+        }
     } else {
         sent = static_cast<size_t>(ret);
     }
-    delete[] iov;
+    if (iov != iovAuto) {
+        delete[] iov;
+    }
     return status;
 }
 
@@ -135,7 +146,11 @@ static QStatus RecvSGCommon(SocketFd sockfd, struct sockaddr_storage* addr, sock
     QCC_DbgTrace(("RecvSGCommon(sockfd = &d, addr, addrLen, sg = <>, received = <>)",
                   sockfd));
 
-    iov = new struct iovec[sg.Size()];
+    /*
+     * We will usually avoid the memory allocation
+     */
+    struct iovec iovAuto[16];
+    iov = sg.Size() <= ArraySize(iovAuto) ? iovAuto : new struct iovec[sg.Size()];
     for (index = 0, iter = sg.Begin(); iter != sg.End(); ++index, ++iter) {
         iov[index].iov_base = iter->buf;
         iov[index].iov_len = iter->len;
@@ -0,0 +1,220 @@
+/**
+ * @file
+ * Opens many TCP connections to a daemon at once and authenticates each of them as a remote
+ * daemon would, then reports how many connections per second the daemon authenticated. In flood
+ * mode the connections are closed right after the initial byte to measure the daemon accept loop.
+ */
+
+/******************************************************************************
+ * Copyright 2013, Qualcomm Innovation Center, Inc.
+ *
+ *    Licensed under the Apache License, Version 2.0 (the "License");
+ *    you may not use this file except in compliance with the License.
+ *    You may obtain a copy of the License at
+ *
+ *        http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *    Unless required by applicable law or agreed to in writing, software
+ *    distributed under the License is distributed on an "AS IS" BASIS,
+ *    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *    See the License for the specific language governing permissions and
+ *    limitations under the License.
+ ******************************************************************************/
+#include <qcc/platform.h>
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <vector>
+
+#include <qcc/Debug.h>
+#include <qcc/IPAddress.h>
+#include <qcc/Socket.h>
+#include <qcc/SocketStream.h>
+#include <qcc/String.h>
+#include <qcc/StringUtil.h>
+#include <qcc/Thread.h>
+#include <qcc/time.h>
+
+#if defined(QCC_OS_LINUX)
+#include <unistd.h>
+#endif
+
+#include <alljoyn/BusAttachment.h>
+#include <alljoyn/Status.h>
+
+#include "RemoteEndpoint.h"
+
+#define QCC_MODULE "ALLJOYN"
+
+using namespace qcc;
+using namespace std;
+using namespace ajn;
+
+class StormThread : public Thread {
+  public:
+    StormThread(BusAttachment& bus, const IPAddress& addr, uint16_t port, uint32_t connections, bool flood) :
+        Thread("Storm"), bus(bus), addr(addr), port(port), connections(connections), flood(flood), succeeded(0), failed(0) { }
+
+    ThreadReturn STDCALL Run(void* arg)
+    {
+        for (uint32_t i = 0; i < connections; ++i) {
+            if (Authenticate() == ER_OK) {
+                ++succeeded;
+            } else {
+                ++failed;
+            }
+        }
+        return 0;
+    }
+
+    BusAttachment& bus;
+    IPAddress addr;
+    uint16_t port;
+    uint32_t connections;
+    bool flood;
+    uint32_t succeeded;
+    uint32_t failed;
+
+  private:
+    QStatus Authenticate()
+    {
+        SocketFd sockFd = -1;
+        QStatus status = Socket(QCC_AF_INET, QCC_SOCK_STREAM, sockFd);
+        if (status != ER_OK) {
+            return status;
+        }
+        status = qcc::Connect(sockFd, addr, port);
+        if (status == ER_OK) {
+            /* Every connection starts with a single zero byte */
+            uint8_t nul = 0;
+            size_t sent;
+            status = Send(sockFd, &nul, 1, sent);
+        }
+        if ((status != ER_OK) || flood) {
+            qcc::Close(sockFd);
+            return status;
+        }
+        SocketStream stream(sockFd);
+        RemoteEndpoint ep(bus, false, "", &stream, "storm");
+        ep->GetFeatures().isBusToBus = true;
+        ep->GetFeatures().allowRemote = true;
+        ep->GetFeatures().handlePassing = false;
+        qcc::String authName;
+        qcc::String redirection;
+        status = ep->Establish("ANONYMOUS", authName, redirection);
+        stream.Close();
+        return status;
+    }
+};
+
+/*
+ * CPU time used so far by a process in milliseconds or 0 if it cannot be read.
+ */
+static uint64_t ProcessCpuMs(uint32_t pid)
+{
+    uint64_t ms = 0;
+#if defined(QCC_OS_LINUX)
+    qcc::String path = "/proc/" + U32ToString(pid) + "/stat";
+    FILE* f = fopen(path.c_str(), "r");
+    if (f) {
+        char buf[1024];
+        size_t n = fread(buf, 1, sizeof(buf) - 1, f);
+        fclose(f);
+        buf[n] = 0;
+        /* utime and stime are the 12th and 13th fields after the parenthesized command name */
+        const char* p = strrchr(buf, ')');
+        unsigned long long utime = 0;
+        unsigned long long stime = 0;
+        if (p && (sscanf(p + 1, " %*c %*d %*d %*d %*d %*d %*u %*u %*u %*u %*u %llu %llu", &utime, &stime) == 2)) {
+            ms = ((utime + stime) * 1000) / sysconf(_SC_CLK_TCK);
+        }
+    }
+#endif
+    return ms;
+}
+
+static void Usage()
+{
+    printf("Usage: authstorm [-h] [-f] [-a <addr>] [-p <port>] [-t <threads>] [-c <connections>] [-P <pid>]\n\n");
+    printf("Options:\n");
+    printf("   -h                    = Print this help message\n");
+    printf("   -f                    = Flood: close each connection after the initial byte\n");
+    printf("   -a <addr>             = IPv4 address of the daemon (default 127.0.0.1)\n");
+    printf("   -p <port>             = TCP port of the daemon (default 9955)\n");
+    printf("   -t <threads>          = Number of connections opened at once (default 64)\n");
+    printf("   -c <connections>      = Number of connections per thread (default 100)\n");
+    printf("   -P <pid>              = Report the CPU time used by the daemon with this pid\n\n");
+    printf("The daemon limits max_incomplete_connections and max_completed_connections must be\n");
+    printf("at least the number of threads or connections over the limits count as failures.\n");
+}
+
+int main(int argc, char** argv)
+{
+    qcc::String addr = "127.0.0.1";
+    uint16_t port = 9955;
+    uint32_t numThreads = 64;
+    uint32_t connections = 100;
+    bool flood = false;
+    uint32_t pid = 0;
+
+    for (int i = 1; i < argc; ++i) {
+        if (0 == strcmp("-f", argv[i])) {
+            flood = true;
+        } else if ((0 == strcmp("-a", argv[i])) && (++i < argc)) {
+            addr = argv[i];
+        } else if ((0 == strcmp("-p", argv[i])) && (++i < argc)) {
+            port = static_cast<uint16_t>(StringToU32(argv[i], 0, port));
+        } else if ((0 == strcmp("-t", argv[i])) && (++i < argc)) {
+            numThreads = StringToU32(argv[i], 0, numThreads);
+        } else if ((0 == strcmp("-c", argv[i])) && (++i < argc)) {
+            connections = StringToU32(argv[i], 0, connections);
+        } else if ((0 == strcmp("-P", argv[i])) && (++i < argc)) {
+            pid = StringToU32(argv[i], 0, pid);
+        } else {
+            Usage();
+            exit(1);
+        }
+    }
+
+    BusAttachment bus("authstorm", true);
+    IPAddress ipAddr;
+    QStatus status = ipAddr.SetAddress(addr);
+    if (status != ER_OK) {
+        printf("Bad address %s: %s\n", addr.c_str(), QCC_StatusText(status));
+        exit(1);
+    }
+
+    vector<StormThread*> threads;
+    uint64_t startCpu = pid ? ProcessCpuMs(pid) : 0;
+    uint64_t start = GetTimestamp64();
+    for (uint32_t i = 0; i < numThreads; ++i) {
+        threads.push_back(new StormThread(bus, ipAddr, port, connections, flood));
+        threads.back()->Start();
+    }
+    uint32_t succeeded = 0;
+    uint32_t failed = 0;
+    for (size_t i = 0; i < threads.size(); ++i) {
+        threads[i]->Join();
+        succeeded += threads[i]->succeeded;
+        failed += threads[i]->failed;
+        delete threads[i];
+    }
+    uint64_t ms = GetTimestamp64() - start;
+    printf("%u threads: %u connections/sec (%u %s, %u failed) in %u ms\n",
+           numThreads,
+           (unsigned int)(((uint64_t)succeeded * 1000) / (ms ? ms : 1)),
+           succeeded,
+           flood ? "connected" : "authenticated",
+           failed,
+           (unsigned int)ms);
+    if (pid) {
+        /* Give the daemon a moment to finish with the last connections */
+        qcc::Sleep(1000);
+        uint64_t cpuMs = ProcessCpuMs(pid) - startCpu;
+        printf("daemon used %u ms of CPU, %u us per connection\n",
+               (unsigned int)cpuMs,
+               (unsigned int)((cpuMs * 1000) / (succeeded ? succeeded : 1)));
+    }
+    return 0;
+}
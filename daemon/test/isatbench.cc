@@ -0,0 +1,306 @@
+/**
+ * @file
+ * Measures the cost of answering who-has questions with is-at messages. A recording of who-has
+ * packets is replayed and every question is answered out a number of interfaces, once by building
+ * and serializing the is-at messages for every answer and once by reusing the bytes serialized for
+ * each transport, version and interface the way the name service does. Reports the allocations and
+ * the CPU time used per answer.
+ */
+
+/******************************************************************************
+ * Copyright 2013, Qualcomm Innovation Center, Inc.
+ *
+ *    Licensed under the Apache License, Version 2.0 (the "License");
+ *    you may not use this file except in compliance with the License.
+ *    You may obtain a copy of the License at
+ *
+ *        http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *    Unless required by applicable law or agreed to in writing, software
+ *    distributed under the License is distributed on an "AS IS" BASIS,
+ *    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *    See the License for the specific language governing permissions and
+ *    limitations under the License.
+ ******************************************************************************/
+#include <qcc/platform.h>
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <map>
+#include <new>
+#include <set>
+#include <vector>
+
+#include <qcc/Debug.h>
+#include <qcc/String.h>
+#include <qcc/StringUtil.h>
+
+#include <alljoyn/Status.h>
+#include <alljoyn/TransportMask.h>
+
+#include "ns/IpNameServiceImpl.h"
+#include "ns/IpNsProtocol.h"
+
+#define QCC_MODULE "ALLJOYN"
+
+using namespace qcc;
+using namespace std;
+using namespace ajn;
+
+/*
+ * Count every allocation made by the process so the two ways of answering can be compared.
+ */
+static bool counting = false;
+static uint64_t allocations = 0;
+
+void* operator new(size_t size) throw(std::bad_alloc)
+{
+    if (counting) {
+        ++allocations;
+    }
+    void* p = malloc(size ? size : 1);
+    if (!p) {
+        throw std::bad_alloc();
+    }
+    return p;
+}
+
+void* operator new[](size_t size) throw(std::bad_alloc)
+{
+    return operator new(size);
+}
+
+void operator delete(void* p) throw()
+{
+    free(p);
+}
+
+void operator delete[](void* p) throw()
+{
+    free(p);
+}
+
+static const uint16_t PORT = 9955;
+static const char* GUID = "0123456789abcdef0123456789abcdef";
+
+/*
+ * Build the is-at messages that carry the advertised names, splitting them across as many
+ * messages as it takes the way IpNameServiceImpl::Retransmit() does.
+ */
+static void Build(const set<qcc::String>& advertised, uint32_t msgVersion, vector<Header>& headers)
+{
+    Header header;
+    header.SetVersion(msgVersion, msgVersion);
+    header.SetTimer(120);
+
+    IsAt isAt;
+    isAt.SetVersion(msgVersion, msgVersion);
+    isAt.SetTransportMask(TRANSPORT_TCP);
+    isAt.SetCompleteFlag(false);
+    if (msgVersion == 0) {
+        isAt.SetTcpFlag(true);
+        isAt.SetUdpFlag(true);
+        isAt.SetPort(PORT);
+    } else {
+        isAt.SetReliableIPv4("", PORT);
+    }
+    isAt.SetGuid(GUID);
+
+    for (set<qcc::String>::const_iterator i = advertised.begin(); i != advertised.end(); ++i) {
+        size_t currentSize = header.GetSerializedSize() + isAt.GetSerializedSize() + 20;
+        if (currentSize + 1 + (*i).size() > IpNameServiceImpl::NS_MESSAGE_MAX) {
+            header.AddAnswer(isAt);
+            headers.push_back(header);
+            header.Reset();
+            isAt.Reset();
+        }
+        isAt.AddName(*i);
+    }
+    if (headers.empty()) {
+        isAt.SetCompleteFlag(true);
+    }
+    header.AddAnswer(isAt);
+    headers.push_back(header);
+}
+
+/*
+ * Write the address of an interface into the is-at messages and serialize them the way
+ * IpNameServiceImpl::SendOutboundMessageActively() does for every interface.
+ */
+static size_t Serialize(Header& header, uint32_t msgVersion, const qcc::String& address, vector<uint8_t>& packet)
+{
+    for (uint8_t j = 0; j < header.GetNumberAnswers(); ++j) {
+        IsAt* isAt;
+        header.GetAnswer(j, &isAt);
+        isAt->ClearIPv4();
+        isAt->ClearReliableIPv4();
+        if (msgVersion == 0) {
+            isAt->SetIPv4(address);
+        } else {
+            isAt->SetReliableIPv4(address, PORT);
+        }
+    }
+    packet.resize(header.GetSerializedSize());
+    return header.Serialize(&packet[0]);
+}
+
+/*
+ * Record who-has packets the way a busy network would deliver them: most ask about names we
+ * advertise, some about names we don't.
+ */
+static void Record(uint32_t numNames, uint32_t numPackets, vector<vector<uint8_t> >& packets)
+{
+    for (uint32_t i = 0; i < numPackets; ++i) {
+        WhoHas whoHas;
+        whoHas.SetVersion(1, 1);
+        whoHas.SetTransportMask(TRANSPORT_TCP);
+        uint32_t n = (i * 7919) % (numNames * 2);
+        if (i & 1) {
+            whoHas.AddName("org.alljoyn.bench.Service" + U32ToString(n % numNames));
+        } else {
+            whoHas.AddName("org.alljoyn.bench.Service" + U32ToString(n) + "*");
+        }
+
+        Header header;
+        header.SetVersion(1, 1);
+        header.SetTimer(120);
+        header.AddQuestion(whoHas);
+
+        vector<uint8_t> packet(header.GetSerializedSize());
+        header.Serialize(&packet[0]);
+        packets.push_back(packet);
+    }
+}
+
+/*
+ * Replay the recorded packets, answering every matching question with the version zero and
+ * version one is-at messages out every interface. Returns the number of answers and adds the
+ * bytes that would have been sent to <bytes>.
+ */
+static uint32_t Replay(const vector<vector<uint8_t> >& packets, const set<qcc::String>& advertised,
+                       const vector<qcc::String>& interfaces, bool cached, uint64_t& bytes)
+{
+    /* The bytes kept for each (version, interface) in the cached pass */
+    static map<pair<uint32_t, uint32_t>, vector<vector<uint8_t> > > cache;
+
+    uint32_t answered = 0;
+    for (size_t p = 0; p < packets.size(); ++p) {
+        Header question;
+        if (question.Deserialize(&packets[p][0], packets[p].size()) != packets[p].size()) {
+            continue;
+        }
+        bool respond = false;
+        for (uint32_t q = 0; !respond && (q < question.GetNumberQuestions()); ++q) {
+            WhoHas whoHas = question.GetQuestion(q);
+            for (uint32_t i = 0; !respond && (i < whoHas.GetNumberNames()); ++i) {
+                respond = IpNameServiceImplMatchAny(advertised, whoHas.GetName(i));
+            }
+        }
+        if (!respond) {
+            continue;
+        }
+        ++answered;
+
+        for (uint32_t msgVersion = 0; msgVersion < 2; ++msgVersion) {
+            if (cached) {
+                for (uint32_t i = 0; i < interfaces.size(); ++i) {
+                    vector<vector<uint8_t> >& kept = cache[make_pair(msgVersion, i)];
+                    if (kept.empty()) {
+                        vector<Header> headers;
+                        Build(advertised, msgVersion, headers);
+                        kept.resize(headers.size());
+                        for (size_t h = 0; h < headers.size(); ++h) {
+                            Serialize(headers[h], msgVersion, interfaces[i], kept[h]);
+                        }
+                    }
+                    for (size_t h = 0; h < kept.size(); ++h) {
+                        bytes += kept[h].size();
+                    }
+                }
+            } else {
+                vector<Header> headers;
+                Build(advertised, msgVersion, headers);
+                for (size_t h = 0; h < headers.size(); ++h) {
+                    for (uint32_t i = 0; i < interfaces.size(); ++i) {
+                        vector<uint8_t> packet;
+                        bytes += Serialize(headers[h], msgVersion, interfaces[i], packet);
+                    }
+                }
+            }
+        }
+    }
+    return answered;
+}
+
+static void Usage()
+{
+    printf("Usage: isatbench [-h] [-n <names>] [-p <packets>] [-f <interfaces>] [-i <iterations>]\n\n");
+    printf("Options:\n");
+    printf("   -h                    = Print this help message\n");
+    printf("   -n <names>            = Number of advertised names (default 50)\n");
+    printf("   -p <packets>          = Number of recorded who-has packets (default 1000)\n");
+    printf("   -f <interfaces>       = Number of live interfaces answered out of (default 3)\n");
+    printf("   -i <iterations>       = Number of times the recording is replayed (default 10)\n");
+}
+
+int main(int argc, char** argv)
+{
+    uint32_t numNames = 50;
+    uint32_t numPackets = 1000;
+    uint32_t numInterfaces = 3;
+    uint32_t iterations = 10;
+
+    for (int i = 1; i < argc; ++i) {
+        if ((0 == strcmp("-n", argv[i])) && (++i < argc)) {
+            numNames = StringToU32(argv[i], 0, numNames);
+        } else if ((0 == strcmp("-p", argv[i])) && (++i < argc)) {
+            numPackets = StringToU32(argv[i], 0, numPackets);
+        } else if ((0 == strcmp("-f", argv[i])) && (++i < argc)) {
+            numInterfaces = StringToU32(argv[i], 0, numInterfaces);
+        } else if ((0 == strcmp("-i", argv[i])) && (++i < argc)) {
+            iterations = StringToU32(argv[i], 0, iterations);
+        } else {
+            Usage();
+            exit(1);
+        }
+    }
+
+    set<qcc::String> advertised;
+    for (uint32_t i = 0; i < numNames; ++i) {
+        advertised.insert("org.alljoyn.bench.Service" + U32ToString(i));
+    }
+
+    vector<qcc::String> interfaces;
+    for (uint32_t i = 0; i < numInterfaces; ++i) {
+        interfaces.push_back("192.168." + U32ToString(i) + ".10");
+    }
+
+    vector<vector<uint8_t> > packets;
+    Record(numNames, numPackets, packets);
+
+    for (int pass = 0; pass < 2; ++pass) {
+        bool cached = (pass == 1);
+        uint32_t answered = 0;
+        uint64_t bytes = 0;
+        allocations = 0;
+        counting = true;
+        clock_t start = clock();
+        for (uint32_t i = 0; i < iterations; ++i) {
+            answered += Replay(packets, advertised, interfaces, cached, bytes);
+        }
+        clock_t cpu = clock() - start;
+        counting = false;
+        uint64_t us = ((uint64_t)cpu * 1000000) / CLOCKS_PER_SEC;
+        printf("%s: %u names %u interfaces %u answers, %u allocations and %u ns of CPU per answer (%u bytes sent)\n",
+               cached ? "Cached bytes" : "Rebuilt     ",
+               numNames,
+               numInterfaces,
+               answered,
+               (unsigned int)(allocations / (answered ? answered : 1)),
+               (unsigned int)((us * 1000) / (answered ? answered : 1)),
+               (unsigned int)bytes);
+    }
+    return 0;
+}
@@ -0,0 +1,173 @@
+/**
+ * @file
+ * Measures name table lookup throughput with many concurrent senders while names are being
+ * acquired and released, with and without the name table lock held for each lookup.
+ */
+
+/******************************************************************************
+ * Copyright 2013, Qualcomm Innovation Center, Inc.
+ *
+ *    Licensed under the Apache License, Version 2.0 (the "License");
+ *    you may not use this file except in compliance with the License.
+ *    You may obtain a copy of the License at
+ *
+ *        http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *    Unless required by applicable law or agreed to in writing, software
+ *    distributed under the License is distributed on an "AS IS" BASIS,
+ *    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *    See the License for the specific language governing permissions and
+ *    limitations under the License.
+ ******************************************************************************/
+#include <qcc/platform.h>
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <vector>
+
+#include <qcc/Debug.h>
+#include <qcc/String.h>
+#include <qcc/StringUtil.h>
+#include <qcc/Thread.h>
+#include <qcc/time.h>
+
+#include <alljoyn/DBusStd.h>
+#include <alljoyn/Status.h>
+
+#include "NameTable.h"
+
+#define QCC_MODULE "ALLJOYN"
+
+using namespace qcc;
+using namespace std;
+using namespace ajn;
+
+class _BenchEndpoint : public _BusEndpoint {
+  public:
+    _BenchEndpoint() : _BusEndpoint(ENDPOINT_TYPE_NULL) { }
+    _BenchEndpoint(const qcc::String& name) : _BusEndpoint(ENDPOINT_TYPE_NULL), uniqueName(name) { }
+    const qcc::String& GetUniqueName() const { return uniqueName; }
+  private:
+    qcc::String uniqueName;
+};
+
+typedef qcc::ManagedObj<_BenchEndpoint> BenchEndpoint;
+
+class SenderThread : public Thread {
+  public:
+    SenderThread(NameTable& nameTable, const vector<qcc::String>& names, uint32_t iterations, bool lockTable) :
+        Thread("Sender"), nameTable(nameTable), names(names), iterations(iterations), lockTable(lockTable), found(0) { }
+
+    ThreadReturn STDCALL Run(void* arg)
+    {
+        for (uint32_t i = 0; i < iterations; ++i) {
+            const qcc::String& name = names[(i * 7919) % names.size()];
+            if (lockTable) {
+                nameTable.Lock();
+            }
+            BusEndpoint ep = nameTable.FindEndpoint(name);
+            if (lockTable) {
+                nameTable.Unlock();
+            }
+            if (ep->IsValid()) {
+                ++found;
+            }
+        }
+        return 0;
+    }
+
+    NameTable& nameTable;
+    const vector<qcc::String>& names;
+    uint32_t iterations;
+    bool lockTable;
+    uint32_t found;
+};
+
+static void Usage()
+{
+    printf("Usage: nametablebench [-h] [-s <senders>] [-n <names>] [-i <iterations>]\n\n");
+    printf("Options:\n");
+    printf("   -h                    = Print this help message\n");
+    printf("   -s <senders>          = Number of concurrent sender threads (default 8)\n");
+    printf("   -n <names>            = Number of unique names in the name table (default 1000)\n");
+    printf("   -i <iterations>       = Number of lookups per sender (default 200000)\n");
+}
+
+int main(int argc, char** argv)
+{
+    uint32_t numSenders = 8;
+    uint32_t numNames = 1000;
+    uint32_t iterations = 200000;
+
+    for (int i = 1; i < argc; ++i) {
+        if ((0 == strcmp("-s", argv[i])) && (++i < argc)) {
+            numSenders = StringToU32(argv[i], 0, numSenders);
+        } else if ((0 == strcmp("-n", argv[i])) && (++i < argc)) {
+            numNames = StringToU32(argv[i], 0, numNames);
+        } else if ((0 == strcmp("-i", argv[i])) && (++i < argc)) {
+            iterations = StringToU32(argv[i], 0, iterations);
+        } else {
+            Usage();
+            exit(1);
+        }
+    }
+
+    NameTable nameTable;
+    vector<qcc::String> names;
+    for (uint32_t i = 0; i < numNames; ++i) {
+        BenchEndpoint bep(nameTable.GenerateUniqueName());
+        BusEndpoint ep = BusEndpoint::cast(bep);
+        nameTable.AddUniqueName(ep);
+        names.push_back(ep->GetUniqueName());
+        if (i & 1) {
+            qcc::String alias = "org.alljoyn.bench.Name" + U32ToString(i);
+            uint32_t disposition;
+            nameTable.AddAlias(alias, ep->GetUniqueName(), 0, disposition);
+            names.push_back(alias);
+        }
+    }
+
+    for (int pass = 0; pass < 2; ++pass) {
+        bool lockTable = (pass == 0);
+        vector<SenderThread*> senders;
+        uint64_t start = GetTimestamp64();
+        for (uint32_t i = 0; i < numSenders; ++i) {
+            senders.push_back(new SenderThread(nameTable, names, iterations, lockTable));
+            senders.back()->Start();
+        }
+        /*
+         * Acquire and release names while the senders are running the way RequestName and
+         * ReleaseName calls do.
+         */
+        uint32_t changes = 0;
+        bool running = true;
+        while (running) {
+            qcc::String alias = "org.alljoyn.bench.Churn" + U32ToString(changes % 64);
+            uint32_t disposition;
+            nameTable.AddAlias(alias, names[0], 0, disposition);
+            nameTable.RemoveAlias(alias, names[0], disposition);
+            changes += 2;
+            running = false;
+            for (size_t i = 0; i < senders.size(); ++i) {
+                if (senders[i]->IsRunning()) {
+                    running = true;
+                    break;
+                }
+            }
+        }
+        uint32_t found = 0;
+        for (size_t i = 0; i < senders.size(); ++i) {
+            senders[i]->Join();
+            found += senders[i]->found;
+            delete senders[i];
+        }
+        uint64_t ms = GetTimestamp64() - start;
+        printf("%s: %u senders %u lookups/sec (%u found), %u name changes\n",
+               lockTable ? "Locked lookups  " : "Lockless lookups",
+               numSenders,
+               (unsigned int)(((uint64_t)numSenders * iterations * 1000) / (ms ? ms : 1)),
+               found,
+               changes);
+    }
+    return 0;
+}
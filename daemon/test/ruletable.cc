@@ -0,0 +1,179 @@
+/**
+ * @file
+ * Microbenchmark comparing broadcast rule matching over the full rule table
+ * with the indexed lookup in RuleTable::GetMatchingEndpoints.
+ */
+
+/******************************************************************************
+ * Copyright 2013, Qualcomm Innovation Center, Inc.
+ *
+ *    Licensed under the Apache License, Version 2.0 (the "License");
+ *    you may not use this file except in compliance with the License.
+ *    You may obtain a copy of the License at
+ *
+ *        http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *    Unless required by applicable law or agreed to in writing, software
+ *    distributed under the License is distributed on an "AS IS" BASIS,
+ *    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *    See the License for the specific language governing permissions and
+ *    limitations under the License.
+ ******************************************************************************/
+
+#include <qcc/platform.h>
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <set>
+#include <vector>
+
+#include <qcc/Debug.h>
+#include <qcc/String.h>
+#include <qcc/StringUtil.h>
+#include <qcc/time.h>
+
+#include <alljoyn/BusAttachment.h>
+#include <alljoyn/Message.h>
+#include <alljoyn/version.h>
+
+#include <alljoyn/Status.h>
+
+#include "BusEndpoint.h"
+#include "RuleTable.h"
+
+#define QCC_MODULE "ALLJOYN"
+
+using namespace qcc;
+using namespace std;
+using namespace ajn;
+
+static const uint32_t NUM_IFACES = 50;
+static const uint32_t NUM_MEMBERS = 20;
+
+class _TestMessage : public _Message {
+  public:
+    _TestMessage(BusAttachment& bus) : _Message(bus) { }
+
+    QStatus Signal(const char* objPath, const char* iface, const char* signalName)
+    {
+        return SignalMsg("", NULL, 0, objPath, iface, signalName, NULL, 0, 0, 0);
+    }
+};
+
+typedef ManagedObj<_TestMessage> TestMessage;
+
+/*
+ * Matching as done by DaemonRouter before rules were indexed.
+ */
+static void LinearMatch(RuleTable& ruleTable, const Message& msg, set<BusEndpoint>& matches)
+{
+    ruleTable.Lock();
+    RuleIterator it = ruleTable.Begin();
+    while (it != ruleTable.End()) {
+        if (it->second.IsMatch(msg)) {
+            matches.insert(it->first);
+            it = ruleTable.AdvanceToNextEndpoint(it->first);
+        } else {
+            ++it;
+        }
+    }
+    ruleTable.Unlock();
+}
+
+static void usage(void)
+{
+    printf("Usage: ruletable [-n <iterations>] [-e <endpoints>]\n\n");
+    printf("Options:\n");
+    printf("   -h                = Print this help message\n");
+    printf("   -n <iterations>   = Number of messages matched per rule table size\n");
+    printf("   -e <endpoints>    = Number of endpoints that rules are spread over\n");
+}
+
+int main(int argc, char** argv)
+{
+    uint32_t iterations = 10000;
+    uint32_t numEndpoints = 200;
+
+    printf("AllJoyn Library version: %s\n", ajn::GetVersion());
+    printf("AllJoyn Library build info: %s\n", ajn::GetBuildInfo());
+
+    for (int i = 1; i < argc; ++i) {
+        if ((0 == strcmp("-n", argv[i])) && (++i < argc)) {
+            iterations = StringToU32(argv[i], 0, iterations);
+        } else if ((0 == strcmp("-e", argv[i])) && (++i < argc)) {
+            numEndpoints = StringToU32(argv[i], 0, numEndpoints);
+        } else {
+            usage();
+            exit(1);
+        }
+    }
+
+    BusAttachment bus("ruletable");
+    vector<BusEndpoint> endpoints;
+    for (uint32_t i = 0; i < numEndpoints; ++i) {
+        EndpointType type = ENDPOINT_TYPE_NULL;
+        endpoints.push_back(BusEndpoint(type));
+    }
+
+    /* Messages cycle over a fixed set of interfaces and members */
+    vector<Message> msgs;
+    for (uint32_t i = 0; i < NUM_IFACES; ++i) {
+        TestMessage tmsg(bus);
+        String iface = "org.alljoyn.bench.Iface" + U32ToString(i);
+        String member = "Signal" + U32ToString(i % NUM_MEMBERS);
+        QStatus status = tmsg->Signal("/org/alljoyn/bench", iface.c_str(), member.c_str());
+        if (status != ER_OK) {
+            QCC_LogError(status, ("Failed to create signal"));
+            return 1;
+        }
+        msgs.push_back(Message::cast(tmsg));
+    }
+
+    const uint32_t ruleCounts[] = { 100, 1000, 5000, 10000 };
+    printf("%10s %16s %16s %10s\n", "rules", "linear (ns/msg)", "indexed (ns/msg)", "matches");
+    for (size_t c = 0; c < ArraySize(ruleCounts); ++c) {
+        RuleTable ruleTable;
+        for (uint32_t r = 0; r < ruleCounts[c]; ++r) {
+            BusEndpoint& ep = endpoints[r % numEndpoints];
+            String spec = "type='signal',interface='org.alljoyn.bench.Iface" + U32ToString(r % 1000) +
+                          "',member='Signal" + U32ToString(r % NUM_MEMBERS) + "'";
+            /* Sprinkle in some path-only and wildcard rules */
+            if ((r % 97) == 0) {
+                spec = "type='signal',path='/org/alljoyn/bench" + U32ToString(r) + "'";
+            } else if ((r % 499) == 0) {
+                spec = "type='signal',sender='" + ep->GetUniqueName() + "'";
+            }
+            ruleTable.AddRule(ep, Rule(spec.c_str()));
+        }
+
+        size_t linearMatches = 0;
+        uint64_t start = GetTimestamp64();
+        for (uint32_t i = 0; i < iterations; ++i) {
+            set<BusEndpoint> matches;
+            LinearMatch(ruleTable, msgs[i % msgs.size()], matches);
+            linearMatches += matches.size();
+        }
+        uint64_t linearMs = GetTimestamp64() - start;
+
+        size_t indexedMatches = 0;
+        start = GetTimestamp64();
+        for (uint32_t i = 0; i < iterations; ++i) {
+            set<BusEndpoint> matches;
+            ruleTable.GetMatchingEndpoints(msgs[i % msgs.size()], matches);
+            indexedMatches += matches.size();
+        }
+        uint64_t indexedMs = GetTimestamp64() - start;
+
+        if (linearMatches != indexedMatches) {
+            printf("Mismatch: linear matched %u endpoints, indexed matched %u endpoints\n",
+                   (unsigned int)linearMatches, (unsigned int)indexedMatches);
+            return 1;
+        }
+        printf("%10u %16u %16u %10u\n", ruleCounts[c],
+               (unsigned int)((linearMs * 1000000) / iterations),
+               (unsigned int)((indexedMs * 1000000) / iterations),
+               (unsigned int)(indexedMatches / iterations));
+    }
+    return 0;
+}
@@ -0,0 +1,184 @@
+/**
+ * @file
+ * Measures how fast who-has questions are matched against many advertised names. A recording of
+ * who-has packets is replayed through the name service matching, once by comparing every question
+ * with every advertised name and once by looking only at the advertised names sharing the prefix
+ * of the question.
+ */
+
+/******************************************************************************
+ * Copyright 2013, Qualcomm Innovation Center, Inc.
+ *
+ *    Licensed under the Apache License, Version 2.0 (the "License");
+ *    you may not use this file except in compliance with the License.
+ *    You may obtain a copy of the License at
+ *
+ *        http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *    Unless required by applicable law or agreed to in writing, software
+ *    distributed under the License is distributed on an "AS IS" BASIS,
+ *    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *    See the License for the specific language governing permissions and
+ *    limitations under the License.
+ ******************************************************************************/
+#include <qcc/platform.h>
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <list>
+#include <set>
+#include <vector>
+
+#include <qcc/Debug.h>
+#include <qcc/String.h>
+#include <qcc/StringUtil.h>
+#include <qcc/time.h>
+
+#include <alljoyn/Status.h>
+#include <alljoyn/TransportMask.h>
+
+#include "ns/IpNameServiceImpl.h"
+#include "ns/IpNsProtocol.h"
+
+#define QCC_MODULE "ALLJOYN"
+
+using namespace qcc;
+using namespace std;
+using namespace ajn;
+
+/*
+ * Record who-has packets the way a busy network would deliver them: questions about names we
+ * advertise, about names we don't and prefix questions from discovering clients.
+ */
+static void Record(uint32_t numNames, uint32_t numPackets, vector<vector<uint8_t> >& packets)
+{
+    for (uint32_t i = 0; i < numPackets; ++i) {
+        WhoHas whoHas;
+        whoHas.SetVersion(1, 1);
+        whoHas.SetTransportMask(TRANSPORT_TCP);
+        uint32_t n = (i * 7919) % (numNames * 2);
+        switch (i % 4) {
+        case 0:
+            whoHas.AddName("org.alljoyn.bench.Service" + U32ToString(n));
+            break;
+
+        case 1:
+            whoHas.AddName("org.alljoyn.bench.Service" + U32ToString(n % numNames) + "*");
+            break;
+
+        case 2:
+            whoHas.AddName("org.alljoyn.other.Service" + U32ToString(n) + "*");
+            break;
+
+        default:
+            whoHas.AddName("com.example.app" + U32ToString(n) + ".*");
+            whoHas.AddName("org.alljoyn.bench.Service" + U32ToString(n));
+            break;
+        }
+
+        Header header;
+        header.SetVersion(1, 1);
+        header.SetTimer(120);
+        header.AddQuestion(whoHas);
+
+        vector<uint8_t> packet(header.GetSerializedSize());
+        header.Serialize(&packet[0]);
+        packets.push_back(packet);
+    }
+}
+
+/*
+ * Replay the recorded packets and count the questions that would be answered.
+ */
+static uint32_t Replay(const vector<vector<uint8_t> >& packets, const list<qcc::String>* advertisedList,
+                       const set<qcc::String>* advertisedSet)
+{
+    uint32_t answered = 0;
+    for (size_t p = 0; p < packets.size(); ++p) {
+        Header header;
+        if (header.Deserialize(&packets[p][0], packets[p].size()) != packets[p].size()) {
+            continue;
+        }
+        for (uint32_t q = 0; q < header.GetNumberQuestions(); ++q) {
+            WhoHas whoHas = header.GetQuestion(q);
+            bool respond = false;
+            for (uint32_t i = 0; !respond && (i < whoHas.GetNumberNames()); ++i) {
+                qcc::String wkn = whoHas.GetName(i);
+                if (advertisedSet) {
+                    respond = IpNameServiceImplMatchAny(*advertisedSet, wkn);
+                } else {
+                    for (list<qcc::String>::const_iterator j = advertisedList->begin(); j != advertisedList->end(); ++j) {
+                        if (IpNameServiceImplWildcardMatch(*j, wkn) == false) {
+                            respond = true;
+                            break;
+                        }
+                    }
+                }
+            }
+            if (respond) {
+                ++answered;
+            }
+        }
+    }
+    return answered;
+}
+
+static void Usage()
+{
+    printf("Usage: whohasbench [-h] [-n <names>] [-p <packets>] [-i <iterations>]\n\n");
+    printf("Options:\n");
+    printf("   -h                    = Print this help message\n");
+    printf("   -n <names>            = Number of advertised names (default 500)\n");
+    printf("   -p <packets>          = Number of recorded who-has packets (default 1000)\n");
+    printf("   -i <iterations>       = Number of times the recording is replayed (default 20)\n");
+}
+
+int main(int argc, char** argv)
+{
+    uint32_t numNames = 500;
+    uint32_t numPackets = 1000;
+    uint32_t iterations = 20;
+
+    for (int i = 1; i < argc; ++i) {
+        if ((0 == strcmp("-n", argv[i])) && (++i < argc)) {
+            numNames = StringToU32(argv[i], 0, numNames);
+        } else if ((0 == strcmp("-p", argv[i])) && (++i < argc)) {
+            numPackets = StringToU32(argv[i], 0, numPackets);
+        } else if ((0 == strcmp("-i", argv[i])) && (++i < argc)) {
+            iterations = StringToU32(argv[i], 0, iterations);
+        } else {
+            Usage();
+            exit(1);
+        }
+    }
+
+    list<qcc::String> advertisedList;
+    set<qcc::String> advertisedSet;
+    for (uint32_t i = 0; i < numNames; ++i) {
+        qcc::String name = "org.alljoyn.bench.Service" + U32ToString(i);
+        advertisedList.push_back(name);
+        advertisedSet.insert(name);
+    }
+    advertisedList.sort();
+
+    vector<vector<uint8_t> > packets;
+    Record(numNames, numPackets, packets);
+
+    for (int pass = 0; pass < 2; ++pass) {
+        bool indexed = (pass == 1);
+        uint32_t answered = 0;
+        uint64_t start = GetTimestamp64();
+        for (uint32_t i = 0; i < iterations; ++i) {
+            answered = Replay(packets, indexed ? NULL : &advertisedList, indexed ? &advertisedSet : NULL);
+        }
+        uint64_t ms = GetTimestamp64() - start;
+        printf("%s: %u names %u packets/sec (%u of %u answered)\n",
+               indexed ? "Prefix index" : "Linear scan ",
+               numNames,
+               (unsigned int)(((uint64_t)numPackets * iterations * 1000) / (ms ? ms : 1)),
+               answered,
+               numPackets);
+    }
+    return 0;
+}
@@ -791,7 +791,7 @@ bool ProximityNameService::GetPeerConnectSpec(const qcc::String guid, qcc::Strin
     return false;
 }
 
-extern bool IpNameServiceImplWildcardMatch(qcc::String str, qcc::String pat);
+extern bool IpNameServiceImplWildcardMatch(const qcc::String& str, const qcc::String& pat);
 
 #if DO_P2P_NAME_ADVERTISE
 void ProximityNameService::StartMaintainanceTimer()
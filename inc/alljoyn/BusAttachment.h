@@ -1683,6 +1683,20 @@ class BusAttachment : public MessageReceiver {
      */
     QStatus SetDaemonDebug(const char* module, uint32_t level);
 
+    /**
+     * Set the number of serial numbers tracked for each remote peer to detect replayed messages.
+     * A message is rejected with #ER_BUS_INVALID_HEADER_SERIAL if its serial number has been seen
+     * before or is further behind the highest serial number received from the peer than the
+     * window allows. Applications that receive many messages out of order, for example on
+     * unreliable or heavily used multipoint sessions, need a larger window than the default of 128.
+     *
+     * The window applies to peers first seen after this call, so it should be set before Connect().
+     * The daemon sets its own window with the limit@serial_window configuration value.
+     *
+     * @param size   Number of serial numbers tracked for each peer, between 32 and 65536.
+     */
+    void SetSerialWindowSize(uint32_t size);
+
     /**
      * Returns the current non-absolute real-time clock used internally by AllJoyn. This value can be
      * compared with the timestamps on messages to calculate the time since a timestamped message
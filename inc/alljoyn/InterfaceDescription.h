@@ -48,6 +48,10 @@ static const uint8_t MEMBER_ANNOTATE_NO_REPLY   = 1; /**< No reply annotate flag
 static const uint8_t MEMBER_ANNOTATE_DEPRECATED = 2; /**< Deprecated annotate flag */
 // @}
 
+/// @cond ALLJOYN_DEV
+class MarshalPlan;
+/// @endcond
+
 /**
  * @class InterfaceDescription
  * Class for describing message bus interfaces. %InterfaceDescription objects describe the methods,
@@ -90,6 +94,8 @@ class InterfaceDescription {
         qcc::String argNames;                /**< Comma separated list of argument names - can be NULL */
         AnnotationsMap* annotations;           /**< Map of annotations */
         qcc::String accessPerms;              /**< Required permissions to invoke this call */
+        const MarshalPlan* argsPlan;          /**< @internal Marshal plan for signature, compiled when the interface is activated */
+        const MarshalPlan* returnPlan;        /**< @internal Marshal plan for returnSignature, compiled when the interface is activated */
 
         /** %Member constructor.
          *
@@ -653,7 +659,7 @@ class InterfaceDescription {
      * csharp/Sessions/Sessions/App.xaml.cs @n
      * csharp/Sessions/Sessions/Common/MyBusObject.cs @n
      */
-    void Activate() { isActivated = true; }
+    void Activate();
 
     /**
      * Indicates if this interface is secure. Secure interfaces require end-to-end authentication.
@@ -157,6 +157,7 @@ class HeaderFields {
 class _Message;
 class _RemoteEndpoint;
 class BusAttachment;
+class MarshalPlan;
 
 /**
  * @cond ALLJOYN_DEV
@@ -279,10 +280,18 @@ class _Message {
      * See also these sample file(s): @n
      * windows/Service/Service.cpp @n
      *
-     * @param[out] args  Returns the arguments
+     * @param[out] args  Returns the arguments, NULL if unmarshal failed
      * @param[out] numArgs The number of arguments
      */
-    void GetArgs(size_t& numArgs, const MsgArg*& args) { args = msgArgs; numArgs = numMsgArgs; }
+    void GetArgs(size_t& numArgs, const MsgArg*& args) {
+        if (lazyArgs && (DecodeLazyArgs() != ER_OK)) {
+            numArgs = 0;
+            args = NULL;
+            return;
+        }
+        args = msgArgs;
+        numArgs = numMsgArgs;
+    }
 
     /**
      * Return a specific argument.
@@ -330,7 +339,33 @@ class _Message {
      *      - The argument
      *      - NULL if unmarshal failed or there is not such argument.
      */
-    const MsgArg* GetArg(size_t argN = 0) { return (argN < numMsgArgs) ? &msgArgs[argN] : NULL; }
+    const MsgArg* GetArg(size_t argN = 0) {
+        if (argN >= numMsgArgs) {
+            return NULL;
+        }
+        if (lazyArgs && (DecodeLazyArg(argN) != ER_OK)) {
+            return NULL;
+        }
+        return &msgArgs[argN];
+    }
+
+    /**
+     * @internal
+     * Get the value of a basic type argument directly from the message body without unmarshaling
+     * the message arguments. Only arguments of type byte, boolean, int32, uint32, string and object
+     * path can be peeked. A string value references the message buffer so is only valid for the
+     * lifetime of the message.
+     *
+     * @param argN  The index of the argument to get.
+     * @param arg   Returns the argument value.
+     *
+     * @return
+     *      - #ER_OK if the argument was returned
+     *      - #ER_BUS_BAD_VALUE_TYPE if the argument is not a basic type that can be peeked
+     *      - #ER_BUS_NOT_ALLOWED if the message body is encrypted or not available
+     *      - An error status if the message body is malformed
+     */
+    QStatus PeekArg(size_t argN, MsgArg& arg) const;
 
     /**
      * Unpack and return the arguments for this message. This method uses the functionality from
@@ -702,6 +737,7 @@ class _Message {
      * @param args        The method call argument list (can be NULL)
      * @param numArgs     The number of arguments
      * @param flags       A logical OR of the AllJoyn flags
+     * @param plan        Marshal plan compiled for the signature (can be NULL)
      * @return
      *      - #ER_OK if successful
      *      - An error status otherwise
@@ -714,7 +750,8 @@ class _Message {
                     const qcc::String& methodName,
                     const MsgArg* args,
                     size_t numArgs,
-                    uint8_t flags);
+                    uint8_t flags,
+                    const MarshalPlan* plan = NULL);
 
     /**
      * @internal
@@ -731,6 +768,7 @@ class _Message {
      * @param flags       A logical OR of the AllJoyn flags.
      * @param timeToLive  Time-to-live. Units are seconds for sessionless signals. Milliseconds for non-sessionless signals.
      *                    Signals that cannot be sent within this time limit are discarded. Zero indicates reliable delivery.
+     * @param plan        Marshal plan compiled for the signature (can be NULL)
      * @return
      *      - #ER_OK if successful
      *      - An error status otherwise
@@ -744,7 +782,8 @@ class _Message {
                       const MsgArg* args,
                       size_t numArgs,
                       uint8_t flags,
-                      uint16_t timeToLive);
+                      uint16_t timeToLive,
+                      const MarshalPlan* plan = NULL);
 
 
     /**
@@ -754,13 +793,19 @@ class _Message {
      * @param expectedSignature       The expected signature for this message.
      * @param expectedReplySignature  The expected reply signature for this message if it is a
      *                                method call message or NULL otherwise.
+     * @param lazy                    If true the message body is validated but each top-level
+     *                                argument is only decoded when it is first accessed by GetArg()
+     *                                or GetArgs(). Decoding modifies the message without a lock so
+     *                                this is only for internal routing code that owns the message;
+     *                                never for messages that are passed to application handlers.
      *
      * @return
      *         - #ER_OK if the message was unmarshaled
      *         - Error status indicating why the unmarshal failed.
      */
     QStatus UnmarshalArgs(const qcc::String& expectedSignature,
-                          const char* expectedReplySignature = NULL);
+                          const char* expectedReplySignature = NULL,
+                          bool lazy = false);
 
     /**
      * @internal
@@ -816,16 +861,196 @@ class _Message {
      */
     QStatus Deliver(RemoteEndpoint& endpoint);
 
+    /**
+     * @internal
+     * Reference counted buffer that holds a marshaled message. Copies of a message and endpoints
+     * that are writing the message share the same wire buffer. A shared wire buffer is never
+     * modified, it is copied first.
+     */
+    struct WireBuffer;
+
+    /**
+     * @internal
+     * Per-endpoint write state for a message. A message that is queued on several endpoints is
+     * written from the same wire buffer, each endpoint tracks its own progress with a write cursor.
+     */
+    class WriteCursor {
+        friend class _Message;
+      public:
+        /**
+         * Construct an idle write cursor.
+         */
+        WriteCursor() : writeState(MESSAGE_NEW), buf(NULL), writePtr(NULL), countWrite(0), numWrites(0) { }
+
+        /**
+         * Destructor releases the wire buffer if one is held.
+         */
+        ~WriteCursor() { Reset(); }
+
+        /**
+         * Release the wire buffer and return the cursor to its initial state so it can be used to
+         * write another message.
+         */
+        void Reset();
+
+        /**
+         * Get the next byte of the message to be written.
+         *
+         * @return  Pointer to the first byte not yet written.
+         */
+        const uint8_t* GetWritePtr() const { return writePtr; }
+
+        /**
+         * Get the number of bytes of the message that remain to be written.
+         *
+         * @return  Number of bytes not yet written.
+         */
+        size_t GetRemaining() const { return countWrite; }
+
+        /**
+         * Record that bytes of the message were written by the caller. The cursor is complete
+         * when all bytes have been written.
+         *
+         * @param numBytes  Number of bytes written, must not exceed GetRemaining().
+         */
+        void Advance(size_t numBytes)
+        {
+            writePtr += numBytes;
+            countWrite -= numBytes;
+            writeState = (countWrite == 0) ? MESSAGE_COMPLETE : MESSAGE_HEADER_BODY;
+        }
+
+        /**
+         * Check if delivery of the message has started.
+         *
+         * @return  true if BeginDelivery() has been called since the last Reset().
+         */
+        bool IsStarted() const { return writeState != MESSAGE_NEW; }
+
+        /**
+         * Check if the message has been completely written.
+         *
+         * @return  true if there is nothing left to write.
+         */
+        bool IsComplete() const { return writeState == MESSAGE_COMPLETE; }
+
+        /**
+         * Get the number of write calls made by DeliverNonBlocking() for the message.
+         *
+         * @return  Number of write calls since the last Reset().
+         */
+        uint32_t GetNumWrites() const { return numWrites; }
+
+      private:
+        WriteCursor(const WriteCursor& other);
+        WriteCursor& operator=(const WriteCursor& other);
+
+        AllJoynMessageState writeState; ///< The current state of the message during write.
+        WireBuffer* buf;                ///< Wire buffer being written (holds a reference).
+        const uint8_t* writePtr;        ///< Pointer to the current write position in the buffer.
+        size_t countWrite;              ///< Number of bytes remaining to write for completion of the message.
+        uint32_t numWrites;             ///< Number of write calls made for the message.
+    };
+
     /**
      * @internal
      * Deliver a marshaled message to a remote endpoint. Non-blocking
      *
      * @param endpoint   Endpoint to receive marshaled message.
+     * @param cursor     Write state of the message for this endpoint.
      * @return
      *      - #ER_OK if successful
      *      - An error status otherwise
      */
-    QStatus DeliverNonBlocking(RemoteEndpoint& endpoint);
+    QStatus DeliverNonBlocking(RemoteEndpoint& endpoint, WriteCursor& cursor);
+
+    /**
+     * @internal
+     * Start delivery of a marshaled message to a remote endpoint without writing anything. The
+     * message is checked and encrypted if required and the cursor is pointed at the bytes to
+     * write. This lets the caller gather the bytes of several messages into a single write. If
+     * the message is not to be sent (e.g. the TTL has expired) the cursor is already complete.
+     *
+     * @param endpoint   Endpoint to receive marshaled message.
+     * @param cursor     Write state of the message for this endpoint.
+     * @return
+     *      - #ER_OK if successful
+     *      - An error status otherwise
+     */
+    QStatus BeginDelivery(RemoteEndpoint& endpoint, WriteCursor& cursor);
+
+    /**
+     * @internal
+     * Per-endpoint read buffer. Bytes are read from the endpoint in bulk into a ring and each
+     * complete message is moved into a slot of a wire buffer that is shared by several messages.
+     * This means small messages do not each need a read call and a buffer allocation.
+     *
+     * A message keeps the whole wire buffer it was cut from alive so the shared wire buffers come
+     * in size classes. Each class only holds messages up to a fixed fraction of its size, so a
+     * message that is kept after the others have been released pins a small multiple of its own
+     * size. Messages too large for any class get their own buffer.
+     */
+    class ReadBuffer {
+        friend class _Message;
+      public:
+        static const size_t RING_SIZE = 16 * 1024;  ///< Size of the ring, larger messages are read directly.
+        static const size_t NUM_SLAB_CLASSES = 2;   ///< Number of sizes of shared wire buffers.
+        static const size_t SLAB_SLOTS = 8;         ///< Minimum number of messages that fit in a shared wire buffer.
+
+        /**
+         * Get the size of the shared wire buffers of a size class. A size class holds messages
+         * with buffers up to 1/SLAB_SLOTS of this size.
+         *
+         * @param cls  The size class.
+         *
+         * @return  Size of the wire buffers of the class.
+         */
+        static size_t SlabSize(size_t cls) { return (cls == 0) ? (4 * 1024) : (32 * 1024); }
+
+        /**
+         * Construct an empty read buffer.
+         */
+        ReadBuffer();
+
+        /**
+         * Destructor releases the ring and the shared wire buffer.
+         */
+        ~ReadBuffer();
+
+        /**
+         * Get the number of bytes that have been read but not yet consumed by a message.
+         *
+         * @return  Number of buffered bytes.
+         */
+        size_t Buffered() const { return tail - head; }
+
+      private:
+        ReadBuffer(const ReadBuffer& other);
+        ReadBuffer& operator=(const ReadBuffer& other);
+
+        uint8_t* ring;          ///< Bytes read from the endpoint.
+        size_t head;            ///< Offset of the first unconsumed byte in the ring.
+        size_t tail;            ///< Offset of the end of the bytes in the ring.
+        WireBuffer* slab[NUM_SLAB_CLASSES];     ///< Wire buffers that complete messages are moved into (hold a reference).
+        size_t slabUsed[NUM_SLAB_CLASSES];      ///< Number of bytes of each slab that have been handed out to messages.
+    };
+
+    /**
+     * @internal
+     * Reads a message from a remote endpoint through a read buffer. If a complete message is not
+     * available it returns immediately. Messages that are too large for the read buffer are read
+     * directly into their own buffer.
+     *
+     * @param endpoint       The endpoint to read the message data from.
+     * @param rxBuf          The read buffer for the endpoint.
+     * @param checkSender    True if message's sender field should be validated against the endpoint's unique name.
+     * @param exact          If true, don't read any bytes beyond the end of this message.
+     * @return
+     *      - #ER_OK if successful i.e. message is complete
+     *      - #ER_TIMEOUT if message is incomplete
+     *      - An error status otherwise
+     */
+    QStatus ReadBuffered(RemoteEndpoint& endpoint, ReadBuffer& rxBuf, bool checkSender, bool exact = false);
     /**
      * @internal
      * Marshal the message again with the new sender name if one was provided.
@@ -840,8 +1065,90 @@ class _Message {
     /**
      * @internal
      * Sets the serial number to the next available value for the bus attachment for this message.
+     *
+     * @return
+     *      - #ER_OK if the serial number was set
+     *      - An error status otherwise
+     */
+    QStatus SetSerialNumber();
+
+    /**
+     * @internal
+     * Storage for the MsgArgs created when the message body is unmarshaled. The body is sized
+     * before it is parsed so all of the MsgArgs are allocated in one block and are destroyed
+     * together when the args are cleared. Containers parsed into the arena do not own their
+     * nested MsgArgs.
      */
-    void SetSerialNumber();
+    class ArgArena {
+      public:
+        /**
+         * Construct an empty arena.
+         */
+        ArgArena() : capacity(0), args(NULL), used(0), counts(inlineCounts), numCounts(0), maxCounts(NUM_INLINE_COUNTS), nextCount(0) { }
+
+        /**
+         * Destructor destroys any MsgArgs allocated from the arena.
+         */
+        ~ArgArena() { Release(); }
+
+        /**
+         * Tests if the arena currently holds the message args.
+         */
+        bool IsActive() const { return args != NULL; }
+
+        /**
+         * Record the number of elements of the next container array found while sizing.
+         *
+         * @return  An index that is passed to SetCount() once the elements have been counted.
+         */
+        size_t AddCount();
+
+        /**
+         * Set the number of elements recorded by AddCount().
+         */
+        void SetCount(size_t index, uint32_t count) { counts[index] = count; }
+
+        /**
+         * Get the element count for the next container array being parsed. Arrays are parsed in
+         * the same order as they were sized.
+         */
+        uint32_t NextCount() { return (nextCount < numCounts) ? counts[nextCount++] : 0; }
+
+        /**
+         * Allocate the storage for the number of MsgArgs computed by the sizing pass.
+         */
+        void Reserve();
+
+        /**
+         * Get MsgArgs from the arena.
+         *
+         * @param numArgs  The number of contiguous MsgArgs required.
+         *
+         * @return  The MsgArgs or NULL if the arena does not have enough room.
+         */
+        MsgArg* Alloc(size_t numArgs);
+
+        /**
+         * Destroy the MsgArgs and free the storage.
+         */
+        void Release();
+
+        size_t capacity;           ///< Number of MsgArgs the body needs, computed by the sizing pass.
+
+      private:
+        ArgArena(const ArgArena& other);
+        ArgArena& operator=(const ArgArena& other);
+
+        static const size_t NUM_INLINE_COUNTS = 8;
+
+        MsgArg* args;                           ///< Storage for the MsgArgs.
+        size_t used;                            ///< Number of MsgArgs handed out.
+        uint32_t* counts;                       ///< Element counts of container arrays in parse order.
+        size_t numCounts;                       ///< Number of element counts recorded.
+        size_t maxCounts;                       ///< Number of element counts that fit in counts.
+        size_t nextCount;                       ///< Next element count to be used by the parser.
+        uint32_t inlineCounts[NUM_INLINE_COUNTS]; ///< Avoids allocating counts for typical messages.
+    };
 
     /// @endcond
 
@@ -925,10 +1232,16 @@ class _Message {
     bool endianSwap;             ///< true if endianness will be swapped.
 
     MessageHeader msgHeader;     ///< Current message header.
-    uint8_t* _msgBuf;            ///< Pointer to the current msg buffer.
-    uint64_t* msgBuf;            ///< Pointer to the current msg buffer (8 byte aligned pointer into _msgBuf).
+    WireBuffer* wireBuf;         ///< The current (possibly shared) msg buffer.
+    uint64_t* msgBuf;            ///< Pointer to the current msg buffer (8 byte aligned pointer into wireBuf).
+    mutable bool ownsSlot;       ///< True if no other message or write cursor uses this message's part of a shared wire buffer.
     MsgArg* msgArgs;             ///< Pointer to the unmarshaled arguments.
     uint8_t numMsgArgs;          ///< Number of message args (signature cannot be longer than 255 chars).
+    ArgArena argArena;           ///< Holds the unmarshaled arguments and their nested MsgArgs.
+    uint32_t* lazyArgs;          ///< Body offsets of top-level args not yet decoded by a lazy unmarshal.
+    size_t numLazyArgs;          ///< Number of top-level args still to be decoded.
+
+    static const uint32_t LAZY_ARG_DECODED = 0xFFFFFFFF;  ///< Marks a lazy arg as decoded.
 
     size_t bufSize;              ///< The current allocated size of the msg buffer.
     uint8_t* bufEOD;             ///< End of data currently in buffer.
@@ -939,6 +1252,7 @@ class _Message {
     uint32_t timestamp;          ///< Timestamp (local time) for messages with a ttl (time to live).
 
     qcc::String replySignature;  ///< Expected reply signature for a method call
+    const MarshalPlan* replyPlan; ///< Marshal plan for the reply to a method call (can be NULL)
 
     qcc::String authMechanism;   ///< For secure messages indicates the authentication mechanism that was used
 
@@ -953,19 +1267,70 @@ class _Message {
     size_t countRead;               ///< Number of bytes remaining to read for completion of the message.
     size_t maxFds;                  ///< Store the number of max FDs for the endpoint, so it doesnt need to be calculated each time.
 
-    AllJoynMessageState writeState; ///< The current state of the message during write.
-    uint8_t* writePtr;              ///< Pointer to the current write position in the buffer.
-    size_t countWrite;              ///< Number of bytes remaining to write for completion of the message.
-
     /**
      * The header fields for this message. Which header fields are present depends on the message
      * type defined in the message header.
      */
     HeaderFields hdrFields;
 
+    /* Internal methods for managing the wire buffer */
+
+    /**
+     * Allocate a new unshared wire buffer of bufSize bytes and point msgBuf at it. Any current
+     * wire buffer must have been released or saved by the caller.
+     */
+    void AllocBuffer();
+
+    /**
+     * Release this message's reference to its wire buffer.
+     */
+    void ReleaseBuffer();
+
+    /**
+     * Make sure this message is the only user of its wire buffer so the buffer can be modified
+     * in place. If the buffer is shared it is copied and the header field and buffer pointers
+     * are moved to the copy. A shared buffer cannot be copied once the message arguments have
+     * been unmarshaled because the arguments may point into the shared buffer.
+     *
+     * @return
+     *      - #ER_OK if the buffer can be modified in place
+     *      - #ER_BUS_NOT_ALLOWED if the buffer is shared and the arguments have been unmarshaled
+     */
+    QStatus MakeBufferWritable();
+
+    /**
+     * Allocate a buffer of bufSize bytes for this message from the shared wire buffer of a read
+     * buffer. If the shared wire buffer is full and messages allocated from it are still in use
+     * the message gets an unshared buffer instead so that messages that are kept around don't pin
+     * more than one shared wire buffer.
+     *
+     * @param rxBuf  The read buffer to allocate from.
+     */
+    void AllocBuffer(ReadBuffer& rxBuf);
+
+    /**
+     * Add a reference to a wire buffer.
+     *
+     * @param buf   The wire buffer (can be NULL).
+     * @return  The wire buffer.
+     */
+    static WireBuffer* AcquireWireBuffer(WireBuffer* buf);
+
+    /**
+     * Release a reference to a wire buffer.
+     *
+     * @param buf   The wire buffer (can be NULL).
+     */
+    static void ReleaseWireBuffer(WireBuffer* buf);
+
     /* Internal methods unmarshal side */
 
     void ClearHeader();
+    void ClearArgs();
+    MsgArg* AllocArgs(size_t numArgs);
+    QStatus SizeValue(const char*& sigPtr, uint8_t*& pos, ArgArena* arena, bool arrayElem = false) const;
+    QStatus DecodeLazyArg(size_t argN);
+    QStatus DecodeLazyArgs();
     QStatus ParseValue(MsgArg* arg, const char*& sigPtr, bool arrayElem = false);
     QStatus ParseStruct(MsgArg* arg, const char*& sigPtr);
     QStatus ParseDictEntry(MsgArg* arg, const char*& sigPtr);
@@ -995,9 +1360,13 @@ class _Message {
                            const MsgArg* args,
                            uint8_t numArgs,
                            uint8_t flags,
-                           SessionId sessionId);
+                           SessionId sessionId,
+                           const MarshalPlan* plan = NULL);
 
     QStatus MarshalArgs(const MsgArg* arg, size_t numArgs);
+    QStatus MarshalPlanArgs(const MarshalPlan& plan, const MsgArg* args, size_t numArgs);
+    QStatus MarshalPlanValue(const MarshalPlan& plan, size_t index, const MsgArg* arg);
+    QStatus MarshalHandle(qcc::SocketFd fd);
     void MarshalHeaderFields();
     size_t ComputeHeaderLen();
 
@@ -1008,7 +1377,9 @@ class _Message {
     qcc::String ToString(const MsgArg* args, size_t numArgs) const;
 
     /* Internal methods for read */
+    inline QStatus CheckHeader();
     inline QStatus InterpretHeader();
+    inline void LoadHeader();
     QStatus PullBytes(RemoteEndpoint& endpoint, bool checkSender, bool pedantic = true, uint32_t timeout = 0);
 };
 
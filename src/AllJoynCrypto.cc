@@ -82,12 +82,30 @@ static qcc::String ConcatenateCompressedFields(uint8_t* hdr, size_t hdrLen, cons
     return result;
 }
 
+_CipherContext::_CipherContext(const KeyBlob& keyBlob) : key(keyBlob), aes(NULL)
+{
+    if (key.GetType() == KeyBlob::AES) {
+        aes = new Crypto_AES(key, Crypto_AES::CCM);
+    }
+}
+
 QStatus Crypto::Encrypt(const _Message& message, const KeyBlob& keyBlob, uint8_t* msgBuf, size_t hdrLen, size_t& bodyLen)
+{
+    CipherContext cipher(keyBlob);
+    return Encrypt(message, cipher, msgBuf, hdrLen, bodyLen);
+}
+
+QStatus Crypto::Decrypt(const _Message& message, const KeyBlob& keyBlob, uint8_t* msgBuf, size_t hdrLen, size_t& bodyLen)
+{
+    CipherContext cipher(keyBlob);
+    return Decrypt(message, cipher, msgBuf, hdrLen, bodyLen);
+}
+
+QStatus Crypto::Encrypt(const _Message& message, const CipherContext& cipher, uint8_t* msgBuf, size_t hdrLen, size_t& bodyLen)
 {
     QStatus status;
-    switch (keyBlob.GetType()) {
-    case KeyBlob::AES:
-    {
+    const KeyBlob& keyBlob = cipher->GetKey();
+    if (cipher->IsValid()) {
         uint8_t* body = msgBuf + hdrLen;
         uint8_t nd[5];
         uint32_t serial = message.GetCallSerial();
@@ -102,34 +120,28 @@ QStatus Crypto::Encrypt(const _Message& message, const KeyBlob& keyBlob, uint8_t
         QCC_DbgHLPrintf(("Encrypt key:   %s", BytesToHexString(keyBlob.GetData(), keyBlob.GetSize()).c_str()));
         QCC_DbgHLPrintf(("        nonce: %s", BytesToHexString(nonce.GetData(), nonce.GetSize()).c_str()));
 
-        Crypto_AES aes(keyBlob, Crypto_AES::CCM);
         if (message.GetFlags() & ALLJOYN_FLAG_COMPRESSED) {
             /*
              * To prevent an attack where the attacker sends a bogus expansion rule we
              * authenticate the compressed headers even though we won't be sending them.
              */
             qcc::String extHdr = ConcatenateCompressedFields(msgBuf, hdrLen, message.GetHeaderFields());
-            status = aes.Encrypt_CCM(body, body, bodyLen, nonce, extHdr.data(), extHdr.size(), MACLength);
+            status = cipher->aes->Encrypt_CCM(body, body, bodyLen, nonce, extHdr.data(), extHdr.size(), MACLength);
         } else {
-            status = aes.Encrypt_CCM(body, body, bodyLen, nonce, msgBuf, hdrLen, MACLength);
+            status = cipher->aes->Encrypt_CCM(body, body, bodyLen, nonce, msgBuf, hdrLen, MACLength);
         }
-    }
-    break;
-
-    default:
+    } else {
         status = ER_BUS_KEYBLOB_OP_INVALID;
         QCC_LogError(status, ("Key type %d not supported for message encryption", keyBlob.GetType()));
-        break;
     }
     return status;
 }
 
-QStatus Crypto::Decrypt(const _Message& message, const KeyBlob& keyBlob, uint8_t* msgBuf, size_t hdrLen, size_t& bodyLen)
+QStatus Crypto::Decrypt(const _Message& message, const CipherContext& cipher, uint8_t* msgBuf, size_t hdrLen, size_t& bodyLen)
 {
     QStatus status;
-    switch (keyBlob.GetType()) {
-    case KeyBlob::AES:
-    {
+    const KeyBlob& keyBlob = cipher->GetKey();
+    if (cipher->IsValid()) {
         uint8_t* body = msgBuf + hdrLen;
         uint8_t nd[5];
         uint32_t serial = message.GetCallSerial();
@@ -144,24 +156,19 @@ QStatus Crypto::Decrypt(const _Message& message, const KeyBlob& keyBlob, uint8_t
         QCC_DbgHLPrintf(("Decrypt key:   %s", BytesToHexString(keyBlob.GetData(), keyBlob.GetSize()).c_str()));
         QCC_DbgHLPrintf(("        nonce: %s", BytesToHexString(nonce.GetData(), nonce.GetSize()).c_str()));
 
-        Crypto_AES aes(keyBlob, Crypto_AES::CCM);
         if (message.GetFlags() & ALLJOYN_FLAG_COMPRESSED) {
             /*
              * To prevent an attack where the attacker sends a bogus expansion rule we
              * authenticate the compressed headers even though we won't be sending them.
              */
             qcc::String extHdr = ConcatenateCompressedFields(msgBuf, hdrLen, message.GetHeaderFields());
-            status = aes.Decrypt_CCM(body, body, bodyLen, nonce, extHdr.data(), extHdr.size(), MACLength);
+            status = cipher->aes->Decrypt_CCM(body, body, bodyLen, nonce, extHdr.data(), extHdr.size(), MACLength);
         } else {
-            status = aes.Decrypt_CCM(body, body, bodyLen, nonce, msgBuf, hdrLen, MACLength);
+            status = cipher->aes->Decrypt_CCM(body, body, bodyLen, nonce, msgBuf, hdrLen, MACLength);
         }
-    }
-    break;
-
-    default:
+    } else {
         status = ER_BUS_KEYBLOB_OP_INVALID;
         QCC_LogError(status, ("Key type %d not supported for message decryption", keyBlob.GetType()));
-        break;
     }
     if (status != ER_OK) {
         status = ER_BUS_MESSAGE_DECRYPTION_FAILED;
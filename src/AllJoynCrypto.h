@@ -26,7 +26,9 @@
 #endif
 
 #include <qcc/platform.h>
+#include <qcc/Crypto.h>
 #include <qcc/KeyBlob.h>
+#include <qcc/ManagedObj.h>
 
 #include <alljoyn/Message.h>
 
@@ -35,6 +37,66 @@
 
 namespace ajn {
 
+/**
+ * A key blob together with a cipher context initialized from it. Setting up a cipher context
+ * involves computing the key schedule so contexts are created once per key and shared by
+ * reference.
+ */
+class _CipherContext {
+
+    friend class Crypto;
+
+  public:
+
+    /**
+     * Default constructor, creates an invalid context.
+     */
+    _CipherContext() : aes(NULL) { }
+
+    /**
+     * Create a cipher context for a key blob.
+     *
+     * @param keyBlob  The key blob to create a context for. If the key type is not supported for
+     *                 message encryption the context will be invalid.
+     */
+    _CipherContext(const qcc::KeyBlob& keyBlob);
+
+    /**
+     * Destructor
+     */
+    ~_CipherContext() { delete aes; }
+
+    /**
+     * Get the key blob this context was created from.
+     *
+     * @return  The key blob.
+     */
+    const qcc::KeyBlob& GetKey() const { return key; }
+
+    /**
+     * Tests if this context can be used for encryption and decryption.
+     *
+     * @return  Returns true if the context has a valid key.
+     */
+    bool IsValid() const { return aes != NULL; }
+
+  private:
+
+    /**
+     * Copying a cipher context is not allowed.
+     */
+    _CipherContext(const _CipherContext& other);
+    _CipherContext& operator=(const _CipherContext& other);
+
+    qcc::KeyBlob key;       /**< The key the context was created from */
+    qcc::Crypto_AES* aes;   /**< AES-CCM context or NULL if the key type is not supported */
+};
+
+/**
+ * CipherContext is a reference counted (managed) version of _CipherContext.
+ */
+typedef qcc::ManagedObj<_CipherContext> CipherContext;
+
 /**
  * Class for encapsulating AllJoyn message encryption and decryption operations.
  */
@@ -77,6 +139,39 @@ class Crypto {
      */
     static QStatus Decrypt(const _Message& message, const qcc::KeyBlob& keyBlob, uint8_t* msgBuf, size_t hdrLen, size_t& bodyLen);
 
+    /**
+     * Encrypt a marshaled message inplace using a cipher context that was previously created
+     * for the key. This avoids recomputing the key schedule for every message.
+     *
+     * @param message         The message being encrypted
+     * @param cipher          The cipher context for the encryption operation.
+     * @param msgBuf          The message data to be encrypted.
+     * @param hdrLen          The length of the header part of the message that will not be encrypted.
+     * @param bodyLen[in/out] On input the size of the plaintext body, on output the size of the
+     *                        encrypted body.
+     *
+     * @return - ER_OK if the data was succesfully encrypted.
+     *         - ER_BUS_KEYBLOB_OP_INVALID if the context cannot be used for encryption.
+     *         - Other errors if the arguments are invalid.
+     */
+    static QStatus Encrypt(const _Message& message, const CipherContext& cipher, uint8_t* msgBuf, size_t hdrLen, size_t& bodyLen);
+
+    /**
+     * Decrypt and authenticate a marshaled message inplace using a cipher context that was
+     * previously created for the key.
+     *
+     * @param message         The message being decrypted
+     * @param cipher          The cipher context for the decryption operation.
+     * @param msgBuf          The message data to be decrypted.
+     * @param hdrLen          The length of the non-encrypted header part of the message.
+     * @param bodyLen[in/out] On input the size of the crypttext body, on output the size of the
+     *                        decrypted body.
+     *
+     * @return - ER_OK if the data was succesfully decrypted.
+     *         - ER_BUS_MESSAGE_DECRYPTION_FAILED if the data could not be decrypted.
+     */
+    static QStatus Decrypt(const _Message& message, const CipherContext& cipher, uint8_t* msgBuf, size_t hdrLen, size_t& bodyLen);
+
     /**
      * Compute a SHA1 hash over the header fields and return the result in a key blob.
      *
@@ -1108,7 +1108,7 @@ void AllJoynPeerObj::HandleSecurityViolation(Message& msg, QStatus status)
     QCC_DbgTrace(("HandleSecurityViolation %s %s", QCC_StatusText(status), msg->Description().c_str()));
 
     if (status == ER_BUS_MESSAGE_DECRYPTION_FAILED) {
-        PeerState peerState = peerStateTable->GetPeerState(msg->GetSender());
+        PeerState peerState = peerStateTable->GetPeerState(msg->GetSender(), false);
         /*
          * If we believe the peer is secure we have a clear security violation
          */
@@ -1144,9 +1144,11 @@ void AllJoynPeerObj::NameOwnerChanged(const char* busName, const char* previousO
     if (newOwner == NULL) {
         QCC_DbgHLPrintf(("Peer %s is gone", busName));
         /*
-         * Clean up peer state.
+         * Clean up peer state and any other peers that have been idle too long.
          */
-        bus->GetInternal().GetPeerStateTable()->DelPeerState(busName);
+        PeerStateTable* peerStateTable = bus->GetInternal().GetPeerStateTable();
+        peerStateTable->DelPeerState(busName);
+        peerStateTable->EvictIdle();
         /*
          * We are no longer in an authentication conversation with this peer.
          */
@@ -91,6 +91,7 @@ QStatus org::alljoyn::CreateInterfaces(BusAttachment& bus)
         ifc->AddSignal("LostAdvertisedName",       "sqs",              "name,transport,prefix",                        0);
         ifc->AddSignal("SessionLost",              "u",                "sessionId",                                    0);
         ifc->AddSignal("MPSessionChanged",         "usb",              "sessionId,name,isAdded",                       0);
+        ifc->AddSignal("SessionlessCatchupComplete", "",               "",                                             0);
 
         ifc->Activate();
     }
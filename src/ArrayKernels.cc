@@ -0,0 +1,243 @@
+/**
+ * @file
+ *
+ * This file implements bulk operations on arrays of scalar values.
+ */
+
+/******************************************************************************
+ * Copyright 2013, Qualcomm Innovation Center, Inc.
+ *
+ *    Licensed under the Apache License, Version 2.0 (the "License");
+ *    you may not use this file except in compliance with the License.
+ *    You may obtain a copy of the License at
+ *
+ *        http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *    Unless required by applicable law or agreed to in writing, software
+ *    distributed under the License is distributed on an "AS IS" BASIS,
+ *    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *    See the License for the specific language governing permissions and
+ *    limitations under the License.
+ ******************************************************************************/
+
+#include <qcc/platform.h>
+
+#include <string.h>
+
+#include "ArrayKernels.h"
+
+/*
+ * The instruction set is chosen at compile time from the target the compiler was configured for.
+ */
+#if defined(__AVX2__)
+#include <immintrin.h>
+#define ALLJOYN_SIMD_AVX2
+#define ALLJOYN_SIMD_SSE2
+#elif defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && (_M_IX86_FP >= 2))
+#include <emmintrin.h>
+#define ALLJOYN_SIMD_SSE2
+#elif defined(__ARM_NEON) || defined(__ARM_NEON__)
+#include <arm_neon.h>
+#define ALLJOYN_SIMD_NEON
+#endif
+
+namespace ajn {
+
+static inline uint16_t Swap16(uint16_t v)
+{
+    return (uint16_t)((v >> 8) | (v << 8));
+}
+
+static inline uint32_t Swap32(uint32_t v)
+{
+    return (v >> 24) | ((v >> 8) & 0x0000FF00) | ((v << 8) & 0x00FF0000) | (v << 24);
+}
+
+static inline uint64_t Swap64(uint64_t v)
+{
+    return ((uint64_t)Swap32((uint32_t)v) << 32) | Swap32((uint32_t)(v >> 32));
+}
+
+#if defined(ALLJOYN_SIMD_AVX2)
+/*
+ * Reverse bytes within each element of 32 byte blocks. Returns the number of bytes processed.
+ */
+static inline size_t ShuffleBlocks(uint8_t* dst, const uint8_t* src, size_t bytes, const __m256i& mask)
+{
+    size_t i = 0;
+    for (; (i + 32) <= bytes; i += 32) {
+        __m256i v = _mm256_loadu_si256((const __m256i*)(src + i));
+        _mm256_storeu_si256((__m256i*)(dst + i), _mm256_shuffle_epi8(v, mask));
+    }
+    return i;
+}
+#endif
+
+#if defined(ALLJOYN_SIMD_SSE2)
+static inline __m128i Swap16x8(__m128i v)
+{
+    return _mm_or_si128(_mm_slli_epi16(v, 8), _mm_srli_epi16(v, 8));
+}
+#endif
+
+void SwapArray16(void* dst, const void* src, size_t num)
+{
+    uint8_t* d = (uint8_t*)dst;
+    const uint8_t* s = (const uint8_t*)src;
+    size_t done = 0;
+
+#if defined(ALLJOYN_SIMD_AVX2)
+    const __m256i mask = _mm256_setr_epi8(1, 0, 3, 2, 5, 4, 7, 6, 9, 8, 11, 10, 13, 12, 15, 14,
+                                          1, 0, 3, 2, 5, 4, 7, 6, 9, 8, 11, 10, 13, 12, 15, 14);
+    done = ShuffleBlocks(d, s, num * 2, mask);
+#elif defined(ALLJOYN_SIMD_SSE2)
+    for (; (done + 16) <= (num * 2); done += 16) {
+        __m128i v = _mm_loadu_si128((const __m128i*)(s + done));
+        _mm_storeu_si128((__m128i*)(d + done), Swap16x8(v));
+    }
+#elif defined(ALLJOYN_SIMD_NEON)
+    for (; (done + 16) <= (num * 2); done += 16) {
+        vst1q_u8(d + done, vrev16q_u8(vld1q_u8(s + done)));
+    }
+#endif
+    for (; done < (num * 2); done += 2) {
+        uint16_t v;
+        memcpy(&v, s + done, 2);
+        v = Swap16(v);
+        memcpy(d + done, &v, 2);
+    }
+}
+
+void SwapArray32(void* dst, const void* src, size_t num)
+{
+    uint8_t* d = (uint8_t*)dst;
+    const uint8_t* s = (const uint8_t*)src;
+    size_t done = 0;
+
+#if defined(ALLJOYN_SIMD_AVX2)
+    const __m256i mask = _mm256_setr_epi8(3, 2, 1, 0, 7, 6, 5, 4, 11, 10, 9, 8, 15, 14, 13, 12,
+                                          3, 2, 1, 0, 7, 6, 5, 4, 11, 10, 9, 8, 15, 14, 13, 12);
+    done = ShuffleBlocks(d, s, num * 4, mask);
+#elif defined(ALLJOYN_SIMD_SSE2)
+    for (; (done + 16) <= (num * 4); done += 16) {
+        __m128i v = Swap16x8(_mm_loadu_si128((const __m128i*)(s + done)));
+        v = _mm_shufflelo_epi16(v, _MM_SHUFFLE(2, 3, 0, 1));
+        v = _mm_shufflehi_epi16(v, _MM_SHUFFLE(2, 3, 0, 1));
+        _mm_storeu_si128((__m128i*)(d + done), v);
+    }
+#elif defined(ALLJOYN_SIMD_NEON)
+    for (; (done + 16) <= (num * 4); done += 16) {
+        vst1q_u8(d + done, vrev32q_u8(vld1q_u8(s + done)));
+    }
+#endif
+    for (; done < (num * 4); done += 4) {
+        uint32_t v;
+        memcpy(&v, s + done, 4);
+        v = Swap32(v);
+        memcpy(d + done, &v, 4);
+    }
+}
+
+void SwapArray64(void* dst, const void* src, size_t num)
+{
+    uint8_t* d = (uint8_t*)dst;
+    const uint8_t* s = (const uint8_t*)src;
+    size_t done = 0;
+
+#if defined(ALLJOYN_SIMD_AVX2)
+    const __m256i mask = _mm256_setr_epi8(7, 6, 5, 4, 3, 2, 1, 0, 15, 14, 13, 12, 11, 10, 9, 8,
+                                          7, 6, 5, 4, 3, 2, 1, 0, 15, 14, 13, 12, 11, 10, 9, 8);
+    done = ShuffleBlocks(d, s, num * 8, mask);
+#elif defined(ALLJOYN_SIMD_SSE2)
+    for (; (done + 16) <= (num * 8); done += 16) {
+        __m128i v = Swap16x8(_mm_loadu_si128((const __m128i*)(s + done)));
+        v = _mm_shufflelo_epi16(v, _MM_SHUFFLE(0, 1, 2, 3));
+        v = _mm_shufflehi_epi16(v, _MM_SHUFFLE(0, 1, 2, 3));
+        _mm_storeu_si128((__m128i*)(d + done), v);
+    }
+#elif defined(ALLJOYN_SIMD_NEON)
+    for (; (done + 16) <= (num * 8); done += 16) {
+        vst1q_u8(d + done, vrev64q_u8(vld1q_u8(s + done)));
+    }
+#endif
+    for (; done < (num * 8); done += 8) {
+        uint64_t v;
+        memcpy(&v, s + done, 8);
+        v = Swap64(v);
+        memcpy(d + done, &v, 8);
+    }
+}
+
+bool UnpackBoolArray(bool* dst, const void* src, size_t num, bool swap)
+{
+    const uint8_t* s = (const uint8_t*)src;
+    size_t i = 0;
+
+    /*
+     * The vector code writes bools as bytes so is only used where bool is a single byte.
+     */
+#if defined(ALLJOYN_SIMD_SSE2)
+    if (sizeof(bool) == 1) {
+        /* A marshaled true in the other endianess reads as 0x01000000 */
+        const __m128i one = _mm_set1_epi32(swap ? 0x01000000 : 1);
+        const __m128i lsb = _mm_set1_epi32(1);
+        const __m128i zero = _mm_setzero_si128();
+        __m128i bad = zero;
+        for (; (i + 16) <= num; i += 16) {
+            __m128i v[4];
+            for (size_t j = 0; j < 4; ++j) {
+                v[j] = _mm_loadu_si128((const __m128i*)(s + (i + j * 4) * 4));
+                bad = _mm_or_si128(bad, _mm_andnot_si128(one, v[j]));
+            }
+            if (dst) {
+                for (size_t j = 0; j < 4; ++j) {
+                    v[j] = _mm_andnot_si128(_mm_cmpeq_epi32(v[j], zero), lsb);
+                }
+                __m128i b = _mm_packus_epi16(_mm_packs_epi32(v[0], v[1]), _mm_packs_epi32(v[2], v[3]));
+                _mm_storeu_si128((__m128i*)(dst + i), b);
+            }
+        }
+        if (_mm_movemask_epi8(_mm_cmpeq_epi32(bad, zero)) != 0xFFFF) {
+            return false;
+        }
+    }
+#elif defined(ALLJOYN_SIMD_NEON)
+    if (sizeof(bool) == 1) {
+        const uint32x4_t one = vdupq_n_u32(swap ? 0x01000000 : 1);
+        const uint32x4_t lsb = vdupq_n_u32(1);
+        uint32x4_t bad = vdupq_n_u32(0);
+        for (; (i + 16) <= num; i += 16) {
+            uint32x4_t v[4];
+            for (size_t j = 0; j < 4; ++j) {
+                v[j] = vreinterpretq_u32_u8(vld1q_u8(s + (i + j * 4) * 4));
+                bad = vorrq_u32(bad, vbicq_u32(v[j], one));
+            }
+            if (dst) {
+                uint16x8_t lo = vcombine_u16(vmovn_u32(vminq_u32(v[0], lsb)), vmovn_u32(vminq_u32(v[1], lsb)));
+                uint16x8_t hi = vcombine_u16(vmovn_u32(vminq_u32(v[2], lsb)), vmovn_u32(vminq_u32(v[3], lsb)));
+                vst1q_u8((uint8_t*)(dst + i), vcombine_u8(vmovn_u16(lo), vmovn_u16(hi)));
+            }
+        }
+        uint32x2_t folded = vorr_u32(vget_low_u32(bad), vget_high_u32(bad));
+        if ((vget_lane_u32(folded, 0) | vget_lane_u32(folded, 1)) != 0) {
+            return false;
+        }
+    }
+#endif
+    for (; i < num; ++i) {
+        uint32_t b;
+        memcpy(&b, s + i * 4, 4);
+        if (swap) {
+            b = Swap32(b);
+        }
+        if (b > 1) {
+            return false;
+        }
+        if (dst) {
+            dst[i] = (b == 1);
+        }
+    }
+    return true;
+}
+
+}
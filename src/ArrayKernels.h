@@ -0,0 +1,79 @@
+#ifndef _ALLJOYN_ARRAYKERNELS_H
+#define _ALLJOYN_ARRAYKERNELS_H
+/**
+ * @file
+ * Bulk operations on arrays of scalar values used when marshaling and unmarshaling messages.
+ * These are vectorized with AVX2, SSE2 or NEON when the compiler targets those instruction sets
+ * and fall back to scalar code otherwise.
+ */
+
+/******************************************************************************
+ * Copyright 2013, Qualcomm Innovation Center, Inc.
+ *
+ *    Licensed under the Apache License, Version 2.0 (the "License");
+ *    you may not use this file except in compliance with the License.
+ *    You may obtain a copy of the License at
+ *
+ *        http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *    Unless required by applicable law or agreed to in writing, software
+ *    distributed under the License is distributed on an "AS IS" BASIS,
+ *    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *    See the License for the specific language governing permissions and
+ *    limitations under the License.
+ ******************************************************************************/
+
+#ifndef __cplusplus
+#error Only include ArrayKernels.h in C++ code.
+#endif
+
+#include <qcc/platform.h>
+
+namespace ajn {
+
+/**
+ * Copy an array of 16 bit values reversing the byte order of each value. The source and
+ * destination do not need to be aligned and may be the same array.
+ *
+ * @param dst  The destination array.
+ * @param src  The source array.
+ * @param num  The number of values to copy.
+ */
+void SwapArray16(void* dst, const void* src, size_t num);
+
+/**
+ * Copy an array of 32 bit values reversing the byte order of each value. The source and
+ * destination do not need to be aligned and may be the same array.
+ *
+ * @param dst  The destination array.
+ * @param src  The source array.
+ * @param num  The number of values to copy.
+ */
+void SwapArray32(void* dst, const void* src, size_t num);
+
+/**
+ * Copy an array of 64 bit values reversing the byte order of each value. The source and
+ * destination do not need to be aligned and may be the same array.
+ *
+ * @param dst  The destination array.
+ * @param src  The source array.
+ * @param num  The number of values to copy.
+ */
+void SwapArray64(void* dst, const void* src, size_t num);
+
+/**
+ * Check that an array of marshaled booleans only holds the values 0 and 1 and optionally convert
+ * them to an array of bool.
+ *
+ * @param dst   Returns the bool values, can be NULL to only validate the array.
+ * @param src   The marshaled 32 bit boolean values.
+ * @param num   The number of values.
+ * @param swap  True if the marshaled values are in the opposite endianess to this host.
+ *
+ * @return  true if all the values are valid booleans.
+ */
+bool UnpackBoolArray(bool* dst, const void* src, size_t num, bool swap);
+
+}
+
+#endif
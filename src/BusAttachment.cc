@@ -1310,6 +1310,11 @@ QStatus BusAttachment::SetDaemonDebug(const char* module, uint32_t level)
     return status;
 }
 
+void BusAttachment::SetSerialWindowSize(uint32_t size)
+{
+    busInternal->GetPeerStateTable()->SetSerialWindowSize(size);
+}
+
 QStatus BusAttachment::BindSessionPort(SessionPort& sessionPort, const SessionOpts& opts, SessionPortListener& listener)
 {
     if (!IsConnected()) {
@@ -20,6 +20,9 @@
  ******************************************************************************/
 
 #include <qcc/platform.h>
+
+#include <string.h>
+
 #include <qcc/GUID.h>
 #include <qcc/Debug.h>
 #include <qcc/Thread.h>
@@ -46,3 +49,89 @@ void _BusEndpoint::Invalidate()
     isValid = false;
 }
 
+bool _BusEndpoint::GetCachedRoute(const char* name, uint32_t generation, BusEndpoint& dest)
+{
+    bool found = false;
+    routeCacheLock.Lock(MUTEX_CONTEXT);
+    size_t i = routeCache.size();
+    while (i-- > 0) {
+        if (routeCache[i].generation != generation) {
+            /* Release stale routes as soon as they are seen so they don't keep endpoints alive */
+            if (i != (routeCache.size() - 1)) {
+                routeCache[i] = routeCache.back();
+            }
+            routeCache.pop_back();
+        } else if (!found && (strcmp(routeCache[i].name.c_str(), name) == 0)) {
+            dest = routeCache[i].dest;
+            found = true;
+        }
+    }
+    routeCacheLock.Unlock(MUTEX_CONTEXT);
+    return found;
+}
+
+void _BusEndpoint::CacheRoute(const qcc::String& name, uint32_t generation, BusEndpoint& dest)
+{
+    routeCacheLock.Lock(MUTEX_CONTEXT);
+    /* Replace an entry for the same name or else the oldest entry */
+    size_t i;
+    for (i = 0; i < routeCache.size(); ++i) {
+        if (routeCache[i].name == name) {
+            break;
+        }
+    }
+    if (i == routeCache.size()) {
+        if (routeCache.size() < ROUTE_CACHE_SIZE) {
+            routeCache.push_back(CachedRoute());
+        } else {
+            i = routeCacheNext;
+            routeCacheNext = (routeCacheNext + 1) % ROUTE_CACHE_SIZE;
+        }
+    }
+    routeCache[i].name = name;
+    routeCache[i].generation = generation;
+    routeCache[i].dest = dest;
+    routeCacheLock.Unlock(MUTEX_CONTEXT);
+
+    /* Let the destination know who to tell when it goes away */
+    qcc::String uniqueName = GetUniqueName();
+    dest->routeCacheLock.Lock(MUTEX_CONTEXT);
+    dest->routeCachers.insert(uniqueName);
+    dest->routeCacheLock.Unlock(MUTEX_CONTEXT);
+}
+
+void _BusEndpoint::ClearRouteCache()
+{
+    /* The cached endpoints are released after the lock is released */
+    std::vector<CachedRoute> released;
+    routeCacheLock.Lock(MUTEX_CONTEXT);
+    routeCache.swap(released);
+    routeCacheNext = 0;
+    routeCacheLock.Unlock(MUTEX_CONTEXT);
+}
+
+void _BusEndpoint::ReleaseCachedRoutes(const BusEndpoint& dest)
+{
+    /* The cached endpoints are released after the lock is released */
+    std::vector<CachedRoute> released;
+    routeCacheLock.Lock(MUTEX_CONTEXT);
+    size_t i = routeCache.size();
+    while (i-- > 0) {
+        if (routeCache[i].dest == dest) {
+            released.push_back(routeCache[i]);
+            if (i != (routeCache.size() - 1)) {
+                routeCache[i] = routeCache.back();
+            }
+            routeCache.pop_back();
+        }
+    }
+    routeCacheLock.Unlock(MUTEX_CONTEXT);
+}
+
+void _BusEndpoint::TakeRouteCachers(std::set<qcc::String>& names)
+{
+    names.clear();
+    routeCacheLock.Lock(MUTEX_CONTEXT);
+    routeCachers.swap(names);
+    routeCacheLock.Unlock(MUTEX_CONTEXT);
+}
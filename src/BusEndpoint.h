@@ -23,6 +23,9 @@
 
 #include <qcc/platform.h>
 
+#include <set>
+#include <vector>
+
 #include <qcc/GUID.h>
 #include <qcc/Mutex.h>
 #include <qcc/String.h>
@@ -60,14 +63,14 @@ class _BusEndpoint : public MessageSink {
     /**
      * Default constructor initializes an invalid endpoint
      */
-    _BusEndpoint() : endpointType(ENDPOINT_TYPE_INVALID), isValid(false), disconnectStatus(ER_OK) { }
+    _BusEndpoint() : endpointType(ENDPOINT_TYPE_INVALID), isValid(false), disconnectStatus(ER_OK), routeCacheNext(0) { }
 
     /**
      * Constructor.
      *
      * @param type    BusEndpoint type.
      */
-    _BusEndpoint(EndpointType type) : endpointType(type), isValid(type != ENDPOINT_TYPE_INVALID), disconnectStatus(ER_OK)  { }
+    _BusEndpoint(EndpointType type) : endpointType(type), isValid(type != ENDPOINT_TYPE_INVALID), disconnectStatus(ER_OK), routeCacheNext(0)  { }
 
     /**
      * Virtual destructor for derivable class.
@@ -169,11 +172,70 @@ class _BusEndpoint : public MessageSink {
      */
     bool operator <(const _BusEndpoint& other) const { return reinterpret_cast<ptrdiff_t>(this) < reinterpret_cast<ptrdiff_t>(&other); }
 
+    /**
+     * Get a destination that messages from this endpoint were recently routed to. Destinations
+     * cached in an earlier route generation are released.
+     *
+     * @param name        The destination bus name.
+     * @param generation  The current route generation.
+     * @param[out] dest   Returns the destination endpoint.
+     *
+     * @return  true if the destination was cached in the same route generation.
+     */
+    bool GetCachedRoute(const char* name, uint32_t generation, BusEndpoint& dest);
+
+    /**
+     * Remember the destination a message from this endpoint was routed to.
+     *
+     * @param name        The destination bus name.
+     * @param generation  The route generation before the destination was looked up.
+     * @param dest        The destination endpoint.
+     */
+    void CacheRoute(const qcc::String& name, uint32_t generation, BusEndpoint& dest);
+
+    /**
+     * Forget the destinations messages from this endpoint were routed to.
+     */
+    void ClearRouteCache();
+
+    /**
+     * Forget the routes from this endpoint to a destination that is going away.
+     *
+     * @param dest   The destination endpoint.
+     */
+    void ReleaseCachedRoutes(const BusEndpoint& dest);
+
+    /**
+     * Get the unique names of the endpoints that have cached a route to this endpoint. The
+     * names are forgotten once they have been returned.
+     *
+     * @param[out] names   Returns the unique names of the endpoints.
+     */
+    void TakeRouteCachers(std::set<qcc::String>& names);
+
   protected:
 
     EndpointType endpointType;   /**< Type of endpoint */
     bool isValid;                /**< Is endpoint currently valid */
     QStatus disconnectStatus;    /**< Reason for the disconnect */
+
+  private:
+
+    /**
+     * Number of destinations remembered by the route cache.
+     */
+    static const size_t ROUTE_CACHE_SIZE = 4;
+
+    struct CachedRoute {
+        qcc::String name;
+        uint32_t generation;
+        BusEndpoint dest;
+    };
+
+    qcc::Mutex routeCacheLock;            /**< Lock that protects the route cache */
+    std::vector<CachedRoute> routeCache;  /**< Destinations recently routed to */
+    size_t routeCacheNext;                /**< Next route cache entry to replace */
+    std::set<qcc::String> routeCachers;   /**< Endpoints that have cached a route to this endpoint */
 };
 
 
@@ -498,7 +498,8 @@ QStatus BusObject::Signal(const char* destination,
                             args,
                             numArgs,
                             flags,
-                            timeToLive);
+                            timeToLive,
+                            signalMember.argsPlan);
     if (status == ER_OK) {
         BusEndpoint bep = BusEndpoint::cast(bus->GetInternal().GetLocalEndpoint());
         status = bus->GetInternal().GetRouter().PushMessage(msg, bep);
@@ -49,8 +49,10 @@ QStatus ClientRouter::PushMessage(Message& msg, BusEndpoint& sender)
         status = ER_BUS_NO_ENDPOINT;
     } else {
         if (sender == BusEndpoint::cast(localEndpoint)) {
-            localEndpoint->UpdateSerialNumber(msg);
-            status = nonLocalEndpoint->PushMessage(msg);
+            status = localEndpoint->UpdateSerialNumber(msg);
+            if (status == ER_OK) {
+                status = nonLocalEndpoint->PushMessage(msg);
+            }
         } else {
             status = localEndpoint->PushMessage(msg);
         }
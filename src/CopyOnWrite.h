@@ -0,0 +1,246 @@
+#ifndef _ALLJOYN_COPYONWRITE_H
+#define _ALLJOYN_COPYONWRITE_H
+/**
+ * @file
+ * This file defines a container for read-mostly tables that are updated by copying.
+ */
+
+/******************************************************************************
+ * Copyright 2013, Qualcomm Innovation Center, Inc.
+ *
+ *    Licensed under the Apache License, Version 2.0 (the "License");
+ *    you may not use this file except in compliance with the License.
+ *    You may obtain a copy of the License at
+ *
+ *        http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *    Unless required by applicable law or agreed to in writing, software
+ *    distributed under the License is distributed on an "AS IS" BASIS,
+ *    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *    See the License for the specific language governing permissions and
+ *    limitations under the License.
+ ******************************************************************************/
+
+#ifndef __cplusplus
+#error Only include CopyOnWrite.h in C++ code.
+#endif
+
+#include <qcc/platform.h>
+
+#include <vector>
+
+#include <qcc/Thread.h>
+#include <qcc/atomic.h>
+
+namespace ajn {
+
+/**
+ * Holds a value that is read far more often than it is written. Readers pin the current version
+ * of the value with a single atomic increment and never block or copy. Writers copy the current
+ * version, modify the copy and publish it as the new current version.
+ *
+ * Versions are never freed while the container exists. A version that is no longer current and
+ * has no readers is reused by the next update so the number of versions is bounded by the number
+ * of readers that were ever pinned at once. Because versions stay allocated a reader can safely
+ * pin a version that has just been replaced, it sees the version is no longer current, unpins it
+ * and tries again.
+ *
+ * Writers must be serialized by the owner, readers need no locking.
+ */
+template <typename T>
+class CopyOnWrite {
+  private:
+    struct Version {
+        T value;
+        volatile int32_t readers;
+        Version() : value(), readers(0) { }
+    };
+
+  public:
+
+    /**
+     * A reader pins a version of the value while it exists.
+     */
+    class Reader {
+      public:
+        /**
+         * Construct a reader that has not pinned a version.
+         */
+        Reader() : version(NULL) { }
+
+        /**
+         * Construct a reader and pin the current version.
+         *
+         * @param cow  The container to read.
+         */
+        Reader(CopyOnWrite& cow) : version(NULL) { Pin(cow); }
+
+        /**
+         * Destructor unpins the version.
+         */
+        ~Reader() { Unpin(); }
+
+        /**
+         * Pin the current version releasing any version already pinned.
+         *
+         * @param cow  The container to read.
+         */
+        void Pin(CopyOnWrite& cow)
+        {
+            Unpin();
+            for (;;) {
+                Version* v = cow.current;
+                qcc::IncrementAndFetch(&v->readers);
+                if (v == cow.current) {
+                    version = v;
+                    break;
+                }
+                qcc::DecrementAndFetch(&v->readers);
+            }
+        }
+
+        /**
+         * Release the pinned version.
+         */
+        void Unpin()
+        {
+            if (version) {
+                qcc::DecrementAndFetch(&version->readers);
+                version = NULL;
+            }
+        }
+
+        /**
+         * Get the pinned value.
+         *
+         * @return The pinned value which must not be modified.
+         */
+        const T& operator*() const { return version->value; }
+
+        /**
+         * Get the pinned value.
+         *
+         * @return The pinned value which must not be modified.
+         */
+        const T* operator->() const { return &version->value; }
+
+      private:
+        Reader(const Reader& other);
+        Reader& operator=(const Reader& other);
+
+        Version* version;
+    };
+
+    /**
+     * Constructor
+     */
+    CopyOnWrite() : next(NULL), generation(0)
+    {
+        Version* v = new Version();
+        versions.push_back(v);
+        current = v;
+    }
+
+    /**
+     * Destructor. There must be no readers.
+     */
+    ~CopyOnWrite()
+    {
+        for (size_t i = 0; i < versions.size(); ++i) {
+            delete versions[i];
+        }
+    }
+
+    /**
+     * Start an update. Must be called by the owner's serialized writer.
+     *
+     * @return A copy of the current value to be modified and then published.
+     */
+    T& BeginUpdate()
+    {
+        /*
+         * A reader increments its count and then checks its version is current, the writer publishes
+         * a version and then checks the counts. The barrier between publishing and checking means a
+         * version cannot be reused by the writer if the reader thinks it is still current.
+         */
+        qcc::IncrementAndFetch(&generation);
+        next = NULL;
+        for (size_t i = 0; i < versions.size(); ++i) {
+            if ((versions[i] != current) && (versions[i]->readers == 0)) {
+                next = versions[i];
+                break;
+            }
+        }
+        if (!next) {
+            next = new Version();
+            versions.push_back(next);
+        }
+        next->value = current->value;
+        return next->value;
+    }
+
+    /**
+     * Make the value returned by BeginUpdate() the current version.
+     */
+    void Publish()
+    {
+        /*
+         * The atomic increment is a full memory barrier so the new value is visible before it is published.
+         */
+        qcc::IncrementAndFetch(&generation);
+        current = next;
+        next = NULL;
+    }
+
+    /**
+     * Get the current value. Must only be called by the owner's serialized writer.
+     *
+     * @return The current value.
+     */
+    const T& Current() const { return current->value; }
+
+    /**
+     * Reset the versions that are not current and have no readers so they do not hold on to
+     * anything the current version no longer refers to. Must be called by the owner's serialized
+     * writer.
+     */
+    void Trim()
+    {
+        /*
+         * Same barrier as BeginUpdate() so a version a reader thinks is current is not reset.
+         */
+        qcc::IncrementAndFetch(&generation);
+        for (size_t i = 0; i < versions.size(); ++i) {
+            if ((versions[i] != current) && (versions[i]->readers == 0)) {
+                versions[i]->value = T();
+            }
+        }
+    }
+
+    /**
+     * Wait until there are no readers of any version other than the current one. Used by writers
+     * before freeing anything an earlier version refers to, so readers must not hold a version
+     * pinned while they wait for the writer.
+     */
+    void WaitForReaders()
+    {
+        for (size_t i = 0; i < versions.size(); ++i) {
+            while ((versions[i] != current) && (versions[i]->readers != 0)) {
+                qcc::Sleep(1);
+            }
+        }
+    }
+
+  private:
+    CopyOnWrite(const CopyOnWrite& other);
+    CopyOnWrite& operator=(const CopyOnWrite& other);
+
+    Version* volatile current;        ///< The current version
+    Version* next;                    ///< The version being updated
+    std::vector<Version*> versions;   ///< All versions
+    volatile int32_t generation;      ///< Number of versions published
+};
+
+}
+
+#endif
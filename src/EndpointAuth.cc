@@ -22,6 +22,7 @@
 
 #include <qcc/platform.h>
 
+#include <assert.h>
 #include <algorithm>
 
 #include <qcc/String.h>
@@ -161,91 +162,7 @@ QStatus EndpointAuth::WaitHello()
     }
     status = hello->Unmarshal(endpoint, false);
     if (ER_OK == status) {
-        if (hello->GetType() != MESSAGE_METHOD_CALL) {
-            QCC_DbgPrintf(("First message must be Hello/BusHello method call"));
-            return ER_BUS_ESTABLISH_FAILED;
-        }
-        if (strcmp(hello->GetInterface(), org::freedesktop::DBus::InterfaceName) == 0) {
-            if (hello->GetCallSerial() == 0) {
-                QCC_DbgPrintf(("Hello expected non-zero serial"));
-                return ER_BUS_ESTABLISH_FAILED;
-            }
-            if (strcmp(hello->GetDestination(), org::freedesktop::DBus::WellKnownName) != 0) {
-                QCC_DbgPrintf(("Hello expected destination \"%s\"", org::freedesktop::DBus::WellKnownName));
-                return ER_BUS_ESTABLISH_FAILED;
-            }
-            if (strcmp(hello->GetObjectPath(), org::freedesktop::DBus::ObjectPath) != 0) {
-                QCC_DbgPrintf(("Hello expected object path \"%s\"", org::freedesktop::DBus::ObjectPath));
-                return ER_BUS_ESTABLISH_FAILED;
-            }
-            if (strcmp(hello->GetMemberName(), "Hello") != 0) {
-                QCC_DbgPrintf(("Hello expected member \"Hello\""));
-                return ER_BUS_ESTABLISH_FAILED;
-            }
-            endpoint->GetFeatures().isBusToBus = false;
-            endpoint->GetFeatures().allowRemote = (0 != (hello->GetFlags() & ALLJOYN_FLAG_ALLOW_REMOTE_MSG));
-            /*
-             * Remote name for the endpoint is the unique name we are allocating.
-             */
-            remoteName = uniqueName;
-        } else if (strcmp(hello->GetInterface(), org::alljoyn::Bus::InterfaceName) == 0) {
-            if (hello->GetCallSerial() == 0) {
-                QCC_DbgPrintf(("Hello expected non-zero serial"));
-                return ER_BUS_ESTABLISH_FAILED;
-            }
-            if (strcmp(hello->GetDestination(), org::alljoyn::Bus::WellKnownName) != 0) {
-                QCC_DbgPrintf(("Hello expected destination \"%s\"", org::alljoyn::Bus::WellKnownName));
-                return ER_BUS_ESTABLISH_FAILED;
-            }
-            if (strcmp(hello->GetObjectPath(), org::alljoyn::Bus::ObjectPath) != 0) {
-                QCC_DbgPrintf(("Hello expected object path \"%s\"", org::alljoyn::Bus::ObjectPath));
-                return ER_BUS_ESTABLISH_FAILED;
-            }
-            if (strcmp(hello->GetMemberName(), "BusHello") != 0) {
-                QCC_DbgPrintf(("Hello expected member \"BusHello\""));
-                return ER_BUS_ESTABLISH_FAILED;
-            }
-            size_t numArgs;
-            const MsgArg* args;
-            status = hello->UnmarshalArgs("su");
-            hello->GetArgs(numArgs, args);
-            if ((ER_OK == status) && (2 == numArgs) && (ALLJOYN_STRING == args[0].typeId) && (ALLJOYN_UINT32 == args[1].typeId)) {
-                remoteGUID = qcc::GUID128(args[0].v_string.str);
-                remoteProtocolVersion = args[1].v_uint32;
-                if (remoteGUID == bus.GetInternal().GetGlobalGUID()) {
-                    QCC_DbgPrintf(("BusHello was sent by self"));
-                    return ER_BUS_SELF_CONNECT;
-                }
-            } else {
-                QCC_DbgPrintf(("BusHello expected 2 args with signature \"su\""));
-                return ER_BUS_ESTABLISH_FAILED;
-            }
-            endpoint->GetFeatures().isBusToBus = true;
-            endpoint->GetFeatures().allowRemote = true;
-
-            /*
-             * Remote name for the endpoint is the sender of the hello.
-             */
-            remoteName = hello->GetSender();
-        } else {
-            QCC_DbgPrintf(("Hello expected interface \"%s\" or \"%s\"", org::freedesktop::DBus::InterfaceName,
-                           org::alljoyn::Bus::InterfaceName));
-            return ER_BUS_ESTABLISH_FAILED;
-        }
-        redirection = endpoint->RedirectionAddress();
-        if (redirection.empty()) {
-            QCC_DbgHLPrintf(("Endpoint remote %sname %s", endpoint->GetFeatures().isBusToBus ? "(bus-to-bus) " : "", remoteName.c_str()));
-            status = hello->HelloReply(endpoint->GetFeatures().isBusToBus, uniqueName);
-        } else {
-            QCC_DbgHLPrintf(("Endpoint redirecting name %s to %d", remoteName.c_str(), redirection.c_str()));
-            status = hello->ErrorMsg(hello, RedirectError, redirection.c_str());
-        }
-    }
-    if (ER_OK == status) {
-        status = hello->Deliver(endpoint);
-        if (ER_OK != status) {
-            QCC_LogError(status, ("%s", __FUNCTION__));
-        }
+        status = ReplyHello(hello, redirection);
     }
     if ((ER_OK == status) && !redirection.empty()) {
         /*
@@ -268,6 +185,98 @@ QStatus EndpointAuth::WaitHello()
     return status;
 }
 
+QStatus EndpointAuth::ReplyHello(Message& hello, qcc::String& redirection)
+{
+    QStatus status = ER_OK;
+
+    if (hello->GetType() != MESSAGE_METHOD_CALL) {
+        QCC_DbgPrintf(("First message must be Hello/BusHello method call"));
+        return ER_BUS_ESTABLISH_FAILED;
+    }
+    if (strcmp(hello->GetInterface(), org::freedesktop::DBus::InterfaceName) == 0) {
+        if (hello->GetCallSerial() == 0) {
+            QCC_DbgPrintf(("Hello expected non-zero serial"));
+            return ER_BUS_ESTABLISH_FAILED;
+        }
+        if (strcmp(hello->GetDestination(), org::freedesktop::DBus::WellKnownName) != 0) {
+            QCC_DbgPrintf(("Hello expected destination \"%s\"", org::freedesktop::DBus::WellKnownName));
+            return ER_BUS_ESTABLISH_FAILED;
+        }
+        if (strcmp(hello->GetObjectPath(), org::freedesktop::DBus::ObjectPath) != 0) {
+            QCC_DbgPrintf(("Hello expected object path \"%s\"", org::freedesktop::DBus::ObjectPath));
+            return ER_BUS_ESTABLISH_FAILED;
+        }
+        if (strcmp(hello->GetMemberName(), "Hello") != 0) {
+            QCC_DbgPrintf(("Hello expected member \"Hello\""));
+            return ER_BUS_ESTABLISH_FAILED;
+        }
+        endpoint->GetFeatures().isBusToBus = false;
+        endpoint->GetFeatures().allowRemote = (0 != (hello->GetFlags() & ALLJOYN_FLAG_ALLOW_REMOTE_MSG));
+        /*
+         * Remote name for the endpoint is the unique name we are allocating.
+         */
+        remoteName = uniqueName;
+    } else if (strcmp(hello->GetInterface(), org::alljoyn::Bus::InterfaceName) == 0) {
+        if (hello->GetCallSerial() == 0) {
+            QCC_DbgPrintf(("Hello expected non-zero serial"));
+            return ER_BUS_ESTABLISH_FAILED;
+        }
+        if (strcmp(hello->GetDestination(), org::alljoyn::Bus::WellKnownName) != 0) {
+            QCC_DbgPrintf(("Hello expected destination \"%s\"", org::alljoyn::Bus::WellKnownName));
+            return ER_BUS_ESTABLISH_FAILED;
+        }
+        if (strcmp(hello->GetObjectPath(), org::alljoyn::Bus::ObjectPath) != 0) {
+            QCC_DbgPrintf(("Hello expected object path \"%s\"", org::alljoyn::Bus::ObjectPath));
+            return ER_BUS_ESTABLISH_FAILED;
+        }
+        if (strcmp(hello->GetMemberName(), "BusHello") != 0) {
+            QCC_DbgPrintf(("Hello expected member \"BusHello\""));
+            return ER_BUS_ESTABLISH_FAILED;
+        }
+        size_t numArgs;
+        const MsgArg* args;
+        status = hello->UnmarshalArgs("su");
+        hello->GetArgs(numArgs, args);
+        if ((ER_OK == status) && (2 == numArgs) && (ALLJOYN_STRING == args[0].typeId) && (ALLJOYN_UINT32 == args[1].typeId)) {
+            remoteGUID = qcc::GUID128(args[0].v_string.str);
+            remoteProtocolVersion = args[1].v_uint32;
+            if (remoteGUID == bus.GetInternal().GetGlobalGUID()) {
+                QCC_DbgPrintf(("BusHello was sent by self"));
+                return ER_BUS_SELF_CONNECT;
+            }
+        } else {
+            QCC_DbgPrintf(("BusHello expected 2 args with signature \"su\""));
+            return ER_BUS_ESTABLISH_FAILED;
+        }
+        endpoint->GetFeatures().isBusToBus = true;
+        endpoint->GetFeatures().allowRemote = true;
+
+        /*
+         * Remote name for the endpoint is the sender of the hello.
+         */
+        remoteName = hello->GetSender();
+    } else {
+        QCC_DbgPrintf(("Hello expected interface \"%s\" or \"%s\"", org::freedesktop::DBus::InterfaceName,
+                       org::alljoyn::Bus::InterfaceName));
+        return ER_BUS_ESTABLISH_FAILED;
+    }
+    redirection = endpoint->RedirectionAddress();
+    if (redirection.empty()) {
+        QCC_DbgHLPrintf(("Endpoint remote %sname %s", endpoint->GetFeatures().isBusToBus ? "(bus-to-bus) " : "", remoteName.c_str()));
+        status = hello->HelloReply(endpoint->GetFeatures().isBusToBus, uniqueName);
+    } else {
+        QCC_DbgHLPrintf(("Endpoint redirecting name %s to %d", remoteName.c_str(), redirection.c_str()));
+        status = hello->ErrorMsg(hello, RedirectError, redirection.c_str());
+    }
+    if (ER_OK == status) {
+        status = hello->Deliver(endpoint);
+        if (ER_OK != status) {
+            QCC_LogError(status, ("%s", __FUNCTION__));
+        }
+    }
+    return status;
+}
+
 
 static const char NegotiateUnixFd[] = "NEGOTIATE_UNIX_FD";
 static const char AgreeUnixFd[] = "AGREE_UNIX_FD";
@@ -460,4 +469,136 @@ ExitEstablish:
     return status;
 }
 
+/*
+ * Longest SASL line accepted from a connection that is authenticating without blocking.
+ */
+static const size_t MAX_SASL_LINE = 4096;
+
+QStatus EndpointAuth::ReadLineNonBlocking(qcc::String& line)
+{
+    /*
+     * Read a byte at a time like Source::GetLine() so none of the data following the line is
+     * consumed. A partial line is kept until the rest of it arrives.
+     */
+    Source& source = endpoint->GetSource();
+    while (true) {
+        char c;
+        size_t actual;
+        QStatus status = source.PullBytes(&c, 1, actual, 0);
+        if (status == ER_TIMEOUT) {
+            return ER_WOULDBLOCK;
+        }
+        if (status != ER_OK) {
+            return status;
+        }
+        if (actual != 1) {
+            return ER_FAIL;
+        }
+        if (c == '\n') {
+            return ER_OK;
+        }
+        if (c != '\r') {
+            if (line.size() >= MAX_SASL_LINE) {
+                return ER_BUS_ESTABLISH_FAILED;
+            }
+            line.push_back(c);
+        }
+    }
+}
+
+void EndpointAuth::AcceptBegin(const qcc::String& authMechanisms, AuthListener* listener)
+{
+    QCC_DbgPrintf(("EndpointAuth::AcceptBegin authMechanisms=\"%s\"", authMechanisms.c_str()));
+
+    assert(isAccepting && (acceptState == ACCEPT_IDLE));
+    if (listener) {
+        authListener.Set(listener);
+        hasListener = true;
+    }
+    acceptSasl = new SASLEngine(bus, AuthMechanism::CHALLENGER, authMechanisms, NULL, authListener, this);
+    /*
+     * The server's GUID is sent to the client when the authentication succeeds
+     */
+    acceptSasl->SetLocalId(bus.GetInternal().GetGlobalGUID().ToString());
+    acceptState = ACCEPT_SASL;
+}
+
+QStatus EndpointAuth::AcceptAdvance(qcc::String& authUsed)
+{
+    QStatus status = ER_OK;
+
+    while ((status == ER_OK) && (acceptState == ACCEPT_SASL)) {
+        /*
+         * Get the challenge
+         */
+        status = ReadLineNonBlocking(acceptLine);
+        if (status != ER_OK) {
+            break;
+        }
+        SASLEngine::AuthState state;
+        qcc::String outStr;
+        status = acceptSasl->Advance(acceptLine, outStr, state);
+        acceptLine.clear();
+        if (status != ER_OK) {
+            QCC_DbgPrintf(("Server authentication failed %s", QCC_StatusText(status)));
+            break;
+        }
+        if (state == SASLEngine::ALLJOYN_AUTH_SUCCESS) {
+            /*
+             * Remember the authentication mechanism that was used
+             */
+            acceptAuthUsed = acceptSasl->GetMechanism();
+            delete acceptSasl;
+            acceptSasl = NULL;
+            authListener.Set(NULL);
+            acceptState = ACCEPT_HELLO;
+            break;
+        }
+        /*
+         * Send the response
+         */
+        size_t numPushed;
+        status = endpoint->GetSink().PushBytes((void*)(outStr.data()), outStr.length(), numPushed);
+        if (status == ER_OK) {
+            QCC_DbgPrintf(("Sent %s", outStr.c_str()));
+        } else {
+            QCC_LogError(status, ("Failed to write to stream"));
+        }
+    }
+    if ((status == ER_OK) && (acceptState == ACCEPT_HELLO)) {
+        /*
+         * Wait for the hello message
+         */
+        status = acceptHello->ReadNonBlocking(endpoint, false);
+        if (status == ER_TIMEOUT) {
+            return ER_WOULDBLOCK;
+        }
+        if (status == ER_OK) {
+            status = acceptHello->Unmarshal(endpoint, false);
+        }
+        if (status == ER_OK) {
+            qcc::String redirection;
+            status = ReplyHello(acceptHello, redirection);
+            if ((status == ER_OK) && !redirection.empty()) {
+                /*
+                 * There is no waiting for the other end to close the connection here, the caller
+                 * drops it.
+                 */
+                status = ER_BUS_ENDPOINT_REDIRECTED;
+            }
+        }
+        if (status == ER_OK) {
+            authUsed = acceptAuthUsed;
+        }
+    }
+    if (status != ER_WOULDBLOCK) {
+        QCC_DbgPrintf(("Accept complete %s", QCC_StatusText(status)));
+        delete acceptSasl;
+        acceptSasl = NULL;
+        authListener.Set(NULL);
+        acceptState = ACCEPT_DONE;
+    }
+    return status;
+}
+
 }
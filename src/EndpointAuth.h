@@ -28,6 +28,8 @@
 #include <qcc/GUID.h>
 #include <qcc/Stream.h>
 
+#include <alljoyn/Message.h>
+
 #include "BusInternal.h"
 #include "SASLEngine.h"
 
@@ -59,13 +61,21 @@ class EndpointAuth : public SASLEngine::ExtensionHandler {
         endpoint(endpoint),
         uniqueName(bus.GetInternal().GetRouter().GenerateUniqueName()),
         isAccepting(isAcceptor),
-        remoteProtocolVersion(0)
+        remoteProtocolVersion(0),
+        acceptState(ACCEPT_IDLE),
+        acceptSasl(NULL),
+        acceptHello(bus),
+        hasListener(false)
     { }
 
     /**
      * Destructor
      */
-    ~EndpointAuth() { };
+    ~EndpointAuth()
+    {
+        delete acceptSasl;
+        authListener.Set(NULL);
+    }
 
     /**
      * Establish a connection.
@@ -83,6 +93,37 @@ class EndpointAuth : public SASLEngine::ExtensionHandler {
      */
     QStatus Establish(const qcc::String& authMechanisms, qcc::String& authUsed, qcc::String& redirection, AuthListener* listener = NULL);
 
+    /**
+     * Start accepting a connection without blocking. The connection is established by calling
+     * AcceptAdvance() each time data is available on the endpoint's stream. Connections accepted
+     * this way cannot be redirected.
+     *
+     * @param authMechanisms  The authentication mechanisms to accept.
+     * @param listener        Authentication credentials listener
+     */
+    void AcceptBegin(const qcc::String& authMechanisms, AuthListener* listener = NULL);
+
+    /**
+     * Continue accepting a connection with the data that is available on the endpoint's stream
+     * without waiting for more.
+     *
+     * @param authUsed  Returns the name of the authentication method that was used to establish the connection.
+     *
+     * @return
+     *      - ER_OK if the connection has been established
+     *      - ER_WOULDBLOCK if more data is needed
+     *      - An error status otherwise
+     */
+    QStatus AcceptAdvance(qcc::String& authUsed);
+
+    /**
+     * Check if the next call to AcceptAdvance() may block. Authentication mechanisms that need
+     * credentials call out to the authentication listener and the key store.
+     *
+     * @return  true if the next call to AcceptAdvance() may block.
+     */
+    bool AcceptMayBlock() const { return (acceptState == ACCEPT_SASL) && hasListener; }
+
     /**
      * Get the unique bus name assigned by the bus for this endpoint.
      *
@@ -143,10 +184,27 @@ class EndpointAuth : public SASLEngine::ExtensionHandler {
 
     ProtectedAuthListener authListener;  ///< Authentication listener
 
+    /** States of a non-blocking accept */
+    enum AcceptState {
+        ACCEPT_IDLE,     ///< AcceptBegin() has not been called
+        ACCEPT_SASL,     ///< Running the SASL conversation
+        ACCEPT_HELLO,    ///< Waiting for the hello message
+        ACCEPT_DONE      ///< The accept has succeeded or failed
+    };
+
+    AcceptState acceptState;         ///< State of a non-blocking accept
+    SASLEngine* acceptSasl;          ///< SASL engine for a non-blocking accept
+    qcc::String acceptLine;          ///< Partially read SASL line
+    qcc::String acceptAuthUsed;      ///< Authentication mechanism used by a non-blocking accept
+    Message acceptHello;             ///< Partially read hello message
+    bool hasListener;                ///< True if there is an authentication listener
+
     /* Internal methods */
 
     QStatus Hello(qcc::String& redirection);
     QStatus WaitHello();
+    QStatus ReplyHello(Message& hello, qcc::String& redirection);
+    QStatus ReadLineNonBlocking(qcc::String& line);
 };
 
 }
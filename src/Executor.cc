@@ -0,0 +1,343 @@
+/**
+ * @file
+ *
+ * This file implements a pool of worker threads for running method and signal handlers.
+ */
+
+/******************************************************************************
+ * Copyright 2013, Qualcomm Innovation Center, Inc.
+ *
+ *    Licensed under the Apache License, Version 2.0 (the "License");
+ *    you may not use this file except in compliance with the License.
+ *    You may obtain a copy of the License at
+ *
+ *        http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *    Unless required by applicable law or agreed to in writing, software
+ *    distributed under the License is distributed on an "AS IS" BASIS,
+ *    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *    See the License for the specific language governing permissions and
+ *    limitations under the License.
+ ******************************************************************************/
+
+#include <qcc/platform.h>
+
+#include <qcc/Debug.h>
+#include <qcc/Event.h>
+#include <qcc/Mutex.h>
+#include <qcc/String.h>
+#include <qcc/StringUtil.h>
+#include <qcc/Thread.h>
+#include <qcc/atomic.h>
+
+#include "Executor.h"
+
+#define QCC_MODULE "ALLJOYN"
+
+using namespace std;
+using namespace qcc;
+
+namespace ajn {
+
+/*
+ * How long a dispatcher blocked on a full executor waits before checking again
+ */
+static const uint32_t SPACE_WAIT_MS = 100;
+
+class Executor::Worker : public qcc::Thread {
+  public:
+    Worker(Executor& executor, const qcc::String& name, size_t index) :
+        Thread(name + "-" + U32ToString((uint32_t)index)),
+        index(index),
+        idle(false),
+        holdsLock(false),
+        executor(executor) { }
+
+    std::deque<Lane*> lanes;  ///< Runnable lanes owned by this worker
+    qcc::Mutex lock;          ///< Lock protecting the lanes deque
+    qcc::Event wakeEvent;     ///< Set when work is scheduled that this worker should look at
+    size_t index;             ///< Index of this worker in the executor
+    volatile bool idle;       ///< True while this worker is looking for work or waiting
+    bool holdsLock;           ///< True while the task running on this worker holds the reentrancy lock
+
+  protected:
+    qcc::ThreadReturn STDCALL Run(void* arg);
+
+  private:
+    Executor& executor;
+};
+
+qcc::ThreadReturn STDCALL Executor::Worker::Run(void* arg)
+{
+    while (!IsStopping()) {
+        /*
+         * Mark this worker idle before looking for work so anything scheduled after we have
+         * looked will set our wake event.
+         */
+        idle = true;
+        wakeEvent.ResetEvent();
+        Lane* lane = executor.TakeLane(this);
+        if (lane) {
+            idle = false;
+            executor.RunLane(this, lane);
+        } else {
+            QStatus status = Event::Wait(wakeEvent);
+            if ((status == ER_ALERTED_THREAD) && !IsStopping()) {
+                GetStopEvent().ResetEvent();
+            }
+        }
+    }
+    idle = false;
+    return 0;
+}
+
+Executor::Executor(const qcc::String& name, uint32_t concurrency, uint32_t maxPending) :
+    maxPending(maxPending),
+    numPending(0),
+    nextWorker(0),
+    running(false)
+{
+    if (concurrency == 0) {
+        concurrency = 1;
+    }
+    for (uint32_t i = 0; i < concurrency; ++i) {
+        workers.push_back(new Worker(*this, name, i));
+    }
+}
+
+Executor::~Executor()
+{
+    Stop();
+    Join();
+    for (size_t i = 0; i < workers.size(); ++i) {
+        delete workers[i];
+    }
+}
+
+QStatus Executor::Start()
+{
+    QStatus status = ER_OK;
+
+    running = true;
+    for (size_t i = 0; (status == ER_OK) && (i < workers.size()); ++i) {
+        status = workers[i]->Start();
+    }
+    if (status != ER_OK) {
+        QCC_LogError(status, ("Failed to start executor thread"));
+        Stop();
+    }
+    return status;
+}
+
+QStatus Executor::Stop()
+{
+    QStatus status = ER_OK;
+
+    running = false;
+    for (size_t i = 0; i < workers.size(); ++i) {
+        QStatus s = workers[i]->Stop();
+        if (status == ER_OK) {
+            status = s;
+        }
+    }
+    /* Release any dispatchers blocked waiting for space */
+    spaceEvent.SetEvent();
+    return status;
+}
+
+QStatus Executor::Join()
+{
+    QStatus status = ER_OK;
+
+    for (size_t i = 0; i < workers.size(); ++i) {
+        QStatus s = workers[i]->Join();
+        if (status == ER_OK) {
+            status = s;
+        }
+    }
+    DiscardAll();
+    return status;
+}
+
+Executor::Worker* Executor::GetWorker()
+{
+    Thread* thread = Thread::GetThread();
+    for (size_t i = 0; i < workers.size(); ++i) {
+        if (workers[i] == thread) {
+            return workers[i];
+        }
+    }
+    return NULL;
+}
+
+QStatus Executor::Dispatch(const qcc::String& key, ExecutorListener* listener, void* context)
+{
+    Worker* self = GetWorker();
+
+    lanesLock.Lock(MUTEX_CONTEXT);
+    /*
+     * Apply back pressure to threads feeding the executor. Our own workers are never blocked
+     * because they are the threads that make space.
+     */
+    while (running && !self && maxPending && (numPending >= maxPending)) {
+        spaceEvent.ResetEvent();
+        lanesLock.Unlock(MUTEX_CONTEXT);
+        QStatus status = Event::Wait(spaceEvent, SPACE_WAIT_MS);
+        if ((status != ER_OK) && (status != ER_TIMEOUT)) {
+            return status;
+        }
+        lanesLock.Lock(MUTEX_CONTEXT);
+    }
+    if (!running) {
+        lanesLock.Unlock(MUTEX_CONTEXT);
+        return ER_BUS_STOPPING;
+    }
+    Lane* lane;
+    map<qcc::String, Lane*>::iterator it = lanes.find(key);
+    if (it == lanes.end()) {
+        lane = new Lane(key);
+        lanes[key] = lane;
+        lane->tasks.push_back(Task(listener, context));
+        Schedule(lane, self);
+    } else {
+        /* The lane is already queued or running, it will pick up this task in order */
+        lane = it->second;
+        lane->tasks.push_back(Task(listener, context));
+    }
+    ++numPending;
+    lanesLock.Unlock(MUTEX_CONTEXT);
+    return ER_OK;
+}
+
+void Executor::Schedule(Lane* lane, Worker* self)
+{
+    /*
+     * Workers keep the work they generate, other threads spread work round robin.
+     */
+    Worker* worker = self ? self : workers[(uint32_t)IncrementAndFetch(&nextWorker) % workers.size()];
+
+    worker->lock.Lock(MUTEX_CONTEXT);
+    worker->lanes.push_back(lane);
+    worker->lock.Unlock(MUTEX_CONTEXT);
+
+    if (worker->idle) {
+        worker->wakeEvent.SetEvent();
+    } else {
+        /*
+         * The owner is busy so wake an idle worker to steal the lane
+         */
+        for (size_t i = 0; i < workers.size(); ++i) {
+            if (workers[i]->idle) {
+                workers[i]->wakeEvent.SetEvent();
+                break;
+            }
+        }
+    }
+}
+
+Executor::Lane* Executor::TakeLane(Worker* worker)
+{
+    Lane* lane = NULL;
+
+    /*
+     * Take the oldest lane from our own deque
+     */
+    worker->lock.Lock(MUTEX_CONTEXT);
+    if (!worker->lanes.empty()) {
+        lane = worker->lanes.front();
+        worker->lanes.pop_front();
+    }
+    worker->lock.Unlock(MUTEX_CONTEXT);
+
+    /*
+     * Steal from the other end of the other workers' deques
+     */
+    for (size_t i = 1; !lane && (i < workers.size()); ++i) {
+        Worker* victim = workers[(worker->index + i) % workers.size()];
+        victim->lock.Lock(MUTEX_CONTEXT);
+        if (!victim->lanes.empty()) {
+            lane = victim->lanes.back();
+            victim->lanes.pop_back();
+        }
+        victim->lock.Unlock(MUTEX_CONTEXT);
+    }
+    return lane;
+}
+
+void Executor::RunLane(Worker* worker, Lane* lane)
+{
+    lanesLock.Lock(MUTEX_CONTEXT);
+    Task task = lane->tasks.front();
+    lane->tasks.pop_front();
+    lanesLock.Unlock(MUTEX_CONTEXT);
+
+    reentrancyLock.Lock(MUTEX_CONTEXT);
+    worker->holdsLock = true;
+    task.listener->RunTask(task.context, running ? ER_OK : ER_BUS_STOPPING);
+    if (worker->holdsLock) {
+        worker->holdsLock = false;
+        reentrancyLock.Unlock(MUTEX_CONTEXT);
+    }
+
+    lanesLock.Lock(MUTEX_CONTEXT);
+    if (maxPending && (numPending-- == maxPending)) {
+        spaceEvent.SetEvent();
+    }
+    /*
+     * Run one task per turn so lanes sharing a worker take turns
+     */
+    if (lane->tasks.empty()) {
+        lanes.erase(lane->key);
+        delete lane;
+    } else {
+        Schedule(lane, worker);
+    }
+    lanesLock.Unlock(MUTEX_CONTEXT);
+}
+
+void Executor::DiscardAll()
+{
+    vector<Lane*> discard;
+
+    lanesLock.Lock(MUTEX_CONTEXT);
+    for (size_t i = 0; i < workers.size(); ++i) {
+        workers[i]->lock.Lock(MUTEX_CONTEXT);
+        workers[i]->lanes.clear();
+        workers[i]->lock.Unlock(MUTEX_CONTEXT);
+    }
+    for (map<qcc::String, Lane*>::iterator it = lanes.begin(); it != lanes.end(); ++it) {
+        discard.push_back(it->second);
+    }
+    lanes.clear();
+    numPending = 0;
+    lanesLock.Unlock(MUTEX_CONTEXT);
+
+    /*
+     * Let the listeners release the task contexts
+     */
+    for (size_t i = 0; i < discard.size(); ++i) {
+        while (!discard[i]->tasks.empty()) {
+            Task task = discard[i]->tasks.front();
+            discard[i]->tasks.pop_front();
+            task.listener->RunTask(task.context, ER_BUS_STOPPING);
+        }
+        delete discard[i];
+    }
+}
+
+void Executor::EnableReentrancy()
+{
+    Worker* worker = GetWorker();
+    if (worker && worker->holdsLock) {
+        worker->holdsLock = false;
+        reentrancyLock.Unlock(MUTEX_CONTEXT);
+    }
+}
+
+bool Executor::ThreadHoldsLock()
+{
+    Worker* worker = GetWorker();
+    return worker && worker->holdsLock;
+}
+
+}
@@ -0,0 +1,193 @@
+#ifndef _ALLJOYN_EXECUTOR_H
+#define _ALLJOYN_EXECUTOR_H
+/**
+ * @file
+ * This file defines a pool of worker threads for running method and signal handlers.
+ */
+
+/******************************************************************************
+ * Copyright 2013, Qualcomm Innovation Center, Inc.
+ *
+ *    Licensed under the Apache License, Version 2.0 (the "License");
+ *    you may not use this file except in compliance with the License.
+ *    You may obtain a copy of the License at
+ *
+ *        http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *    Unless required by applicable law or agreed to in writing, software
+ *    distributed under the License is distributed on an "AS IS" BASIS,
+ *    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *    See the License for the specific language governing permissions and
+ *    limitations under the License.
+ ******************************************************************************/
+
+#ifndef __cplusplus
+#error Only include Executor.h in C++ code.
+#endif
+
+#include <qcc/platform.h>
+
+#include <deque>
+#include <map>
+#include <vector>
+
+#include <qcc/Event.h>
+#include <qcc/Mutex.h>
+#include <qcc/String.h>
+#include <qcc/Thread.h>
+
+#include <alljoyn/Status.h>
+
+namespace ajn {
+
+/**
+ * Interface implemented by the receivers of tasks run by an Executor.
+ */
+class ExecutorListener {
+  public:
+    /**
+     * Virtual destructor for derivable class.
+     */
+    virtual ~ExecutorListener() { }
+
+    /**
+     * Called on an executor thread to run a task.
+     *
+     * @param context  The context passed in when the task was dispatched.
+     * @param reason   ER_OK if the task should run, or ER_BUS_STOPPING if the executor is shutting
+     *                 down and the task is being discarded. The listener must still release any
+     *                 resources held by the context.
+     */
+    virtual void RunTask(void* context, QStatus reason) = 0;
+};
+
+/**
+ * An Executor runs tasks on a fixed pool of worker threads. Each worker has its own deque of
+ * runnable lanes and an idle worker steals lanes from the other workers so a slow handler does
+ * not hold up work queued behind it.
+ *
+ * Tasks are dispatched with a key, typically the unique name of the sender of a message. Tasks
+ * with the same key are queued on a lane and run one at a time in the order they were dispatched
+ * so messages from one peer are delivered in order. Tasks with different keys can run on different
+ * workers.
+ *
+ * Like a qcc::Timer created with preventReentrancy set, tasks hold the executor's reentrancy lock
+ * while they run so handlers are serialized. A task that calls EnableReentrancy() releases the lock
+ * for the rest of its execution allowing other tasks to run concurrently with it.
+ */
+class Executor {
+  public:
+
+    /**
+     * Constructor
+     *
+     * @param name         Name for the worker threads.
+     * @param concurrency  Number of worker threads.
+     * @param maxPending   Maximum number of tasks that can be queued before Dispatch() blocks
+     *                     callers that are not executor threads, 0 for no limit.
+     */
+    Executor(const qcc::String& name, uint32_t concurrency, uint32_t maxPending);
+
+    /**
+     * Destructor. Stops the worker threads and discards any tasks that have not run.
+     */
+    virtual ~Executor();
+
+    /**
+     * Start the worker threads.
+     *
+     * @return ER_OK if the executor was started.
+     */
+    QStatus Start();
+
+    /**
+     * Stop the worker threads. Tasks that have not started running are discarded when the
+     * executor is joined.
+     *
+     * @return ER_OK if the executor was stopped.
+     */
+    QStatus Stop();
+
+    /**
+     * Wait for the worker threads to exit and discard any tasks that have not run.
+     *
+     * @return ER_OK if the worker threads have exited.
+     */
+    QStatus Join();
+
+    /**
+     * Check if the executor is running.
+     *
+     * @return true if the executor has been started and not stopped.
+     */
+    bool IsRunning() const { return running; }
+
+    /**
+     * Queue a task to run on a worker thread.
+     *
+     * @param key       Tasks with the same key run one at a time in dispatch order.
+     * @param listener  The listener to run the task.
+     * @param context   Context passed to the listener.
+     *
+     * @return
+     *      - #ER_OK if the task was queued.
+     *      - #ER_BUS_STOPPING if the executor is not running, the task is not queued.
+     */
+    QStatus Dispatch(const qcc::String& key, ExecutorListener* listener, void* context);
+
+    /**
+     * Allow the task running on the calling thread to run concurrently with other tasks.
+     */
+    void EnableReentrancy();
+
+    /**
+     * Check if the calling thread is running a task that holds the reentrancy lock.
+     *
+     * @return true if the calling thread is an executor thread holding the reentrancy lock.
+     */
+    bool ThreadHoldsLock();
+
+  private:
+
+    /**
+     * Private copy constructor and assignment to prevent copying.
+     */
+    Executor(const Executor& other);
+    Executor& operator=(const Executor& other);
+
+    /** A task waiting to run */
+    struct Task {
+        ExecutorListener* listener;
+        void* context;
+        Task(ExecutorListener* listener, void* context) : listener(listener), context(context) { }
+    };
+
+    /** The tasks queued for a key. A lane only exists while it is queued on a worker or running. */
+    struct Lane {
+        qcc::String key;
+        std::deque<Task> tasks;
+        Lane(const qcc::String& key) : key(key) { }
+    };
+
+    class Worker;
+
+    Worker* GetWorker();
+    void Schedule(Lane* lane, Worker* worker);
+    Lane* TakeLane(Worker* worker);
+    void RunLane(Worker* worker, Lane* lane);
+    void DiscardAll();
+
+    std::vector<Worker*> workers;             ///< The worker threads
+    std::map<qcc::String, Lane*> lanes;       ///< Lanes with tasks queued or running
+    qcc::Mutex lanesLock;                     ///< Lock protecting the lanes and pending count
+    qcc::Mutex reentrancyLock;                ///< Held by a task while it runs unless reentrancy is enabled
+    qcc::Event spaceEvent;                    ///< Set when a task completes if dispatchers may be blocked
+    uint32_t maxPending;                      ///< Maximum number of queued tasks
+    uint32_t numPending;                      ///< Number of queued and running tasks
+    volatile int32_t nextWorker;              ///< Round robin index for dispatches from non-executor threads
+    volatile bool running;                    ///< True while the executor is running
+};
+
+}
+
+#endif
@@ -28,6 +28,7 @@
 #include <alljoyn/Status.h>
 
 #include "SignatureUtils.h"
+#include "MarshalPlan.h"
 
 #define QCC_MODULE "ALLJOYN"
 
@@ -101,7 +102,9 @@ InterfaceDescription::Member::Member(
     returnSignature(returnSignature ? returnSignature : ""),
     argNames(argNames ? argNames : ""),
     annotations(new AnnotationsMap()),
-    accessPerms(accessPerms ? accessPerms : "") {
+    accessPerms(accessPerms ? accessPerms : ""),
+    argsPlan(NULL),
+    returnPlan(NULL) {
 
     if (annotation & MEMBER_ANNOTATE_DEPRECATED) {
         (*annotations)[org::freedesktop::DBus::AnnotateDeprecated] = "true";
@@ -120,7 +123,9 @@ InterfaceDescription::Member::Member(const Member& other)
     returnSignature(other.returnSignature),
     argNames(other.argNames),
     annotations(new AnnotationsMap(*(other.annotations))),
-    accessPerms(other.accessPerms)
+    accessPerms(other.accessPerms),
+    argsPlan(other.argsPlan ? new MarshalPlan(*other.argsPlan) : NULL),
+    returnPlan(other.returnPlan ? new MarshalPlan(*other.returnPlan) : NULL)
 {
 }
 
@@ -136,6 +141,10 @@ InterfaceDescription::Member& InterfaceDescription::Member::operator=(const Memb
         delete annotations;
         annotations = new AnnotationsMap(*(other.annotations));
         accessPerms = other.accessPerms;
+        delete argsPlan;
+        argsPlan = other.argsPlan ? new MarshalPlan(*other.argsPlan) : NULL;
+        delete returnPlan;
+        returnPlan = other.returnPlan ? new MarshalPlan(*other.returnPlan) : NULL;
     }
     return *this;
 }
@@ -143,6 +152,8 @@ InterfaceDescription::Member& InterfaceDescription::Member::operator=(const Memb
 InterfaceDescription::Member::~Member()
 {
     delete annotations;
+    delete argsPlan;
+    delete returnPlan;
 }
 
 size_t InterfaceDescription::Member::GetAnnotations(qcc::String* names, qcc::String* values, size_t size) const
@@ -267,6 +278,39 @@ InterfaceDescription& InterfaceDescription::operator=(const InterfaceDescription
     return *this;
 }
 
+static const MarshalPlan* CompilePlan(const qcc::String& signature)
+{
+    MarshalPlan* plan = NULL;
+    if (!signature.empty()) {
+        plan = new MarshalPlan(signature);
+        if (!plan->IsValid()) {
+            delete plan;
+            plan = NULL;
+        }
+    }
+    return plan;
+}
+
+void InterfaceDescription::Activate()
+{
+    if (!isActivated) {
+        /*
+         * Members can no longer change so compile their signatures into marshal plans
+         */
+        Definitions::MemberMap::iterator mit;
+        for (mit = defs->members.begin(); mit != defs->members.end(); ++mit) {
+            Member& member = mit->second;
+            if (!member.argsPlan) {
+                member.argsPlan = CompilePlan(member.signature);
+            }
+            if (!member.returnPlan) {
+                member.returnPlan = CompilePlan(member.returnSignature);
+            }
+        }
+        isActivated = true;
+    }
+}
+
 bool InterfaceDescription::IsSecure() const
 {
     AnnotationsMap::const_iterator it = defs->annotations.find(org::alljoyn::Bus::Secure);
@@ -22,14 +22,13 @@
  ******************************************************************************/
 #include <qcc/platform.h>
 
-#include <list>
-
 #include <qcc/Debug.h>
 #include <qcc/GUID.h>
 #include <qcc/String.h>
 #include <qcc/StringUtil.h>
 #include <qcc/Thread.h>
 #include <qcc/atomic.h>
+#include <qcc/time.h>
 
 #include <alljoyn/DBusStd.h>
 #include <alljoyn/AllJoynStd.h>
@@ -38,6 +37,7 @@
 #include <alljoyn/ProxyBusObject.h>
 
 #include "LocalTransport.h"
+#include "Executor.h"
 #include "Router.h"
 #include "MethodTable.h"
 #include "SignalTable.h"
@@ -55,23 +55,55 @@ namespace ajn {
 
 static const uint32_t LOCAL_ENDPOINT_CONCURRENCY = 4;
 
+/*
+ * Number of messages per dispatcher thread that can be queued before the dispatcher applies back
+ * pressure to the threads delivering messages.
+ */
+static const uint32_t LOCAL_ENDPOINT_MAX_PENDING_PER_THREAD = 16;
+
+/*
+ * Key for tasks the local endpoint dispatches for itself. This never matches a unique name.
+ */
+static const char* LOCAL_TASK_KEY = "";
+
+/*
+ * Prefix for the keys replies are dispatched on. Replies from a sender get a lane of their own so a
+ * handler that enables concurrent callbacks and then makes a blocking call to the peer that sent the
+ * message it is handling does not wait on a reply queued behind it on the sender's lane. Unique names
+ * start with ':' so these keys never match a sender's key.
+ */
+static const char* LOCAL_REPLY_KEY_PREFIX = "reply";
+
+/*
+ * Reply timeouts are tracked on a timer wheel with this tick and number of slots. One turn of the
+ * wheel covers about 10 seconds.
+ */
+static const uint32_t LOCAL_ENDPOINT_REPLY_TICK_MS = 20;
+static const uint32_t LOCAL_ENDPOINT_REPLY_SLOTS = 512;
 
-class _LocalEndpoint::Dispatcher : public qcc::Timer, public qcc::AlarmListener {
+
+class _LocalEndpoint::Dispatcher : public Executor, public ExecutorListener {
   public:
-    Dispatcher(_LocalEndpoint* endpoint, uint32_t concurrency = LOCAL_ENDPOINT_CONCURRENCY) : Timer("lepDisp", true, concurrency, true, 10), AlarmListener(), endpoint(endpoint) { }
+    Dispatcher(_LocalEndpoint* endpoint, uint32_t concurrency = LOCAL_ENDPOINT_CONCURRENCY) :
+        Executor("lepDisp", concurrency, concurrency * LOCAL_ENDPOINT_MAX_PENDING_PER_THREAD), endpoint(endpoint) { }
+
+    /*
+     * Messages are dispatched keyed on the sender so messages from each sender are handled in order.
+     * Method replies and errors from a sender are handled in order on a separate key.
+     */
     QStatus DispatchMessage(Message& msg);
 
-    void AlarmTriggered(const qcc::Alarm& alarm, QStatus reason);
+    void RunTask(void* context, QStatus reason);
 
   private:
     _LocalEndpoint* endpoint;
 };
 
-class _LocalEndpoint::DeferredCallbacks : public qcc::AlarmListener {
+class _LocalEndpoint::DeferredCallbacks : public ExecutorListener {
   public:
     DeferredCallbacks(_LocalEndpoint* ep) : endpoint(ep) { }
 
-    void AlarmTriggered(const qcc::Alarm& alarm, QStatus reason);
+    void RunTask(void* context, QStatus reason);
 
   private:
     _LocalEndpoint* endpoint;
@@ -109,7 +141,7 @@ bool LocalTransport::IsRunning()
     return !isStoppedEvent.IsSet();
 }
 
-class _LocalEndpoint::ReplyContext {
+class _LocalEndpoint::ReplyContext : public TimerWheel::Entry {
   public:
     ReplyContext(LocalEndpoint ep,
                  MessageReceiver* receiver,
@@ -124,16 +156,9 @@ class _LocalEndpoint::ReplyContext {
         method(method),
         callFlags(methodCall->GetFlags()),
         serial(methodCall->msgHeader.serialNum),
-        context(context)
+        context(context),
+        expires(GetTimestamp64() + timeout)
     {
-        uint32_t zero = 0;
-        void* tempContext = (void*)this;
-        AlarmListener* listener = ep.unwrap();
-        alarm = Alarm(timeout, listener, tempContext, zero);
-    }
-
-    ~ReplyContext() {
-        ep->replyTimer.RemoveAlarm(alarm, false /* don't block if alarm in progress */);
     }
 
     LocalEndpoint ep;                            /* The endpoint this reply context is associated with */
@@ -143,7 +168,7 @@ class _LocalEndpoint::ReplyContext {
     uint8_t callFlags;                           /* Flags from the method call */
     uint32_t serial;                             /* Serial number for the method reply */
     void* context;                               /* The calling object's context */
-    qcc::Alarm alarm;                            /* Alarm object for handling method call timeouts */
+    uint64_t expires;                            /* Time when the method call times out */
 
   private:
     ReplyContext(const ReplyContext& other);
@@ -159,6 +184,8 @@ _LocalEndpoint::_LocalEndpoint(BusAttachment& bus, uint32_t concurrency) :
     objectsLock(),
     replyMapLock(),
     replyTimer("replyTimer", true),
+    replyWheel(LOCAL_ENDPOINT_REPLY_TICK_MS, LOCAL_ENDPOINT_REPLY_SLOTS),
+    replyTickScheduled(false),
     dbusObj(NULL),
     alljoynObj(NULL),
     alljoynDebugObj(NULL),
@@ -179,11 +206,14 @@ _LocalEndpoint::~_LocalEndpoint()
          * Delete any stale reply contexts
          */
         replyMapLock.Lock(MUTEX_CONTEXT);
-        for (map<uint32_t, ReplyContext*>::iterator iter = replyMap.begin(); iter != replyMap.end(); ++iter) {
-            QCC_DbgHLPrintf(("LocalEndpoint~LocalEndpoint deleting reply handler for serial %u", iter->second->serial));
-            delete iter->second;
+        vector<ReplyContext*> contexts;
+        replyMap.GetAll(contexts);
+        for (vector<ReplyContext*>::iterator iter = contexts.begin(); iter != contexts.end(); ++iter) {
+            QCC_DbgHLPrintf(("LocalEndpoint~LocalEndpoint deleting reply handler for serial %u", (*iter)->serial));
+            replyWheel.Cancel(*iter);
+            delete *iter;
         }
-        replyMap.clear();
+        replyMap.Clear();
         replyMapLock.Unlock(MUTEX_CONTEXT);
         /*
          * Unregister all application registered bus objects
@@ -384,11 +414,17 @@ QStatus _LocalEndpoint::PeerInterface(Message& message)
 
 QStatus _LocalEndpoint::Dispatcher::DispatchMessage(Message& msg)
 {
-    uint32_t zero = 0;
-    void* context = new Message(msg);
-    qcc::AlarmListener* localEndpointListener = this;
-    Alarm alarm(zero, localEndpointListener, context, zero);
-    return AddAlarm(alarm);
+    Message* context = new Message(msg);
+    QStatus status;
+    if ((msg->GetType() == MESSAGE_METHOD_RET) || (msg->GetType() == MESSAGE_ERROR)) {
+        status = Dispatch(qcc::String(LOCAL_REPLY_KEY_PREFIX) + msg->GetSender(), this, context);
+    } else {
+        status = Dispatch(msg->GetSender(), this, context);
+    }
+    if (status != ER_OK) {
+        delete context;
+    }
+    return status;
 }
 
 void _LocalEndpoint::EnableReentrancy()
@@ -407,9 +443,9 @@ bool _LocalEndpoint::IsReentrantCall()
 
 }
 
-void _LocalEndpoint::Dispatcher::AlarmTriggered(const Alarm& alarm, QStatus reason)
+void _LocalEndpoint::Dispatcher::RunTask(void* context, QStatus reason)
 {
-    Message* msg = static_cast<Message*>(alarm->GetContext());
+    Message* msg = static_cast<Message*>(context);
     if (msg) {
         if (reason == ER_OK) {
             QStatus status = endpoint->DoPushMessage(*msg);
@@ -612,28 +648,32 @@ BusObject* _LocalEndpoint::FindLocalObject(const char* objectPath) {
     return ret;
 }
 
-void _LocalEndpoint::UpdateSerialNumber(Message& msg)
+QStatus _LocalEndpoint::UpdateSerialNumber(Message& msg)
 {
     uint32_t serial = msg->msgHeader.serialNum;
     /*
      * If the previous serial number is not the latest we replace it.
      */
     if (serial != bus->GetInternal().PrevSerial()) {
-        msg->SetSerialNumber();
+        QStatus status = msg->SetSerialNumber();
+        if (status != ER_OK) {
+            return status;
+        }
         /*
          * If the message is a method call me must update the reply map
          */
         if (msg->GetType() == MESSAGE_METHOD_CALL) {
             replyMapLock.Lock(MUTEX_CONTEXT);
-            ReplyContext* rc = RemoveReplyHandler(serial);
+            ReplyContext* rc = replyMap.Remove(serial);
             if (rc) {
                 rc->serial = msg->msgHeader.serialNum;
-                replyMap[rc->serial] = rc;
+                replyMap.Insert(rc->serial, rc);
             }
             replyMapLock.Unlock(MUTEX_CONTEXT);
         }
         QCC_DbgPrintf(("LocalEndpoint::UpdateSerialNumber for %s serial=%u was %u", msg->Description().c_str(), msg->msgHeader.serialNum, serial));
     }
+    return ER_OK;
 }
 
 QStatus _LocalEndpoint::RegisterReplyHandler(MessageReceiver* receiver,
@@ -651,17 +691,18 @@ QStatus _LocalEndpoint::RegisterReplyHandler(MessageReceiver* receiver,
         ReplyContext* rc =  new ReplyContext(LocalEndpoint::wrap(this), receiver, replyHandler, &method, methodCallMsg, context, timeout);
         QCC_DbgPrintf(("LocalEndpoint::RegisterReplyHandler"));
         /*
-         * Add reply context.
+         * Add reply context and set timeout
          */
         replyMapLock.Lock(MUTEX_CONTEXT);
-        replyMap[methodCallMsg->msgHeader.serialNum] = rc;
+        replyMap.Insert(methodCallMsg->msgHeader.serialNum, rc);
+        replyWheel.Schedule(rc, rc->expires, GetTimestamp64());
+        bool tick = StartReplyTick();
         replyMapLock.Unlock(MUTEX_CONTEXT);
-        /*
-         * Set timeout
-         */
-        status = replyTimer.AddAlarm(rc->alarm);
-        if (status != ER_OK) {
-            UnregisterReplyHandler(methodCallMsg);
+        if (tick) {
+            status = AddReplyTick();
+            if (status != ER_OK) {
+                UnregisterReplyHandler(methodCallMsg);
+            }
         }
     }
     return status;
@@ -686,25 +727,48 @@ bool _LocalEndpoint::UnregisterReplyHandler(Message& methodCall)
 _LocalEndpoint::ReplyContext* _LocalEndpoint::RemoveReplyHandler(uint32_t serial)
 {
     QCC_DbgPrintf(("LocalEndpoint::RemoveReplyHandler for serial=%u", serial));
-    ReplyContext* rc = NULL;
-    map<uint32_t, ReplyContext*>::iterator iter = replyMap.find(serial);
-    if (iter != replyMap.end()) {
-        rc = iter->second;
-        replyMap.erase(iter);
+    ReplyContext* rc = replyMap.Remove(serial);
+    if (rc) {
+        replyWheel.Cancel(rc);
         assert(rc->serial == serial);
     }
     return rc;
 }
 
+/*
+ * NOTE: Must be called holding replyMapLock
+ */
+bool _LocalEndpoint::StartReplyTick()
+{
+    if (!replyTickScheduled && (replyWheel.Size() > 0)) {
+        replyTickScheduled = true;
+        return true;
+    } else {
+        return false;
+    }
+}
+
+QStatus _LocalEndpoint::AddReplyTick()
+{
+    uint32_t tick = replyWheel.GetTickMs();
+    AlarmListener* listener = this;
+    QStatus status = replyTimer.AddAlarm(Alarm(tick, listener));
+    if (status != ER_OK) {
+        replyMapLock.Lock(MUTEX_CONTEXT);
+        replyTickScheduled = false;
+        replyMapLock.Unlock(MUTEX_CONTEXT);
+    }
+    return status;
+}
+
 bool _LocalEndpoint::PauseReplyHandlerTimeout(Message& methodCallMsg)
 {
     bool paused = false;
     if (methodCallMsg->GetType() == MESSAGE_METHOD_CALL) {
         replyMapLock.Lock();
-        map<uint32_t, ReplyContext*>::iterator iter = replyMap.find(methodCallMsg->GetCallSerial());
-        if (iter != replyMap.end()) {
-            ReplyContext*rc = iter->second;
-            paused = replyTimer.RemoveAlarm(rc->alarm);
+        ReplyContext* rc = replyMap.Find(methodCallMsg->GetCallSerial());
+        if (rc) {
+            paused = replyWheel.Cancel(rc);
         }
         replyMapLock.Unlock();
     }
@@ -715,18 +779,24 @@ bool _LocalEndpoint::ResumeReplyHandlerTimeout(Message& methodCallMsg)
 {
     bool resumed = false;
     if (methodCallMsg->GetType() == MESSAGE_METHOD_CALL) {
+        bool tick = false;
         replyMapLock.Lock();
-        map<uint32_t, ReplyContext*>::iterator iter = replyMap.find(methodCallMsg->GetCallSerial());
-        if (iter != replyMap.end()) {
-            ReplyContext*rc = iter->second;
-            QStatus status = replyTimer.AddAlarm(rc->alarm);
-            if (status == ER_OK) {
-                resumed = true;
-            } else {
-                QCC_LogError(status, ("Failed to resume reply handler timeout for %s", methodCallMsg->Description().c_str()));
+        ReplyContext* rc = replyMap.Find(methodCallMsg->GetCallSerial());
+        if (rc) {
+            if (!rc->IsScheduled()) {
+                replyWheel.Schedule(rc, rc->expires, GetTimestamp64());
             }
+            tick = StartReplyTick();
+            resumed = true;
         }
         replyMapLock.Unlock();
+        if (tick) {
+            QStatus status = AddReplyTick();
+            if (status != ER_OK) {
+                resumed = false;
+                QCC_LogError(status, ("Failed to resume reply handler timeout for %s", methodCallMsg->Description().c_str()));
+            }
+        }
     }
     return resumed;
 }
@@ -777,14 +847,14 @@ QStatus _LocalEndpoint::UnregisterAllHandlers(MessageReceiver* receiver)
      * Remove any reply handlers for this receiver
      */
     replyMapLock.Lock(MUTEX_CONTEXT);
-    for (map<uint32_t, ReplyContext*>::iterator iter = replyMap.begin(); iter != replyMap.end();) {
-        ReplyContext* rc = iter->second;
+    vector<ReplyContext*> contexts;
+    replyMap.GetAll(contexts);
+    for (vector<ReplyContext*>::iterator iter = contexts.begin(); iter != contexts.end(); ++iter) {
+        ReplyContext* rc = *iter;
         if (rc->receiver == receiver) {
-            replyMap.erase(iter);
+            replyMap.Remove(rc->serial);
+            replyWheel.Cancel(rc);
             delete rc;
-            iter = replyMap.begin();
-        } else {
-            ++iter;
         }
     }
     replyMapLock.Unlock(MUTEX_CONTEXT);
@@ -792,20 +862,52 @@ QStatus _LocalEndpoint::UnregisterAllHandlers(MessageReceiver* receiver)
 }
 
 /*
- * Alarm handler for method calls that have not received a response within the timeout period.
+ * Alarm handler that ticks the reply timer wheel to find method calls that have not received a
+ * response within the timeout period.
  */
 void _LocalEndpoint::AlarmTriggered(const Alarm& alarm, QStatus reason)
 {
-    ReplyContext* rc = reinterpret_cast<ReplyContext*>(alarm->GetContext());
-    uint32_t serial = rc->serial;
+    vector<TimerWheel::Entry*> expired;
+    vector<uint32_t> serials;
+
+    for (;;) {
+        replyMapLock.Lock(MUTEX_CONTEXT);
+        if (reason == ER_OK) {
+            replyWheel.Advance(GetTimestamp64(), expired);
+        } else {
+            replyWheel.ExpireAll(expired);
+        }
+        for (size_t i = 0; i < expired.size(); ++i) {
+            ReplyContext* rc = static_cast<ReplyContext*>(expired[i]);
+            /*
+             * Clear the encrypted flag so the error response doesn't get rejected.
+             */
+            rc->callFlags &= ~ALLJOYN_FLAG_ENCRYPTED;
+            serials.push_back(rc->serial);
+        }
+        expired.clear();
+        replyTickScheduled = false;
+        bool tick = (reason == ER_OK) && StartReplyTick();
+        replyMapLock.Unlock(MUTEX_CONTEXT);
+        for (size_t i = 0; i < serials.size(); ++i) {
+            ReplyTimedOut(serials[i], reason);
+        }
+        serials.clear();
+        if (!tick || (AddReplyTick() == ER_OK)) {
+            break;
+        }
+        /*
+         * The reply timer is exiting so expire the remaining method calls now.
+         */
+        reason = ER_TIMER_EXITING;
+    }
+}
+
+void _LocalEndpoint::ReplyTimedOut(uint32_t serial, QStatus reason)
+{
     Message msg(*bus);
     QStatus status = ER_OK;
 
-    /*
-     * Clear the encrypted flag so the error response doesn't get rejected.
-     */
-    rc->callFlags &= ~ALLJOYN_FLAG_ENCRYPTED;
-
     if (running) {
         QCC_DbgPrintf(("Timed out waiting for METHOD_REPLY with serial %d", serial));
         if (reason == ER_TIMER_EXITING) {
@@ -837,10 +939,9 @@ QStatus _LocalEndpoint::HandleMethodCall(Message& message)
     QStatus status = ER_OK;
 
     /* Look up the member */
-    MethodTable::SafeEntry* safeEntry = methodTable.Find(message->GetObjectPath(),
-                                                         message->GetInterface(),
-                                                         message->GetMemberName());
-    const MethodTable::Entry* entry = safeEntry ? safeEntry->entry : NULL;
+    MethodTable::SafeEntry safeEntry;
+    methodTable.Find(message->GetObjectPath(), message->GetInterface(), message->GetMemberName(), safeEntry);
+    const MethodTable::Entry* entry = safeEntry.entry;
 
     if (entry == NULL) {
         if (strcmp(message->GetInterface(), org::freedesktop::DBus::Peer::InterfaceName) == 0) {
@@ -859,6 +960,7 @@ QStatus _LocalEndpoint::HandleMethodCall(Message& message)
         QCC_LogError(status, ("Method call to secure interface was not encrypted"));
     } else {
         status = message->UnmarshalArgs(entry->member->signature, entry->member->returnSignature.c_str());
+        message->replyPlan = entry->member->returnPlan;
     }
     if (status == ER_OK) {
         /* Call the method handler */
@@ -909,9 +1011,6 @@ QStatus _LocalEndpoint::HandleMethodCall(Message& message)
         QCC_LogError(status, ("Ignoring message %s", message->Description().c_str()));
         status = ER_OK;
     }
-
-    // safeEntry might be null here
-    delete safeEntry;
     return status;
 }
 
@@ -919,31 +1018,24 @@ QStatus _LocalEndpoint::HandleSignal(Message& message)
 {
     QStatus status = ER_OK;
 
-    signalTable.Lock();
-
-    /* Look up the signal */
-    pair<SignalTable::const_iterator, SignalTable::const_iterator> range =
-        signalTable.Find(message->GetObjectPath(), message->GetInterface(), message->GetMemberName());
+    /*
+     * Look up the signal, the handlers stay valid while we call them even if they are unregistered.
+     */
+    SignalTable::Handlers handlers;
+    signalTable.Find(message->GetInterface(), message->GetMemberName(), handlers);
 
     /*
      * Quick exit if there are no handlers for this signal
      */
-    if (range.first == range.second) {
-        signalTable.Unlock();
+    const char* objPath = message->GetObjectPath();
+    size_t first = 0;
+    while ((first < handlers.Size()) && !handlers[first].Matches(objPath)) {
+        ++first;
+    }
+    if (first == handlers.Size()) {
         return ER_OK;
     }
-    /*
-     * Build a list of all signal handlers for this signal
-     */
-    list<SignalTable::Entry> callList;
-    const InterfaceDescription::Member* signal = range.first->second.member;
-    do {
-        callList.push_back(range.first->second);
-    } while (++range.first != range.second);
-    /*
-     * We have our callback list so we can unlock the signal table.
-     */
-    signalTable.Unlock();
+    const InterfaceDescription::Member* signal = handlers[first].member;
     /*
      * Validate and unmarshal the signal
      */
@@ -959,9 +1051,11 @@ QStatus _LocalEndpoint::HandleSignal(Message& message)
             status = ER_OK;
         }
     } else {
-        list<SignalTable::Entry>::const_iterator callit;
-        for (callit = callList.begin(); callit != callList.end(); ++callit) {
-            (callit->object->*callit->handler)(callit->member, message->GetObjectPath(), message);
+        for (size_t i = first; i < handlers.Size(); ++i) {
+            const SignalTable::Entry& entry = handlers[i];
+            if (entry.Matches(objPath)) {
+                (entry.object->*entry.handler)(entry.member, message->GetObjectPath(), message);
+            }
         }
     }
     return status;
@@ -1017,7 +1111,7 @@ QStatus _LocalEndpoint::HandleMethodReply(Message& message)
     return status;
 }
 
-void _LocalEndpoint::DeferredCallbacks::AlarmTriggered(const qcc::Alarm& alarm, QStatus reason)
+void _LocalEndpoint::DeferredCallbacks::RunTask(void* context, QStatus reason)
 {
     if (reason == ER_OK) {
         /*
@@ -1052,9 +1146,8 @@ void _LocalEndpoint::OnBusConnected()
     /*
      * Use the local endpoint's dispatcher to call back to report the object registrations.
      */
-    uint32_t zero = 0;
     if (dispatcher) {
-        dispatcher->AddAlarm(Alarm(zero, deferredCallbacks));
+        dispatcher->Dispatch(LOCAL_TASK_KEY, deferredCallbacks, NULL);
     }
 }
 
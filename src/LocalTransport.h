@@ -45,7 +45,9 @@
 #include "BusEndpoint.h"
 #include "CompressionRules.h"
 #include "MethodTable.h"
+#include "SerialTable.h"
 #include "SignalTable.h"
+#include "TimerWheel.h"
 #include "Transport.h"
 
 #include <qcc/STLContainer.h>
@@ -75,7 +77,7 @@ class _LocalEndpoint : public _BusEndpoint, public qcc::AlarmListener, public Me
     /**
      * Default constructor initializes an invalid endpoint. This allows for the declaration of uninitialized LocalEndpoint variables.
      */
-    _LocalEndpoint() : dispatcher(NULL), deferredCallbacks(NULL), bus(NULL), replyTimer("replyTimer", true) { }
+    _LocalEndpoint() : dispatcher(NULL), deferredCallbacks(NULL), bus(NULL), replyTimer("replyTimer", true), replyWheel(1, 1), replyTickScheduled(false) { }
 
     /**
      * Constructor
@@ -158,8 +160,12 @@ class _LocalEndpoint : public _BusEndpoint, public qcc::AlarmListener, public Me
      * that were delayed pending authentication the serial number may be updated by this call.
      *
      * @param msg  The message to update the serial number on.
+     *
+     * @return
+     *      - #ER_OK if the serial number is up to date
+     *      - An error status otherwise
      */
-    void UpdateSerialNumber(Message& msg);
+    QStatus UpdateSerialNumber(Message& msg);
 
     /**
      * Pause the timeout handler for specified method call. If the reply handler is succesfully
@@ -427,9 +433,9 @@ class _LocalEndpoint : public _BusEndpoint, public qcc::AlarmListener, public Me
     std::tr1::unordered_map<const char*, BusObject*, Hash, PathEq> localObjects;
 
     /**
-     * List of contexts for method call replies.
+     * Contexts for method call replies indexed by the serial number of the method call.
      */
-    std::map<uint32_t, ReplyContext*> replyMap;
+    SerialTable<ReplyContext> replyMap;
 
     bool running;                      /**< Is the local endpoint up and running */
     MethodTable methodTable;           /**< Hash table of BusObject methods */
@@ -439,7 +445,9 @@ class _LocalEndpoint : public _BusEndpoint, public qcc::AlarmListener, public Me
     qcc::Mutex replyMapLock;           /**< Mutex protecting reply contexts */
     qcc::GUID128 guid;                 /**< GUID to uniquely identify a local endpoint */
     qcc::String uniqueName;            /**< Unique name for endpoint */
-    qcc::Timer replyTimer;             /**< Timer used to timeout method calls */
+    qcc::Timer replyTimer;             /**< Timer that ticks the reply timer wheel */
+    TimerWheel replyWheel;             /**< Timeouts for method calls, protected by replyMapLock */
+    bool replyTickScheduled;           /**< True if the reply timer has an alarm to tick the wheel */
 
     std::vector<BusObject*> defaultObjects;  /**< Auto-generated, heap allocated parent objects */
 
@@ -485,10 +493,33 @@ class _LocalEndpoint : public _BusEndpoint, public qcc::AlarmListener, public Me
     QStatus HandleMethodReply(Message& msg);
 
     /**
-     *   Process a timeout on a METHOD_REPLY message
+     * Tick the reply timer wheel and process timeouts on METHOD_REPLY messages
      */
     void AlarmTriggered(const qcc::Alarm& alarm, QStatus reason);
 
+    /**
+     * Process a timeout on a METHOD_REPLY message
+     *
+     * @param serial  The serial number of the method call that timed out.
+     * @param reason  ER_OK if the method call timed out or ER_TIMER_EXITING if the timer is exiting.
+     */
+    void ReplyTimedOut(uint32_t serial, QStatus reason);
+
+    /**
+     * Start ticking the reply timer wheel if it is not already ticking.
+     * Must be called holding replyMapLock.
+     *
+     * @return true if the caller must add the tick alarm after releasing replyMapLock.
+     */
+    bool StartReplyTick();
+
+    /**
+     * Add the alarm that ticks the reply timer wheel.
+     *
+     * @return ER_OK if the alarm was added.
+     */
+    QStatus AddReplyTick();
+
     /**
      * Inner utility method used bo RegisterBusObject.
      * Do not call this method externally.
@@ -0,0 +1,278 @@
+/**
+ * @file
+ *
+ * This file implements compiling a signature into a plan for marshaling message args.
+ */
+
+/******************************************************************************
+ * Copyright 2013, Qualcomm Innovation Center, Inc.
+ *
+ *    Licensed under the Apache License, Version 2.0 (the "License");
+ *    you may not use this file except in compliance with the License.
+ *    You may obtain a copy of the License at
+ *
+ *        http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *    Unless required by applicable law or agreed to in writing, software
+ *    distributed under the License is distributed on an "AS IS" BASIS,
+ *    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *    See the License for the specific language governing permissions and
+ *    limitations under the License.
+ ******************************************************************************/
+
+#include <qcc/platform.h>
+
+#include <string.h>
+
+#include <qcc/Debug.h>
+#include <qcc/String.h>
+
+#include <alljoyn/MsgArg.h>
+
+#include "MarshalPlan.h"
+#include "SignatureUtils.h"
+
+#define QCC_MODULE "ALLJOYN"
+
+using namespace std;
+using namespace qcc;
+
+namespace ajn {
+
+#define PadUp(n, i)   (((n) + (i) - 1) & ~((i) - 1))
+
+MarshalPlan::MarshalPlan(const qcc::String& signature) : signature(signature), numArgs(0), valid(false)
+{
+    QStatus status = ER_OK;
+
+    if (SignatureUtils::IsValidSignature(signature.c_str())) {
+        const char* sigPtr = this->signature.c_str();
+        while ((status == ER_OK) && *sigPtr) {
+            status = Compile(sigPtr, false);
+            ++numArgs;
+        }
+        valid = (status == ER_OK);
+    }
+    if (!valid) {
+        steps.clear();
+        numArgs = 0;
+        QCC_DbgPrintf(("Unable to compile marshal plan for signature \"%s\"", signature.c_str()));
+    }
+}
+
+QStatus MarshalPlan::Compile(const char*& sigPtr, bool arrayElem)
+{
+    QStatus status = ER_OK;
+    size_t index = steps.size();
+    Step step;
+
+    memset(&step, 0, sizeof(step));
+    step.typeId = (uint16_t)(*sigPtr++);
+    step.alignment = (uint8_t)SignatureUtils::AlignmentForType((AllJoynTypeId)step.typeId);
+    steps.push_back(step);
+
+    switch (step.typeId) {
+    case ALLJOYN_BYTE:
+    case ALLJOYN_INT16:
+    case ALLJOYN_UINT16:
+    case ALLJOYN_INT32:
+    case ALLJOYN_UINT32:
+    case ALLJOYN_DOUBLE:
+    case ALLJOYN_UINT64:
+    case ALLJOYN_INT64:
+        steps[index].op = OP_BASIC;
+        steps[index].size = step.alignment;
+        break;
+
+    case ALLJOYN_BOOLEAN:
+        steps[index].op = OP_BOOLEAN;
+        break;
+
+    case ALLJOYN_STRING:
+        steps[index].op = OP_STRING;
+        break;
+
+    case ALLJOYN_OBJECT_PATH:
+        steps[index].op = OP_OBJECT_PATH;
+        break;
+
+    case ALLJOYN_SIGNATURE:
+        steps[index].op = OP_SIGNATURE;
+        break;
+
+    case ALLJOYN_HANDLE:
+        steps[index].op = OP_HANDLE;
+        break;
+
+    case ALLJOYN_VARIANT:
+        steps[index].op = OP_VARIANT;
+        break;
+
+    case ALLJOYN_ARRAY:
+        switch (*sigPtr) {
+        case ALLJOYN_BYTE:
+        case ALLJOYN_BOOLEAN:
+        case ALLJOYN_INT16:
+        case ALLJOYN_UINT16:
+        case ALLJOYN_INT32:
+        case ALLJOYN_UINT32:
+        case ALLJOYN_DOUBLE:
+        case ALLJOYN_UINT64:
+        case ALLJOYN_INT64:
+            /* Arrays of scalars are held in a single MsgArg */
+            steps[index].op = OP_SCALAR_ARRAY;
+            steps[index].typeId = (uint16_t)((*sigPtr << 8) | ALLJOYN_ARRAY);
+            steps[index].elemAlignment = (uint8_t)SignatureUtils::AlignmentForType((AllJoynTypeId)(*sigPtr));
+            steps[index].size = (*sigPtr == ALLJOYN_BOOLEAN) ? 4 : steps[index].elemAlignment;
+            ++sigPtr;
+            break;
+
+        default:
+        {
+            const char* elemSig = sigPtr;
+            steps[index].op = OP_ARRAY;
+            steps[index].elemAlignment = (uint8_t)SignatureUtils::AlignmentForType((AllJoynTypeId)(*elemSig));
+            status = Compile(sigPtr, true);
+            steps[index].elemSigOffset = (uint8_t)(elemSig - signature.c_str());
+            steps[index].elemSigLen = (uint8_t)(sigPtr - elemSig);
+        }
+        break;
+        }
+        break;
+
+    case ALLJOYN_STRUCT_OPEN:
+        steps[index].op = OP_STRUCT;
+        steps[index].typeId = ALLJOYN_STRUCT;
+        while ((status == ER_OK) && (*sigPtr != ALLJOYN_STRUCT_CLOSE)) {
+            status = *sigPtr ? Compile(sigPtr, false) : ER_BUS_BAD_SIGNATURE;
+            ++steps[index].numMembers;
+        }
+        ++sigPtr;
+        break;
+
+    case ALLJOYN_DICT_ENTRY_OPEN:
+        steps[index].op = OP_DICT_ENTRY;
+        steps[index].typeId = ALLJOYN_DICT_ENTRY;
+        status = arrayElem ? Compile(sigPtr, false) : ER_BUS_BAD_SIGNATURE;
+        if (status == ER_OK) {
+            status = Compile(sigPtr, false);
+        }
+        if ((status == ER_OK) && (*sigPtr++ != ALLJOYN_DICT_ENTRY_CLOSE)) {
+            status = ER_BUS_BAD_SIGNATURE;
+        }
+        break;
+
+    default:
+        status = ER_BUS_BAD_SIGNATURE;
+        break;
+    }
+    steps[index].next = (uint16_t)steps.size();
+    return status;
+}
+
+QStatus MarshalPlan::GetSize(const MsgArg* args, size_t numArgs, size_t& size) const
+{
+    QStatus status = ER_OK;
+    size_t sz = 0;
+
+    if (!valid || !args || (numArgs != this->numArgs)) {
+        return ER_BUS_UNEXPECTED_SIGNATURE;
+    }
+    size_t index = 0;
+    for (size_t i = 0; (status == ER_OK) && (i < numArgs); ++i) {
+        status = SizeValue(index, &args[i], sz);
+        index = steps[index].next;
+    }
+    if (status == ER_OK) {
+        size = sz;
+    }
+    return status;
+}
+
+QStatus MarshalPlan::SizeValue(size_t index, const MsgArg* arg, size_t& sz) const
+{
+    QStatus status = ER_OK;
+    const Step& step = steps[index];
+
+    if (!arg || (arg->typeId != step.typeId)) {
+        return ER_BUS_UNEXPECTED_SIGNATURE;
+    }
+    sz = PadUp(sz, step.alignment);
+
+    switch (step.op) {
+    case OP_BASIC:
+        sz += step.size;
+        break;
+
+    case OP_BOOLEAN:
+    case OP_HANDLE:
+        sz += 4;
+        break;
+
+    case OP_STRING:
+    case OP_OBJECT_PATH:
+        sz += 4 + arg->v_string.len + 1;
+        break;
+
+    case OP_SIGNATURE:
+        sz += 1 + arg->v_signature.len + 1;
+        break;
+
+    case OP_VARIANT:
+        /* The type of a variant is only known at runtime */
+        if (!arg->v_variant.val) {
+            return ER_BUS_UNEXPECTED_SIGNATURE;
+        }
+        sz = SignatureUtils::GetSize(arg, 1, sz);
+        break;
+
+    case OP_SCALAR_ARRAY:
+        sz = PadUp(sz + 4, step.elemAlignment) + step.size * arg->v_scalarArray.numElements;
+        break;
+
+    case OP_ARRAY:
+    {
+        const char* elemSig = arg->v_array.GetElemSig();
+        if (!elemSig || (strlen(elemSig) != step.elemSigLen) || (memcmp(elemSig, signature.c_str() + step.elemSigOffset, step.elemSigLen) != 0)) {
+            return ER_BUS_UNEXPECTED_SIGNATURE;
+        }
+        size_t numElements = arg->v_array.GetNumElements();
+        const MsgArg* elements = arg->v_array.GetElements();
+        if (numElements && !elements) {
+            return ER_BUS_UNEXPECTED_SIGNATURE;
+        }
+        sz = PadUp(sz + 4, step.elemAlignment);
+        for (size_t i = 0; (status == ER_OK) && (i < numElements); ++i) {
+            status = SizeValue(index + 1, &elements[i], sz);
+        }
+    }
+    break;
+
+    case OP_STRUCT:
+    {
+        if ((arg->v_struct.numMembers != step.numMembers) || !arg->v_struct.members) {
+            return ER_BUS_UNEXPECTED_SIGNATURE;
+        }
+        size_t member = index + 1;
+        for (size_t i = 0; (status == ER_OK) && (i < step.numMembers); ++i) {
+            status = SizeValue(member, &arg->v_struct.members[i], sz);
+            member = steps[member].next;
+        }
+    }
+    break;
+
+    case OP_DICT_ENTRY:
+        status = SizeValue(index + 1, arg->v_dictEntry.key, sz);
+        if (status == ER_OK) {
+            status = SizeValue(steps[index + 1].next, arg->v_dictEntry.val, sz);
+        }
+        break;
+
+    default:
+        status = ER_BUS_UNEXPECTED_SIGNATURE;
+        break;
+    }
+    return status;
+}
+
+}
@@ -0,0 +1,139 @@
+#ifndef _ALLJOYN_MARSHALPLAN_H
+#define _ALLJOYN_MARSHALPLAN_H
+/**
+ * @file
+ * This file defines a class for compiling a signature into a plan for marshaling message args.
+ */
+
+/******************************************************************************
+ * Copyright 2013, Qualcomm Innovation Center, Inc.
+ *
+ *    Licensed under the Apache License, Version 2.0 (the "License");
+ *    you may not use this file except in compliance with the License.
+ *    You may obtain a copy of the License at
+ *
+ *        http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *    Unless required by applicable law or agreed to in writing, software
+ *    distributed under the License is distributed on an "AS IS" BASIS,
+ *    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *    See the License for the specific language governing permissions and
+ *    limitations under the License.
+ ******************************************************************************/
+
+#ifndef __cplusplus
+#error Only include MarshalPlan.h in C++ code.
+#endif
+
+#include <qcc/platform.h>
+#include <qcc/String.h>
+
+#include <vector>
+
+#include <alljoyn/MsgArg.h>
+
+#include <alljoyn/Status.h>
+
+namespace ajn {
+
+/**
+ * A marshal plan is a signature compiled into a flat sequence of steps, one step per type in the
+ * signature. Each step records the operation used to marshal the value, the alignment, and the
+ * type id the MsgArg must have, so marshaling args with a plan does not need to interpret type
+ * codes or compute alignments. A plan never changes once it has been compiled so it can be used
+ * concurrently from several threads.
+ */
+class MarshalPlan {
+  public:
+
+    /**
+     * Operations for marshaling a value
+     */
+    enum OpCode {
+        OP_BASIC,         ///< Fixed size integer or double value
+        OP_BOOLEAN,       ///< Boolean value
+        OP_STRING,        ///< String value
+        OP_OBJECT_PATH,   ///< Object path value
+        OP_SIGNATURE,     ///< Signature value
+        OP_HANDLE,        ///< Socket handle
+        OP_VARIANT,       ///< Variant, the value is marshaled by the generic marshaler
+        OP_SCALAR_ARRAY,  ///< Array of fixed size values copied as a block
+        OP_ARRAY,         ///< Array of containers, strings or variants, the length is patched in
+        OP_STRUCT,        ///< Struct, the members follow this step
+        OP_DICT_ENTRY     ///< Dictionary entry, the key and value follow this step
+    };
+
+    /**
+     * A single step in a marshal plan
+     */
+    struct Step {
+        uint8_t op;             ///< The operation for this step
+        uint8_t alignment;      ///< Wire alignment of the value
+        uint8_t size;           ///< Size of a basic value or of a scalar array element
+        uint8_t elemAlignment;  ///< Wire alignment of the array elements
+        uint16_t typeId;        ///< The type id the MsgArg for this step must have
+        uint16_t next;          ///< Index of the step following this complete type
+        uint8_t numMembers;     ///< Number of struct members
+        uint8_t elemSigOffset;  ///< Offset of the array element signature in the plan signature
+        uint8_t elemSigLen;     ///< Length of the array element signature
+    };
+
+    /**
+     * Compile a signature into a marshal plan
+     *
+     * @param signature  The signature to compile.
+     */
+    MarshalPlan(const qcc::String& signature);
+
+    /**
+     * Check if the signature was compiled.
+     *
+     * @return  true if the signature was valid and has been compiled.
+     */
+    bool IsValid() const { return valid; }
+
+    /**
+     * Get the signature this plan was compiled from.
+     *
+     * @return  The signature.
+     */
+    const qcc::String& GetSignature() const { return signature; }
+
+    /**
+     * Get a step.
+     *
+     * @param index  The index of the step, the first top-level arg is at index 0.
+     *
+     * @return  The step.
+     */
+    const Step& GetStep(size_t index) const { return steps[index]; }
+
+    /**
+     * Check that an array of MsgArgs have the types required by this plan and compute the size
+     * of the marshaled args. If the args pass this check they have exactly the signature the plan
+     * was compiled from.
+     *
+     * @param args     The args to check.
+     * @param numArgs  The number of args.
+     * @param size     Returns the marshaled size of the args.
+     *
+     * @return
+     *      - #ER_OK if the args match the plan.
+     *      - #ER_BUS_UNEXPECTED_SIGNATURE if they don't.
+     */
+    QStatus GetSize(const MsgArg* args, size_t numArgs, size_t& size) const;
+
+  private:
+
+    QStatus Compile(const char*& sigPtr, bool arrayElem);
+    QStatus SizeValue(size_t index, const MsgArg* arg, size_t& sz) const;
+
+    qcc::String signature;    ///< The signature this plan was compiled from
+    std::vector<Step> steps;  ///< The steps of the plan
+    size_t numArgs;           ///< Number of complete types in the signature
+    bool valid;               ///< True if the signature was compiled
+};
+
+}
+
+#endif
@@ -33,6 +33,7 @@
 #include <qcc/time.h>
 #include <qcc/Util.h>
 #include <qcc/Debug.h>
+#include <qcc/atomic.h>
 
 #include <alljoyn/Message.h>
 #include <alljoyn/BusAttachment.h>
@@ -53,6 +54,23 @@ namespace ajn {
 
 char _Message::outEndian = _Message::myEndian;
 
+struct _Message::WireBuffer {
+    int32_t refs;     /**< Number of messages and write cursors using this buffer */
+    size_t size;      /**< Usable size of the buffer */
+    uint64_t* data;   /**< 8 byte aligned start of the buffer */
+
+    static WireBuffer* Alloc(size_t size)
+    {
+        /* The buffer follows the WireBuffer in the same allocation */
+        uint8_t* mem = new uint8_t[sizeof(WireBuffer) + size + 7];
+        WireBuffer* buf = reinterpret_cast<WireBuffer*>(mem);
+        buf->refs = 1;
+        buf->size = size;
+        buf->data = (uint64_t*)((uintptr_t)(mem + sizeof(WireBuffer) + 7) & ~7); /* Align to 8 byte boundary */
+        return buf;
+    }
+};
+
 qcc::String _Message::ToString() const
 {
     return ToString(msgArgs, numMsgArgs);
@@ -293,6 +311,9 @@ QStatus _Message::GetArgs(const char* signature, ...)
     if (sigLen == 0) {
         return ER_BAD_ARG_1;
     }
+    if (lazyArgs) {
+        DecodeLazyArgs();
+    }
     va_list argp;
     va_start(argp, signature);
     QStatus status = MsgArg::VParseArgs(signature, sigLen, msgArgs, numMsgArgs, &argp);
@@ -303,18 +324,20 @@ QStatus _Message::GetArgs(const char* signature, ...)
 _Message::_Message(BusAttachment& bus) :
     bus(&bus),
     endianSwap(false),
-    _msgBuf(NULL),
+    wireBuf(NULL),
     msgBuf(NULL),
+    ownsSlot(false),
     msgArgs(NULL),
     numMsgArgs(0),
+    lazyArgs(NULL),
+    numLazyArgs(0),
     ttl(0),
+    replyPlan(NULL),
     handles(NULL),
     numHandles(0),
     encrypt(false),
     readState(MESSAGE_NEW),
-    countRead(0),
-    writeState(MESSAGE_NEW),
-    countWrite(0)
+    countRead(0)
 {
     msgHeader.msgType = MESSAGE_INVALID;
     msgHeader.endian = myEndian;
@@ -322,8 +345,8 @@ _Message::_Message(BusAttachment& bus) :
 
 _Message::~_Message(void)
 {
-    delete [] _msgBuf;
-    delete [] msgArgs;
+    ReleaseBuffer();
+    ClearArgs();
     while (numHandles) {
         qcc::Close(handles[--numHandles]);
     }
@@ -335,36 +358,38 @@ _Message::_Message(const _Message& other) :
     endianSwap(other.endianSwap),
     msgHeader(other.msgHeader),
     numMsgArgs(other.numMsgArgs),
+    numLazyArgs(other.numLazyArgs),
     bufSize(other.bufSize),
     ttl(other.ttl),
     timestamp(other.timestamp),
     replySignature(other.replySignature),
+    replyPlan(other.replyPlan),
     authMechanism(other.authMechanism),
     rcvEndpointName(other.rcvEndpointName),
     numHandles(other.numHandles),
     encrypt(other.encrypt),
     readState(other.readState),
     countRead(other.countRead),
-    writeState(other.writeState),
-    countWrite(other.countWrite),
     hdrFields(other.hdrFields)
 {
     if (bufSize > 0) {
         assert(other.msgBuf != NULL);
-        _msgBuf = new uint8_t[bufSize + 7];
-        msgBuf = (uint64_t*)((uintptr_t)(_msgBuf + 7) & ~7);
-        bufEOD = ((uint8_t*)msgBuf) + (other.bufEOD - ((uint8_t*)other.msgBuf));
-        bufPos = ((uint8_t*)msgBuf) + (other.bufPos - ((uint8_t*)other.msgBuf));
-        bodyPtr = ((uint8_t*)msgBuf) + (other.bodyPtr - ((uint8_t*)other.msgBuf));
         /*
-         * Copy in buffer and zero fill the pad at the end of the data
+         * The wire buffer is shared with the other message, it gets copied if either message
+         * needs to modify it.
          */
-        ::memcpy(msgBuf, other.msgBuf, bufSize);
-        ::memset(bufEOD, 0, (uint8_t*)msgBuf + bufSize - bufEOD);
+        wireBuf = AcquireWireBuffer(other.wireBuf);
+        msgBuf = other.msgBuf;
+        ownsSlot = false;
+        other.ownsSlot = false;
+        bufEOD = other.bufEOD;
+        bufPos = other.bufPos;
+        bodyPtr = other.bodyPtr;
     } else {
         assert(other.msgBuf == NULL);
-        _msgBuf = NULL;
+        wireBuf = NULL;
         msgBuf = NULL;
+        ownsSlot = false;
         bufEOD = NULL;
         bufPos = NULL;
         bodyPtr = NULL;
@@ -377,6 +402,12 @@ _Message::_Message(const _Message& other) :
     } else {
         msgArgs = NULL;
     }
+    if (other.lazyArgs) {
+        lazyArgs = new uint32_t[numMsgArgs];
+        memcpy(lazyArgs, other.lazyArgs, numMsgArgs * sizeof(uint32_t));
+    } else {
+        lazyArgs = NULL;
+    }
     if (numHandles > 0) {
         handles = new qcc::SocketFd[numHandles];
         for (size_t i = 0; i < numHandles; ++i) {
@@ -397,14 +428,13 @@ QStatus _Message::ReMarshal(const char* senderName)
     /*
      * Remarshal invalidates any unmarshalled message args.
      */
-    delete [] msgArgs;
-    msgArgs = NULL;
-    numMsgArgs = 0;
+    ClearArgs();
 
     /*
-     * We delete the current buffer after we have copied the body data
+     * We release the current buffer after we have copied the body data
      */
-    uint8_t* _savBuf = _msgBuf;
+    WireBuffer* savBuf = wireBuf;
+    wireBuf = NULL;
 
     /*
      * Compute the new header sizes
@@ -415,8 +445,7 @@ QStatus _Message::ReMarshal(const char* senderName)
      * message reducing the places where we need to check for bufEOD when unmarshaling the body.
      */
     bufSize = sizeof(msgHeader) + ((((msgHeader.headerLen + 7) & ~7) + msgHeader.bodyLen + 7) & ~7) + 8;
-    _msgBuf = new uint8_t[bufSize + 7];
-    msgBuf = (uint64_t*)((uintptr_t)(_msgBuf + 7) & ~7); /* Align to 8 byte boundary */
+    AllocBuffer();
     bufPos = (uint8_t*)msgBuf;
     memcpy(bufPos, &msgHeader, sizeof(msgHeader));
     bufPos += sizeof(msgHeader);
@@ -448,10 +477,163 @@ QStatus _Message::ReMarshal(const char* senderName)
      */
     assert((size_t)(bufEOD - (uint8_t*)msgBuf) < bufSize);
     memset(bufEOD, 0, (uint8_t*)msgBuf + bufSize - bufEOD);
-    delete [] _savBuf;
+    ReleaseWireBuffer(savBuf);
+    return ER_OK;
+}
+
+_Message::WireBuffer* _Message::AcquireWireBuffer(WireBuffer* buf)
+{
+    if (buf) {
+        IncrementAndFetch(&buf->refs);
+    }
+    return buf;
+}
+
+void _Message::ReleaseWireBuffer(WireBuffer* buf)
+{
+    if (buf && (DecrementAndFetch(&buf->refs) == 0)) {
+        delete [] reinterpret_cast<uint8_t*>(buf);
+    }
+}
+
+void _Message::AllocBuffer()
+{
+    wireBuf = WireBuffer::Alloc(bufSize);
+    msgBuf = wireBuf->data;
+    ownsSlot = false;
+}
+
+void _Message::AllocBuffer(ReadBuffer& rxBuf)
+{
+    /*
+     * Pick the smallest size class for the message, large messages get their own buffer.
+     */
+    size_t cls = 0;
+    while ((cls < ReadBuffer::NUM_SLAB_CLASSES) && ((bufSize * ReadBuffer::SLAB_SLOTS) > ReadBuffer::SlabSize(cls))) {
+        ++cls;
+    }
+    if (cls == ReadBuffer::NUM_SLAB_CLASSES) {
+        AllocBuffer();
+        return;
+    }
+    size_t slabSize = ReadBuffer::SlabSize(cls);
+    WireBuffer*& slab = rxBuf.slab[cls];
+    size_t& slabUsed = rxBuf.slabUsed[cls];
+    /*
+     * Start over at the beginning of the slab when it is full and all the messages that were
+     * allocated from it have been released. If some of them are still in use they may be kept
+     * for a long time, rather than leave them pinning the full slab and start another one the
+     * message gets a buffer of its own until the slab is free again.
+     */
+    if (!slab) {
+        slab = WireBuffer::Alloc(slabSize);
+        slabUsed = 0;
+    } else if ((slabSize - slabUsed) < bufSize) {
+        if (slab->refs != 1) {
+            AllocBuffer();
+            return;
+        }
+        slabUsed = 0;
+    }
+    assert((bufSize & 7) == 0);
+    wireBuf = AcquireWireBuffer(slab);
+    msgBuf = reinterpret_cast<uint64_t*>(reinterpret_cast<uint8_t*>(slab->data) + slabUsed);
+    ownsSlot = true;
+    slabUsed += bufSize;
+}
+
+void _Message::ReleaseBuffer()
+{
+    ReleaseWireBuffer(wireBuf);
+    wireBuf = NULL;
+    msgBuf = NULL;
+    ownsSlot = false;
+}
+
+QStatus _Message::MakeBufferWritable()
+{
+    /*
+     * The other users of a slab only use their own part of it so the part of a message that
+     * owns its slot can be modified in place.
+     */
+    if (!wireBuf || (wireBuf->refs == 1) || ownsSlot) {
+        return ER_OK;
+    }
+    if (msgArgs != NULL) {
+        QStatus status = ER_BUS_NOT_ALLOWED;
+        QCC_LogError(status, ("Cannot copy a shared buffer after the message args have been unmarshaled"));
+        return status;
+    }
+    WireBuffer* shared = wireBuf;
+    uint8_t* oldBase = (uint8_t*)msgBuf;
+    uint8_t* oldEnd = oldBase + bufSize;
+
+    AllocBuffer();
+    uint8_t* newBase = (uint8_t*)msgBuf;
+    ::memcpy(newBase, oldBase, bufSize);
+    bufEOD = bufEOD ? newBase + (bufEOD - oldBase) : NULL;
+    bufPos = bufPos ? newBase + (bufPos - oldBase) : NULL;
+    bodyPtr = bodyPtr ? newBase + (bodyPtr - oldBase) : NULL;
+    /*
+     * Header fields that were marshaled or unmarshaled point into the old buffer.
+     */
+    for (size_t i = 0; i < ArraySize(hdrFields.field); ++i) {
+        MsgArg& field = hdrFields.field[i];
+        const char** str = NULL;
+        switch (field.typeId) {
+        case ALLJOYN_STRING:
+            str = &field.v_string.str;
+            break;
+
+        case ALLJOYN_OBJECT_PATH:
+            str = &field.v_objPath.str;
+            break;
+
+        case ALLJOYN_SIGNATURE:
+            str = &field.v_signature.sig;
+            break;
+
+        default:
+            break;
+        }
+        if (str && ((const uint8_t*)*str >= oldBase) && ((const uint8_t*)*str < oldEnd)) {
+            *str = (const char*)(newBase + ((const uint8_t*)*str - oldBase));
+        }
+    }
+    ReleaseWireBuffer(shared);
     return ER_OK;
 }
 
+const size_t _Message::ReadBuffer::RING_SIZE;
+const size_t _Message::ReadBuffer::NUM_SLAB_CLASSES;
+const size_t _Message::ReadBuffer::SLAB_SLOTS;
+
+_Message::ReadBuffer::ReadBuffer() : ring(new uint8_t[RING_SIZE]), head(0), tail(0)
+{
+    for (size_t i = 0; i < NUM_SLAB_CLASSES; ++i) {
+        slab[i] = NULL;
+        slabUsed[i] = 0;
+    }
+}
+
+_Message::ReadBuffer::~ReadBuffer()
+{
+    for (size_t i = 0; i < NUM_SLAB_CLASSES; ++i) {
+        _Message::ReleaseWireBuffer(slab[i]);
+    }
+    delete [] ring;
+}
+
+void _Message::WriteCursor::Reset()
+{
+    _Message::ReleaseWireBuffer(buf);
+    buf = NULL;
+    writeState = MESSAGE_NEW;
+    writePtr = NULL;
+    countWrite = 0;
+    numWrites = 0;
+}
+
 bool _Message::IsExpired(uint32_t* tillExpireMS) const
 {
     uint32_t expires;
@@ -480,6 +662,23 @@ bool _Message::IsExpired(uint32_t* tillExpireMS) const
     return expires == 0;
 }
 
+/*
+ * Free the unmarshaled message args
+ */
+void _Message::ClearArgs()
+{
+    if (argArena.IsActive()) {
+        argArena.Release();
+    } else {
+        delete [] msgArgs;
+    }
+    delete [] lazyArgs;
+    lazyArgs = NULL;
+    numLazyArgs = 0;
+    msgArgs = NULL;
+    numMsgArgs = 0;
+}
+
 /*
  * Clear the header fields - this also frees any data allocated to them.
  */
@@ -489,9 +688,7 @@ void _Message::ClearHeader()
         for (uint32_t fieldId = ALLJOYN_HDR_FIELD_INVALID; fieldId < ArraySize(hdrFields.field); fieldId++) {
             hdrFields.field[fieldId].Clear();
         }
-        delete [] msgArgs;
-        msgArgs = NULL;
-        numMsgArgs = 0;
+        ClearArgs();
         ttl = 0;
         msgHeader.msgType = MESSAGE_INVALID;
         while (numHandles) {
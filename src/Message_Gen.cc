@@ -42,6 +42,8 @@
 #include "AllJoynCrypto.h"
 #include "AllJoynPeerObj.h"
 #include "SignatureUtils.h"
+#include "MarshalPlan.h"
+#include "ArrayKernels.h"
 #include "BusInternal.h"
 
 #define QCC_MODULE "ALLJOYN"
@@ -114,6 +116,34 @@ static inline QStatus CheckedArraySize(size_t sz, uint32_t& len)
     }
 }
 
+QStatus _Message::MarshalHandle(qcc::SocketFd fd)
+{
+    uint32_t index = 0;
+    /* Check if handle is already listed */
+    while ((index < numHandles) && (handles[index] != fd)) {
+        ++index;
+    }
+    /* If handle was not found expand handle array */
+    if (index == numHandles) {
+        qcc::SocketFd* h = new qcc::SocketFd[numHandles + 1];
+        memcpy(h, handles, numHandles * sizeof(qcc::SocketFd));
+        delete [] handles;
+        handles = h;
+        QStatus status = qcc::SocketDup(fd, handles[numHandles++]);
+        if (status != ER_OK) {
+            --numHandles;
+            return status;
+        }
+    }
+    /* Marshal the index of the handle */
+    if (endianSwap) {
+        MarshalReversed(&index, 4);
+    } else {
+        Marshal4(index);
+    }
+    return ER_OK;
+}
+
 QStatus _Message::MarshalArgs(const MsgArg* arg, size_t numArgs)
 {
     QStatus status = ER_OK;
@@ -233,9 +263,8 @@ QStatus _Message::MarshalArgs(const MsgArg* arg, size_t numArgs)
             }
             if (endianSwap) {
                 MarshalReversed(&len, 4);
-                for (size_t i = 0; i < arg->v_scalarArray.numElements; i++) {
-                    MarshalReversed(&arg->v_scalarArray.v_uint32[i], 4);
-                }
+                SwapArray32(bufPos, arg->v_scalarArray.v_uint32, arg->v_scalarArray.numElements);
+                bufPos += len;
             } else {
                 Marshal4(len);
                 MarshalBytes(arg->v_scalarArray.v_uint32, len);
@@ -257,9 +286,8 @@ QStatus _Message::MarshalArgs(const MsgArg* arg, size_t numArgs)
                 if (endianSwap) {
                     MarshalReversed(&len, 4);
                     MarshalPad(8);
-                    for (size_t i = 0; i < arg->v_scalarArray.numElements; i++) {
-                        MarshalReversed(&arg->v_scalarArray.v_uint64[i], 8);
-                    }
+                    SwapArray64(bufPos, arg->v_scalarArray.v_uint64, arg->v_scalarArray.numElements);
+                    bufPos += len;
                 } else {
                     Marshal4(len);
                     MarshalPad(8);
@@ -284,9 +312,8 @@ QStatus _Message::MarshalArgs(const MsgArg* arg, size_t numArgs)
             }
             if (endianSwap) {
                 MarshalReversed(&len, 4);
-                for (size_t i = 0; i < arg->v_scalarArray.numElements; i++) {
-                    MarshalReversed(&arg->v_scalarArray.v_uint16[i], 2);
-                }
+                SwapArray16(bufPos, arg->v_scalarArray.v_uint16, arg->v_scalarArray.numElements);
+                bufPos += len;
             } else {
                 Marshal4(len);
                 MarshalBytes(arg->v_scalarArray.v_uint16, len);
@@ -409,41 +436,232 @@ QStatus _Message::MarshalArgs(const MsgArg* arg, size_t numArgs)
             break;
 
         case ALLJOYN_HANDLE:
-        {
-            uint32_t index = 0;
-            /* Check if handle is already listed */
-            while ((index < numHandles) && (handles[index] != arg->v_handle.fd)) {
-                ++index;
+            status = MarshalHandle(arg->v_handle.fd);
+            break;
+
+        default:
+            status = ER_BUS_BAD_VALUE_TYPE;
+            break;
+        }
+        if (status != ER_OK) {
+            break;
+        }
+        ++arg;
+    }
+    return status;
+}
+
+/*
+ * Marshal args that have already been checked against a marshal plan by MarshalPlan::GetSize()
+ */
+QStatus _Message::MarshalPlanArgs(const MarshalPlan& plan, const MsgArg* args, size_t numArgs)
+{
+    QStatus status = ER_OK;
+    size_t step = 0;
+    for (size_t i = 0; (status == ER_OK) && (i < numArgs); ++i) {
+        status = MarshalPlanValue(plan, step, &args[i]);
+        step = plan.GetStep(step).next;
+    }
+    return status;
+}
+
+QStatus _Message::MarshalPlanValue(const MarshalPlan& plan, size_t index, const MsgArg* arg)
+{
+    QStatus status = ER_OK;
+    const MarshalPlan::Step& step = plan.GetStep(index);
+    uint32_t len;
+
+    MarshalPad(step.alignment);
+
+    switch (step.op) {
+    case MarshalPlan::OP_BASIC:
+        switch (step.size) {
+        case 1:
+            Marshal1(arg->v_byte);
+            break;
+
+        case 2:
+            if (endianSwap) {
+                MarshalReversed(&arg->v_uint16, 2);
+            } else {
+                Marshal2(arg->v_uint16);
             }
-            /* If handle was not found expand handle array */
-            if (index == numHandles) {
-                qcc::SocketFd* h = new qcc::SocketFd[numHandles + 1];
-                memcpy(h, handles, numHandles * sizeof(qcc::SocketFd));
-                delete [] handles;
-                handles = h;
-                status = qcc::SocketDup(arg->v_handle.fd, handles[numHandles++]);
-                if (status != ER_OK) {
-                    --numHandles;
-                    break;
-                }
+            break;
+
+        case 4:
+            if (endianSwap) {
+                MarshalReversed(&arg->v_uint32, 4);
+            } else {
+                Marshal4(arg->v_uint32);
             }
-            /* Marshal the index of the handle */
+            break;
+
+        default:
             if (endianSwap) {
-                MarshalReversed(&index, 4);
+                MarshalReversed(&arg->v_uint64, 8);
             } else {
-                Marshal4(index);
+                Marshal8(arg->v_uint64);
             }
+            break;
         }
         break;
 
-        default:
-            status = ER_BUS_BAD_VALUE_TYPE;
+    case MarshalPlan::OP_BOOLEAN:
+        len = arg->v_bool ? 1 : 0;
+        if (endianSwap) {
+            MarshalReversed(&len, 4);
+        } else {
+            Marshal4(len);
+        }
+        break;
+
+    case MarshalPlan::OP_OBJECT_PATH:
+        if (!arg->v_objPath.str || (arg->v_objPath.len == 0)) {
+            status = ER_BUS_BAD_OBJ_PATH;
             break;
         }
+
+    // FALLTHROUGH
+    case MarshalPlan::OP_STRING:
+        if (arg->v_string.str) {
+            if (arg->v_string.str[arg->v_string.len]) {
+                status = ER_BUS_NOT_NUL_TERMINATED;
+                break;
+            }
+            if (endianSwap) {
+                MarshalReversed(&arg->v_string.len, 4);
+            } else {
+                Marshal4(arg->v_string.len);
+            }
+            MarshalBytes((void*)arg->v_string.str, arg->v_string.len + 1);
+        } else {
+            Marshal4(0);
+            Marshal1(0);
+        }
+        break;
+
+    case MarshalPlan::OP_SIGNATURE:
+        if (arg->v_signature.sig) {
+            if (arg->v_signature.sig[arg->v_signature.len]) {
+                status = ER_BUS_NOT_NUL_TERMINATED;
+                break;
+            }
+            Marshal1(arg->v_signature.len);
+            MarshalBytes((void*)arg->v_signature.sig, arg->v_signature.len + 1);
+        } else {
+            Marshal1(0);
+            Marshal1(0);
+        }
+        break;
+
+    case MarshalPlan::OP_HANDLE:
+        status = MarshalHandle(arg->v_handle.fd);
+        break;
+
+    case MarshalPlan::OP_VARIANT:
+        status = MarshalArgs(arg, 1);
+        break;
+
+    case MarshalPlan::OP_SCALAR_ARRAY:
+    {
+        size_t numElements = arg->v_scalarArray.numElements;
+        status = CheckedArraySize(step.size * numElements, len);
         if (status != ER_OK) {
             break;
         }
-        ++arg;
+        if (len && !arg->v_scalarArray.v_byte) {
+            status = ER_BUS_BAD_VALUE;
+            break;
+        }
+        if (endianSwap) {
+            MarshalReversed(&len, 4);
+        } else {
+            Marshal4(len);
+        }
+        /* Even empty arrays are padded to the element type alignment boundary */
+        if (step.elemAlignment == 8) {
+            MarshalPad(8);
+        }
+        if (step.typeId == ALLJOYN_BOOLEAN_ARRAY) {
+            for (size_t i = 0; i < numElements; i++) {
+                uint32_t b = arg->v_scalarArray.v_bool[i] ? 1 : 0;
+                if (endianSwap) {
+                    MarshalReversed(&b, 4);
+                } else {
+                    Marshal4(b);
+                }
+            }
+        } else if (endianSwap && (step.size > 1)) {
+            switch (step.size) {
+            case 2:
+                SwapArray16(bufPos, arg->v_scalarArray.v_uint16, numElements);
+                break;
+
+            case 4:
+                SwapArray32(bufPos, arg->v_scalarArray.v_uint32, numElements);
+                break;
+
+            default:
+                SwapArray64(bufPos, arg->v_scalarArray.v_uint64, numElements);
+                break;
+            }
+            bufPos += len;
+        } else if (len) {
+            MarshalBytes(arg->v_scalarArray.v_byte, len);
+        }
+    }
+    break;
+
+    case MarshalPlan::OP_ARRAY:
+    {
+        uint8_t* lenPos = bufPos;
+        bufPos += 4;
+        /* Length does not include padding for first element, so pad to 8 byte boundary if required. */
+        if (step.elemAlignment == 8) {
+            MarshalPad(8);
+        }
+        uint8_t* elemPos = bufPos;
+        const MsgArg* elements = arg->v_array.GetElements();
+        for (size_t i = 0; (status == ER_OK) && (i < arg->v_array.GetNumElements()); ++i) {
+            status = MarshalPlanValue(plan, index + 1, &elements[i]);
+        }
+        if (status == ER_OK) {
+            status = CheckedArraySize(bufPos - elemPos, len);
+        }
+        if (status == ER_OK) {
+            /* Patch in length */
+            uint8_t* tmpPos = bufPos;
+            bufPos = lenPos;
+            if (endianSwap) {
+                MarshalReversed(&len, 4);
+            } else {
+                Marshal4(len);
+            }
+            bufPos = tmpPos;
+        }
+    }
+    break;
+
+    case MarshalPlan::OP_STRUCT:
+    {
+        size_t member = index + 1;
+        for (size_t i = 0; (status == ER_OK) && (i < step.numMembers); ++i) {
+            status = MarshalPlanValue(plan, member, &arg->v_struct.members[i]);
+            member = plan.GetStep(member).next;
+        }
+    }
+    break;
+
+    case MarshalPlan::OP_DICT_ENTRY:
+        status = MarshalPlanValue(plan, index + 1, arg->v_dictEntry.key);
+        if (status == ER_OK) {
+            status = MarshalPlanValue(plan, plan.GetStep(index + 1).next, arg->v_dictEntry.val);
+        }
+        break;
+
+    default:
+        status = ER_BUS_BAD_VALUE_TYPE;
+        break;
     }
     return status;
 }
@@ -517,76 +735,96 @@ QStatus _Message::Deliver(RemoteEndpoint& endpoint)
     return status;
 }
 
-QStatus _Message::DeliverNonBlocking(RemoteEndpoint& endpoint)
+QStatus _Message::BeginDelivery(RemoteEndpoint& endpoint, WriteCursor& cursor)
 {
-    size_t pushed;
-    QStatus status = ER_OK;
-    Sink& sink = endpoint->GetSink();
-
-    switch (writeState) {
-    case MESSAGE_NEW:
-        writePtr = reinterpret_cast<uint8_t*>(msgBuf);
-        countWrite = bufEOD - writePtr;
-        pushed = 0;
+    QStatus status;
 
-        if (countWrite == 0) {
-            status = ER_BUS_EMPTY_MESSAGE;
-            QCC_LogError(status, ("Message is empty"));
-            return status;
-        }
-        /*
-         * Handles can only be passed if that feature was negotiated.
-         */
-        if (handles && !endpoint->GetFeatures().handlePassing) {
-            status = ER_BUS_HANDLES_NOT_ENABLED;
-            QCC_LogError(status, ("Handle passing was not negotiated on this connection"));
-            return status;
-        }
+    assert(cursor.writeState == MESSAGE_NEW);
+    if ((msgBuf == NULL) || (bufEOD == reinterpret_cast<uint8_t*>(msgBuf))) {
+        status = ER_BUS_EMPTY_MESSAGE;
+        QCC_LogError(status, ("Message is empty"));
+        return status;
+    }
+    /*
+     * Handles can only be passed if that feature was negotiated.
+     */
+    if (handles && !endpoint->GetFeatures().handlePassing) {
+        status = ER_BUS_HANDLES_NOT_ENABLED;
+        QCC_LogError(status, ("Handle passing was not negotiated on this connection"));
+        return status;
+    }
+    /*
+     * If the message has a TTL, check if it has expired
+     */
+    if (ttl && IsExpired()) {
+        QCC_DbgHLPrintf(("TTL has expired - discarding message %s", Description().c_str()));
+        cursor.writeState = MESSAGE_COMPLETE;
+        return ER_OK;
+    }
+    /*
+     * Check if message needs to be encrypted
+     */
+    if (encrypt) {
+        status = EncryptMessage();
         /*
-         * If the message has a TTL, check if it has expired
+         * Delivery is retried when the authentication completes
          */
-        if (ttl && IsExpired()) {
-            QCC_DbgHLPrintf(("TTL has expired - discarding message %s", Description().c_str()));
+        if (status == ER_BUS_AUTHENTICATION_PENDING) {
+            cursor.writeState = MESSAGE_COMPLETE;
             return ER_OK;
         }
-        /*
-         * Check if message needs to be encrypted
-         */
-        if (encrypt) {
-            status = EncryptMessage();
-            /*
-             * Delivery is retried when the authentication completes
-             */
-            if (status == ER_BUS_AUTHENTICATION_PENDING) {
-                return ER_OK;
-            }
+    }
+    /*
+     * The cursor holds a reference to the wire buffer so the bytes being written cannot
+     * change even if the message itself is modified while the write is in progress.
+     */
+    cursor.buf = AcquireWireBuffer(wireBuf);
+    ownsSlot = false;
+    cursor.writePtr = reinterpret_cast<uint8_t*>(msgBuf);
+    cursor.countWrite = bufEOD - cursor.writePtr;
+    cursor.writeState = MESSAGE_HEADERFIELDS;
+    return ER_OK;
+}
+
+QStatus _Message::DeliverNonBlocking(RemoteEndpoint& endpoint, WriteCursor& cursor)
+{
+    size_t pushed = 0;
+    QStatus status = ER_OK;
+    Sink& sink = endpoint->GetSink();
+
+    switch (cursor.writeState) {
+    case MESSAGE_NEW:
+        status = BeginDelivery(endpoint, cursor);
+        if ((status != ER_OK) || (cursor.writeState == MESSAGE_COMPLETE)) {
+            return status;
         }
-        writeState = MESSAGE_HEADERFIELDS;
 
     case MESSAGE_HEADERFIELDS:
         if (handles) {
-            status = sink.PushBytesAndFds(writePtr, countWrite, pushed, handles, numHandles, endpoint->GetProcessId());
+            status = sink.PushBytesAndFds(cursor.writePtr, cursor.countWrite, pushed, handles, numHandles, endpoint->GetProcessId());
         } else {
-            status = sink.PushBytes(writePtr, countWrite, pushed, (msgHeader.flags & ALLJOYN_FLAG_SESSIONLESS) ? (ttl * 1000) : ttl);
+            status = sink.PushBytes(cursor.writePtr, cursor.countWrite, pushed, (msgHeader.flags & ALLJOYN_FLAG_SESSIONLESS) ? (ttl * 1000) : ttl);
         }
+        ++cursor.numWrites;
 
         if (status == ER_OK) {
-            countWrite -= pushed;
-            writePtr += pushed;
-            writeState = MESSAGE_HEADER_BODY;
+            cursor.countWrite -= pushed;
+            cursor.writePtr += pushed;
+            cursor.writeState = MESSAGE_HEADER_BODY;
         } else break;
 
     case MESSAGE_HEADER_BODY:
         status = ER_OK;
-        while (status == ER_OK && countWrite > 0) {
-            status = sink.PushBytes(writePtr, countWrite, pushed);
+        while (status == ER_OK && cursor.countWrite > 0) {
+            status = sink.PushBytes(cursor.writePtr, cursor.countWrite, pushed);
+            ++cursor.numWrites;
             if (status == ER_OK) {
-                countWrite -= pushed;
-                writePtr += pushed;
+                cursor.countWrite -= pushed;
+                cursor.writePtr += pushed;
             }
         }
-        if (countWrite == 0) {
-            writeState = MESSAGE_COMPLETE;
+        if (cursor.countWrite == 0) {
+            cursor.writeState = MESSAGE_COMPLETE;
         }
         break;
 
@@ -734,9 +972,9 @@ size_t _Message::ComputeHeaderLen()
 
 QStatus _Message::EncryptMessage()
 {
-    KeyBlob key;
-    PeerState peerState = bus->GetInternal().GetPeerStateTable()->GetPeerState(GetDestination());
-    QStatus status = peerState->GetKey(key, PEER_SESSION_KEY);
+    CipherContext cipher;
+    PeerState peerState = bus->GetInternal().GetPeerStateTable()->GetPeerState(GetDestination(), false);
+    QStatus status = peerState->GetCipher(cipher, PEER_SESSION_KEY);
 
     if (status == ER_OK) {
         /*
@@ -750,13 +988,19 @@ QStatus _Message::EncryptMessage()
     if (status == ER_OK) {
         size_t argsLen = msgHeader.bodyLen - ajn::Crypto::MACLength;
         size_t hdrLen = ROUNDUP8(sizeof(msgHeader) + msgHeader.headerLen);
-        status = ajn::Crypto::Encrypt(*this, key, (uint8_t*)msgBuf, hdrLen, argsLen);
+        /*
+         * Encryption is done in place so the wire buffer must not be shared
+         */
+        status = MakeBufferWritable();
+        if (status == ER_OK) {
+            status = ajn::Crypto::Encrypt(*this, cipher, (uint8_t*)msgBuf, hdrLen, argsLen);
+        }
         if (status == ER_OK) {
             QCC_DbgHLPrintf(("EncryptMessage: %s", Description().c_str()));
             /*
              * Save the authentication mechanism that was used.
              */
-            authMechanism = key.GetTag();
+            authMechanism = cipher->GetKey().GetTag();
             encrypt = false;
             assert(msgHeader.bodyLen == argsLen);
         }
@@ -783,13 +1027,26 @@ QStatus _Message::MarshalMessage(const qcc::String& expectedSignature,
                                  const MsgArg* args,
                                  uint8_t numArgs,
                                  uint8_t flags,
-                                 uint32_t sessionId)
+                                 uint32_t sessionId,
+                                 const MarshalPlan* plan)
 {
     char signature[256];
     QStatus status = ER_OK;
-    size_t argsLen = (numArgs == 0) ? 0 : SignatureUtils::GetSize(args, numArgs);
+    size_t argsLen = 0;
     size_t hdrLen = 0;
 
+    /*
+     * A marshal plan compiled for the expected signature checks the arg types and computes the
+     * body size in a single pass. If the args don't fit the plan they are marshaled the generic
+     * way which reports why they are wrong.
+     */
+    if (plan && ((numArgs == 0) || (plan->GetSignature() != expectedSignature) || (plan->GetSize(args, numArgs, argsLen) != ER_OK))) {
+        plan = NULL;
+    }
+    if (!plan && (numArgs > 0)) {
+        argsLen = SignatureUtils::GetSize(args, numArgs);
+    }
+
     if (!bus->IsStarted()) {
         return ER_BUS_BUS_NOT_STARTED;
     }
@@ -818,7 +1075,7 @@ QStatus _Message::MarshalMessage(const qcc::String& expectedSignature,
      * Keep the old message buffer around until we are done because some of the strings we are
      * marshaling may point into the old message.
      */
-    uint8_t* _oldMsgBuf = _msgBuf;
+    WireBuffer* oldWireBuf = wireBuf;
     /*
      * Clear out stale message data
      */
@@ -826,7 +1083,7 @@ QStatus _Message::MarshalMessage(const qcc::String& expectedSignature,
     bufPos = NULL;
     bufEOD = NULL;
     msgBuf = NULL;
-    _msgBuf = NULL;
+    wireBuf = NULL;
     /*
      * There should be a mapping for every field type
      */
@@ -860,9 +1117,15 @@ QStatus _Message::MarshalMessage(const qcc::String& expectedSignature,
     hdrFields.field[ALLJOYN_HDR_FIELD_SIGNATURE].Clear();
     if (numArgs > 0) {
         size_t sigLen = 0;
-        status = SignatureUtils::MakeSignature(args, numArgs, signature, sigLen);
-        if (status != ER_OK) {
-            goto ExitMarshalMessage;
+        if (plan) {
+            /* Args that fit the plan have the plan's signature */
+            sigLen = expectedSignature.size();
+            memcpy(signature, expectedSignature.c_str(), sigLen + 1);
+        } else {
+            status = SignatureUtils::MakeSignature(args, numArgs, signature, sigLen);
+            if (status != ER_OK) {
+                goto ExitMarshalMessage;
+            }
         }
         if (sigLen > 0) {
             hdrFields.field[ALLJOYN_HDR_FIELD_SIGNATURE].typeId = ALLJOYN_SIGNATURE;
@@ -911,8 +1174,7 @@ QStatus _Message::MarshalMessage(const qcc::String& expectedSignature,
      * Allocate buffer for entire message.
      */
     bufSize = (hdrLen + msgHeader.bodyLen + 7);
-    _msgBuf = new uint8_t[bufSize + 7];
-    msgBuf = (uint64_t*)((uintptr_t)(_msgBuf + 7) & ~7); /* Align to 8 byte boundary */
+    AllocBuffer();
     /*
      * Initialize the buffer and copy in the message header
      */
@@ -951,7 +1213,7 @@ QStatus _Message::MarshalMessage(const qcc::String& expectedSignature,
      * Marshal the message body
      */
     bodyPtr = bufPos;
-    status = MarshalArgs(args, numArgs);
+    status = plan ? MarshalPlanArgs(*plan, args, numArgs) : MarshalArgs(args, numArgs);
     if (status != ER_OK) {
         goto ExitMarshalMessage;
     }
@@ -982,15 +1244,13 @@ ExitMarshalMessage:
     /*
      * Don't need the old message buffer any more
      */
-    delete [] _oldMsgBuf;
+    ReleaseWireBuffer(oldWireBuf);
 
     if (status == ER_OK) {
         QCC_DbgHLPrintf(("MarshalMessage: %d+%d %s %s", hdrLen, msgHeader.bodyLen, Description().c_str(), encrypt ? " (encrypted)" : ""));
     } else {
         QCC_LogError(status, ("MarshalMessage: %s", Description().c_str()));
-        msgBuf = NULL;
-        delete [] _msgBuf;
-        _msgBuf = NULL;
+        ReleaseBuffer();
         bodyPtr = NULL;
         bufPos = NULL;
         bufEOD = NULL;
@@ -1084,7 +1344,8 @@ QStatus _Message::CallMsg(const qcc::String& signature,
                           const qcc::String& methodName,
                           const MsgArg* args,
                           size_t numArgs,
-                          uint8_t flags)
+                          uint8_t flags,
+                          const MarshalPlan* plan)
 {
     QStatus status;
 
@@ -1136,7 +1397,7 @@ QStatus _Message::CallMsg(const qcc::String& signature,
     /*
      * Build method call message
      */
-    status = MarshalMessage(signature, destination, MESSAGE_METHOD_CALL, args, numArgs, flags, sessionId);
+    status = MarshalMessage(signature, destination, MESSAGE_METHOD_CALL, args, numArgs, flags, sessionId, plan);
 
 ExitCallMsg:
     return status;
@@ -1152,7 +1413,8 @@ QStatus _Message::SignalMsg(const qcc::String& signature,
                             const MsgArg* args,
                             size_t numArgs,
                             uint8_t flags,
-                            uint16_t timeToLive)
+                            uint16_t timeToLive,
+                            const MarshalPlan* plan)
 {
     QStatus status;
 
@@ -1211,7 +1473,7 @@ QStatus _Message::SignalMsg(const qcc::String& signature,
     /*
      * Build signal message
      */
-    status = MarshalMessage(signature, destination, MESSAGE_SIGNAL, args, numArgs, flags, sessionId);
+    status = MarshalMessage(signature, destination, MESSAGE_SIGNAL, args, numArgs, flags, sessionId, plan);
 
 ExitSignalMsg:
     return status;
@@ -1244,7 +1506,7 @@ QStatus _Message::ReplyMsg(const Message& call, const MsgArg* args, size_t numAr
      * Build method return message (encrypted if the method call was encrypted)
      */
     status = MarshalMessage(call->replySignature, destination, MESSAGE_METHOD_RET, args,
-                            numArgs, call->msgHeader.flags & ALLJOYN_FLAG_ENCRYPTED, sessionId);
+                            numArgs, call->msgHeader.flags & ALLJOYN_FLAG_ENCRYPTED, sessionId, call->replyPlan);
 
     return status;
 }
@@ -1414,12 +1676,19 @@ QStatus _Message::GetExpansion(uint32_t token, MsgArg& replyArg)
     return status;
 }
 
-void _Message::SetSerialNumber()
+QStatus _Message::SetSerialNumber()
 {
+    if (msgBuf) {
+        QStatus status = MakeBufferWritable();
+        if (status != ER_OK) {
+            return status;
+        }
+    }
     msgHeader.serialNum = bus->GetInternal().NextSerial();
     if (msgBuf) {
         ((MessageHeader*)msgBuf)->serialNum = endianSwap ? EndianSwap32(msgHeader.serialNum) : msgHeader.serialNum;
     }
+    return ER_OK;
 }
 
 }
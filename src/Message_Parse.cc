@@ -22,7 +22,9 @@
 
 #include <qcc/platform.h>
 
+#include <assert.h>
 #include <algorithm>
+#include <new>
 
 #include <qcc/String.h>
 #include <qcc/StringUtil.h>
@@ -41,6 +43,7 @@
 #include "AllJoynCrypto.h"
 #include "AllJoynPeerObj.h"
 #include "SignatureUtils.h"
+#include "ArrayKernels.h"
 #include "BusInternal.h"
 
 #define QCC_MODULE "ALLJOYN"
@@ -62,7 +65,432 @@ namespace ajn {
 
 #define VALID_HEADER_FIELD(f) (((f) > ALLJOYN_HDR_FIELD_INVALID) && ((f) < ALLJOYN_HDR_FIELD_UNKNOWN))
 
+size_t _Message::ArgArena::AddCount()
+{
+    if (numCounts == maxCounts) {
+        uint32_t* bigger = new uint32_t[maxCounts * 2];
+        memcpy(bigger, counts, numCounts * sizeof(uint32_t));
+        if (counts != inlineCounts) {
+            delete [] counts;
+        }
+        counts = bigger;
+        maxCounts *= 2;
+    }
+    counts[numCounts] = 0;
+    return numCounts++;
+}
+
+void _Message::ArgArena::Reserve()
+{
+    assert(args == NULL);
+    args = reinterpret_cast<MsgArg*>(new uint64_t[(capacity * sizeof(MsgArg) + sizeof(uint64_t) - 1) / sizeof(uint64_t)]);
+    used = 0;
+    nextCount = 0;
+}
+
+MsgArg* _Message::ArgArena::Alloc(size_t numArgs)
+{
+    if ((capacity - used) < numArgs) {
+        return NULL;
+    }
+    MsgArg* alloc = &args[used];
+    for (size_t i = 0; i < numArgs; ++i) {
+        new (&alloc[i])MsgArg();
+    }
+    used += numArgs;
+    return alloc;
+}
+
+void _Message::ArgArena::Release()
+{
+    if (args) {
+        /*
+         * None of the MsgArgs own their nested MsgArgs so each one is destroyed individually
+         */
+        for (size_t i = 0; i < used; ++i) {
+            args[i].~MsgArg();
+        }
+        delete [] reinterpret_cast<uint64_t*>(args);
+        args = NULL;
+    }
+    if (counts != inlineCounts) {
+        delete [] counts;
+        counts = inlineCounts;
+        maxCounts = NUM_INLINE_COUNTS;
+    }
+    capacity = 0;
+    used = 0;
+    numCounts = 0;
+    nextCount = 0;
+}
+
+/*
+ * Get MsgArgs for a container value. While the body is being unmarshaled they come from the arena,
+ * otherwise (e.g. header fields) they are allocated individually and owned by the container.
+ */
+MsgArg* _Message::AllocArgs(size_t numArgs)
+{
+    if (argArena.IsActive()) {
+        return argArena.Alloc(numArgs);
+    } else {
+        return new MsgArg[numArgs];
+    }
+}
+
+/*
+ * Walks a value in the body the same way as ParseValue() and checks it is well formed but does not
+ * create any MsgArgs. If an arena is passed in this also counts the MsgArgs that parsing the value
+ * will need and records the number of elements in each container array.
+ */
+QStatus _Message::SizeValue(const char*& sigPtr, uint8_t*& pos, ArgArena* arena, bool arrayElem) const
+{
+    QStatus status = ER_OK;
+
+    switch (AllJoynTypeId typeId = (AllJoynTypeId)(*sigPtr++)) {
+    case ALLJOYN_BYTE:
+        pos += 1;
+        break;
+
+    case ALLJOYN_INT16:
+    case ALLJOYN_UINT16:
+        pos = AlignPtr(pos, 2) + 2;
+        break;
+
+    case ALLJOYN_BOOLEAN:
+    case ALLJOYN_HANDLE:
+    {
+        pos = AlignPtr(pos, 4);
+        if ((pos + 4) > bufEOD) {
+            status = ER_BUS_BAD_LENGTH;
+            break;
+        }
+        uint32_t v = endianSwap ? EndianSwap32(*((uint32_t*)pos)) : *((uint32_t*)pos);
+        if (typeId == ALLJOYN_BOOLEAN) {
+            if (v > 1) {
+                status = ER_BUS_BAD_VALUE;
+            }
+        } else {
+            uint32_t numHandles = (hdrFields.field[ALLJOYN_HDR_FIELD_HANDLES].typeId == ALLJOYN_INVALID) ? 0 : hdrFields.field[ALLJOYN_HDR_FIELD_HANDLES].v_uint32;
+            if (v >= numHandles) {
+                status = ER_BUS_NO_SUCH_HANDLE;
+            }
+        }
+        pos += 4;
+    }
+    break;
+
+    case ALLJOYN_INT32:
+    case ALLJOYN_UINT32:
+        pos = AlignPtr(pos, 4) + 4;
+        break;
+
+    case ALLJOYN_DOUBLE:
+    case ALLJOYN_UINT64:
+    case ALLJOYN_INT64:
+        pos = AlignPtr(pos, 8) + 8;
+        break;
+
+    case ALLJOYN_OBJECT_PATH:
+    case ALLJOYN_STRING:
+    {
+        pos = AlignPtr(pos, 4);
+        if ((pos + 4) > bufEOD) {
+            status = ER_BUS_BAD_LENGTH;
+            break;
+        }
+        uint32_t len = endianSwap ? EndianSwap32(*((uint32_t*)pos)) : *((uint32_t*)pos);
+        if (len > ALLJOYN_MAX_PACKET_LEN) {
+            status = ER_BUS_BAD_LENGTH;
+            break;
+        }
+        const char* str = (const char*)(pos + 4);
+        pos += 4 + len;
+        if (pos >= bufEOD) {
+            status = ER_BUS_BAD_LENGTH;
+        } else if (*pos++ != 0) {
+            status = ER_BUS_NOT_NUL_TERMINATED;
+        } else if ((typeId == ALLJOYN_OBJECT_PATH) && !IsLegalObjectPath(str)) {
+            status = ER_BUS_BAD_OBJ_PATH;
+        }
+    }
+    break;
 
+    case ALLJOYN_SIGNATURE:
+        if (pos >= bufEOD) {
+            status = ER_BUS_BAD_LENGTH;
+        } else {
+            const char* sig = (const char*)(pos + 1);
+            pos += 1 + *pos;
+            if (pos >= bufEOD) {
+                status = ER_BUS_BAD_LENGTH;
+            } else if (*pos++ != 0) {
+                status = ER_BUS_NOT_NUL_TERMINATED;
+            } else if (!SignatureUtils::IsValidSignature(sig)) {
+                status = ER_BUS_BAD_SIGNATURE;
+            }
+        }
+        break;
+
+    case ALLJOYN_ARRAY:
+    {
+        const char* elemSig = sigPtr;
+        status = SignatureUtils::ParseCompleteType(sigPtr);
+        if (status != ER_OK) {
+            break;
+        }
+        pos = AlignPtr(pos, 4);
+        if ((pos + 4) > bufEOD) {
+            status = ER_BUS_BAD_LENGTH;
+            break;
+        }
+        uint32_t len = endianSwap ? EndianSwap32(*((uint32_t*)pos)) : *((uint32_t*)pos);
+        pos += 4;
+        if ((len > ALLJOYN_MAX_ARRAY_LEN) || ((pos + len) > bufEOD)) {
+            status = ER_BUS_BAD_LENGTH;
+            break;
+        }
+        switch (*elemSig) {
+        case ALLJOYN_BOOLEAN:
+            if (len & 3) {
+                status = ER_BUS_BAD_LENGTH;
+                break;
+            }
+            if (!UnpackBoolArray(NULL, pos, len / 4, endianSwap)) {
+                status = ER_BUS_BAD_VALUE;
+            }
+            pos += len;
+            break;
+
+        /*
+         * Scalar arrays don't have nested MsgArgs but the length must be a multiple of the
+         * element size just as ParseArray requires.
+         */
+        case ALLJOYN_BYTE:
+            pos += len;
+            break;
+
+        case ALLJOYN_INT16:
+        case ALLJOYN_UINT16:
+            if (len & 1) {
+                status = ER_BUS_BAD_LENGTH;
+            }
+            pos += len;
+            break;
+
+        case ALLJOYN_INT32:
+        case ALLJOYN_UINT32:
+            if (len & 3) {
+                status = ER_BUS_BAD_LENGTH;
+            }
+            pos += len;
+            break;
+
+        case ALLJOYN_DOUBLE:
+        case ALLJOYN_INT64:
+        case ALLJOYN_UINT64:
+            if (len & 7) {
+                status = ER_BUS_BAD_LENGTH;
+            }
+            pos = AlignPtr(pos, 8) + len;
+            break;
+
+        case ALLJOYN_STRUCT_OPEN:
+        case ALLJOYN_DICT_ENTRY_OPEN:
+            pos = AlignPtr(pos, 8);
+
+        /* Falling through */
+        default:
+        {
+            uint8_t* endOfArray = pos + len;
+            size_t index = arena ? arena->AddCount() : 0;
+            uint32_t numElements = 0;
+            while ((status == ER_OK) && (pos < endOfArray)) {
+                const char* esig = elemSig;
+                status = SizeValue(esig, pos, arena, true);
+                ++numElements;
+            }
+            if (arena) {
+                arena->SetCount(index, numElements);
+                arena->capacity += numElements;
+            }
+        }
+        break;
+        }
+    }
+    break;
+
+    case ALLJOYN_DICT_ENTRY_OPEN:
+        if (!arrayElem) {
+            status = ER_BUS_BAD_SIGNATURE;
+            break;
+        }
+
+    /* Falling through */
+    case ALLJOYN_STRUCT_OPEN:
+    {
+        char close = (typeId == ALLJOYN_STRUCT_OPEN) ? ALLJOYN_STRUCT_CLOSE : ALLJOYN_DICT_ENTRY_CLOSE;
+        pos = AlignPtr(pos, 8);
+        while ((status == ER_OK) && (*sigPtr != close)) {
+            if (*sigPtr == 0) {
+                status = ER_BUS_BAD_SIGNATURE;
+            } else {
+                status = SizeValue(sigPtr, pos, arena);
+                if (arena) {
+                    ++arena->capacity;
+                }
+            }
+        }
+        ++sigPtr;
+    }
+    break;
+
+    case ALLJOYN_VARIANT:
+    {
+        if (pos >= bufEOD) {
+            status = ER_BUS_BAD_LENGTH;
+            break;
+        }
+        size_t len = (size_t)(*pos);
+        const char* varSig = (const char*)(++pos);
+        pos += len;
+        if ((pos >= bufEOD) || (*pos++ != 0) || !SignatureUtils::IsValidSignature(varSig)) {
+            status = ER_BUS_BAD_SIGNATURE;
+        } else {
+            status = SizeValue(varSig, pos, arena);
+            if ((status == ER_OK) && (*varSig != 0)) {
+                status = ER_BUS_BAD_SIGNATURE;
+            }
+            if (arena) {
+                ++arena->capacity;
+            }
+        }
+    }
+    break;
+
+    default:
+        status = ER_BUS_BAD_VALUE_TYPE;
+        break;
+    }
+    if ((status == ER_OK) && (pos > bufEOD)) {
+        status = ER_BUS_BAD_SIGNATURE;
+    }
+    return status;
+}
+
+/*
+ * Decode an arg that was indexed by a lazy unmarshal
+ */
+QStatus _Message::DecodeLazyArg(size_t argN)
+{
+    if (!lazyArgs || (lazyArgs[argN] == LAZY_ARG_DECODED)) {
+        return ER_OK;
+    }
+    const char* sig = GetSignature();
+    for (size_t i = 0; i < argN; ++i) {
+        SignatureUtils::ParseCompleteType(sig);
+    }
+    bufPos = bodyPtr + lazyArgs[argN];
+    QStatus status = ParseValue(&msgArgs[argN], sig);
+    if (status != ER_OK) {
+        /*
+         * The body was validated when it was unmarshaled so this should not happen. If it does the
+         * decoded args cannot be trusted so they are all discarded.
+         */
+        QCC_LogError(status, ("Failed to decode arg %u of %s", (uint32_t)argN, Description().c_str()));
+        delete [] msgArgs;
+        msgArgs = NULL;
+        numMsgArgs = 0;
+        numLazyArgs = 0;
+    } else {
+        lazyArgs[argN] = LAZY_ARG_DECODED;
+        --numLazyArgs;
+    }
+    if (numLazyArgs == 0) {
+        delete [] lazyArgs;
+        lazyArgs = NULL;
+        if (endianSwap) {
+            endianSwap = false;
+            msgHeader.endian = myEndian;
+        }
+    }
+    return status;
+}
+
+QStatus _Message::DecodeLazyArgs()
+{
+    QStatus status = ER_OK;
+    for (size_t i = 0; (status == ER_OK) && lazyArgs && (i < numMsgArgs); ++i) {
+        status = DecodeLazyArg(i);
+    }
+    return status;
+}
+
+/*
+ * Get the value of a basic type arg without unmarshaling the message body
+ */
+QStatus _Message::PeekArg(size_t argN, MsgArg& arg) const
+{
+    const char* sig = GetSignature();
+    uint8_t* pos = bodyPtr;
+    QStatus status = ER_OK;
+
+    if ((msgHeader.flags & ALLJOYN_FLAG_ENCRYPTED) || !bodyPtr) {
+        return ER_BUS_NOT_ALLOWED;
+    }
+    for (size_t i = 0; (status == ER_OK) && (i < argN); ++i) {
+        if (*sig == 0) {
+            return ER_BUS_NO_SUCH_OBJECT;
+        }
+        status = SizeValue(sig, pos, NULL);
+    }
+    if (status != ER_OK) {
+        return status;
+    }
+    arg.Clear();
+    switch (AllJoynTypeId typeId = (AllJoynTypeId)(*sig)) {
+    case ALLJOYN_BYTE:
+        if (pos >= bufEOD) {
+            return ER_BUS_BAD_LENGTH;
+        }
+        arg.typeId = typeId;
+        arg.v_byte = *pos;
+        break;
+
+    case ALLJOYN_BOOLEAN:
+    case ALLJOYN_INT32:
+    case ALLJOYN_UINT32:
+        pos = AlignPtr(pos, 4);
+        if ((pos + 4) > bufEOD) {
+            return ER_BUS_BAD_LENGTH;
+        }
+        arg.typeId = typeId;
+        arg.v_uint32 = endianSwap ? EndianSwap32(*((uint32_t*)pos)) : *((uint32_t*)pos);
+        if (typeId == ALLJOYN_BOOLEAN) {
+            arg.v_bool = (arg.v_uint32 == 1);
+        }
+        break;
+
+    case ALLJOYN_OBJECT_PATH:
+    case ALLJOYN_STRING:
+    {
+        const char* strSig = sig;
+        uint8_t* strPos = pos;
+        status = SizeValue(strSig, strPos, NULL);
+        if (status == ER_OK) {
+            pos = AlignPtr(pos, 4);
+            arg.typeId = typeId;
+            arg.v_string.len = (size_t)(endianSwap ? EndianSwap32(*((uint32_t*)pos)) : *((uint32_t*)pos));
+            arg.v_string.str = (const char*)(pos + 4);
+        }
+    }
+    break;
+
+    default:
+        status = ER_BUS_BAD_VALUE_TYPE;
+        break;
+    }
+    return status;
+}
 
 QStatus _Message::ParseArray(MsgArg* arg,
                              const char*& sigPtr)
@@ -118,12 +546,9 @@ QStatus _Message::ParseArray(MsgArg* arg,
             arg->typeId = (AllJoynTypeId)((elemTypeId << 8) | ALLJOYN_ARRAY);
             arg->v_scalarArray.numElements = (size_t)(len / 2);
             if (endianSwap) {
-                arg->v_scalarArray.v_uint16 = new uint16_t[arg->v_scalarArray.numElements];
-                uint16_t* p = (uint16_t*)arg->v_scalarArray.v_uint16;
-                uint16_t* n = (uint16_t*)bufPos;
-                for (size_t i = 0; i < arg->v_scalarArray.numElements; i++) {
-                    *p++ = EndianSwap16(*n++);
-                }
+                uint16_t* p = new uint16_t[arg->v_scalarArray.numElements];
+                SwapArray16(p, bufPos, arg->v_scalarArray.numElements);
+                arg->v_scalarArray.v_uint16 = p;
                 arg->flags = MsgArg::OwnsData;
             } else {
                 arg->v_scalarArray.v_uint16 = (uint16_t*)bufPos;
@@ -138,28 +563,12 @@ QStatus _Message::ParseArray(MsgArg* arg,
         if ((len & 3) == 0) {
             size_t num = (size_t)(len / 4);
             bool* bools = new bool[num];
-            for (size_t i = 0; i < num; i++) {
-                uint32_t b = *(uint32_t*)bufPos;
-                if (endianSwap) {
-                    b = EndianSwap32(b);
-                }
-                if (b > 1) {
-                    delete [] bools;
-                    status = ER_BUS_BAD_VALUE;
-                    break;
-                }
-                bools[i] = (b == 1);
-                bufPos += 4;
-            }
-            /*
-             * if status is set to ER_BUS_BAD_VALUE it means the for loop above
-             * found that the value was not an ALLJOYN_BOOLEAN type and deleted
-             * the array 'bools' then exited the for loop. Do not try and set
-             * the 'v_scalarArray.v_bool' to the now invalid 'bools'.
-             */
-            if (status == ER_BUS_BAD_VALUE) {
+            if (!UnpackBoolArray(bools, bufPos, num, endianSwap)) {
+                delete [] bools;
+                status = ER_BUS_BAD_VALUE;
                 break;
             }
+            bufPos += len;
             arg->typeId = ALLJOYN_BOOLEAN_ARRAY;
             arg->v_scalarArray.numElements = num;
             arg->v_scalarArray.v_bool = bools;
@@ -175,12 +584,9 @@ QStatus _Message::ParseArray(MsgArg* arg,
             arg->typeId = (AllJoynTypeId)((elemTypeId << 8) | ALLJOYN_ARRAY);
             arg->v_scalarArray.numElements = (size_t)(len / 4);
             if (endianSwap) {
-                arg->v_scalarArray.v_uint32 = new uint32_t[arg->v_scalarArray.numElements];
-                uint32_t* p = (uint32_t*)arg->v_scalarArray.v_uint32;
-                uint32_t* n = (uint32_t*)bufPos;
-                for (size_t i = 0; i < arg->v_scalarArray.numElements; i++) {
-                    *p++ = EndianSwap32(*n++);
-                }
+                uint32_t* p = new uint32_t[arg->v_scalarArray.numElements];
+                SwapArray32(p, bufPos, arg->v_scalarArray.numElements);
+                arg->v_scalarArray.v_uint32 = p;
                 arg->flags = MsgArg::OwnsData;
             } else {
                 arg->v_scalarArray.v_uint32 = (uint32_t*)bufPos;
@@ -200,12 +606,9 @@ QStatus _Message::ParseArray(MsgArg* arg,
             bufPos = AlignPtr(bufPos, 8);
             arg->v_scalarArray.v_uint64 = (uint64_t*)bufPos;
             if (endianSwap) {
-                arg->v_scalarArray.v_uint64 = new uint64_t[arg->v_scalarArray.numElements];
-                uint64_t* p = (uint64_t*)arg->v_scalarArray.v_uint64;
-                uint64_t* n = (uint64_t*)bufPos;
-                for (size_t i = 0; i < arg->v_scalarArray.numElements; i++) {
-                    *p++ = EndianSwap64(*n++);
-                }
+                uint64_t* p = new uint64_t[arg->v_scalarArray.numElements];
+                SwapArray64(p, bufPos, arg->v_scalarArray.numElements);
+                arg->v_scalarArray.v_uint64 = p;
                 arg->flags = MsgArg::OwnsData;
             } else {
                 arg->v_scalarArray.v_uint64 = (uint64_t*)bufPos;
@@ -230,7 +633,26 @@ QStatus _Message::ParseArray(MsgArg* arg,
         qcc::String elemSig(sigStart, sigPtr - sigStart);
         size_t numElements = 0;
         MsgArg* elements = NULL;
-        if (len > 0) {
+        if (argArena.IsActive()) {
+            /*
+             * The sizing pass already counted the elements so the arena has exactly the right
+             * number of MsgArgs for them.
+             */
+            uint8_t* endOfArray = bufPos + len;
+            size_t count = argArena.NextCount();
+            elements = (count > 0) ? argArena.Alloc(count) : NULL;
+            if ((count > 0) && !elements) {
+                status = ER_BUS_BAD_LENGTH;
+            }
+            while ((status == ER_OK) && (bufPos < endOfArray)) {
+                if (numElements == count) {
+                    status = ER_BUS_BAD_LENGTH;
+                    break;
+                }
+                const char* esig = elemSig.c_str();
+                status = ParseValue(&elements[numElements++], esig, true);
+            }
+        } else if (len > 0) {
             /*
              * We know how many bytes there are in the array but not how many elements until we
              * unmarshal them.
@@ -266,8 +688,10 @@ QStatus _Message::ParseArray(MsgArg* arg,
         }
         if (status == ER_OK) {
             arg->v_array.SetElements(elemSig.c_str(), numElements, elements);
-            arg->flags |= MsgArg::OwnsArgs;
-        } else {
+            if (!argArena.IsActive()) {
+                arg->flags |= MsgArg::OwnsArgs;
+            }
+        } else if (!argArena.IsActive()) {
             delete [] elements;
         }
     }
@@ -302,8 +726,14 @@ QStatus _Message::ParseStruct(MsgArg* arg, const char*& sigPtr)
 
     QCC_DbgPrintf(("ParseStruct at pos:%d", bufPos - bodyPtr));
 
-    arg->v_struct.members = new MsgArg[arg->v_struct.numMembers];
-    arg->flags |= MsgArg::OwnsArgs;
+    arg->v_struct.members = AllocArgs(arg->v_struct.numMembers);
+    if (!arg->v_struct.members) {
+        arg->typeId = ALLJOYN_INVALID;
+        return ER_BUS_BAD_LENGTH;
+    }
+    if (!argArena.IsActive()) {
+        arg->flags |= MsgArg::OwnsArgs;
+    }
     for (uint32_t i = 0; i < arg->v_struct.numMembers; ++i) {
         status = ParseValue(&arg->v_struct.members[i], memberSig);
         if (status != ER_OK) {
@@ -337,9 +767,19 @@ QStatus _Message::ParseDictEntry(MsgArg* arg,
 
         QCC_DbgPrintf(("ParseDictEntry at pos:%d", bufPos - bodyPtr));
 
-        arg->v_dictEntry.key = new MsgArg();
-        arg->v_dictEntry.val = new MsgArg();
-        arg->flags |= MsgArg::OwnsArgs;
+        if (argArena.IsActive()) {
+            MsgArg* keyVal = argArena.Alloc(2);
+            if (!keyVal) {
+                arg->typeId = ALLJOYN_INVALID;
+                return ER_BUS_BAD_LENGTH;
+            }
+            arg->v_dictEntry.key = &keyVal[0];
+            arg->v_dictEntry.val = &keyVal[1];
+        } else {
+            arg->v_dictEntry.key = new MsgArg();
+            arg->v_dictEntry.val = new MsgArg();
+            arg->flags |= MsgArg::OwnsArgs;
+        }
         status = ParseValue(arg->v_dictEntry.key, memberSig);
         if (status == ER_OK) {
             status = ParseValue(arg->v_dictEntry.val, memberSig);
@@ -365,6 +805,16 @@ QStatus _Message::ParseVariant(MsgArg* arg)
         status = ER_BUS_BAD_LENGTH;
     } else if (*bufPos++ != 0) {
         status = ER_BUS_BAD_SIGNATURE;
+    } else if (argArena.IsActive()) {
+        arg->v_variant.val = argArena.Alloc(1);
+        if (arg->v_variant.val) {
+            status = ParseValue(arg->v_variant.val, sigPtr);
+        } else {
+            status = ER_BUS_BAD_LENGTH;
+        }
+        if ((status == ER_OK) && (*sigPtr != 0)) {
+            status = ER_BUS_BAD_SIGNATURE;
+        }
     } else {
         arg->v_variant.val = new MsgArg();
         arg->flags |= MsgArg::OwnsArgs;
@@ -374,7 +824,9 @@ QStatus _Message::ParseVariant(MsgArg* arg)
         }
     }
     if (status != ER_OK) {
-        delete arg->v_variant.val;
+        if (!argArena.IsActive()) {
+            delete arg->v_variant.val;
+        }
         arg->typeId = ALLJOYN_INVALID;
     }
     return status;
@@ -554,12 +1006,13 @@ QStatus _Message::ParseValue(MsgArg* arg, const char*& sigPtr, bool arrayElem)
  */
 static const char* WildCardSignature = "*";
 
-QStatus _Message::UnmarshalArgs(const qcc::String& expectedSignature, const char* expectedReplySignature)
+QStatus _Message::UnmarshalArgs(const qcc::String& expectedSignature, const char* expectedReplySignature, bool lazy)
 {
     const char* sig = GetSignature();
     QStatus status = ER_OK;
     int _numMsgArgs = 0;
     MsgArg* _msgArgs = NULL;
+    uint32_t* _lazyArgs = NULL;
 
     /* Check if message body is already unmarshaled */
     if (msgArgs != NULL) {
@@ -588,9 +1041,9 @@ QStatus _Message::UnmarshalArgs(const qcc::String& expectedSignature, const char
     if (msgHeader.flags & ALLJOYN_FLAG_ENCRYPTED) {
         bool broadcast = (hdrFields.field[ALLJOYN_HDR_FIELD_DESTINATION].typeId == ALLJOYN_INVALID);
         size_t hdrLen = bodyPtr - (uint8_t*)msgBuf;
-        PeerState peerState = bus->GetInternal().GetPeerStateTable()->GetPeerState(GetSender());
-        KeyBlob key;
-        status = peerState->GetKey(key, broadcast ? PEER_GROUP_KEY : PEER_SESSION_KEY);
+        PeerState peerState = bus->GetInternal().GetPeerStateTable()->GetPeerState(GetSender(), false);
+        CipherContext cipher;
+        status = peerState->GetCipher(cipher, broadcast ? PEER_GROUP_KEY : PEER_SESSION_KEY);
         if (status != ER_OK) {
             QCC_LogError(status, ("Unable to decrypt message"));
             /*
@@ -612,44 +1065,94 @@ QStatus _Message::UnmarshalArgs(const qcc::String& expectedSignature, const char
          * algorithm adds appends a MAC block to the end of the encrypted data.
          */
         size_t bodyLen = msgHeader.bodyLen;
-        status = ajn::Crypto::Decrypt(*this, key, (uint8_t*)msgBuf, hdrLen, bodyLen);
+        /*
+         * Decryption is done in place so the wire buffer must not be shared
+         */
+        status = MakeBufferWritable();
+        if (status != ER_OK) {
+            goto ExitUnmarshalArgs;
+        }
+        status = ajn::Crypto::Decrypt(*this, cipher, (uint8_t*)msgBuf, hdrLen, bodyLen);
         if (status != ER_OK) {
             goto ExitUnmarshalArgs;
         }
         msgHeader.bodyLen = static_cast<uint32_t>(bodyLen);
-        authMechanism = key.GetTag();
+        authMechanism = cipher->GetKey().GetTag();
     }
     /*
      * Calculate how many arguments there are
      */
     _numMsgArgs = SignatureUtils::CountCompleteTypes(sig);
-    _msgArgs = new MsgArg[_numMsgArgs];
+    lazy = lazy && (_numMsgArgs > 0);
 
-    /*
-     * Unmarshal the body values
-     */
-    bufPos = bodyPtr;
-    for (uint8_t i = 0; i < _numMsgArgs; i++) {
-        status = ParseValue(&_msgArgs[i], sig);
-        if (status != ER_OK) {
-            _numMsgArgs = i;
-            goto ExitUnmarshalArgs;
+    if (lazy) {
+        /*
+         * Validate the body and record where each arg starts. The args are decoded individually
+         * the first time they are accessed.
+         */
+        const char* argSig = sig;
+        uint8_t* pos = bodyPtr;
+        _lazyArgs = new uint32_t[_numMsgArgs];
+        for (int i = 0; (status == ER_OK) && (i < _numMsgArgs); i++) {
+            _lazyArgs[i] = static_cast<uint32_t>(pos - bodyPtr);
+            status = SizeValue(argSig, pos, NULL);
+        }
+        if ((status == ER_OK) && ((pos - bodyPtr) != static_cast<ptrdiff_t>(msgHeader.bodyLen))) {
+            QCC_DbgHLPrintf(("UnmarshalArgs expected argLen %d got %d", msgHeader.bodyLen, (pos - bodyPtr)));
+            status = ER_BUS_BAD_SIGNATURE;
+        }
+        _msgArgs = new MsgArg[_numMsgArgs];
+    } else {
+        /*
+         * Size the body so that all of the MsgArgs can be allocated from the arena at once. If
+         * sizing fails the body is malformed, the MsgArgs are allocated individually and parsing
+         * reports the error.
+         */
+        if (_numMsgArgs > 0) {
+            const char* sizeSig = sig;
+            uint8_t* pos = bodyPtr;
+            argArena.capacity = _numMsgArgs;
+            for (int i = 0; (status == ER_OK) && (i < _numMsgArgs); i++) {
+                status = SizeValue(sizeSig, pos, &argArena);
+            }
+            if (status == ER_OK) {
+                argArena.Reserve();
+            } else {
+                argArena.Release();
+                status = ER_OK;
+            }
+        }
+        _msgArgs = AllocArgs(_numMsgArgs);
+
+        /*
+         * Unmarshal the body values
+         */
+        bufPos = bodyPtr;
+        for (uint8_t i = 0; i < _numMsgArgs; i++) {
+            status = ParseValue(&_msgArgs[i], sig);
+            if (status != ER_OK) {
+                _numMsgArgs = i;
+                goto ExitUnmarshalArgs;
+            }
+        }
+        if ((bufPos - bodyPtr) != static_cast<ptrdiff_t>(msgHeader.bodyLen)) {
+            QCC_DbgHLPrintf(("UnmarshalArgs expected argLen %d got %d", msgHeader.bodyLen, (bufPos - bodyPtr)));
+            status = ER_BUS_BAD_SIGNATURE;
         }
-    }
-    if ((bufPos - bodyPtr) != static_cast<ptrdiff_t>(msgHeader.bodyLen)) {
-        QCC_DbgHLPrintf(("UnmarshalArgs expected argLen %d got %d", msgHeader.bodyLen, (bufPos - bodyPtr)));
-        status = ER_BUS_BAD_SIGNATURE;
     }
 
 ExitUnmarshalArgs:
 
     if (status == ER_OK) {
-        QCC_DbgPrintf(("Unmarshaled\n%s", ToString().c_str()));
         /*
          * If the message arguments are ever unmarshalled we convert the entire message to the native
-         * endianess.
+         * endianess. Lazy args still need to be decoded from the body so this is deferred until
+         * the last one has been decoded.
          */
-        if (endianSwap) {
+        if (lazy) {
+            lazyArgs = _lazyArgs;
+            numLazyArgs = _numMsgArgs;
+        } else if (endianSwap) {
             QCC_DbgPrintf(("UnmarshalArgs converting to native endianess"));
             endianSwap = false;
             msgHeader.endian = myEndian;
@@ -667,10 +1170,16 @@ ExitUnmarshalArgs:
          */
         msgArgs = _msgArgs;
         numMsgArgs = _numMsgArgs;
+        if (!lazy) {
+            QCC_DbgPrintf(("Unmarshaled\n%s", ToString().c_str()));
+        }
     } else {
-        if (_msgArgs) {
+        if (argArena.IsActive()) {
+            argArena.Release();
+        } else {
             delete [] _msgArgs;
         }
+        delete [] _lazyArgs;
         QCC_LogError(status, ("UnmarshalArgs failed"));
     }
     return status;
@@ -840,10 +1349,9 @@ QStatus _Message::HeaderChecks(bool pedantic)
 
 }
 
-/* Check the first 16 bytes of the header */
-QStatus _Message::InterpretHeader()
+/* Check the first 16 bytes of the header and compute the packet size */
+QStatus _Message::CheckHeader()
 {
-    readState = MESSAGE_HEADER_BODY;
     /*
      * Check if we need to swizzle the endianness
      */
@@ -890,8 +1398,24 @@ QStatus _Message::InterpretHeader()
      * message reducing the places where we need to check for bufEOD when unmarshaling the body.
      */
     bufSize = sizeof(msgHeader) + ((pktSize + 7) & ~7) + sizeof(uint64_t);
-    _msgBuf = new uint8_t[bufSize + 7];
-    msgBuf = (uint64_t*)((uintptr_t)(_msgBuf + 7) & ~7); /* Align to 8 byte boundary */
+    return ER_OK;
+}
+
+/* Check the first 16 bytes of the header and allocate a buffer for the message */
+QStatus _Message::InterpretHeader()
+{
+    QStatus status = CheckHeader();
+    if (status == ER_OK) {
+        LoadHeader();
+    }
+    return status;
+}
+
+/* Allocate a buffer for a message with a checked header and copy the header into it */
+void _Message::LoadHeader()
+{
+    readState = MESSAGE_HEADER_BODY;
+    AllocBuffer();
     /*
      * Copy header into the buffer
      */
@@ -913,8 +1437,6 @@ QStatus _Message::InterpretHeader()
     memset(bufEOD, 0, (uint8_t*)msgBuf + bufSize - bufEOD);
     /* Set count to number of bytes remaining */
     countRead = pktSize;
-    return ER_OK;
-
 }
 
 QStatus _Message::PullBytes(RemoteEndpoint& endpoint, bool checkSender, bool pedantic, uint32_t timeout)
@@ -1007,15 +1529,85 @@ QStatus _Message::ReadNonBlocking(RemoteEndpoint& endpoint, bool checkSender, bo
     return status;
 }
 
+QStatus _Message::ReadBuffered(RemoteEndpoint& endpoint, ReadBuffer& rxBuf, bool checkSender, bool exact)
+{
+    QStatus status = ER_OK;
+
+    /*
+     * Messages that are too large for the ring are read directly into their own buffer.
+     */
+    if (readState != MESSAGE_NEW) {
+        return ReadNonBlocking(endpoint, checkSender);
+    }
+    while (status == ER_OK) {
+        size_t avail = rxBuf.tail - rxBuf.head;
+        size_t need = sizeof(msgHeader);
+        if (avail >= sizeof(msgHeader)) {
+            memcpy(&msgHeader, rxBuf.ring + rxBuf.head, sizeof(msgHeader));
+            status = CheckHeader();
+            if (status != ER_OK) {
+                break;
+            }
+            need += pktSize;
+            if (need > ReadBuffer::RING_SIZE) {
+                /*
+                 * Move whatever has already been read into the message's own buffer, the rest of
+                 * the message is read directly from the endpoint.
+                 */
+                LoadHeader();
+                rxBuf.head += sizeof(msgHeader);
+                size_t n = (std::min)(countRead, rxBuf.tail - rxBuf.head);
+                memcpy(bufPos, rxBuf.ring + rxBuf.head, n);
+                bufPos += n;
+                countRead -= n;
+                rxBuf.head = rxBuf.tail = 0;
+                return ReadNonBlocking(endpoint, checkSender);
+            }
+            if (avail >= need) {
+                /*
+                 * The message is complete. The bytes on the wire are moved as they are into an 8
+                 * byte aligned slot of the shared wire buffer where the message is parsed.
+                 */
+                AllocBuffer(rxBuf);
+                memcpy(msgBuf, rxBuf.ring + rxBuf.head, need);
+                bufEOD = (uint8_t*)msgBuf + need;
+                memset(bufEOD, 0, (uint8_t*)msgBuf + bufSize - bufEOD);
+                bufPos = (uint8_t*)msgBuf + sizeof(msgHeader);
+                readState = MESSAGE_COMPLETE;
+                rxBuf.head += need;
+                if (rxBuf.head == rxBuf.tail) {
+                    rxBuf.head = rxBuf.tail = 0;
+                }
+                return ER_OK;
+            }
+        }
+        /*
+         * Make room at the end of the ring and read as many bytes as are available. If this is
+         * the last message to be read from the endpoint only the bytes for this message are read.
+         */
+        if (rxBuf.head > 0) {
+            memmove(rxBuf.ring, rxBuf.ring + rxBuf.head, avail);
+            rxBuf.head = 0;
+            rxBuf.tail = avail;
+        }
+        size_t toRead = exact ? (need - avail) : (ReadBuffer::RING_SIZE - rxBuf.tail);
+        size_t read = 0;
+        status = endpoint->GetSource().PullBytes(rxBuf.ring + rxBuf.tail, toRead, read, 0);
+        rxBuf.tail += read;
+    }
+    if ((status != ER_SOCK_OTHER_END_CLOSED) && (status != ER_STOPPING_THREAD) && (status != ER_TIMEOUT)) {
+        QCC_LogError(status, ("Failed to read message on %s", endpoint->GetUniqueName().c_str()));
+    }
+    return status;
+}
+
 QStatus _Message::Read(RemoteEndpoint& endpoint, bool checkSender, bool pedantic, uint32_t timeout)
 {
     QStatus status = ER_OK;
     /*
      * Clear out any stale message state
      */
-    msgBuf = NULL;
-    delete [] _msgBuf;
-    _msgBuf = NULL;
+    ReleaseBuffer();
     ClearHeader();
     readState = MESSAGE_NEW;
 
@@ -1267,9 +1859,7 @@ ExitUnmarshal:
         /*
          * There was an unrecoverable failure while unmarshaling the message, cleanup before we return.
          */
-        msgBuf = NULL;
-        delete [] _msgBuf;
-        _msgBuf = NULL;
+        ReleaseBuffer();
         ClearHeader();
         if ((status != ER_SOCK_OTHER_END_CLOSED) && (status != ER_STOPPING_THREAD)) {
             QCC_LogError(status, ("Failed to unmarshal message received on %s", endpoint->GetUniqueName().c_str()));
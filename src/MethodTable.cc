@@ -36,15 +36,41 @@ namespace ajn {
 MethodTable::~MethodTable()
 {
     lock.Lock(MUTEX_CONTEXT);
-    MapType::iterator iter = hashTable.begin();
-    while (iter != hashTable.end()) {
+    const MapType& table = hashTable.Current();
+    for (MapType::const_iterator iter = table.begin(); iter != table.end(); ++iter) {
         delete iter->second;
     }
-
-    hashTable.clear();
+    hashTable.BeginUpdate().clear();
+    hashTable.Publish();
     lock.Unlock(MUTEX_CONTEXT);
 }
 
+void MethodTable::Insert(MapType& table, const Key& key, Entry* entry)
+{
+    MapType::iterator iter = table.find(key);
+    if (iter != table.end()) {
+        /* The old key may point into the entry being replaced */
+        retired.push_back(iter->second);
+        table.erase(iter);
+    }
+    table.insert(pair<const Key, Entry*>(key, entry));
+}
+
+void MethodTable::DeleteRetired()
+{
+    if (!retired.empty()) {
+        /*
+         * Lookups pin a snapshot only until they have taken a reference on the entry they found so
+         * this wait is short. Deleting an entry waits for the method calls that are using it.
+         */
+        hashTable.WaitForReaders();
+        for (size_t i = 0; i < retired.size(); ++i) {
+            delete retired[i];
+        }
+        retired.clear();
+    }
+}
+
 void MethodTable::Add(BusObject* object,
                       MessageReceiver::MethodHandler func,
                       const InterfaceDescription::Member* member,
@@ -52,56 +78,70 @@ void MethodTable::Add(BusObject* object,
 {
     Entry* entry = new Entry(object, func, member, context);
     lock.Lock(MUTEX_CONTEXT);
-    hashTable[Key(object->GetPath(), entry->ifaceStr.empty() ? NULL : entry->ifaceStr.c_str(), member->name.c_str())] = entry;
+    /*
+     * When called from AddAll() all the methods for an object are published together
+     */
+    bool publish = (update == NULL);
+    MapType& table = publish ? hashTable.BeginUpdate() : *update;
+    Insert(table, Key(object->GetPath(), entry->ifaceStr.empty() ? NULL : entry->ifaceStr.c_str(), member->name.c_str()), entry);
 
     /* Method calls don't require an interface so we need to add an entry with a NULL interface */
     if (!entry->ifaceStr.empty()) {
-        hashTable[Key(object->GetPath(), NULL, member->name.c_str())] = new Entry(*entry);
+        Insert(table, Key(object->GetPath(), NULL, member->name.c_str()), new Entry(*entry));
+    }
+    if (publish) {
+        hashTable.Publish();
+        DeleteRetired();
     }
     lock.Unlock(MUTEX_CONTEXT);
 }
 
-MethodTable::SafeEntry* MethodTable::Find(const char* objectPath,
-                                          const char* iface,
-                                          const char* methodName)
+bool MethodTable::Find(const char* objectPath,
+                       const char* iface,
+                       const char* methodName,
+                       SafeEntry& safeEntry)
 {
-    SafeEntry* entry = NULL;
     Key key(objectPath, iface, methodName);
-    lock.Lock(MUTEX_CONTEXT);
-    MapType::iterator iter = hashTable.find(key);
-    if (iter != hashTable.end()) {
-        entry = new SafeEntry();
-        entry->Set(iter->second);
+    CopyOnWrite<MapType>::Reader table(hashTable);
+    MapType::const_iterator iter = table->find(key);
+    if (iter != table->end()) {
+        safeEntry.Set(iter->second);
+        return true;
+    } else {
+        return false;
     }
-    lock.Unlock(MUTEX_CONTEXT);
-    return entry;
 }
 
 void MethodTable::RemoveAll(BusObject* object)
 {
-    MapType::iterator iter;
     /*
-     * Iterate over all entries deleting all entries that reference the object
+     * Publish a snapshot without the entries that reference the object then delete them
      */
     lock.Lock(MUTEX_CONTEXT);
-    iter = hashTable.begin();
-    while (iter != hashTable.end()) {
+    MapType& table = hashTable.BeginUpdate();
+    MapType::iterator iter = table.begin();
+    while (iter != table.end()) {
         if (iter->second->object == object) {
-            Entry* deleteMe = iter->second;
-            hashTable.erase(iter);
-            delete deleteMe;
-            iter = hashTable.begin();
+            retired.push_back(iter->second);
+            table.erase(iter++);
         } else {
             ++iter;
         }
     }
+    hashTable.Publish();
+    DeleteRetired();
     lock.Unlock(MUTEX_CONTEXT);
 }
 
 void MethodTable::AddAll(BusObject* object)
 {
+    lock.Lock(MUTEX_CONTEXT);
+    update = &hashTable.BeginUpdate();
     object->InstallMethods(*this);
+    update = NULL;
+    hashTable.Publish();
+    DeleteRetired();
+    lock.Unlock(MUTEX_CONTEXT);
 }
 
 }
-
@@ -38,10 +38,15 @@
 
 #include <qcc/STLContainer.h>
 
+#include "CopyOnWrite.h"
+
 namespace ajn {
 
 /**
  * %MethodTable is a hash table that maps object paths to BusObject instances.
+ *
+ * Lookups do not take a lock. The table is a copy-on-write snapshot, registering or unregistering
+ * an object builds a new snapshot while lookups continue to use the one they started with.
  */
 class MethodTable {
 
@@ -101,6 +106,11 @@ class MethodTable {
         const Entry* entry;
     };
 
+    /**
+     * Constructor
+     */
+    MethodTable() : update(NULL) { }
+
     /**
      * Destructor
      */
@@ -119,16 +129,17 @@ class MethodTable {
              void* context = NULL);
 
     /**
-     * Find an Entry based on set of criteria.
+     * Find an Entry based on set of criteria. This does not block or allocate memory.
      *
      * @param objectPath   The object path.
      * @param iface        The interface.
      * @param methodName   The method name.
-     * @return
-     *      - Entry that matches objectPath, interface and method
-     *      - NULL if not found
+     * @param safeEntry    Returns the entry that matches objectPath, interface and method. The
+     *                     entry cannot be removed until safeEntry is destroyed.
+     *
+     * @return  true if an entry was found.
      */
-    SafeEntry* Find(const char* objectPath, const char* iface, const char* methodName);
+    bool Find(const char* objectPath, const char* iface, const char* methodName, SafeEntry& safeEntry);
 
     /**
      * Remove all hash entries related to the specified object.
@@ -146,7 +157,7 @@ class MethodTable {
 
   private:
 
-    qcc::Mutex lock; /**< Lock protecting the method table */
+    qcc::Mutex lock; /**< Lock serializing changes to the method table */
 
     /**
      * Type definition for method hash table key
@@ -199,7 +210,13 @@ class MethodTable {
 
     /** The hash table */
     typedef std::tr1::unordered_map<Key, Entry*, Hash, Equal> MapType;
-    MapType hashTable;
+    CopyOnWrite<MapType> hashTable;
+
+    MapType* update;               /**< The snapshot being built while an object's methods are added */
+    std::vector<Entry*> retired;   /**< Entries to delete once no lookup can be using them */
+
+    void Insert(MapType& table, const Key& key, Entry* entry);
+    void DeleteRetired();
 };
 
 }
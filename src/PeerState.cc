@@ -65,67 +65,224 @@ uint32_t _PeerState::EstimateTimestamp(uint32_t remote)
     return remote + static_cast<uint32_t>(clockOffset);
 }
 
-#define IN_RANGE(val, start, sz) ((((start) <= ((start) + (sz))) && ((val) >= (start)) && ((val) < ((start) + (sz)))) || \
-                                  (((start) > ((start) + (sz))) && !(((val) >= ((start) + (sz))) && ((val) < (start)))))
-
 bool _PeerState::IsValidSerial(uint32_t serial, bool secure, bool unreliable)
 {
-    bool ret = false;
     /*
      * Serial 0 is always invalid.
      */
-    if (serial != 0) {
-        const size_t winSize = sizeof(window) / sizeof(window[0]);
-        uint32_t* entry = window + (serial % winSize);
-        if ((*entry != serial) && IN_RANGE(serial, *entry, numeric_limits<uint32_t>::max() / 2)) {
-            *entry = serial;
-            ret = true;
+    if (serial == 0) {
+        return false;
+    }
+    const uint32_t numWords = static_cast<uint32_t>(window.size());
+    int32_t ahead = static_cast<int32_t>(serial - windowTop);
+    if ((ahead > 0) || (windowTop == 0)) {
+        /*
+         * Slide the window forward clearing the words for the serial numbers we skipped over.
+         */
+        uint32_t words = ((serial >> 5) - (windowTop >> 5)) & (0xFFFFFFFF >> 5);
+        if ((words > numWords) || (windowTop == 0)) {
+            words = numWords;
         }
+        for (uint32_t i = 1; i <= words; ++i) {
+            window[((windowTop >> 5) + i) % numWords] = 0;
+        }
+        windowTop = serial;
+    } else if ((windowTop - serial) >= windowSize) {
+        /*
+         * Too old to tell if this is a replay
+         */
+        return false;
+    }
+    uint32_t& word = window[(serial >> 5) % numWords];
+    uint32_t bit = 1U << (serial & 31);
+    if (word & bit) {
+        return false;
     }
-    return ret;
+    word |= bit;
+    return true;
+}
 
+void _PeerState::SetSerialWindowSize(uint32_t size)
+{
+    if (size > MAX_SERIAL_WINDOW) {
+        size = MAX_SERIAL_WINDOW;
+    } else if (size < 32) {
+        size = 32;
+    }
+    if (size != windowSize) {
+        /*
+         * The number of words is a power of 2 so the ring stays contiguous when serial numbers wrap.
+         */
+        size_t numWords = 2;
+        while (numWords < (((size + 31) >> 5) + 1)) {
+            numWords <<= 1;
+        }
+        std::vector<uint32_t> old(numWords, 0);
+        old.swap(window);
+        uint32_t oldSize = windowSize;
+        windowSize = size;
+        /*
+         * Copy the serial numbers that are inside both windows
+         */
+        uint32_t keep = (oldSize < size) ? oldSize : size;
+        for (uint32_t i = 0; windowTop && (i < keep); ++i) {
+            uint32_t serial = windowTop - i;
+            if (old[(serial >> 5) % old.size()] & (1U << (serial & 31))) {
+                window[(serial >> 5) % window.size()] |= (1U << (serial & 31));
+            }
+        }
+    }
 }
 
-PeerStateTable::PeerStateTable()
+PeerStateTable::PeerStateTable(size_t maxPeers, uint32_t idleTimeout) :
+    maxPerShard((maxPeers + NUM_SHARDS - 1) / NUM_SHARDS),
+    idleTimeout(idleTimeout),
+    serialWindow(_PeerState::DEFAULT_SERIAL_WINDOW)
 {
     Clear();
 }
 
-PeerState PeerStateTable::GetPeerState(const qcc::String& busName)
+bool PeerStateTable::IsEvictable(const qcc::String& busName, const Entry& entry)
+{
+    /*
+     * The group key is carried by the null-name peer. Peers with keys or that are being
+     * authenticated are only removed when they leave the bus.
+     */
+    return !busName.empty() && !entry.peerState->IsSecure() && !entry.peerState->GetAuthEvent();
+}
+
+void PeerStateTable::EvictOldest(Shard& shard)
+{
+    PeerMap::iterator oldest = shard.peerMap.end();
+    for (PeerMap::iterator iter = shard.peerMap.begin(); iter != shard.peerMap.end(); ++iter) {
+        if (IsEvictable(iter->first, iter->second) && ((oldest == shard.peerMap.end()) || (iter->second.lastAccess < oldest->second.lastAccess))) {
+            oldest = iter;
+        }
+    }
+    if (oldest != shard.peerMap.end()) {
+        QCC_DbgHLPrintf(("PeerStateTable::EvictOldest() evicting %s", oldest->first.c_str()));
+        shard.peerMap.erase(oldest);
+        ++shard.evictions;
+    }
+}
+
+void PeerStateTable::Insert(Shard& shard, const qcc::String& busName, const Entry& entry)
+{
+    PeerMap::iterator iter = shard.peerMap.find(busName);
+    if (iter != shard.peerMap.end()) {
+        iter->second = entry;
+    } else {
+        if (shard.peerMap.size() >= maxPerShard) {
+            EvictOldest(shard);
+        }
+        shard.peerMap.insert(PeerMap::value_type(busName, entry));
+    }
+}
+
+PeerState PeerStateTable::GetPeerState(const qcc::String& busName, bool createIfUnknown)
 {
-    lock.Lock(MUTEX_CONTEXT);
-    QCC_DbgHLPrintf(("PeerStateTable::GetPeerState() %s state for %s", peerMap.count(busName) ? "got" : "no", busName.c_str()));
-    PeerState result = peerMap[busName];
-    lock.Unlock(MUTEX_CONTEXT);
+    PeerState result;
+    Shard& shard = GetShard(busName);
+    uint64_t now = GetTimestamp64();
+    shard.lock.Lock(MUTEX_CONTEXT);
+    PeerMap::iterator iter = shard.peerMap.find(busName);
+    if (iter != shard.peerMap.end()) {
+        QCC_DbgHLPrintf(("PeerStateTable::GetPeerState() got state for %s", busName.c_str()));
+        iter->second.lastAccess = now;
+        result = iter->second.peerState;
+        ++shard.hits;
+    } else {
+        QCC_DbgHLPrintf(("PeerStateTable::GetPeerState() no state for %s", busName.c_str()));
+        ++shard.misses;
+        if (createIfUnknown) {
+            result->SetSerialWindowSize(serialWindow);
+            Insert(shard, busName, Entry(result, now));
+        }
+    }
+    shard.lock.Unlock(MUTEX_CONTEXT);
 
     return result;
 }
 
+bool PeerStateTable::IsKnownPeer(const qcc::String& busName)
+{
+    Shard& shard = GetShard(busName);
+    shard.lock.Lock(MUTEX_CONTEXT);
+    bool known = shard.peerMap.count(busName) > 0;
+    shard.lock.Unlock(MUTEX_CONTEXT);
+    return known;
+}
+
 PeerState PeerStateTable::GetPeerState(const qcc::String& uniqueName, const qcc::String& aliasName)
 {
     assert(uniqueName[0] == ':');
     PeerState result;
-    lock.Lock(MUTEX_CONTEXT);
-    std::map<const qcc::String, PeerState>::iterator iter = peerMap.find(uniqueName);
-    if (iter == peerMap.end()) {
+    Shard& uniqueShard = GetShard(uniqueName);
+    Shard& aliasShard = GetShard(aliasName);
+    uint64_t now = GetTimestamp64();
+    /*
+     * Lock the shards in a consistent order so the unique name and alias are updated atomically.
+     */
+    Shard* first = (&uniqueShard < &aliasShard) ? &uniqueShard : &aliasShard;
+    Shard* second = (&uniqueShard < &aliasShard) ? &aliasShard : &uniqueShard;
+    first->lock.Lock(MUTEX_CONTEXT);
+    if (second != first) {
+        second->lock.Lock(MUTEX_CONTEXT);
+    }
+    PeerMap::iterator iter = uniqueShard.peerMap.find(uniqueName);
+    if (iter == uniqueShard.peerMap.end()) {
         QCC_DbgHLPrintf(("PeerStateTable::GetPeerState() no state stored for %s aka %s", uniqueName.c_str(), aliasName.c_str()));
-        result = peerMap[aliasName];
-        peerMap[uniqueName] = result;
+        ++uniqueShard.misses;
+        PeerMap::iterator alias = aliasShard.peerMap.find(aliasName);
+        if (alias != aliasShard.peerMap.end()) {
+            result = alias->second.peerState;
+            alias->second.lastAccess = now;
+        } else {
+            result->SetSerialWindowSize(serialWindow);
+            Insert(aliasShard, aliasName, Entry(result, now));
+        }
+        Insert(uniqueShard, uniqueName, Entry(result, now));
     } else {
         QCC_DbgHLPrintf(("PeerStateTable::GetPeerState() got state for %s aka %s", uniqueName.c_str(), aliasName.c_str()));
-        result = iter->second;
-        peerMap[aliasName] = result;
+        ++uniqueShard.hits;
+        iter->second.lastAccess = now;
+        result = iter->second.peerState;
+        Insert(aliasShard, aliasName, Entry(result, now));
     }
-    lock.Unlock(MUTEX_CONTEXT);
+    if (second != first) {
+        second->lock.Unlock(MUTEX_CONTEXT);
+    }
+    first->lock.Unlock(MUTEX_CONTEXT);
     return result;
 }
 
 void PeerStateTable::DelPeerState(const qcc::String& busName)
 {
-    lock.Lock(MUTEX_CONTEXT);
-    QCC_DbgHLPrintf(("PeerStateTable::DelPeerState() %s for %s", peerMap.count(busName) ? "remove state" : "no state to remove", busName.c_str()));
-    peerMap.erase(busName);
-    lock.Unlock(MUTEX_CONTEXT);
+    Shard& shard = GetShard(busName);
+    shard.lock.Lock(MUTEX_CONTEXT);
+    QCC_DbgHLPrintf(("PeerStateTable::DelPeerState() %s for %s", shard.peerMap.count(busName) ? "remove state" : "no state to remove", busName.c_str()));
+    shard.peerMap.erase(busName);
+    shard.lock.Unlock(MUTEX_CONTEXT);
+}
+
+void PeerStateTable::EvictIdle()
+{
+    uint64_t now = GetTimestamp64();
+    for (size_t i = 0; i < NUM_SHARDS; ++i) {
+        Shard& shard = shards[i];
+        shard.lock.Lock(MUTEX_CONTEXT);
+        PeerMap::iterator iter = shard.peerMap.begin();
+        while (iter != shard.peerMap.end()) {
+            if (((now - iter->second.lastAccess) > idleTimeout) && IsEvictable(iter->first, iter->second)) {
+                QCC_DbgHLPrintf(("PeerStateTable::EvictIdle() evicting %s", iter->first.c_str()));
+                shard.peerMap.erase(iter++);
+                ++shard.evictions;
+            } else {
+                ++iter;
+            }
+        }
+        shard.lock.Unlock(MUTEX_CONTEXT);
+    }
 }
 
 void PeerStateTable::GetGroupKey(qcc::KeyBlob& key)
@@ -141,25 +298,49 @@ void PeerStateTable::GetGroupKey(qcc::KeyBlob& key)
     groupPeer->SetAuthorization(MESSAGE_SIGNAL, _PeerState::ALLOW_SECURE_TX);
 }
 
+void PeerStateTable::GetStats(Stats& stats)
+{
+    stats.size = 0;
+    stats.hits = 0;
+    stats.misses = 0;
+    stats.evictions = 0;
+    for (size_t i = 0; i < NUM_SHARDS; ++i) {
+        Shard& shard = shards[i];
+        shard.lock.Lock(MUTEX_CONTEXT);
+        stats.size += shard.peerMap.size();
+        stats.hits += shard.hits;
+        stats.misses += shard.misses;
+        stats.evictions += shard.evictions;
+        shard.lock.Unlock(MUTEX_CONTEXT);
+    }
+}
+
 void PeerStateTable::Clear()
 {
     qcc::KeyBlob key;
-    lock.Lock(MUTEX_CONTEXT);
-    peerMap.clear();
+    for (size_t i = 0; i < NUM_SHARDS; ++i) {
+        shards[i].lock.Lock(MUTEX_CONTEXT);
+        shards[i].peerMap.clear();
+        shards[i].lock.Unlock(MUTEX_CONTEXT);
+    }
     PeerState nullPeer;
     QCC_DbgHLPrintf(("Allocating group key"));
     key.Rand(Crypto_AES::AES128_SIZE, KeyBlob::AES);
     key.SetTag("GroupKey", KeyBlob::NO_ROLE);
     nullPeer->SetKey(key, PEER_SESSION_KEY);
-    peerMap[""] = nullPeer;
-    lock.Unlock(MUTEX_CONTEXT);
+    Shard& shard = GetShard("");
+    shard.lock.Lock(MUTEX_CONTEXT);
+    shard.peerMap[""] = Entry(nullPeer, GetTimestamp64());
+    shard.lock.Unlock(MUTEX_CONTEXT);
 }
 
 PeerStateTable::~PeerStateTable()
 {
-    lock.Lock(MUTEX_CONTEXT);
-    peerMap.clear();
-    lock.Unlock(MUTEX_CONTEXT);
+    for (size_t i = 0; i < NUM_SHARDS; ++i) {
+        shards[i].lock.Lock(MUTEX_CONTEXT);
+        shards[i].peerMap.clear();
+        shards[i].lock.Unlock(MUTEX_CONTEXT);
+    }
 }
 
 }
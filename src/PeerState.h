@@ -29,6 +29,7 @@
 
 #include <map>
 #include <limits>
+#include <vector>
 #include <assert.h>
 
 #include <alljoyn/Message.h>
@@ -40,9 +41,14 @@
 #include <qcc/Mutex.h>
 #include <qcc/Event.h>
 #include <qcc/time.h>
+#include <qcc/Util.h>
 
 #include <alljoyn/Status.h>
 
+#include <qcc/STLContainer.h>
+
+#include "AllJoynCrypto.h"
+
 namespace ajn {
 
 /* Forward declaration */
@@ -82,12 +88,24 @@ class _PeerState {
         lastDriftAdjustTime(0),
         expectedSerial(0),
         isSecure(false),
-        authEvent(NULL)
+        authEvent(NULL),
+        windowTop(0),
+        windowSize(0)
     {
-        ::memset(window, 0, sizeof(window));
         ::memset(authorizations, 0, sizeof(authorizations));
+        SetSerialWindowSize(DEFAULT_SERIAL_WINDOW);
     }
 
+    /**
+     * Default number of serial numbers tracked by IsValidSerial().
+     */
+    static const uint32_t DEFAULT_SERIAL_WINDOW = 128;
+
+    /**
+     * Maximum number of serial numbers that can be tracked by IsValidSerial().
+     */
+    static const uint32_t MAX_SERIAL_WINDOW = 64 * 1024;
+
     /**
      * Get the (estimated) timestamp for this remote peer converted to local host time. The estimate
      * is updated based on the timestamp recently received.
@@ -100,9 +118,9 @@ class _PeerState {
 
     /**
      * This method is called whenever a message is unmarshaled. It checks that the serial number is
-     * valid by comparing against the last N serial numbers received from this peer. Secure messages
-     * have additional checks for replay attacks. Unreliable messages are checked for in-order
-     * arrival.
+     * valid by comparing against the last N serial numbers received from this peer. A serial number
+     * is valid if it has not been seen before and is no more than N behind the highest serial
+     * number received.
      *
      * @param serial      The serial number being checked.
      * @param secure      The message was flagged as secure
@@ -141,7 +159,7 @@ class _PeerState {
      * @param keyType    Indicate if this is the unicast or broadcast key.
      */
     void SetKey(const qcc::KeyBlob& key, PeerKeyType keyType) {
-        keys[keyType] = key;
+        ciphers[keyType] = CipherContext(key);
         isSecure = key.IsValid();
     }
 
@@ -155,9 +173,29 @@ class _PeerState {
      *          - ER_BUS_KEY_EXPIRED if there was a session key but the key has expired.
      */
     QStatus GetKey(qcc::KeyBlob& key, PeerKeyType keyType) {
+        CipherContext cipher;
+        QStatus status = GetCipher(cipher, keyType);
+        if (status == ER_OK) {
+            key = cipher->GetKey();
+        }
+        return status;
+    }
+
+    /**
+     * Gets the cipher context for the session key for this peer. The context is created when the
+     * key is set so encrypting or decrypting a message does not have to set up the key again.
+     *
+     * @param cipher    [out]Returns the cipher context for the session key.
+     * @param keyType   Indicate if this is the unicast or broadcast key.
+     *
+     * @return  - ER_OK if there is a session key set for this peer.
+     *          - ER_BUS_KEY_UNAVAILABLE if no session key has been set for this peer.
+     *          - ER_BUS_KEY_EXPIRED if there was a session key but the key has expired.
+     */
+    QStatus GetCipher(CipherContext& cipher, PeerKeyType keyType) {
         if (isSecure) {
-            key = keys[keyType];
-            if (key.HasExpired()) {
+            cipher = ciphers[keyType];
+            if (cipher->GetKey().HasExpired()) {
                 ClearKeys();
                 return ER_BUS_KEY_EXPIRED;
             } else {
@@ -169,11 +207,12 @@ class _PeerState {
     }
 
     /**
-     * Clear the keys for this peer.
+     * Clear the keys for this peer. Messages that are being encrypted or decrypted hold a
+     * reference to the cipher context so the context is released when they are done with it.
      */
     void ClearKeys() {
-        keys[PEER_SESSION_KEY].Erase();
-        keys[PEER_GROUP_KEY].Erase();
+        ciphers[PEER_SESSION_KEY] = CipherContext();
+        ciphers[PEER_GROUP_KEY] = CipherContext();
         isSecure = false;
     }
 
@@ -214,7 +253,15 @@ class _PeerState {
      *
      * @return Size of the serial number validation window.
      */
-    size_t SerialWindowSize() { return sizeof(window) / sizeof(window[0]); }
+    size_t SerialWindowSize() { return windowSize; }
+
+    /**
+     * Set the window size for serial number validation. Serial numbers already received that are
+     * still inside the new window are kept.
+     *
+     * @param size  Number of serial numbers to track, limited to MAX_SERIAL_WINDOW.
+     */
+    void SetSerialWindowSize(uint32_t size);
 
     static const uint8_t ALLOW_SECURE_TX = 0x01; /* Transmit authorization */
     static const uint8_t ALLOW_SECURE_RX = 0x02; /* Receive authorization */
@@ -311,39 +358,79 @@ class _PeerState {
     uint8_t authorizations[4];
 
     /**
-     * The session keys (unicast and broadcast) for this peer.
+     * The session keys (unicast and broadcast) for this peer together with their cipher contexts.
+     */
+    CipherContext ciphers[2];
+
+    /**
+     * Serial number window. Used by IsValidSerial() to detect replay attacks. A ring of bits, one
+     * for each of the serial numbers before windowTop, with at least one extra word so the window
+     * can slide forward a whole word at a time.
      */
-    qcc::KeyBlob keys[2];
+    std::vector<uint32_t> window;
 
     /**
-     * Serial number window. Used by IsValidSerial() to detect replay attacks. The size of the
-     * window defines that largest tolerable gap between consecutive serial numbers.
+     * The highest serial number received.
      */
-    uint32_t window[128];
+    uint32_t windowTop;
+
+    /**
+     * Number of serial numbers behind windowTop that are tracked.
+     */
+    uint32_t windowSize;
 
 };
 
 
 /**
  * This class is a container for managing state information about remote peers.
+ *
+ * The table is split into shards by a hash of the bus name, each with its own lock, so lookups
+ * for different peers rarely contend. Peers that have no keys and are not being authenticated
+ * are evicted when they have been idle for too long or when the table is full.
  */
 class PeerStateTable {
 
   public:
 
+    /**
+     * Default maximum number of bus names in the table.
+     */
+    static const size_t DEFAULT_MAX_PEERS = 4096;
+
+    /**
+     * Default time in milliseconds a peer without keys can be idle before it is evicted.
+     */
+    static const uint32_t DEFAULT_IDLE_TIMEOUT = 10 * 60 * 1000;
+
+    /**
+     * Counters for monitoring the peer state table.
+     */
+    struct Stats {
+        size_t size;          /**< Number of bus names in the table */
+        uint64_t hits;        /**< Number of lookups that found a peer */
+        uint64_t misses;      /**< Number of lookups that did not find a peer */
+        uint64_t evictions;   /**< Number of idle peers evicted */
+    };
+
     /**
      * Constructor
+     *
+     * @param maxPeers     Maximum number of bus names in the table before idle peers are evicted.
+     * @param idleTimeout  Time in milliseconds a peer without keys can be idle before it is evicted.
      */
-    PeerStateTable();
+    PeerStateTable(size_t maxPeers = DEFAULT_MAX_PEERS, uint32_t idleTimeout = DEFAULT_IDLE_TIMEOUT);
 
     /**
      * Get the peer state for given a bus name.
      *
-     * @param busName   The bus name for a remote connection
+     * @param busName          The bus name for a remote connection
+     * @param createIfUnknown  If true peer state is added to the table if the peer is not known.
+     *                         Otherwise new peer state is returned but is not added to the table.
      *
      * @return  The peer state.
      */
-    PeerState GetPeerState(const qcc::String& busName);
+    PeerState GetPeerState(const qcc::String& busName, bool createIfUnknown = true);
 
     /**
      * Fnd out if the bus name is for a known peer.
@@ -352,12 +439,7 @@ class PeerStateTable {
      *
      * @return  Returns true if the peer is known.
      */
-    bool IsKnownPeer(const qcc::String& busName) {
-        lock.Lock(MUTEX_CONTEXT);
-        bool known = peerMap.count(busName) > 0;
-        lock.Unlock(MUTEX_CONTEXT);
-        return known;
-    }
+    bool IsKnownPeer(const qcc::String& busName);
 
     /**
      * Get the peer state looking the peer state up by a unique name or a known alias for the peer.
@@ -378,7 +460,7 @@ class PeerStateTable {
      * @return  Returns true if the two bus names are known to refer to the same peer.
      */
     bool IsAlias(const qcc::String& name1, const qcc::String& name2) {
-        return (name1 == name2) || (GetPeerState(name1).iden(GetPeerState(name2)));
+        return (name1 == name2) || (GetPeerState(name1, false).iden(GetPeerState(name2, false)));
     }
 
     /**
@@ -388,6 +470,12 @@ class PeerStateTable {
      */
     void DelPeerState(const qcc::String& busName);
 
+    /**
+     * Evict peers without keys that have been idle for longer than the idle timeout. This is called
+     * when peers leave the bus so the table does not grow with peers that left unnoticed.
+     */
+    void EvictIdle();
+
     /**
      * Gets the group (broadcast) key for the local peer. This is used to encrypt
      * broadcast messages sent by this peer.
@@ -396,6 +484,21 @@ class PeerStateTable {
      */
     void GetGroupKey(qcc::KeyBlob& key);
 
+    /**
+     * Set the serial number window size for peers added to the table. Peers that send many
+     * messages out of order, for example on unreliable or multipoint sessions, need a larger window.
+     *
+     * @param size  Number of serial numbers tracked for each peer.
+     */
+    void SetSerialWindowSize(uint32_t size) { serialWindow = size; }
+
+    /**
+     * Get the table size and lookup counters.
+     *
+     * @param stats  [out]Returns the counters.
+     */
+    void GetStats(Stats& stats);
+
     /**
      * Clear all peer state.
      */
@@ -409,14 +512,75 @@ class PeerStateTable {
   private:
 
     /**
-     * Mapping table from bus names to peer state.
+     * Number of shards, a power of 2.
+     */
+    static const size_t NUM_SHARDS = 16;
+
+    /**
+     * Peer state and the time it was last looked up.
+     */
+    struct Entry {
+        PeerState peerState;
+        uint64_t lastAccess;
+        Entry() : lastAccess(0) { }
+        Entry(const PeerState& peerState, uint64_t lastAccess) : peerState(peerState), lastAccess(lastAccess) { }
+    };
+
+    /**
+     * Hash functor for bus names.
+     */
+    struct Hash {
+        size_t operator()(const qcc::String& s) const { return qcc::hash_string(s.c_str()); }
+    };
+
+    /**
+     * Type definition for a mapping table from bus names to peer state.
+     */
+    typedef std::tr1::unordered_map<qcc::String, Entry, Hash> PeerMap;
+
+    /**
+     * A shard of the table and its counters.
+     */
+    struct Shard {
+        qcc::Mutex lock;
+        PeerMap peerMap;
+        uint64_t hits;
+        uint64_t misses;
+        uint64_t evictions;
+        Shard() : hits(0), misses(0), evictions(0) { }
+    };
+
+    Shard& GetShard(const qcc::String& busName) { return shards[(Hash()(busName) >> 4) & (NUM_SHARDS - 1)]; }
+
+    bool IsEvictable(const qcc::String& busName, const Entry& entry);
+
+    void EvictOldest(Shard& shard);
+
+    /**
+     * Add or replace the entry for a bus name, evicting the oldest entry first if the shard is full.
+     * Must be called with the shard locked.
+     */
+    void Insert(Shard& shard, const qcc::String& busName, const Entry& entry);
+
+    /**
+     * The shards of the table.
+     */
+    Shard shards[NUM_SHARDS];
+
+    /**
+     * Maximum number of bus names in a shard.
+     */
+    const size_t maxPerShard;
+
+    /**
+     * Time in milliseconds a peer without keys can be idle before it is evicted.
      */
-    std::map<const qcc::String, PeerState> peerMap;
+    const uint32_t idleTimeout;
 
     /**
-     * Mutex to protect the peer table
+     * Serial number window size for new peers.
      */
-    qcc::Mutex lock;
+    volatile uint32_t serialWindow;
 
 };
 
@@ -648,7 +648,7 @@ QStatus ProxyBusObject::MethodCallAsync(const InterfaceDescription::Member& meth
     if ((flags & ALLJOYN_FLAG_ENCRYPTED) && !bus->IsPeerSecurityEnabled()) {
         return ER_BUS_SECURITY_NOT_ENABLED;
     }
-    status = msg->CallMsg(method.signature, serviceName, sessionId, path, method.iface->GetName(), method.name, args, numArgs, flags);
+    status = msg->CallMsg(method.signature, serviceName, sessionId, path, method.iface->GetName(), method.name, args, numArgs, flags, method.argsPlan);
     if (status == ER_OK) {
         if (!(flags & ALLJOYN_FLAG_NO_REPLY_EXPECTED)) {
             status = localEndpoint->RegisterReplyHandler(receiver, replyHandler, method, msg, context, timeout);
@@ -752,7 +752,7 @@ QStatus ProxyBusObject::MethodCall(const InterfaceDescription::Member& method,
         status = ER_BUS_SECURITY_NOT_ENABLED;
         goto MethodCallExit;
     }
-    status = msg->CallMsg(method.signature, serviceName, sessionId, path, method.iface->GetName(), method.name, args, numArgs, flags);
+    status = msg->CallMsg(method.signature, serviceName, sessionId, path, method.iface->GetName(), method.name, args, numArgs, flags, method.argsPlan);
     if (status != ER_OK) {
         goto MethodCallExit;
     }
@@ -20,6 +20,8 @@
 #include <qcc/platform.h>
 
 #include <assert.h>
+#include <algorithm>
+#include <vector>
 
 #include <qcc/Debug.h>
 #include <qcc/String.h>
@@ -52,6 +54,30 @@ namespace ajn {
 
 #define ENDPOINT_IS_DEAD_ALERTCODE  1
 
+/*
+ * Limits on the number of messages and bytes taken from the tx queue and written with a single
+ * gathered write.
+ */
+static const size_t MAX_TX_BATCH_MSGS = 16;
+static const size_t MAX_TX_BATCH_BYTES = 64 * 1024;
+
+/*
+ * Default tx queue watermarks in bytes. A push to the normal lane blocks once the queue reaches
+ * the high watermark until it drains to the low watermark.
+ */
+static const size_t DEFAULT_TX_HIGH_WATERMARK = 128 * 1024;
+static const size_t DEFAULT_TX_LOW_WATERMARK = 64 * 1024;
+
+/*
+ * Transmit lanes, higher priority lanes are always drained first. Which lane a message goes in
+ * only depends on its sender so the messages from each sender stay in order.
+ */
+enum TxLane {
+    TX_LANE_HIGH = 0,    /**< Control messages from the bus controllers */
+    TX_LANE_NORMAL = 1,  /**< All other messages */
+    TX_NUM_LANES = 2
+};
+
 class _RemoteEndpoint::Internal {
     friend class _RemoteEndpoint;
   public:
@@ -59,7 +85,11 @@ class _RemoteEndpoint::Internal {
     Internal(BusAttachment& bus, bool incoming, const qcc::String& connectSpec, Stream* stream, const char* threadName, bool isSocket) :
         bus(bus),
         stream(stream),
-        txQueue(),
+        txQueuedBytes(0),
+        txLaneBytes(),
+        txHighWatermark(DEFAULT_TX_HIGH_WATERMARK),
+        txLowWatermark(DEFAULT_TX_LOW_WATERMARK),
+        txBlocked(false),
         txWaitQueue(),
         lock(),
         exitCount(0),
@@ -78,23 +108,73 @@ class _RemoteEndpoint::Internal {
         threadName(threadName),
         started(false),
         currentReadMsg(bus),
+        rxBuffer(NULL),
         validateSender(incoming),
         hasRxSessionMsg(false),
-        getNextMsg(true),
-        currentWriteMsg(bus),
+        txBatchHead(0),
+        txInFlight(0),
+        gatherWrites(false),
         stopping(false),
-        sessionId(0)
+        sessionId(0),
+        auth(NULL),
+        dispatching(false)
     {
     }
 
     ~Internal() {
+        delete rxBuffer;
+        delete auth;
+    }
+
+    /*
+     * Clear the blocked state and alert the threads waiting for the txQueue to drain. Called
+     * with the lock held.
+     */
+    void UnblockTx()
+    {
+        txBlocked = false;
+        while (!txWaitQueue.empty()) {
+            Thread* wakeMe = txWaitQueue.back();
+            txWaitQueue.pop_back();
+            QStatus status = wakeMe->Alert();
+            if (ER_OK != status) {
+                QCC_LogError(status, ("Failed to alert thread blocked on full tx queue"));
+            }
+        }
+    }
+
+    /*
+     * Check if a push to a lane has to wait for the queue to drain. Called with the lock held.
+     */
+    bool TxMustWait(TxLane lane) const
+    {
+        if (lane == TX_LANE_NORMAL) {
+            return txBlocked;
+        } else {
+            return txLaneBytes[lane] > txHighWatermark;
+        }
+    }
+
+    bool TxQueueEmpty() const
+    {
+        for (size_t lane = 0; lane < TX_NUM_LANES; ++lane) {
+            if (!txQueue[lane].empty()) {
+                return false;
+            }
+        }
+        return true;
     }
 
     BusAttachment& bus;                      /**< Message bus associated with this endpoint */
     qcc::Stream* stream;                     /**< Stream for this endpoint or NULL if uninitialized */
 
-    std::deque<Message> txQueue;             /**< Transmit message queue */
-    std::deque<qcc::Thread*> txWaitQueue;    /**< Threads waiting for txQueue to become not-full */
+    std::deque<Message> txQueue[TX_NUM_LANES]; /**< Transmit message queue for each lane */
+    size_t txQueuedBytes;                    /**< Bytes in the txQueue lanes plus bytes being written */
+    size_t txLaneBytes[TX_NUM_LANES];        /**< Bytes in each txQueue lane */
+    size_t txHighWatermark;                  /**< Pushes to the normal lane block at this many queued bytes */
+    size_t txLowWatermark;                   /**< Blocked pushes resume when the queue drains to this many bytes */
+    bool txBlocked;                          /**< True from reaching the high watermark until the low watermark */
+    std::deque<qcc::Thread*> txWaitQueue;    /**< Threads waiting for the txQueue to drain */
     qcc::Mutex lock;                         /**< Mutex that protects the txQueue and timeout values */
     int32_t exitCount;                       /**< Number of sub-threads (rx and tx) that have exited (atomically incremented) */
 
@@ -122,12 +202,20 @@ class _RemoteEndpoint::Internal {
     bool started;                            /**< Is this EP started? */
 
     Message currentReadMsg;                  /**< The message currently being read for this endpoint */
+    _Message::ReadBuffer* rxBuffer;          /**< Buffer for reading several messages at a time or NULL */
     bool validateSender;                     /**< If true, the sender field on incomming messages will be overwritten with actual endpoint name */
     bool hasRxSessionMsg;                    /**< true iff this endpoint has previously processed a non-control message */
-    bool getNextMsg;                         /**< If true, read the next message from the txQueue */
-    Message currentWriteMsg;                 /**< The message currently being read for this endpoint */
+    std::vector<Message> txBatch;            /**< Messages taken from the txQueue to be written */
+    _Message::WriteCursor txCursors[MAX_TX_BATCH_MSGS]; /**< Write state of each message in txBatch for this endpoint */
+    size_t txSizes[MAX_TX_BATCH_MSGS];       /**< Queued size of each message in txBatch */
+    size_t txBatchHead;                      /**< Index of the first message in txBatch that is not completely written */
+    size_t txInFlight;                       /**< Number of messages in txBatch that are not completely written */
+    bool gatherWrites;                       /**< If true, write several messages at a time with PushBytesGathered */
+    TxStats txStats;                         /**< Transmit statistics */
     bool stopping;                           /**< Is this EP stopping? */
     uint32_t sessionId;                      /**< SessionId for BusToBus endpoint. (not used for non-B2B endpoints) */
+    EndpointAuth* auth;                      /**< Authentication in progress for EstablishAdvance() or NULL */
+    bool dispatching;                        /**< True if StartDispatch() registered the stream before Start() */
 };
 
 
@@ -228,28 +316,84 @@ QStatus _RemoteEndpoint::Establish(const qcc::String& authMechanisms, qcc::Strin
 
         status = auth.Establish(authMechanisms, authUsed, redirection, listener);
         if (status == ER_OK) {
-            internal->uniqueName = auth.GetUniqueName();
-            internal->remoteName = auth.GetRemoteName();
-            internal->remoteGUID = auth.GetRemoteGUID();
-            internal->features.protocolVersion = auth.GetRemoteProtocolVersion();
-            internal->features.trusted = (authUsed != "ANONYMOUS") || (GetConnectSpec() == "localhost");
-
-            if (internal->incoming && !internal->features.trusted && !internal->features.isBusToBus) {
-                /* If a transport expects to accept untrusted clients, it MUST implement the
-                 * UntrustedClientStart and UntrustedClientExit methods and call SetListener
-                 * before making a call to _RemoteEndpoint::Establish(). So assert if the
-                 * internal->listener is NULL.
-                 * Note: It is required to set the listener only on the accepting end
-                 * i.e. for incoming endpoints.
-                 */
-                assert(internal->listener);
-                status = internal->listener->UntrustedClientStart();
-            }
+            status = EstablishComplete(auth, authUsed);
         }
     }
     return status;
 }
 
+QStatus _RemoteEndpoint::EstablishComplete(EndpointAuth& auth, const qcc::String& authUsed)
+{
+    QStatus status = ER_OK;
+
+    internal->uniqueName = auth.GetUniqueName();
+    internal->remoteName = auth.GetRemoteName();
+    internal->remoteGUID = auth.GetRemoteGUID();
+    internal->features.protocolVersion = auth.GetRemoteProtocolVersion();
+    internal->features.trusted = (authUsed != "ANONYMOUS") || (GetConnectSpec() == "localhost");
+
+    if (internal->incoming && !internal->features.trusted && !internal->features.isBusToBus) {
+        /* If a transport expects to accept untrusted clients, it MUST implement the
+         * UntrustedClientStart and UntrustedClientExit methods and call SetListener
+         * before making a call to _RemoteEndpoint::Establish(). So assert if the
+         * internal->listener is NULL.
+         * Note: It is required to set the listener only on the accepting end
+         * i.e. for incoming endpoints.
+         */
+        assert(internal->listener);
+        status = internal->listener->UntrustedClientStart();
+    }
+    return status;
+}
+
+QStatus _RemoteEndpoint::EstablishBegin(const qcc::String& authMechanisms, AuthListener* listener)
+{
+    if (!internal) {
+        return ER_BUS_NO_ENDPOINT;
+    }
+    if (!internal->incoming || internal->auth) {
+        return ER_BUS_ESTABLISH_FAILED;
+    }
+    RemoteEndpoint rep = RemoteEndpoint::wrap(this);
+    internal->auth = new EndpointAuth(internal->bus, rep, true);
+    internal->auth->AcceptBegin(authMechanisms, listener);
+    return ER_OK;
+}
+
+QStatus _RemoteEndpoint::EstablishAdvance(qcc::String& authUsed)
+{
+    if (!internal) {
+        return ER_BUS_NO_ENDPOINT;
+    }
+    if (!internal->auth) {
+        return ER_BUS_ESTABLISH_FAILED;
+    }
+    QStatus status = internal->auth->AcceptAdvance(authUsed);
+    if (status == ER_OK) {
+        status = EstablishComplete(*internal->auth, authUsed);
+    }
+    /*
+     * The authentication holds a reference to this endpoint so it must be freed when it is done.
+     */
+    if (status != ER_WOULDBLOCK) {
+        EstablishCancel();
+    }
+    return status;
+}
+
+bool _RemoteEndpoint::EstablishMayBlock() const
+{
+    return internal && internal->auth && internal->auth->AcceptMayBlock();
+}
+
+void _RemoteEndpoint::EstablishCancel()
+{
+    if (internal) {
+        delete internal->auth;
+        internal->auth = NULL;
+    }
+}
+
 QStatus _RemoteEndpoint::SetLinkTimeout(uint32_t& idleTimeout)
 {
     if (internal) {
@@ -317,6 +461,14 @@ QStatus _RemoteEndpoint::Start()
     }
     /* Set the send timeout for this endpoint */
     internal->stream->SetSendTimeout(0);
+    internal->gatherWrites = internal->isSocket && SupportsGatheredWrites();
+    /*
+     * Read messages through a buffer unless handles can be passed. Handles arrive with the first
+     * byte of the message they belong to so the message boundaries must line up with the reads.
+     */
+    if (internal->isSocket && !internal->features.handlePassing && !internal->rxBuffer) {
+        internal->rxBuffer = new _Message::ReadBuffer();
+    }
 
     /* Endpoint needs to be wrapped before we can use it */
     RemoteEndpoint me = RemoteEndpoint::wrap(this);
@@ -325,7 +477,11 @@ QStatus _RemoteEndpoint::Start()
     BusEndpoint bep = BusEndpoint::cast(me);
     status = router.RegisterEndpoint(bep);
     if (status == ER_OK) {
-        status = iodispatch.StartStream(internal->stream, this, this, this);
+        if (internal->dispatching) {
+            status = iodispatch.EnableReadCallback(internal->stream);
+        } else {
+            status = iodispatch.StartStream(internal->stream, this, this, this);
+        }
         if (status != ER_OK) {
             /* Failed to register with iodispatch */
             router.UnregisterEndpoint(this->GetUniqueName(), this->GetEndpointType());
@@ -342,6 +498,21 @@ QStatus _RemoteEndpoint::Start()
     return status;
 }
 
+QStatus _RemoteEndpoint::StartDispatch()
+{
+    assert(internal);
+    assert(internal->stream);
+    if (internal->started || internal->dispatching) {
+        return ER_BUS_BUS_ALREADY_STARTED;
+    }
+    /* Writes are not dispatched until the endpoint is started */
+    QStatus status = internal->bus.GetInternal().GetIODispatch().StartStream(internal->stream, this, this, this, true, false);
+    if (status == ER_OK) {
+        internal->dispatching = true;
+    }
+    return status;
+}
+
 void _RemoteEndpoint::SetListener(EndpointListener* listener)
 {
     if (internal) {
@@ -388,7 +559,7 @@ QStatus _RemoteEndpoint::StopAfterTxEmpty(uint32_t maxWaitMs)
     /* Wait for txqueue to empty before triggering stop */
     internal->lock.Lock(MUTEX_CONTEXT);
     while (true) {
-        if (internal->txQueue.empty() || (maxWaitMs && (qcc::GetTimestamp() > (startTime + maxWaitMs)))) {
+        if ((internal->TxQueueEmpty() && (internal->txInFlight == 0)) || (maxWaitMs && (qcc::GetTimestamp() > (startTime + maxWaitMs)))) {
             status = Stop();
             break;
         } else {
@@ -453,6 +624,19 @@ static inline bool IsControlMessage(Message& msg)
     return (::strcmp(sender + offset, ".1") == 0) ? true : false;
 }
 
+/*
+ * Control messages are queued ahead of bulk traffic. Replies and errors from other senders stay
+ * in the normal lane because they must not overtake the messages their sender queued before them.
+ */
+static inline TxLane GetTxLane(Message& msg)
+{
+    if (IsControlMessage(msg)) {
+        return TX_LANE_HIGH;
+    } else {
+        return TX_LANE_NORMAL;
+    }
+}
+
 void _RemoteEndpoint::ExitCallback() {
     /* Ensure the endpoint is valid */
     if (!internal) {
@@ -506,7 +690,15 @@ QStatus _RemoteEndpoint::ReadCallback(qcc::Source& source, bool isTimedOut)
         status = ER_OK;
         while (status == ER_OK) {
 
-            status = internal->currentReadMsg->ReadNonBlocking(rep, (internal->validateSender && !bus2bus));
+            if (internal->rxBuffer) {
+                /*
+                 * If the endpoint is going to pause after the next reply don't read any bytes
+                 * beyond the end of the message. They belong to whoever takes over the stream.
+                 */
+                status = internal->currentReadMsg->ReadBuffered(rep, *internal->rxBuffer, (internal->validateSender && !bus2bus), internal->armRxPause);
+            } else {
+                status = internal->currentReadMsg->ReadNonBlocking(rep, (internal->validateSender && !bus2bus));
+            }
             if (status == ER_OK) {
                 /* Message read complete.Proceed to unmarshal it. */
                 Message msg = internal->currentReadMsg;
@@ -665,6 +857,127 @@ QStatus _RemoteEndpoint::ReadCallback(qcc::Source& source, bool isTimedOut)
     }
     return status;
 }
+void _RemoteEndpoint::FillTxBatch()
+{
+    assert(internal->txBatchHead == internal->txBatch.size());
+    internal->txBatch.clear();
+    internal->txBatchHead = 0;
+
+    size_t batchBytes = 0;
+    for (size_t lane = 0; lane < TX_NUM_LANES; ++lane) {
+        deque<Message>& queue = internal->txQueue[lane];
+        while (!queue.empty()) {
+            Message& next = queue.back();
+            size_t len = next->bufEOD - reinterpret_cast<const uint8_t*>(next->msgBuf);
+            /*
+             * Messages are only gathered if the stream supports it, messages with handles are
+             * always written on their own.
+             */
+            if (!internal->txBatch.empty()) {
+                if (!internal->gatherWrites || internal->txBatch.front()->handles || next->handles) {
+                    break;
+                }
+                if ((internal->txBatch.size() == MAX_TX_BATCH_MSGS) || ((batchBytes + len) > MAX_TX_BATCH_BYTES)) {
+                    break;
+                }
+            }
+            /*
+             * The write state is kept in the endpoint's write cursors so the message can be
+             * shared with the tx queues of other endpoints. Messages that still have to be
+             * encrypted are modified during delivery so they get a copy which shares the wire
+             * buffer until the encryption copies it.
+             */
+            internal->txSizes[internal->txBatch.size()] = len;
+            if (next->encrypt) {
+                internal->txBatch.push_back(Message(next, true));
+            } else {
+                internal->txBatch.push_back(next);
+            }
+            batchBytes += len;
+            internal->txLaneBytes[lane] -= (std::min)(internal->txLaneBytes[lane], len);
+            queue.pop_back();
+        }
+    }
+    internal->txInFlight = internal->txBatch.size();
+}
+
+QStatus _RemoteEndpoint::WriteTxBatch(RemoteEndpoint& rep)
+{
+    QStatus status = ER_OK;
+    TxBuffer bufs[MAX_TX_BATCH_MSGS];
+    size_t numBufs = 0;
+
+    for (size_t i = internal->txBatchHead; i < internal->txBatch.size(); ++i) {
+        _Message::WriteCursor& cursor = internal->txCursors[i];
+        if (!cursor.IsStarted()) {
+            status = internal->txBatch[i]->BeginDelivery(rep, cursor);
+            if (status != ER_OK) {
+                if (i == internal->txBatchHead) {
+                    return status;
+                }
+                /*
+                 * Write the messages ahead of this one, the error is reported when this message
+                 * reaches the head of the batch.
+                 */
+                status = ER_OK;
+                break;
+            }
+        }
+        if (!cursor.IsComplete()) {
+            bufs[numBufs].buf = cursor.GetWritePtr();
+            bufs[numBufs].len = cursor.GetRemaining();
+            ++numBufs;
+        }
+    }
+    /*
+     * Nothing to write if all the remaining messages were discarded (e.g. TTL expired)
+     */
+    if (numBufs == 0) {
+        return ER_OK;
+    }
+    size_t sent = 0;
+    status = PushBytesGathered(bufs, numBufs, sent);
+
+    internal->lock.Lock(MUTEX_CONTEXT);
+    ++internal->txStats.writes;
+    internal->lock.Unlock(MUTEX_CONTEXT);
+
+    if (status == ER_OK) {
+        /*
+         * Advance the write cursors over the bytes sent, a partial write can end anywhere in the
+         * batch and the remainder is written on the next call.
+         */
+        for (size_t i = internal->txBatchHead; (sent > 0) && (i < internal->txBatch.size()); ++i) {
+            _Message::WriteCursor& cursor = internal->txCursors[i];
+            size_t n = (std::min)(sent, cursor.GetRemaining());
+            cursor.Advance(n);
+            sent -= n;
+        }
+    } else if (status == ER_WOULDBLOCK) {
+        status = ER_TIMEOUT;
+    }
+    return status;
+}
+
+void _RemoteEndpoint::CompleteTxBatch()
+{
+    internal->lock.Lock(MUTEX_CONTEXT);
+    while ((internal->txBatchHead < internal->txBatch.size()) && internal->txCursors[internal->txBatchHead].IsComplete()) {
+        _Message::WriteCursor& cursor = internal->txCursors[internal->txBatchHead];
+        ++internal->txStats.messages;
+        internal->txStats.writes += cursor.GetNumWrites();
+        cursor.Reset();
+        internal->txQueuedBytes -= (std::min)(internal->txQueuedBytes, internal->txSizes[internal->txBatchHead]);
+        --internal->txInFlight;
+        ++internal->txBatchHead;
+    }
+    /* Let blocked pushes continue once the queue has drained to the low watermark */
+    if (internal->txBlocked && (internal->txQueuedBytes <= internal->txLowWatermark)) {
+        internal->UnblockTx();
+    }
+    internal->lock.Unlock(MUTEX_CONTEXT);
+}
+
 /* Note: isTimedOut indicates that this is a timeout alarm. This is for future
  * use if SendTimeout functionality is required.
  * Currently unused.
@@ -678,26 +991,13 @@ QStatus _RemoteEndpoint::WriteCallback(qcc::Sink& sink, bool isTimedOut) {
         return ER_BUS_NO_ENDPOINT;
     }
 
+    RemoteEndpoint rep = RemoteEndpoint::wrap(this);
     QStatus status = ER_OK;
     while (status == ER_OK) {
-        if (internal->getNextMsg) {
+        if (internal->txBatchHead == internal->txBatch.size()) {
             internal->lock.Lock(MUTEX_CONTEXT);
-            if (!internal->txQueue.empty()) {
-                /* Make a deep copy of the message since there is state information inside the message.
-                 * Each copy of the message could be in different write state.
-                 */
-                internal->currentWriteMsg = Message(internal->txQueue.back(), true);
-
-                /* Alert next thread on wait queue */
-                if (0 < internal->txWaitQueue.size()) {
-                    Thread* wakeMe = internal->txWaitQueue.back();
-                    internal->txWaitQueue.pop_back();
-                    status = wakeMe->Alert();
-                    if (ER_OK != status) {
-                        QCC_LogError(status, ("Failed to alert thread blocked on full tx queue"));
-                    }
-                }
-                internal->getNextMsg = false;
+            if (!internal->TxQueueEmpty()) {
+                FillTxBatch();
                 internal->lock.Unlock(MUTEX_CONTEXT);
             } else {
 
@@ -706,25 +1006,32 @@ QStatus _RemoteEndpoint::WriteCallback(qcc::Sink& sink, bool isTimedOut) {
                 return ER_OK;
             }
         }
-        /* Deliver message */
-        RemoteEndpoint rep = RemoteEndpoint::wrap(this);
-        status = internal->currentWriteMsg->DeliverNonBlocking(rep);
+        Message& msg = internal->txBatch[internal->txBatchHead];
+        _Message::WriteCursor& cursor = internal->txCursors[internal->txBatchHead];
+        if (internal->gatherWrites && !msg->handles) {
+            /*
+             * Deliver as many messages as possible with a single write. A message that fails
+             * BeginDelivery() is reported here once it reaches the head of the batch.
+             */
+            status = WriteTxBatch(rep);
+        } else {
+            /* Deliver message */
+            status = msg->DeliverNonBlocking(rep, cursor);
+        }
         /* Report authorization failure as a security violation */
         if (status == ER_BUS_NOT_AUTHORIZED) {
-            internal->bus.GetInternal().GetLocalEndpoint()->GetPeerObj()->HandleSecurityViolation(internal->currentWriteMsg, status);
+            internal->bus.GetInternal().GetLocalEndpoint()->GetPeerObj()->HandleSecurityViolation(msg, status);
             /*
              * Clear the error after reporting the security violation otherwise we will exit
-             * this thread which will shut down the endpoint.
+             * this thread which will shut down the endpoint. The message is skipped.
              */
             status = ER_OK;
+            cursor.Advance(cursor.GetRemaining());
         }
         if (status == ER_OK) {
-            /* Message has been successfully delivered. i.e. PushBytes is complete
+            /* Messages that have been successfully delivered. i.e. PushBytes is complete
              */
-            internal->lock.Lock(MUTEX_CONTEXT);
-            internal->txQueue.pop_back();
-            internal->getNextMsg = true;
-            internal->lock.Unlock(MUTEX_CONTEXT);
+            CompleteTxBatch();
         }
     }
 
@@ -752,7 +1059,6 @@ QStatus _RemoteEndpoint::WriteCallback(qcc::Sink& sink, bool isTimedOut) {
 QStatus _RemoteEndpoint::PushMessage(Message& msg)
 {
     QCC_DbgTrace(("RemoteEndpoint::PushMessage %s (serial=%d)", GetUniqueName().c_str(), msg->GetCallSerial()));
-    static const size_t MAX_TX_QUEUE_SIZE = 30;
 
     QStatus status = ER_OK;
 
@@ -771,35 +1077,39 @@ QStatus _RemoteEndpoint::PushMessage(Message& msg)
     if (internal->stopping) {
         return ER_BUS_ENDPOINT_CLOSING;
     }
+    TxLane lane = GetTxLane(msg);
+    size_t len = msg->bufEOD - reinterpret_cast<const uint8_t*>(msg->msgBuf);
+    bool wasEmpty = false;
+
     internal->lock.Lock(MUTEX_CONTEXT);
-    size_t count = internal->txQueue.size();
-    bool wasEmpty = (count == 0);
-    if (MAX_TX_QUEUE_SIZE > count) {
-        internal->txQueue.push_front(msg);
-    } else {
-        while (true) {
+    /*
+     * The normal lane waits for the whole queue to drain. Control messages are never held up
+     * behind bulk traffic but they wait if the high lane by itself goes over the high watermark.
+     */
+    if (internal->TxMustWait(lane)) {
+        uint32_t blockStart = GetTimestamp();
+        ++internal->txStats.blockedCount;
+        while (internal->TxMustWait(lane)) {
             /* Remove a queue entry whose TTLs is expired if possible */
-            deque<Message>::iterator it = internal->txQueue.begin();
+            deque<Message>& queue = internal->txQueue[lane];
+            deque<Message>::iterator it = queue.begin();
             uint32_t maxWait = 20 * 1000;
-            while (it != internal->txQueue.end()) {
+            while (it != queue.end()) {
                 uint32_t expMs;
                 if ((*it)->IsExpired(&expMs)) {
-                    internal->txQueue.erase(it);
+                    size_t expLen = (*it)->bufEOD - reinterpret_cast<const uint8_t*>((*it)->msgBuf);
+                    internal->txQueuedBytes -= (std::min)(internal->txQueuedBytes, expLen);
+                    internal->txLaneBytes[lane] -= (std::min)(internal->txLaneBytes[lane], expLen);
+                    queue.erase(it);
                     break;
                 } else {
                     ++it;
                 }
                 maxWait = (std::min)(maxWait, expMs);
             }
-            if (internal->txQueue.size() < MAX_TX_QUEUE_SIZE) {
-                /* Check queue wasn't drained while we were waiting */
-                if (internal->txQueue.size() == 0) {
-                    wasEmpty = true;
-                }
-                internal->txQueue.push_front(msg);
-                status = ER_OK;
-                break;
-            } else {
+            if (internal->txQueuedBytes <= internal->txLowWatermark) {
+                internal->UnblockTx();
+            } else if (internal->TxMustWait(lane)) {
                 /* This thread will have to wait for room in the queue */
                 Thread* thread = Thread::GetThread();
                 assert(thread);
@@ -827,11 +1137,21 @@ QStatus _RemoteEndpoint::PushMessage(Message& msg)
                 if ((ER_OK != status) && (ER_ALERTED_THREAD != status) && (ER_TIMEOUT != status)) {
                     break;
                 }
-
+                status = ER_OK;
             }
         }
+        internal->txStats.blockedMs += GetTimestamp() - blockStart;
+    }
+    if (status == ER_OK) {
+        /* The write callback has to be enabled if the tx queue was idle */
+        wasEmpty = internal->TxQueueEmpty() && (internal->txInFlight == 0);
+        internal->txQueue[lane].push_front(msg);
+        internal->txQueuedBytes += len;
+        internal->txLaneBytes[lane] += len;
+        if (internal->txQueuedBytes >= internal->txHighWatermark) {
+            internal->txBlocked = true;
+        }
     }
-
 
     if (wasEmpty) {
         internal->bus.GetInternal().GetIODispatch().EnableWriteCallbackNow(internal->stream);
@@ -843,7 +1163,14 @@ QStatus _RemoteEndpoint::PushMessage(Message& msg)
     static uint32_t lastTime = 0;
     uint32_t now = GetTimestamp();
     if ((now - lastTime) > 1000) {
-        QCC_DbgPrintf(("Tx queue size (%s) = %d", GetUniqueName().c_str(), count));
+        TxStats stats;
+        GetTxStats(stats);
+        QCC_DbgPrintf(("Tx queue size (%s) = %u messages %u bytes, blocked %u times for %u ms", GetUniqueName().c_str(),
+                       (uint32_t)stats.queueDepth, (uint32_t)stats.queuedBytes, (uint32_t)stats.blockedCount, (uint32_t)stats.blockedMs));
+        if (stats.messages) {
+            QCC_DbgPrintf(("Tx syscalls per message (%s) = %u.%02u", GetUniqueName().c_str(),
+                           (uint32_t)(stats.writes / stats.messages), (uint32_t)(((stats.writes * 100) / stats.messages) % 100)));
+        }
         lastTime = now;
     }
 #undef QCC_MODULE
@@ -907,4 +1234,33 @@ uint32_t _RemoteEndpoint::GetSessionId() {
     }
 }
 
+void _RemoteEndpoint::SetTxQueueLimits(size_t highWatermark, size_t lowWatermark)
+{
+    if (internal) {
+        internal->lock.Lock(MUTEX_CONTEXT);
+        internal->txHighWatermark = highWatermark;
+        internal->txLowWatermark = (std::min)(lowWatermark, highWatermark);
+        if (internal->txBlocked && (internal->txQueuedBytes <= internal->txLowWatermark)) {
+            internal->UnblockTx();
+        }
+        internal->lock.Unlock(MUTEX_CONTEXT);
+    }
+}
+
+void _RemoteEndpoint::GetTxStats(TxStats& stats) const
+{
+    if (internal) {
+        internal->lock.Lock(MUTEX_CONTEXT);
+        stats = internal->txStats;
+        stats.queueDepth = internal->txInFlight;
+        for (size_t lane = 0; lane < TX_NUM_LANES; ++lane) {
+            stats.queueDepth += internal->txQueue[lane].size();
+        }
+        stats.queuedBytes = internal->txQueuedBytes;
+        internal->lock.Unlock(MUTEX_CONTEXT);
+    } else {
+        stats = TxStats();
+    }
+}
+
 }
@@ -260,6 +260,46 @@ class _RemoteEndpoint : public _BusEndpoint, public qcc::ThreadListener, public
      */
     QStatus Establish(const qcc::String& authMechanisms, qcc::String& authUsed, qcc::String& redirection, AuthListener* listener = NULL);
 
+    /**
+     * Start establishing an incoming connection without blocking. The connection is established by
+     * calling EstablishAdvance() each time data is available on the endpoint's stream.
+     *
+     * @param authMechanisms  The authentication mechanism(s) to accept.
+     * @param listener        Optional authentication listener
+     *
+     * @return
+     *      - ER_OK if successful.
+     *      - An error status otherwise
+     */
+    QStatus EstablishBegin(const qcc::String& authMechanisms, AuthListener* listener = NULL);
+
+    /**
+     * Continue establishing a connection started with EstablishBegin() with the data that is
+     * available on the endpoint's stream without waiting for more.
+     *
+     * @param authUsed        [OUT]    Returns the name of the authentication method
+     *                                 that was used to establish the connection.
+     *
+     * @return
+     *      - ER_OK if the connection has been established.
+     *      - ER_WOULDBLOCK if more data is needed.
+     *      - An error status otherwise
+     */
+    QStatus EstablishAdvance(qcc::String& authUsed);
+
+    /**
+     * Check if the next call to EstablishAdvance() may block calling out to an authentication
+     * listener or the key store.
+     *
+     * @return  true if the next call to EstablishAdvance() may block.
+     */
+    bool EstablishMayBlock() const;
+
+    /**
+     * Abandon establishing a connection started with EstablishBegin().
+     */
+    void EstablishCancel();
+
     /**
      * Get the GUID of the remote side of a bus-to-bus endpoint.
      *
@@ -365,8 +405,73 @@ class _RemoteEndpoint : public _BusEndpoint, public qcc::ThreadListener, public
      */
     void SetSessionId(uint32_t sessionId);
 
+    /**
+     * Transmit statistics for a remote endpoint.
+     */
+    struct TxStats {
+        uint64_t messages;      /**< Number of messages taken off the tx queue */
+        uint64_t writes;        /**< Number of write calls (i.e. system calls) made on the stream */
+        uint64_t queueDepth;    /**< Number of messages currently queued or being written */
+        uint64_t queuedBytes;   /**< Number of bytes currently queued or being written */
+        uint64_t blockedCount;  /**< Number of times PushMessage blocked on a full tx queue */
+        uint64_t blockedMs;     /**< Total time in milliseconds PushMessage spent blocked */
+
+        TxStats() : messages(0), writes(0), queueDepth(0), queuedBytes(0), blockedCount(0), blockedMs(0) { }
+    };
+
+    /**
+     * Set the byte limits for the transmit queue. Once the queued bytes reach the high watermark
+     * callers pushing ordinary messages block until the queue drains to the low watermark.
+     * Control messages from the bus controllers are queued in a separate high priority lane and
+     * only block if that lane by itself goes over the high watermark.
+     *
+     * @param highWatermark  Number of queued bytes at which pushes start blocking.
+     * @param lowWatermark   Number of queued bytes at which blocked pushes are released.
+     */
+    void SetTxQueueLimits(size_t highWatermark, size_t lowWatermark);
+
+    /**
+     * Get the transmit statistics for this endpoint. The number of system calls per message is
+     * writes / messages.
+     *
+     * @param stats  [OUT] Transmit statistics.
+     */
+    void GetTxStats(TxStats& stats) const;
+
   protected:
 
+    /**
+     * A buffer to be written as part of a gathered write.
+     */
+    struct TxBuffer {
+        const uint8_t* buf;  /**< Start of the buffer */
+        size_t len;          /**< Number of bytes in the buffer */
+    };
+
+    /**
+     * Indicate if the stream for this endpoint supports gathered writes. Endpoints that return
+     * true must implement PushBytesGathered(). When gathered writes are supported several
+     * queued messages are written with a single call.
+     *
+     * @return  true if PushBytesGathered() is implemented.
+     */
+    virtual bool SupportsGatheredWrites() const { return false; }
+
+    /**
+     * Write a list of buffers to the stream for this endpoint with a single gathered write
+     * (e.g. writev or sendmsg). Fewer bytes than requested may be written.
+     *
+     * @param bufs     The buffers to write.
+     * @param numBufs  Number of buffers in bufs.
+     * @param numSent  [OUT] Number of bytes written.
+     *
+     * @return
+     *      - ER_OK if some bytes were written.
+     *      - ER_WOULDBLOCK if the stream cannot accept any bytes at this time.
+     *      - An error status otherwise.
+     */
+    virtual QStatus PushBytesGathered(const TxBuffer* bufs, size_t numBufs, size_t& numSent) { return ER_NOT_IMPLEMENTED; }
+
     /**
      * Set link timeout params (with knowledge of the underlying transport characteristics)
      *
@@ -377,6 +482,34 @@ class _RemoteEndpoint : public _BusEndpoint, public qcc::ThreadListener, public
      */
     QStatus SetLinkTimeout(uint32_t idleTimeout, uint32_t probeTimeout, uint32_t maxIdleProbes);
 
+    /**
+     * Register the stream for this endpoint with the IODispatch before the endpoint is started so
+     * a derived class can establish the connection from read callbacks. The derived class handles
+     * ReadCallback() and ExitCallback() itself until it calls Start(), which then uses the
+     * existing registration.
+     *
+     * @return ER_OK if successful.
+     */
+    QStatus StartDispatch();
+
+    /**
+     * Internal callback used to indicate that data is available on the File descriptor.
+     * RemoteEndpoint users should not call this method.
+     *
+     * @param source   Source that data is available on.
+     * @param isTimedOut         false - if the source event has fired.
+     *                           true - if no source event has fired in the specified timeout.
+     */
+    virtual QStatus ReadCallback(qcc::Source& source, bool isTimedOut);
+
+    /**
+     * Internal callback used to indicate that the Stream for this endpoint has been removed
+     * from the IODispatch.
+     * RemoteEndpoint users should not call this method.
+     *
+     */
+    virtual void ExitCallback();
+
   private:
 
     class Internal;
@@ -411,22 +544,43 @@ class _RemoteEndpoint : public _BusEndpoint, public qcc::ThreadListener, public
     bool IsProbeMsg(const Message& msg, bool& isAck);
 
     /**
-     * Internal callback used to indicate that one of the internal threads (rx or tx) has exited.
-     * RemoteEndpoint users should not call this method.
+     * Take messages from the tx queue to be written. Called with the endpoint lock held.
+     */
+    void FillTxBatch();
+
+    /**
+     * Write the messages in the current tx batch with gathered writes.
      *
-     * @param thread   Thread that exited.
+     * @param rep   This endpoint.
+     * @return
+     *      - ER_OK if the messages were written or partially written
+     *      - ER_TIMEOUT if the stream cannot accept more data at this time.
+     *      - An error status otherwise.
      */
-    void ThreadExit(qcc::Thread* thread);
+    QStatus WriteTxBatch(RemoteEndpoint& rep);
 
     /**
-     * Internal callback used to indicate that data is available on the File descriptor.
+     * Remove messages that have been completely written from the current tx batch.
+     */
+    void CompleteTxBatch();
+
+    /**
+     * Save the results of a successful authentication.
+     *
+     * @param auth      The authentication that succeeded.
+     * @param authUsed  The authentication method that was used.
+     *
+     * @return  ER_OK if the endpoint can be used.
+     */
+    QStatus EstablishComplete(EndpointAuth& auth, const qcc::String& authUsed);
+
+    /**
+     * Internal callback used to indicate that one of the internal threads (rx or tx) has exited.
      * RemoteEndpoint users should not call this method.
      *
-     * @param source   Source that data is available on.
-     * @param isTimedOut         false - if the source event has fired.
-     *                           true - if no source event has fired in the specified timeout.
+     * @param thread   Thread that exited.
      */
-    QStatus ReadCallback(qcc::Source& source, bool isTimedOut);
+    void ThreadExit(qcc::Thread* thread);
 
     /**
      * Internal callback used to indicate that data can be written to File descriptor.
@@ -438,14 +592,6 @@ class _RemoteEndpoint : public _BusEndpoint, public qcc::ThreadListener, public
      * @return   ER_OK if successful
      */
     QStatus WriteCallback(qcc::Sink& sink, bool isTimedOut);
-
-    /**
-     * Internal callback used to indicate that the Stream for this endpoint has been removed
-     * from the IODispatch.
-     * RemoteEndpoint users should not call this method.
-     *
-     */
-    void ExitCallback();
 };
 
 }
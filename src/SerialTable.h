@@ -0,0 +1,191 @@
+#ifndef _ALLJOYN_SERIALTABLE_H
+#define _ALLJOYN_SERIALTABLE_H
+/**
+ * @file
+ * This file defines a table of objects indexed by message serial number.
+ */
+
+/******************************************************************************
+ * Copyright 2013, Qualcomm Innovation Center, Inc.
+ *
+ *    Licensed under the Apache License, Version 2.0 (the "License");
+ *    you may not use this file except in compliance with the License.
+ *    You may obtain a copy of the License at
+ *
+ *        http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *    Unless required by applicable law or agreed to in writing, software
+ *    distributed under the License is distributed on an "AS IS" BASIS,
+ *    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *    See the License for the specific language governing permissions and
+ *    limitations under the License.
+ ******************************************************************************/
+
+#ifndef __cplusplus
+#error Only include SerialTable.h in C++ code.
+#endif
+
+#include <qcc/platform.h>
+
+#include <vector>
+
+namespace ajn {
+
+/**
+ * An open addressing hash table mapping serial numbers to pointers. Serial numbers are allocated
+ * sequentially so they are used directly as the hash, outstanding serial numbers fill adjacent
+ * slots and lookups rarely probe more than one slot. Removal shifts entries back rather than
+ * leaving tombstones so the table never needs to be rebuilt to purge deleted entries.
+ *
+ * The table does no locking, the owner must serialize access.
+ */
+template <typename T>
+class SerialTable {
+  public:
+
+    /**
+     * Constructor
+     *
+     * @param capacity  Initial capacity, rounded up to a power of 2.
+     */
+    SerialTable(size_t capacity = 64) : count(0)
+    {
+        size_t n = 8;
+        while (n < capacity) {
+            n <<= 1;
+        }
+        slots.resize(n);
+    }
+
+    /**
+     * Find the object for a serial number.
+     *
+     * @param serial  The serial number.
+     *
+     * @return The object or NULL if there is no object for the serial number.
+     */
+    T* Find(uint32_t serial) const
+    {
+        size_t mask = slots.size() - 1;
+        for (size_t i = serial & mask; slots[i].value; i = (i + 1) & mask) {
+            if (slots[i].serial == serial) {
+                return slots[i].value;
+            }
+        }
+        return NULL;
+    }
+
+    /**
+     * Add or replace the object for a serial number.
+     *
+     * @param serial  The serial number.
+     * @param value   The object, must not be NULL.
+     */
+    void Insert(uint32_t serial, T* value)
+    {
+        if (((count + 1) * 2) > slots.size()) {
+            Grow();
+        }
+        size_t mask = slots.size() - 1;
+        size_t i = serial & mask;
+        while (slots[i].value && (slots[i].serial != serial)) {
+            i = (i + 1) & mask;
+        }
+        if (!slots[i].value) {
+            ++count;
+        }
+        slots[i].serial = serial;
+        slots[i].value = value;
+    }
+
+    /**
+     * Remove the object for a serial number.
+     *
+     * @param serial  The serial number.
+     *
+     * @return The object that was removed or NULL if there was no object for the serial number.
+     */
+    T* Remove(uint32_t serial)
+    {
+        size_t mask = slots.size() - 1;
+        size_t i = serial & mask;
+        while (slots[i].value && (slots[i].serial != serial)) {
+            i = (i + 1) & mask;
+        }
+        T* value = slots[i].value;
+        if (value) {
+            /*
+             * Shift back any following entries that would no longer be reachable from their home slot
+             */
+            for (size_t j = (i + 1) & mask; slots[j].value; j = (j + 1) & mask) {
+                size_t home = slots[j].serial & mask;
+                if (((j - home) & mask) >= ((j - i) & mask)) {
+                    slots[i] = slots[j];
+                    i = j;
+                }
+            }
+            slots[i].value = NULL;
+            --count;
+        }
+        return value;
+    }
+
+    /**
+     * Get all the objects in the table.
+     *
+     * @param values  Returns the objects.
+     */
+    void GetAll(std::vector<T*>& values) const
+    {
+        for (size_t i = 0; i < slots.size(); ++i) {
+            if (slots[i].value) {
+                values.push_back(slots[i].value);
+            }
+        }
+    }
+
+    /**
+     * Remove all objects from the table.
+     */
+    void Clear()
+    {
+        for (size_t i = 0; i < slots.size(); ++i) {
+            slots[i].value = NULL;
+        }
+        count = 0;
+    }
+
+    /**
+     * Get the number of objects in the table.
+     *
+     * @return The number of objects.
+     */
+    size_t Size() const { return count; }
+
+  private:
+
+    struct Slot {
+        uint32_t serial;
+        T* value;
+        Slot() : serial(0), value(NULL) { }
+    };
+
+    void Grow()
+    {
+        std::vector<Slot> old(slots.size() * 2);
+        old.swap(slots);
+        count = 0;
+        for (size_t i = 0; i < old.size(); ++i) {
+            if (old[i].value) {
+                Insert(old[i].serial, old[i].value);
+            }
+        }
+    }
+
+    std::vector<Slot> slots;  ///< The slots, the size is always a power of 2
+    size_t count;             ///< Number of objects in the table
+};
+
+}
+
+#endif
@@ -25,7 +25,7 @@
 #include <qcc/Debug.h>
 #include <qcc/String.h>
 
-#include <list>
+#include <vector>
 
 #include "SignalTable.h"
 
@@ -45,10 +45,12 @@ void SignalTable::Add(MessageReceiver* receiver,
                   member->iface->GetName(),
                   member->name.c_str(),
                   sourcePath.c_str()));
-    Entry entry(handler, receiver, member);
-    Key key(sourcePath, member->iface->GetName(), member->name);
+    Entry entry(handler, receiver, member, sourcePath);
+    Key key(qcc::String(member->iface->GetName()), member->name);
     lock.Lock(MUTEX_CONTEXT);
-    hashTable.insert(pair<const Key, Entry>(key, entry));
+    HandlerMap& table = hashTable.BeginUpdate();
+    table[key].push_back(entry);
+    hashTable.Publish();
     lock.Unlock(MUTEX_CONTEXT);
 }
 
@@ -57,19 +59,24 @@ void SignalTable::Remove(MessageReceiver* receiver,
                          const InterfaceDescription::Member* member,
                          const char* sourcePath)
 {
-    Key key(sourcePath, member->iface->GetName(), member->name.c_str());
-    iterator iter;
-    pair<iterator, iterator> range;
+    Key key(member->iface->GetName(), member->name.c_str());
 
     lock.Lock(MUTEX_CONTEXT);
-    range = hashTable.equal_range(key);
-    iter = range.first;
-    while (iter != range.second) {
-        if ((iter->second.object == receiver) && (iter->second.handler == handler)) {
-            hashTable.erase(iter);
-            break;
-        } else {
-            ++iter;
+    HandlerMap::const_iterator current = hashTable.Current().find(key);
+    if (current != hashTable.Current().end()) {
+        const vector<Entry>& entries = current->second;
+        for (size_t i = 0; i < entries.size(); ++i) {
+            /* An empty source path on either side matches any source path */
+            if ((entries[i].object == receiver) && (entries[i].handler == handler) && entries[i].Matches(sourcePath)) {
+                HandlerMap& table = hashTable.BeginUpdate();
+                HandlerMap::iterator iter = table.find(key);
+                iter->second.erase(iter->second.begin() + i);
+                if (iter->second.empty()) {
+                    table.erase(iter);
+                }
+                hashTable.Publish();
+                break;
+            }
         }
     }
     lock.Unlock(MUTEX_CONTEXT);
@@ -77,28 +84,52 @@ void SignalTable::Remove(MessageReceiver* receiver,
 
 void SignalTable::RemoveAll(MessageReceiver* receiver)
 {
-    bool removed;
     lock.Lock(MUTEX_CONTEXT);
-    do {
-        removed = false;
-        for (iterator iter = hashTable.begin(); iter != hashTable.end(); ++iter) {
-            if (iter->second.object == receiver) {
-                hashTable.erase(iter);
-                removed = true;
+    bool found = false;
+    const HandlerMap& current = hashTable.Current();
+    for (HandlerMap::const_iterator iter = current.begin(); !found && (iter != current.end()); ++iter) {
+        for (size_t i = 0; i < iter->second.size(); ++i) {
+            if (iter->second[i].object == receiver) {
+                found = true;
                 break;
             }
         }
-    } while (removed);
+    }
+    if (found) {
+        HandlerMap& table = hashTable.BeginUpdate();
+        HandlerMap::iterator iter = table.begin();
+        while (iter != table.end()) {
+            vector<Entry>& entries = iter->second;
+            size_t n = 0;
+            for (size_t i = 0; i < entries.size(); ++i) {
+                if (entries[i].object != receiver) {
+                    entries[n++] = entries[i];
+                }
+            }
+            entries.resize(n);
+            if (entries.empty()) {
+                table.erase(iter++);
+            } else {
+                ++iter;
+            }
+        }
+        hashTable.Publish();
+    }
     lock.Unlock(MUTEX_CONTEXT);
 }
 
-pair<SignalTable::const_iterator, SignalTable::const_iterator> SignalTable::Find(const char* sourcePath,
-                                                                                 const char* iface,
-                                                                                 const char* signalName)
+void SignalTable::Find(const char* iface, const char* signalName, Handlers& handlers)
 {
-    Key key(sourcePath, iface, signalName);
-    return hashTable.equal_range(key);
+    Key key(iface, signalName);
+    handlers.reader.Pin(hashTable);
+    HandlerMap::const_iterator iter = handlers.reader->find(key);
+    if (iter != handlers.reader->end()) {
+        handlers.entries = &iter->second[0];
+        handlers.count = iter->second.size();
+    } else {
+        handlers.entries = NULL;
+        handlers.count = 0;
+    }
 }
 
 }
-
@@ -26,7 +26,6 @@
 #endif
 
 #include <qcc/platform.h>
-#include <qcc/StringMapKey.h>
 
 #include <vector>
 
@@ -41,10 +40,16 @@
 
 #include <qcc/STLContainer.h>
 
+#include "CopyOnWrite.h"
+
 namespace ajn {
 
 /**
- * %SignalTable is a multimap that maps interface/signalname and/or source path to SignalHandler instances.
+ * %SignalTable maps interface/signalname to the SignalHandler instances registered for the signal,
+ * optionally filtered by source path.
+ *
+ * Lookups do not take a lock. The table is a copy-on-write snapshot, registering or unregistering a
+ * handler builds a new snapshot while lookups continue to use the one they started with.
  */
 class SignalTable {
 
@@ -54,21 +59,20 @@ class SignalTable {
      * Type definition for signal hash table key
      */
     struct Key {
-        qcc::StringMapKey sourcePath;           /**< The object path of the signal sender */
         qcc::StringMapKey iface;                /**< The Interface name */
         qcc::StringMapKey signalName;           /**< The signal name */
 
         /**
          * Constructor used for lookups only (no storage)
          */
-        Key(const char* src, const char* ifc, const char* sig)
-            : sourcePath(src), iface(ifc), signalName(sig) { }
+        Key(const char* ifc, const char* sig)
+            : iface(ifc), signalName(sig) { }
 
         /**
          * Constructor used for storage into hash table (no dangling char*)
          */
-        Key(const qcc::String& src, const qcc::String& ifc, const qcc::String& sig)
-            : sourcePath(src), iface(ifc), signalName(sig) { }
+        Key(const qcc::String& ifc, const qcc::String& sig)
+            : iface(ifc), signalName(sig) { }
     };
 
     /**
@@ -78,26 +82,39 @@ class SignalTable {
         MessageReceiver::SignalHandler handler;      /**< SignalHandler instance */
         MessageReceiver* object;                     /**< Object that received the signal */
         const InterfaceDescription::Member* member;  /**< Signal member */
+        qcc::String sourcePath;                      /**< Signal originator or empty for all signal originators */
 
         /**
          * Construct an Entry
          */
-        Entry(const MessageReceiver::SignalHandler& handler, MessageReceiver* object, const InterfaceDescription::Member* member)
+        Entry(const MessageReceiver::SignalHandler& handler, MessageReceiver* object, const InterfaceDescription::Member* member,
+              const qcc::String& sourcePath)
             : handler(handler),
             object(object),
-            member(member) { }
+            member(member),
+            sourcePath(sourcePath) { }
 
         /**
          * Construct an empty Entry.
          */
         Entry(void) : handler(), object(NULL), member(NULL) { }
+
+        /**
+         * Test if a signal from an object path should be delivered to this entry.
+         *
+         * @param path  The object path of the signal sender.
+         *
+         * @return true if the entry is for all signal originators or for this originator.
+         */
+        bool Matches(const char* path) const {
+            return sourcePath.empty() || !path || !*path || (sourcePath == path);
+        }
     };
 
     /** %Hash functor */
     struct Hash {
         /** Calculate hash for Key k */
         size_t operator()(const Key& k) const {
-            /* source path cannot factor into hash because a key with no sourcepath is considered equal to one that does */
             size_t hash = 0;
             for (const char* p = k.signalName.c_str(); *p; ++p) {
                 hash = *p + hash * 11;
@@ -113,26 +130,51 @@ class SignalTable {
     struct Equal {
         /** Return true two keys are equal */
         bool operator()(const Key& k1, const Key& k2) const {
-            /* If either source path is null, then this field should be treated as don't care */
-            if ((k1.sourcePath.empty()) || (k2.sourcePath.empty())) {
-                return (0 == strcmp(k1.iface.c_str(), k2.iface.c_str())) && (0 == strcmp(k1.signalName.c_str(), k2.signalName.c_str()));
-            } else {
-                return (0 == strcmp(k1.iface.c_str(), k2.iface.c_str())) && \
-                       (0 == strcmp(k1.signalName.c_str(), k2.signalName.c_str())) && \
-                       (0 == strcmp(k1.sourcePath.c_str(), k2.sourcePath.c_str()));
-            }
+            return (0 == strcmp(k1.iface.c_str(), k2.iface.c_str())) && (0 == strcmp(k1.signalName.c_str(), k2.signalName.c_str()));
         }
     };
 
     /**
-     * Table iterator
+     * Type definition for a snapshot of the signal table
      */
-    typedef std::tr1::unordered_multimap<Key, Entry, Hash, Equal>::iterator iterator;
+    typedef std::tr1::unordered_map<Key, std::vector<Entry>, Hash, Equal> HandlerMap;
 
     /**
-     * Const table iterator
+     * The handlers registered for a signal. The handlers are contiguous and do not change while
+     * this object exists even if handlers are registered or unregistered.
      */
-    typedef std::tr1::unordered_multimap<Key, Entry, Hash, Equal>::const_iterator const_iterator;
+    class Handlers {
+        friend class SignalTable;
+      public:
+        /**
+         * Construct an empty set of handlers.
+         */
+        Handlers() : entries(NULL), count(0) { }
+
+        /**
+         * Get the number of handlers.
+         *
+         * @return  The number of handlers, this includes handlers for other source paths.
+         */
+        size_t Size() const { return count; }
+
+        /**
+         * Get a handler.
+         *
+         * @param i  Index of the handler.
+         *
+         * @return  The handler.
+         */
+        const Entry& operator[](size_t i) const { return entries[i]; }
+
+      private:
+        Handlers(const Handlers& other);
+        Handlers& operator=(const Handlers& other);
+
+        CopyOnWrite<HandlerMap>::Reader reader; /**< Keeps the snapshot the entries belong to */
+        const Entry* entries;                   /**< The handlers */
+        size_t count;                           /**< Number of handlers */
+    };
 
     /**
      * Add an entry to the signal hash table.
@@ -168,33 +210,21 @@ class SignalTable {
     void RemoveAll(MessageReceiver* receiver);
 
     /**
-     * Find Entries based on set of criteria.
-     * Signal table lock should be held until iterators are no longer in use.
-     *
-     * @param sourcePath   The object path of the signal sender.
-     * @param iface    The interface.
-     * @param signalName   The signal name.
+     * Find the handlers for a signal. This does not block or allocate memory. The caller must check
+     * each handler matches the signal's source path.
      *
-     * @return   Iterator range of entries with matching criteria.
-     */
-    std::pair<const_iterator, const_iterator> Find(const char* sourcePath, const char* iface, const char* signalName);
-
-    /**
-     * Get the lock that protects the signal table.
-     */
-    void Lock(void) { lock.Lock(MUTEX_CONTEXT); }
-
-    /**
-     * Release the lock that protects the signal table.
+     * @param iface       The interface.
+     * @param signalName  The signal name.
+     * @param handlers    Returns the handlers registered for the signal.
      */
-    void Unlock(void) { lock.Unlock(MUTEX_CONTEXT); }
+    void Find(const char* iface, const char* signalName, Handlers& handlers);
 
   private:
 
-    qcc::Mutex lock; /**< Lock protecting the signal table */
+    qcc::Mutex lock; /**< Lock serializing changes to the signal table */
 
     /**  The hash table */
-    std::tr1::unordered_multimap<Key, Entry, Hash, Equal> hashTable;
+    CopyOnWrite<HandlerMap> hashTable;
 };
 
 }
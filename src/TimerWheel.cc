@@ -0,0 +1,122 @@
+/**
+ * @file
+ *
+ * This file implements a hashed timer wheel.
+ */
+
+/******************************************************************************
+ * Copyright 2013, Qualcomm Innovation Center, Inc.
+ *
+ *    Licensed under the Apache License, Version 2.0 (the "License");
+ *    you may not use this file except in compliance with the License.
+ *    You may obtain a copy of the License at
+ *
+ *        http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *    Unless required by applicable law or agreed to in writing, software
+ *    distributed under the License is distributed on an "AS IS" BASIS,
+ *    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *    See the License for the specific language governing permissions and
+ *    limitations under the License.
+ ******************************************************************************/
+
+#include <qcc/platform.h>
+
+#include "TimerWheel.h"
+
+using namespace std;
+
+namespace ajn {
+
+TimerWheel::TimerWheel(uint32_t tickMs, uint32_t numSlots) :
+    tickMs(tickMs ? tickMs : 1),
+    mask(1),
+    cursor(0),
+    current(0),
+    count(0)
+{
+    while (mask < numSlots) {
+        mask <<= 1;
+    }
+    slots.resize(mask);
+    --mask;
+    for (size_t i = 0; i < slots.size(); ++i) {
+        slots[i].prev = slots[i].next = &slots[i];
+    }
+}
+
+void TimerWheel::Unlink(Entry* entry)
+{
+    entry->prev->next = entry->next;
+    entry->next->prev = entry->prev;
+    entry->prev = entry->next = NULL;
+}
+
+void TimerWheel::Schedule(Entry* entry, uint64_t when, uint64_t now)
+{
+    Cancel(entry);
+    /*
+     * An empty wheel may not have been advanced for a while so bring it up to date
+     */
+    if (count == 0) {
+        current = now;
+    }
+    /*
+     * Entries always wait for at least the next tick
+     */
+    uint64_t ticks = (when > current) ? ((when - current + tickMs - 1) / tickMs) : 1;
+    Entry& slot = slots[(cursor + ticks) & mask];
+    entry->rounds = (uint32_t)((ticks - 1) / slots.size());
+    entry->prev = slot.prev;
+    entry->next = &slot;
+    slot.prev->next = entry;
+    slot.prev = entry;
+    ++count;
+}
+
+bool TimerWheel::Cancel(Entry* entry)
+{
+    if (entry->IsScheduled()) {
+        Unlink(entry);
+        --count;
+        return true;
+    } else {
+        return false;
+    }
+}
+
+void TimerWheel::Advance(uint64_t now, std::vector<Entry*>& expired)
+{
+    while ((count > 0) && ((current + tickMs) <= now)) {
+        current += tickMs;
+        cursor = (cursor + 1) & mask;
+        Entry& slot = slots[cursor];
+        Entry* entry = slot.next;
+        while (entry != &slot) {
+            Entry* next = entry->next;
+            if (entry->rounds == 0) {
+                Unlink(entry);
+                --count;
+                expired.push_back(entry);
+            } else {
+                --entry->rounds;
+            }
+            entry = next;
+        }
+    }
+}
+
+void TimerWheel::ExpireAll(std::vector<Entry*>& expired)
+{
+    for (size_t i = 0; (count > 0) && (i < slots.size()); ++i) {
+        Entry& slot = slots[(cursor + 1 + i) & mask];
+        while (slot.next != &slot) {
+            Entry* entry = slot.next;
+            Unlink(entry);
+            --count;
+            expired.push_back(entry);
+        }
+    }
+}
+
+}
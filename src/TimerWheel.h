@@ -0,0 +1,136 @@
+#ifndef _ALLJOYN_TIMERWHEEL_H
+#define _ALLJOYN_TIMERWHEEL_H
+/**
+ * @file
+ * This file defines a hashed timer wheel for tracking large numbers of timeouts.
+ */
+
+/******************************************************************************
+ * Copyright 2013, Qualcomm Innovation Center, Inc.
+ *
+ *    Licensed under the Apache License, Version 2.0 (the "License");
+ *    you may not use this file except in compliance with the License.
+ *    You may obtain a copy of the License at
+ *
+ *        http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *    Unless required by applicable law or agreed to in writing, software
+ *    distributed under the License is distributed on an "AS IS" BASIS,
+ *    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *    See the License for the specific language governing permissions and
+ *    limitations under the License.
+ ******************************************************************************/
+
+#ifndef __cplusplus
+#error Only include TimerWheel.h in C++ code.
+#endif
+
+#include <qcc/platform.h>
+
+#include <vector>
+
+namespace ajn {
+
+/**
+ * A hashed timer wheel. Time is divided into ticks and each tick maps to one of a ring of slots.
+ * An entry is linked into the slot for the tick it expires in, along with the number of complete
+ * turns of the wheel to wait, so scheduling and cancelling a timeout are constant time however many
+ * timeouts are outstanding. Timeouts expire on the first tick at or after their expiry time.
+ *
+ * The wheel does no locking and has no thread of its own. The owner serializes access and calls
+ * Advance() at least once per tick while the wheel is not empty.
+ */
+class TimerWheel {
+  public:
+
+    /**
+     * An entry on the timer wheel. Objects that can time out derive from this class.
+     */
+    class Entry {
+        friend class TimerWheel;
+      public:
+        Entry() : prev(NULL), next(NULL), rounds(0) { }
+
+        /**
+         * Check if the entry is on a timer wheel.
+         *
+         * @return true if the entry is scheduled and has not expired or been cancelled.
+         */
+        bool IsScheduled() const { return prev != NULL; }
+
+      private:
+        Entry* prev;      ///< Previous entry in the slot
+        Entry* next;      ///< Next entry in the slot
+        uint32_t rounds;  ///< Number of turns of the wheel before the entry expires
+    };
+
+    /**
+     * Constructor
+     *
+     * @param tickMs    Length of a tick in milliseconds.
+     * @param numSlots  Number of slots on the wheel, rounded up to a power of 2.
+     */
+    TimerWheel(uint32_t tickMs, uint32_t numSlots);
+
+    /**
+     * Schedule an entry to expire. An entry that is already scheduled is rescheduled.
+     *
+     * @param entry  The entry to schedule.
+     * @param when   Absolute time in milliseconds when the entry should expire.
+     * @param now    The current time in milliseconds.
+     */
+    void Schedule(Entry* entry, uint64_t when, uint64_t now);
+
+    /**
+     * Cancel an entry.
+     *
+     * @param entry  The entry to cancel.
+     *
+     * @return true if the entry was scheduled.
+     */
+    bool Cancel(Entry* entry);
+
+    /**
+     * Advance the wheel to the current time removing the entries that have expired.
+     *
+     * @param now      The current time in milliseconds.
+     * @param expired  Returns the expired entries in the order of the ticks they expired on.
+     */
+    void Advance(uint64_t now, std::vector<Entry*>& expired);
+
+    /**
+     * Remove all entries from the wheel.
+     *
+     * @param expired  Returns the entries that were on the wheel.
+     */
+    void ExpireAll(std::vector<Entry*>& expired);
+
+    /**
+     * Get the number of entries on the wheel.
+     *
+     * @return The number of scheduled entries.
+     */
+    size_t Size() const { return count; }
+
+    /**
+     * Get the length of a tick.
+     *
+     * @return The tick length in milliseconds.
+     */
+    uint32_t GetTickMs() const { return tickMs; }
+
+  private:
+
+    static void Unlink(Entry* entry);
+
+    const uint32_t tickMs;    ///< Length of a tick in milliseconds
+    uint32_t mask;            ///< Number of slots - 1
+    std::vector<Entry> slots; ///< Sentinel entries for each slot's circular list
+    uint32_t cursor;          ///< Slot for the current tick
+    uint64_t current;         ///< Time of the current tick
+    size_t count;             ///< Number of entries on the wheel
+};
+
+}
+
+#endif
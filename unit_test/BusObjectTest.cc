@@ -23,6 +23,7 @@
 #include <alljoyn/InterfaceDescription.h>
 #include <alljoyn/DBusStd.h>
 #include <qcc/Debug.h>
+#include <qcc/Event.h>
 #include <qcc/Thread.h>
 
 using namespace ajn;
@@ -83,3 +84,116 @@ TEST_F(BusObjectTest, DISABLED_ObjectRegisteredUnregistered) {
     EXPECT_TRUE(testObj.wasRegistered);
     EXPECT_TRUE(testObj.wasUnregistered);
 }
+
+static const char* SENDER_INTERFACE = "org.alljoyn.test.BusObjectTest.Sender";
+
+/*
+ * Object that emits a signal and answers method calls.
+ */
+class SignalSenderBusObject : public BusObject {
+  public:
+    SignalSenderBusObject(const InterfaceDescription& intf) : BusObject(OBJECT_PATH)
+    {
+        AddInterface(intf);
+        chirp = intf.GetMember("chirp");
+        const MethodEntry methodEntries[] = {
+            { intf.GetMember("ping"), static_cast<MessageReceiver::MethodHandler>(&SignalSenderBusObject::Ping) }
+        };
+        AddMethodHandlers(methodEntries, sizeof(methodEntries) / sizeof(methodEntries[0]));
+    }
+
+    void Ping(const InterfaceDescription::Member* member, Message& msg)
+    {
+        MethodReply(msg, msg->GetArg(0), 1);
+    }
+
+    QStatus Chirp(const char* destination)
+    {
+        return Signal(destination, 0, *chirp);
+    }
+
+    const InterfaceDescription::Member* chirp;
+};
+
+/*
+ * Signal handler that makes a blocking call back to the sender of the signal.
+ */
+class SignalSenderCaller : public MessageReceiver {
+  public:
+    SignalSenderCaller(BusAttachment& bus) : bus(bus), status(ER_FAIL) { }
+
+    void ChirpHandler(const InterfaceDescription::Member* member, const char* srcPath, Message& msg)
+    {
+        bus.EnableConcurrentCallbacks();
+        ProxyBusObject proxy(bus, msg->GetSender(), OBJECT_PATH, 0);
+        proxy.AddInterface(*bus.GetInterface(SENDER_INTERFACE));
+        MsgArg arg("s", "hello");
+        Message reply(bus);
+        status = proxy.MethodCall(SENDER_INTERFACE, "ping", &arg, 1, reply, 5000);
+        if (status == ER_OK) {
+            replyString = reply->GetArg(0)->v_string.str;
+        }
+        done.SetEvent();
+    }
+
+    BusAttachment& bus;
+    QStatus status;
+    qcc::String replyString;
+    Event done;
+};
+
+static void CreateSenderInterface(BusAttachment& bus)
+{
+    InterfaceDescription* intf = NULL;
+    QStatus status = bus.CreateInterface(SENDER_INTERFACE, intf);
+    ASSERT_EQ(ER_OK, status) << "  Actual Status: " << QCC_StatusText(status);
+    intf->AddMember(MESSAGE_METHOD_CALL, "ping", "s", "s", "in,out", 0);
+    intf->AddMember(MESSAGE_SIGNAL, "chirp", "", "", "", 0);
+    intf->Activate();
+}
+
+/*
+ * Messages from a peer are handled in order on a lane keyed on the sender. The reply to a call made
+ * from a signal handler to the sender of the signal must not be queued behind the handler.
+ */
+TEST_F(BusObjectTest, SyncCallToSignalSenderFromSignalHandler) {
+    BusAttachment servicebus("BusObjectTestService", false);
+
+    CreateSenderInterface(servicebus);
+    CreateSenderInterface(bus);
+
+    SignalSenderBusObject sender(*servicebus.GetInterface(SENDER_INTERFACE));
+    status = servicebus.RegisterBusObject(sender);
+    EXPECT_EQ(ER_OK, status) << "  Actual Status: " << QCC_StatusText(status);
+    status = servicebus.Start();
+    EXPECT_EQ(ER_OK, status) << "  Actual Status: " << QCC_StatusText(status);
+    status = servicebus.Connect(ajn::getConnectArg().c_str());
+    EXPECT_EQ(ER_OK, status) << "  Actual Status: " << QCC_StatusText(status);
+
+    SignalSenderCaller caller(bus);
+    status = bus.RegisterSignalHandler(&caller,
+                                       static_cast<MessageReceiver::SignalHandler>(&SignalSenderCaller::ChirpHandler),
+                                       bus.GetInterface(SENDER_INTERFACE)->GetMember("chirp"),
+                                       NULL);
+    EXPECT_EQ(ER_OK, status) << "  Actual Status: " << QCC_StatusText(status);
+    status = bus.Start();
+    EXPECT_EQ(ER_OK, status) << "  Actual Status: " << QCC_StatusText(status);
+    status = bus.Connect(ajn::getConnectArg().c_str());
+    EXPECT_EQ(ER_OK, status) << "  Actual Status: " << QCC_StatusText(status);
+
+    status = sender.Chirp(bus.GetUniqueName().c_str());
+    EXPECT_EQ(ER_OK, status) << "  Actual Status: " << QCC_StatusText(status);
+
+    status = Event::Wait(caller.done, 10000);
+    EXPECT_EQ(ER_OK, status) << "  Actual Status: " << QCC_StatusText(status);
+    EXPECT_EQ(ER_OK, caller.status) << "  Actual Status: " << QCC_StatusText(caller.status);
+    EXPECT_STREQ("hello", caller.replyString.c_str());
+
+    bus.UnregisterSignalHandler(&caller,
+                                static_cast<MessageReceiver::SignalHandler>(&SignalSenderCaller::ChirpHandler),
+                                bus.GetInterface(SENDER_INTERFACE)->GetMember("chirp"),
+                                NULL);
+    servicebus.UnregisterBusObject(sender);
+    servicebus.Stop();
+    servicebus.Join();
+}
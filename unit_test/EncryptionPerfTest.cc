@@ -0,0 +1,216 @@
+/**
+ * @file
+ * Throughput tests for message encryption. Compares encrypting with a cipher context set up per
+ * message against a cached per-peer cipher context, and plain against encrypted method calls.
+ */
+/******************************************************************************
+ * Copyright 2013, Qualcomm Innovation Center, Inc.
+ *
+ *    Licensed under the Apache License, Version 2.0 (the "License");
+ *    you may not use this file except in compliance with the License.
+ *    You may obtain a copy of the License at
+ *
+ *        http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *    Unless required by applicable law or agreed to in writing, software
+ *    distributed under the License is distributed on an "AS IS" BASIS,
+ *    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *    See the License for the specific language governing permissions and
+ *    limitations under the License.
+ ******************************************************************************/
+
+#include <qcc/platform.h>
+
+#include <stdio.h>
+#include <string.h>
+
+#include <qcc/Crypto.h>
+#include <qcc/KeyBlob.h>
+#include <qcc/String.h>
+#include <qcc/time.h>
+#include <qcc/Util.h>
+
+#include <alljoyn/AuthListener.h>
+#include <alljoyn/BusAttachment.h>
+#include <alljoyn/BusObject.h>
+#include <alljoyn/InterfaceDescription.h>
+#include <alljoyn/Message.h>
+#include <alljoyn/ProxyBusObject.h>
+
+#include <alljoyn/Status.h>
+
+/* Private files included for unit testing */
+#include <AllJoynCrypto.h>
+
+#include "ajTestCommon.h"
+
+#include <gtest/gtest.h>
+
+using namespace qcc;
+using namespace ajn;
+
+static const char* PLAIN_INTERFACE_NAME = "org.alljoyn.test.EncryptionPerfTest.Plain";
+static const char* SECURE_INTERFACE_NAME = "org.alljoyn.test.EncryptionPerfTest.Secure";
+static const char* OBJECT_PATH = "/org/alljoyn/test/EncryptionPerfTest";
+
+static const size_t HDR_LEN = 64;
+static const size_t BODY_LEN = 256;
+
+TEST(EncryptionPerfTest, CipherContextThroughput) {
+    const uint32_t iterations = 20000;
+    QStatus status;
+
+    BusAttachment bus("EncryptionPerfTest", false);
+    Message msg(bus);
+
+    KeyBlob key;
+    key.Rand(Crypto_AES::AES128_SIZE, KeyBlob::AES);
+    key.SetTag("EncryptionPerfTest", KeyBlob::NO_ROLE);
+    CipherContext cipher(key);
+    ASSERT_TRUE(cipher->IsValid());
+
+    uint8_t plain[HDR_LEN + BODY_LEN + 8];
+    uint8_t perMsg[sizeof(plain)];
+    uint8_t cached[sizeof(plain)];
+    for (size_t i = 0; i < sizeof(plain); ++i) {
+        plain[i] = (uint8_t)i;
+    }
+
+    /* Key schedule computed for every message */
+    uint64_t start = GetTimestamp64();
+    for (uint32_t i = 0; i < iterations; ++i) {
+        size_t len = BODY_LEN;
+        memcpy(perMsg, plain, sizeof(plain));
+        status = Crypto::Encrypt(*msg, key, perMsg, HDR_LEN, len);
+        ASSERT_EQ(ER_OK, status) << "  Actual Status: " << QCC_StatusText(status);
+    }
+    uint64_t perMsgMs = GetTimestamp64() - start;
+
+    /* Key schedule computed once */
+    start = GetTimestamp64();
+    for (uint32_t i = 0; i < iterations; ++i) {
+        size_t len = BODY_LEN;
+        memcpy(cached, plain, sizeof(plain));
+        status = Crypto::Encrypt(*msg, cipher, cached, HDR_LEN, len);
+        ASSERT_EQ(ER_OK, status) << "  Actual Status: " << QCC_StatusText(status);
+        ASSERT_EQ(BODY_LEN + Crypto::MACLength, len);
+    }
+    uint64_t cachedMs = GetTimestamp64() - start;
+
+    /* Both paths must produce the same cipher text and decrypt back to the plain text */
+    EXPECT_EQ(0, memcmp(perMsg, cached, sizeof(plain)));
+    size_t len = BODY_LEN + Crypto::MACLength;
+    status = Crypto::Decrypt(*msg, cipher, cached, HDR_LEN, len);
+    EXPECT_EQ(ER_OK, status) << "  Actual Status: " << QCC_StatusText(status);
+    EXPECT_EQ(BODY_LEN, len);
+    EXPECT_EQ(0, memcmp(plain, cached, HDR_LEN + BODY_LEN));
+
+    printf("Encrypt %u byte body: per-message key setup %u msgs/sec, cached context %u msgs/sec\n", (unsigned int)BODY_LEN,
+           (unsigned int)((iterations * 1000) / (perMsgMs ? perMsgMs : 1)),
+           (unsigned int)((iterations * 1000) / (cachedMs ? cachedMs : 1)));
+}
+
+class EncryptionPerfAuthListener : public AuthListener {
+    bool RequestCredentials(const char* authMechanism, const char* authPeer, uint16_t authCount, const char* userId, uint16_t credMask, Credentials& creds) {
+        creds.SetPassword("123456");
+        return true;
+    }
+    void AuthenticationComplete(const char* authMechanism, const char* authPeer, bool success) {
+    }
+};
+
+class EncryptionPerfObject : public BusObject {
+  public:
+    EncryptionPerfObject(BusAttachment& bus) : BusObject(OBJECT_PATH) {
+        const char* ifaces[] = { PLAIN_INTERFACE_NAME, SECURE_INTERFACE_NAME };
+        for (size_t i = 0; i < ArraySize(ifaces); ++i) {
+            const InterfaceDescription* intf = bus.GetInterface(ifaces[i]);
+            EXPECT_TRUE(intf != NULL);
+            if (intf) {
+                AddInterface(*intf);
+                AddMethodHandler(intf->GetMember("ping"), static_cast<MessageReceiver::MethodHandler>(&EncryptionPerfObject::Ping));
+            }
+        }
+    }
+
+    void Ping(const InterfaceDescription::Member* member, Message& msg) {
+        MethodReply(msg, msg->GetArg(0), 1);
+    }
+};
+
+static QStatus CreatePingInterfaces(BusAttachment& bus)
+{
+    InterfaceDescription* intf = NULL;
+    QStatus status = bus.CreateInterface(PLAIN_INTERFACE_NAME, intf, false);
+    if (status == ER_OK) {
+        intf->AddMember(MESSAGE_METHOD_CALL, "ping", "s", "s", "in,out", 0);
+        intf->Activate();
+        status = bus.CreateInterface(SECURE_INTERFACE_NAME, intf, true);
+    }
+    if (status == ER_OK) {
+        intf->AddMember(MESSAGE_METHOD_CALL, "ping", "s", "s", "in,out", 0);
+        intf->Activate();
+    }
+    return status;
+}
+
+static uint64_t TimePings(BusAttachment& bus, ProxyBusObject& proxy, const char* iface, uint32_t iterations)
+{
+    String payload((size_t)BODY_LEN, (char)'x');
+    MsgArg arg("s", payload.c_str());
+    Message reply(bus);
+
+    uint64_t start = GetTimestamp64();
+    for (uint32_t i = 0; i < iterations; ++i) {
+        QStatus status = proxy.MethodCall(iface, "ping", &arg, 1, reply);
+        EXPECT_EQ(ER_OK, status) << "  Actual Status: " << QCC_StatusText(status);
+        if (status != ER_OK) {
+            break;
+        }
+    }
+    return GetTimestamp64() - start;
+}
+
+TEST(EncryptionPerfTest, PingThroughput) {
+    const uint32_t iterations = 2000;
+    QStatus status;
+    EncryptionPerfAuthListener authListener;
+
+    BusAttachment serviceBus("EncryptionPerfTestService", false);
+    BusAttachment clientBus("EncryptionPerfTestClient", false);
+    BusAttachment* buses[] = { &serviceBus, &clientBus };
+    for (size_t i = 0; i < ArraySize(buses); ++i) {
+        status = buses[i]->Start();
+        ASSERT_EQ(ER_OK, status) << "  Actual Status: " << QCC_StatusText(status);
+        status = buses[i]->Connect(ajn::getConnectArg().c_str());
+        ASSERT_EQ(ER_OK, status) << "  Actual Status: " << QCC_StatusText(status);
+        status = buses[i]->EnablePeerSecurity("ALLJOYN_SRP_KEYX", &authListener);
+        ASSERT_EQ(ER_OK, status) << "  Actual Status: " << QCC_StatusText(status);
+        status = CreatePingInterfaces(*buses[i]);
+        ASSERT_EQ(ER_OK, status) << "  Actual Status: " << QCC_StatusText(status);
+    }
+
+    EncryptionPerfObject obj(serviceBus);
+    status = serviceBus.RegisterBusObject(obj);
+    ASSERT_EQ(ER_OK, status) << "  Actual Status: " << QCC_StatusText(status);
+
+    ProxyBusObject proxy(clientBus, serviceBus.GetUniqueName().c_str(), OBJECT_PATH, 0);
+    proxy.AddInterface(*clientBus.GetInterface(PLAIN_INTERFACE_NAME));
+    proxy.AddInterface(*clientBus.GetInterface(SECURE_INTERFACE_NAME));
+
+    /* The first secure call authenticates so keep it out of the measurement */
+    TimePings(clientBus, proxy, SECURE_INTERFACE_NAME, 1);
+
+    uint64_t plainMs = TimePings(clientBus, proxy, PLAIN_INTERFACE_NAME, iterations);
+    uint64_t secureMs = TimePings(clientBus, proxy, SECURE_INTERFACE_NAME, iterations);
+
+    printf("Ping %u byte payload: plain %u calls/sec, encrypted %u calls/sec\n", (unsigned int)BODY_LEN,
+           (unsigned int)((iterations * 1000) / (plainMs ? plainMs : 1)),
+           (unsigned int)((iterations * 1000) / (secureMs ? secureMs : 1)));
+
+    serviceBus.UnregisterBusObject(obj);
+    for (size_t i = 0; i < ArraySize(buses); ++i) {
+        buses[i]->Stop();
+        buses[i]->Join();
+    }
+}
@@ -0,0 +1,245 @@
+/**
+ * @file
+ * Tests for the executor used to dispatch method and signal handlers. Checks tasks with the same
+ * key run in order, the reentrancy rules match the timer based dispatcher and compares handler
+ * throughput with a qcc::Timer used as a thread pool.
+ */
+/******************************************************************************
+ * Copyright 2013, Qualcomm Innovation Center, Inc.
+ *
+ *    Licensed under the Apache License, Version 2.0 (the "License");
+ *    you may not use this file except in compliance with the License.
+ *    You may obtain a copy of the License at
+ *
+ *        http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *    Unless required by applicable law or agreed to in writing, software
+ *    distributed under the License is distributed on an "AS IS" BASIS,
+ *    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *    See the License for the specific language governing permissions and
+ *    limitations under the License.
+ ******************************************************************************/
+
+#include <qcc/platform.h>
+
+#include <stdio.h>
+
+#include <qcc/Event.h>
+#include <qcc/Mutex.h>
+#include <qcc/String.h>
+#include <qcc/StringUtil.h>
+#include <qcc/Timer.h>
+#include <qcc/Util.h>
+#include <qcc/atomic.h>
+#include <qcc/time.h>
+
+#include <alljoyn/Status.h>
+
+/* Private files included for unit testing */
+#include <Executor.h>
+
+#include <gtest/gtest.h>
+
+using namespace qcc;
+using namespace ajn;
+
+static const uint32_t CONCURRENCY = 4;
+static const uint32_t NUM_KEYS = 8;
+
+/*
+ * Handler shared by the executor and timer tests. The context encodes a key and a sequence number.
+ */
+class TestHandler : public ExecutorListener, public AlarmListener {
+  public:
+    TestHandler(Executor* executor, Timer* timer, uint32_t expected, bool concurrent, uint32_t work) :
+        executor(executor),
+        timer(timer),
+        expected(expected),
+        concurrent(concurrent),
+        work(work),
+        done(0),
+        inFlight(0),
+        maxInFlight(0),
+        outOfOrder(0),
+        heldLock(0),
+        sink(0)
+    {
+        for (uint32_t i = 0; i < NUM_KEYS; ++i) {
+            nextSeq[i] = 0;
+        }
+    }
+
+    static void* Context(uint32_t key, uint32_t seq) { return (void*)(uintptr_t)((key << 24) | seq); }
+
+    void RunTask(void* context, QStatus reason)
+    {
+        if (reason == ER_OK) {
+            Handle(context);
+        }
+    }
+
+    void AlarmTriggered(const Alarm& alarm, QStatus reason)
+    {
+        if (reason == ER_OK) {
+            Handle(alarm->GetContext());
+        }
+    }
+
+    bool Wait() { return Event::Wait(doneEvent, 60000) == ER_OK; }
+
+    Executor* executor;
+    Timer* timer;
+    uint32_t expected;
+    bool concurrent;
+    uint32_t work;
+    volatile int32_t done;
+    volatile int32_t inFlight;
+    int32_t maxInFlight;
+    uint32_t outOfOrder;
+    uint32_t heldLock;
+    volatile uint32_t sink;
+    uint32_t nextSeq[NUM_KEYS];
+    Mutex lock;
+    Event doneEvent;
+
+  private:
+
+    void Handle(void* context)
+    {
+        uint32_t key = (uint32_t)((uintptr_t)context >> 24);
+        uint32_t seq = (uint32_t)((uintptr_t)context & 0xFFFFFF);
+
+        if (executor ? executor->ThreadHoldsLock() : timer->ThreadHoldsLock()) {
+            ++heldLock;
+        }
+        if (concurrent) {
+            if (executor) {
+                executor->EnableReentrancy();
+            } else {
+                timer->EnableReentrancy();
+            }
+        }
+        int32_t n = IncrementAndFetch(&inFlight);
+
+        lock.Lock(MUTEX_CONTEXT);
+        if (n > maxInFlight) {
+            maxInFlight = n;
+        }
+        if (seq != nextSeq[key]) {
+            ++outOfOrder;
+        }
+        nextSeq[key] = seq + 1;
+        lock.Unlock(MUTEX_CONTEXT);
+
+        for (uint32_t i = 0; i < work; ++i) {
+            sink += i;
+        }
+        DecrementAndFetch(&inFlight);
+        if (IncrementAndFetch(&done) == (int32_t)expected) {
+            doneEvent.SetEvent();
+        }
+    }
+};
+
+TEST(ExecutorTest, KeyOrdering) {
+    const uint32_t perKey = 2000;
+    Executor executor("exTest", CONCURRENCY, 0);
+    TestHandler handler(&executor, NULL, perKey * NUM_KEYS, true, 100);
+
+    ASSERT_EQ(ER_OK, executor.Start());
+    for (uint32_t seq = 0; seq < perKey; ++seq) {
+        for (uint32_t key = 0; key < NUM_KEYS; ++key) {
+            QStatus status = executor.Dispatch("key" + U32ToString(key), &handler, TestHandler::Context(key, seq));
+            ASSERT_EQ(ER_OK, status) << "  Actual Status: " << QCC_StatusText(status);
+        }
+    }
+    EXPECT_TRUE(handler.Wait());
+    EXPECT_EQ(0U, handler.outOfOrder);
+    for (uint32_t key = 0; key < NUM_KEYS; ++key) {
+        EXPECT_EQ(perKey, handler.nextSeq[key]);
+    }
+    executor.Stop();
+    executor.Join();
+}
+
+TEST(ExecutorTest, Reentrancy) {
+    const uint32_t numTasks = 1000;
+    Executor executor("exTest", CONCURRENCY, 10);
+
+    /* Handlers are serialized until they enable reentrancy */
+    TestHandler serial(&executor, NULL, numTasks, false, 1000);
+    ASSERT_EQ(ER_OK, executor.Start());
+    for (uint32_t seq = 0; seq < numTasks; ++seq) {
+        ASSERT_EQ(ER_OK, executor.Dispatch("key" + U32ToString(seq % NUM_KEYS), &serial, TestHandler::Context(seq % NUM_KEYS, seq / NUM_KEYS)));
+    }
+    EXPECT_TRUE(serial.Wait());
+    EXPECT_EQ(1, serial.maxInFlight);
+    EXPECT_EQ(numTasks, serial.heldLock);
+
+    /* Only executor threads hold the lock */
+    EXPECT_FALSE(executor.ThreadHoldsLock());
+
+    TestHandler concurrent(&executor, NULL, numTasks, true, 1000);
+    for (uint32_t seq = 0; seq < numTasks; ++seq) {
+        ASSERT_EQ(ER_OK, executor.Dispatch("key" + U32ToString(seq % NUM_KEYS), &concurrent, TestHandler::Context(seq % NUM_KEYS, seq / NUM_KEYS)));
+    }
+    EXPECT_TRUE(concurrent.Wait());
+    EXPECT_LE(concurrent.maxInFlight, (int32_t)CONCURRENCY);
+    EXPECT_EQ(numTasks, concurrent.heldLock);
+    EXPECT_EQ(0U, concurrent.outOfOrder);
+
+    executor.Stop();
+    executor.Join();
+
+    /* Nothing can be dispatched once the executor has stopped */
+    EXPECT_EQ(ER_BUS_STOPPING, executor.Dispatch("key0", &concurrent, NULL));
+}
+
+/*
+ * Compare handler throughput of the executor with a timer used as a thread pool the way the local
+ * endpoint dispatcher used to be.
+ */
+TEST(ExecutorTest, Throughput) {
+    const uint32_t numTasks = 50000;
+    const uint32_t work[] = { 0, 2000 };
+    const bool concurrent[] = { false, true };
+
+    for (size_t w = 0; w < ArraySize(work); ++w) {
+        for (size_t c = 0; c < ArraySize(concurrent); ++c) {
+            uint64_t ms[2];
+            {
+                Timer timer("tmTest", true, CONCURRENCY, true, 10);
+                TestHandler handler(NULL, &timer, numTasks, concurrent[c], work[w]);
+                ASSERT_EQ(ER_OK, timer.Start());
+                uint64_t start = GetTimestamp64();
+                for (uint32_t seq = 0; seq < numTasks; ++seq) {
+                    uint32_t zero = 0;
+                    AlarmListener* listener = &handler;
+                    ASSERT_EQ(ER_OK, timer.AddAlarm(Alarm(zero, listener, TestHandler::Context(seq % NUM_KEYS, seq / NUM_KEYS), zero)));
+                }
+                EXPECT_TRUE(handler.Wait());
+                ms[0] = GetTimestamp64() - start;
+                timer.Stop();
+                timer.Join();
+            }
+            {
+                Executor executor("exTest", CONCURRENCY, CONCURRENCY * 16);
+                TestHandler handler(&executor, NULL, numTasks, concurrent[c], work[w]);
+                ASSERT_EQ(ER_OK, executor.Start());
+                uint64_t start = GetTimestamp64();
+                for (uint32_t seq = 0; seq < numTasks; ++seq) {
+                    ASSERT_EQ(ER_OK, executor.Dispatch("key" + U32ToString(seq % NUM_KEYS), &handler, TestHandler::Context(seq % NUM_KEYS, seq / NUM_KEYS)));
+                }
+                EXPECT_TRUE(handler.Wait());
+                EXPECT_EQ(0U, handler.outOfOrder);
+                ms[1] = GetTimestamp64() - start;
+                executor.Stop();
+                executor.Join();
+            }
+            printf("Handlers (work=%u, %s): timer %u msgs/sec, executor %u msgs/sec\n", work[w],
+                   concurrent[c] ? "concurrent" : "serialized",
+                   (unsigned int)(((uint64_t)numTasks * 1000) / (ms[0] ? ms[0] : 1)),
+                   (unsigned int)(((uint64_t)numTasks * 1000) / (ms[1] ? ms[1] : 1)));
+        }
+    }
+}
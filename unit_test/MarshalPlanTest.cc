@@ -0,0 +1,246 @@
+/**
+ * @file
+ * Tests for marshaling with the marshal plans compiled for interface members. Checks plans produce
+ * exactly the same wire format as the generic marshaler and compares their throughput.
+ */
+/******************************************************************************
+ * Copyright 2013, Qualcomm Innovation Center, Inc.
+ *
+ *    Licensed under the Apache License, Version 2.0 (the "License");
+ *    you may not use this file except in compliance with the License.
+ *    You may obtain a copy of the License at
+ *
+ *        http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *    Unless required by applicable law or agreed to in writing, software
+ *    distributed under the License is distributed on an "AS IS" BASIS,
+ *    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *    See the License for the specific language governing permissions and
+ *    limitations under the License.
+ ******************************************************************************/
+
+#include <qcc/platform.h>
+
+#include <stdio.h>
+#include <string.h>
+
+#include <qcc/String.h>
+#include <qcc/StringUtil.h>
+#include <qcc/time.h>
+#include <qcc/Util.h>
+
+#include <alljoyn/BusAttachment.h>
+#include <alljoyn/InterfaceDescription.h>
+#include <alljoyn/Message.h>
+#include <alljoyn/MsgArg.h>
+
+#include <alljoyn/Status.h>
+
+/* Private files included for unit testing */
+#include <MarshalPlan.h>
+
+#include <gtest/gtest.h>
+
+using namespace qcc;
+using namespace ajn;
+
+static const char* INTERFACE_NAME = "org.alljoyn.test.MarshalPlanTest";
+static const char* OBJECT_PATH = "/org/alljoyn/test/MarshalPlanTest";
+
+static const size_t NUM_ELEMENTS = 10;
+static const size_t NUM_BYTES = 1024;
+
+class PlanTestMessage : public _Message {
+  public:
+    PlanTestMessage(BusAttachment& bus) : _Message(bus) { }
+
+    QStatus Signal(const InterfaceDescription::Member& member, const MsgArg* args, size_t numArgs, bool usePlan)
+    {
+        return SignalMsg(member.signature, NULL, 0, OBJECT_PATH, member.iface->GetName(), member.name, args, numArgs, 0, 0,
+                         usePlan ? member.argsPlan : NULL);
+    }
+
+    const uint8_t* GetBody() const { return bodyPtr; }
+
+    size_t GetBodyLen() const { return msgHeader.bodyLen; }
+};
+
+/*
+ * Args for the signals in the test interface
+ */
+class PlanTestArgs {
+  public:
+    PlanTestArgs() {
+        static const char* keys[NUM_ELEMENTS] = { "k0", "k1", "k2", "k3", "k4", "k5", "k6", "k7", "k8", "k9" };
+        static const char* strs[] = { "apple", "banana", "cherry", "damson", "elderberry" };
+
+        str.Set("s", "The quick brown fox jumps over the lazy dog");
+
+        for (size_t i = 0; i < NUM_ELEMENTS; ++i) {
+            if (i & 1) {
+                vals[i].Set("u", (uint32_t)i);
+            } else {
+                vals[i].Set("s", strs[i % ArraySize(strs)]);
+            }
+            entries[i].Set("{sv}", keys[i], &vals[i]);
+            structs[i].Set("(sas)", keys[i], ArraySize(strs), strs);
+        }
+        dict.Set("a{sv}", NUM_ELEMENTS, entries);
+        structArray.Set("a(sas)", NUM_ELEMENTS, structs);
+
+        for (size_t i = 0; i < NUM_BYTES; ++i) {
+            bytes[i] = (uint8_t)i;
+        }
+        byteArray.Set("ay", NUM_BYTES, bytes);
+    }
+
+    const MsgArg* Get(const char* signature) const {
+        if (strcmp(signature, "s") == 0) {
+            return &str;
+        } else if (strcmp(signature, "a{sv}") == 0) {
+            return &dict;
+        } else if (strcmp(signature, "a(sas)") == 0) {
+            return &structArray;
+        } else {
+            return &byteArray;
+        }
+    }
+
+  private:
+    MsgArg str;
+    MsgArg vals[NUM_ELEMENTS];
+    MsgArg entries[NUM_ELEMENTS];
+    MsgArg dict;
+    MsgArg structs[NUM_ELEMENTS];
+    MsgArg structArray;
+    uint8_t bytes[NUM_BYTES];
+    MsgArg byteArray;
+};
+
+static const char* signatures[] = { "s", "a{sv}", "a(sas)", "ay" };
+
+static QStatus CreatePlanTestInterface(BusAttachment& bus, const InterfaceDescription*& iface)
+{
+    InterfaceDescription* intf = NULL;
+    QStatus status = bus.CreateInterface(INTERFACE_NAME, intf, false);
+    for (size_t i = 0; (status == ER_OK) && (i < ArraySize(signatures)); ++i) {
+        String name = "Signal" + U32ToString((uint32_t)i);
+        status = intf->AddSignal(name.c_str(), signatures[i], NULL, 0);
+    }
+    if (status == ER_OK) {
+        intf->Activate();
+        iface = intf;
+    }
+    return status;
+}
+
+TEST(MarshalPlanTest, CompileSignatures) {
+    const char* good[] = { "s", "a{sv}", "a(sas)", "ay", "a{s(uax)}", "(ybnqiuxtdsogv)", "aaiaas", "a{ya{sv}}", "h" };
+    for (size_t i = 0; i < ArraySize(good); ++i) {
+        MarshalPlan plan(good[i]);
+        EXPECT_TRUE(plan.IsValid()) << "  Signature: " << good[i];
+        EXPECT_STREQ(good[i], plan.GetSignature().c_str());
+    }
+    const char* bad[] = { "{sv}", "a{sv", "(s", "a", "z" };
+    for (size_t i = 0; i < ArraySize(bad); ++i) {
+        MarshalPlan plan(bad[i]);
+        EXPECT_FALSE(plan.IsValid()) << "  Signature: " << bad[i];
+    }
+}
+
+TEST(MarshalPlanTest, SameWireFormat) {
+    const char endians[] = { ALLJOYN_LITTLE_ENDIAN, ALLJOYN_BIG_ENDIAN };
+    const InterfaceDescription* iface = NULL;
+    PlanTestArgs args;
+    QStatus status;
+
+    BusAttachment bus("MarshalPlanTest", false);
+    status = bus.Start();
+    ASSERT_EQ(ER_OK, status) << "  Actual Status: " << QCC_StatusText(status);
+    status = CreatePlanTestInterface(bus, iface);
+    ASSERT_EQ(ER_OK, status) << "  Actual Status: " << QCC_StatusText(status);
+
+    for (size_t e = 0; e < ArraySize(endians); ++e) {
+        _Message::SetEndianess(endians[e]);
+        for (size_t i = 0; i < ArraySize(signatures); ++i) {
+            String name = "Signal" + U32ToString((uint32_t)i);
+            const InterfaceDescription::Member* member = iface->GetMember(name.c_str());
+            ASSERT_TRUE(member != NULL);
+            ASSERT_TRUE(member->argsPlan != NULL) << "  Signature: " << signatures[i];
+
+            PlanTestMessage generic(bus);
+            status = generic.Signal(*member, args.Get(signatures[i]), 1, false);
+            ASSERT_EQ(ER_OK, status) << "  Actual Status: " << QCC_StatusText(status);
+
+            PlanTestMessage planned(bus);
+            status = planned.Signal(*member, args.Get(signatures[i]), 1, true);
+            ASSERT_EQ(ER_OK, status) << "  Actual Status: " << QCC_StatusText(status);
+
+            EXPECT_STREQ(generic.GetSignature(), planned.GetSignature());
+            ASSERT_EQ(generic.GetBodyLen(), planned.GetBodyLen()) << "  Signature: " << signatures[i];
+            EXPECT_EQ(0, memcmp(generic.GetBody(), planned.GetBody(), generic.GetBodyLen())) << "  Signature: " << signatures[i];
+        }
+    }
+    _Message::SetEndianess(0);
+    bus.Stop();
+    bus.Join();
+}
+
+TEST(MarshalPlanTest, MismatchedArgs) {
+    const InterfaceDescription* iface = NULL;
+    QStatus status;
+
+    BusAttachment bus("MarshalPlanTest", false);
+    status = bus.Start();
+    ASSERT_EQ(ER_OK, status) << "  Actual Status: " << QCC_StatusText(status);
+    status = CreatePlanTestInterface(bus, iface);
+    ASSERT_EQ(ER_OK, status) << "  Actual Status: " << QCC_StatusText(status);
+
+    /* Signal0 has signature "s" and Signal1 has signature "a{sv}" */
+    MsgArg num("u", 42);
+    PlanTestMessage msg(bus);
+    status = msg.Signal(*iface->GetMember("Signal0"), &num, 1, true);
+    EXPECT_EQ(ER_BUS_UNEXPECTED_SIGNATURE, status) << "  Actual Status: " << QCC_StatusText(status);
+
+    MsgArg entry("{ss}", "key", "value");
+    MsgArg dict("a{ss}", 1, &entry);
+    status = msg.Signal(*iface->GetMember("Signal1"), &dict, 1, true);
+    EXPECT_EQ(ER_BUS_UNEXPECTED_SIGNATURE, status) << "  Actual Status: " << QCC_StatusText(status);
+
+    bus.Stop();
+    bus.Join();
+}
+
+TEST(MarshalPlanTest, Throughput) {
+    const uint32_t iterations = 20000;
+    const InterfaceDescription* iface = NULL;
+    PlanTestArgs args;
+    QStatus status;
+
+    BusAttachment bus("MarshalPlanTest", false);
+    status = bus.Start();
+    ASSERT_EQ(ER_OK, status) << "  Actual Status: " << QCC_StatusText(status);
+    status = CreatePlanTestInterface(bus, iface);
+    ASSERT_EQ(ER_OK, status) << "  Actual Status: " << QCC_StatusText(status);
+
+    PlanTestMessage msg(bus);
+    for (size_t i = 0; i < ArraySize(signatures); ++i) {
+        String name = "Signal" + U32ToString((uint32_t)i);
+        const InterfaceDescription::Member* member = iface->GetMember(name.c_str());
+        ASSERT_TRUE(member != NULL);
+        uint64_t ms[2];
+        for (size_t p = 0; p < 2; ++p) {
+            uint64_t start = GetTimestamp64();
+            for (uint32_t n = 0; n < iterations; ++n) {
+                status = msg.Signal(*member, args.Get(signatures[i]), 1, p == 1);
+                ASSERT_EQ(ER_OK, status) << "  Actual Status: " << QCC_StatusText(status);
+            }
+            ms[p] = GetTimestamp64() - start;
+        }
+        printf("Marshal \"%s\": generic %u msgs/sec, plan %u msgs/sec\n", signatures[i],
+               (unsigned int)((iterations * 1000) / (ms[0] ? ms[0] : 1)),
+               (unsigned int)((iterations * 1000) / (ms[1] ? ms[1] : 1)));
+    }
+    bus.Stop();
+    bus.Join();
+}
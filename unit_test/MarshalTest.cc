@@ -22,6 +22,7 @@
 #include <qcc/Pipe.h>
 #include <qcc/String.h>
 #include <qcc/StringUtil.h>
+#include <qcc/time.h>
 
 #include <alljoyn/BusAttachment.h>
 #include <alljoyn/Message.h>
@@ -32,6 +33,7 @@
 /* Private files included for unit testing */
 #include <PeerState.h>
 #include <SignatureUtils.h>
+#include <ArrayKernels.h>
 #include <RemoteEndpoint.h>
 
 /* Header files included for Google Test Framework */
@@ -91,6 +93,8 @@ class TestPipe : public qcc::Pipe {
 class MyMessage : public _Message {
   public:
 
+    typedef _Message::ReadBuffer ReadBuffer;
+
     MyMessage(BusAttachment& Bus) : _Message(Bus) { };
 
     QStatus MethodCall(const char* destination,
@@ -116,7 +120,7 @@ class MyMessage : public _Message {
         return SignalMsg(sig, destination, 0, objPath, iface, signalName, argList, numArgs, 0, 0);
     }
 
-    QStatus UnmarshalBody() { return UnmarshalArgs("*"); }
+    QStatus UnmarshalBody(bool lazy = false) { return UnmarshalArgs("*", NULL, lazy); }
 
     QStatus Read(RemoteEndpoint& ep, const qcc::String& endpointName, bool pedantic = true)
     {
@@ -124,6 +128,11 @@ class MyMessage : public _Message {
         return test;
     }
 
+    QStatus ReadBuffered(RemoteEndpoint& ep, ReadBuffer& rxBuf)
+    {
+        return _Message::ReadBuffered(ep, rxBuf, false);
+    }
+
     QStatus Unmarshal(RemoteEndpoint& ep, const qcc::String& endpointName, bool pedantic = true)
     {
         return _Message::Unmarshal(ep, pedantic);
@@ -297,6 +306,214 @@ TEST(MarshalTest, TestMsgUnpack) {
     delete bus;
 }
 
+TEST(MarshalTest, TestMsgUnpackLazy) {
+    QStatus status = ER_OK;
+
+    BusAttachment*bus = new BusAttachment("TestMsgUnpackLazy", false);
+    bus->Start();
+
+    TestPipe stream;
+    MyMessage msg(*bus);
+    MsgArg args[5];
+    size_t numArgs = ArraySize(args);
+    const char* strs[] = { "one", "two", "three" };
+    double d = 0.9;
+
+    TestPipe* pStream = &stream;
+    static const bool falsiness = false;
+    RemoteEndpoint ep(*bus, falsiness, String::Empty, pStream);
+
+    MsgArg::Set(args, numArgs, "usasyd", 4, "hello", ArraySize(strs), strs, 8, d);
+    status = msg.MethodCall("a.b.c", "/foo/bar", "foo.bar", "test", args, numArgs);
+    ASSERT_EQ(ER_OK, status) << "  Actual Status: " << QCC_StatusText(status);
+
+    status = msg.Deliver(ep);
+    ASSERT_EQ(ER_OK, status) << "  Actual Status: " << QCC_StatusText(status);
+
+    status = msg.Read(ep, ":88.88");
+    ASSERT_EQ(ER_OK, status) << "  Actual Status: " << QCC_StatusText(status);
+
+    status = msg.Unmarshal(ep, ":88.88");
+    ASSERT_EQ(ER_OK, status) << "  Actual Status: " << QCC_StatusText(status);
+
+    /* Basic args can be read straight from the body */
+    MsgArg peeked;
+    status = msg.PeekArg(1, peeked);
+    ASSERT_EQ(ER_OK, status) << "  Actual Status: " << QCC_StatusText(status);
+    EXPECT_STREQ("hello", peeked.v_string.str);
+    EXPECT_EQ(ER_BUS_BAD_VALUE_TYPE, msg.PeekArg(2, peeked));
+
+    status = msg.UnmarshalBody(true);
+    ASSERT_EQ(ER_OK, status) << "  Actual Status: " << QCC_StatusText(status);
+
+    /* Decode the args out of order */
+    const MsgArg* arg = msg.GetArg(4);
+    ASSERT_TRUE(arg != NULL);
+    EXPECT_EQ(ALLJOYN_DOUBLE, arg->typeId);
+    EXPECT_EQ(0.9, arg->v_double);
+
+    arg = msg.GetArg(2);
+    ASSERT_TRUE(arg != NULL);
+    ASSERT_EQ(ALLJOYN_ARRAY, arg->typeId);
+    ASSERT_EQ(ArraySize(strs), arg->v_array.GetNumElements());
+    EXPECT_STREQ("three", arg->v_array.GetElements()[2].v_string.str);
+
+    EXPECT_TRUE(msg.GetArg(5) == NULL);
+
+    uint32_t i;
+    const char* s;
+    uint8_t y;
+    MsgArg* as;
+    size_t numAs;
+    status = msg.GetArgs("usasyd", &i, &s, &numAs, &as, &y, &d);
+    ASSERT_EQ(ER_OK, status) << "  Actual Status: " << QCC_StatusText(status);
+    EXPECT_EQ(4U, i);
+    EXPECT_STREQ("hello", s);
+    EXPECT_EQ(ArraySize(strs), numAs);
+    EXPECT_EQ(8, y);
+    EXPECT_EQ(0.9, d);
+
+    delete bus;
+}
+
+TEST(MarshalTest, TestMsgUnpackBuffered) {
+    QStatus status = ER_OK;
+
+    BusAttachment*bus = new BusAttachment("TestMsgUnpackBuffered", false);
+    bus->Start();
+
+    TestPipe stream;
+    TestPipe* pStream = &stream;
+    static const bool falsiness = false;
+    RemoteEndpoint ep(*bus, falsiness, String::Empty, pStream);
+
+    /*
+     * Messages of varying length so they don't line up on 8 byte boundaries in the read buffer.
+     * One message is larger than the ring and gets read into its own buffer.
+     */
+    static const size_t lengths[] = { 1, 7, 100, 3, 20000, 5, 999, 2 };
+    for (size_t n = 0; n < ArraySize(lengths); ++n) {
+        MyMessage msg(*bus);
+        MsgArg args[2];
+        size_t numArgs = ArraySize(args);
+        String str(lengths[n], (char)('a' + n));
+        MsgArg::Set(args, numArgs, "us", (uint32_t)n, str.c_str());
+        status = msg.MethodCall("a.b.c", "/foo/bar", "foo.bar", "test", args, numArgs);
+        ASSERT_EQ(ER_OK, status) << "  Actual Status: " << QCC_StatusText(status);
+        status = msg.Deliver(ep);
+        ASSERT_EQ(ER_OK, status) << "  Actual Status: " << QCC_StatusText(status);
+    }
+
+    MyMessage::ReadBuffer rxBuf;
+    for (size_t n = 0; n < ArraySize(lengths); ++n) {
+        MyMessage msg(*bus);
+        status = msg.ReadBuffered(ep, rxBuf);
+        ASSERT_EQ(ER_OK, status) << "  Actual Status: " << QCC_StatusText(status);
+
+        status = msg.Unmarshal(ep, ":88.88");
+        ASSERT_EQ(ER_OK, status) << "  Actual Status: " << QCC_StatusText(status);
+
+        status = msg.UnmarshalBody();
+        ASSERT_EQ(ER_OK, status) << "  Actual Status: " << QCC_StatusText(status);
+
+        uint32_t i;
+        const char* s;
+        status = msg.GetArgs("us", &i, &s);
+        ASSERT_EQ(ER_OK, status) << "  Actual Status: " << QCC_StatusText(status);
+        EXPECT_EQ((uint32_t)n, i);
+        EXPECT_EQ(String(lengths[n], (char)('a' + n)), String(s));
+    }
+    EXPECT_EQ((size_t)0, rxBuf.Buffered());
+
+    /* Nothing more to read */
+    MyMessage msg(*bus);
+    status = msg.ReadBuffered(ep, rxBuf);
+    EXPECT_EQ(ER_TIMEOUT, status) << "  Actual Status: " << QCC_StatusText(status);
+
+    delete bus;
+}
+
+/*
+ * Pipe that counts the read calls made on it.
+ */
+class CountingPipe : public TestPipe {
+  public:
+    CountingPipe() : TestPipe(), reads(0) { }
+
+    QStatus PullBytes(void* buf, size_t reqBytes, size_t& actualBytes, uint32_t timeout = Event::WAIT_FOREVER)
+    {
+        ++reads;
+        return TestPipe::PullBytes(buf, reqBytes, actualBytes, timeout);
+    }
+
+    uint32_t reads;
+};
+
+/*
+ * Compares the rx throughput and read calls per message of reading small messages one at a time
+ * with reading them through a ReadBuffer.
+ */
+TEST(MarshalTest, ReadBufferedThroughput) {
+    const uint32_t numMsgs = 1000;
+    const uint32_t iterations = 20;
+    QStatus status = ER_OK;
+
+    BusAttachment*bus = new BusAttachment("ReadBufferedThroughput", false);
+    bus->Start();
+
+    CountingPipe stream;
+    CountingPipe* pStream = &stream;
+    static const bool falsiness = false;
+    RemoteEndpoint ep(*bus, falsiness, String::Empty, pStream);
+
+    uint32_t reads[2];
+    uint64_t ms[2];
+    for (int pass = 0; pass < 2; ++pass) {
+        bool buffered = (pass == 1);
+        MyMessage::ReadBuffer rxBuf;
+        uint32_t received = 0;
+        reads[pass] = 0;
+        ms[pass] = 0;
+        for (uint32_t it = 0; it < iterations; ++it) {
+            for (uint32_t n = 0; n < numMsgs; ++n) {
+                MyMessage msg(*bus);
+                MsgArg args[2];
+                size_t numArgs = ArraySize(args);
+                MsgArg::Set(args, numArgs, "us", n, "a small message body");
+                status = msg.MethodCall("a.b.c", "/foo/bar", "foo.bar", "test", args, numArgs);
+                ASSERT_EQ(ER_OK, status) << "  Actual Status: " << QCC_StatusText(status);
+                status = msg.Deliver(ep);
+                ASSERT_EQ(ER_OK, status) << "  Actual Status: " << QCC_StatusText(status);
+            }
+            stream.reads = 0;
+            uint64_t start = GetTimestamp64();
+            for (uint32_t n = 0; n < numMsgs; ++n) {
+                MyMessage msg(*bus);
+                if (buffered) {
+                    status = msg.ReadBuffered(ep, rxBuf);
+                } else {
+                    status = msg.Read(ep, ":88.88");
+                }
+                ASSERT_EQ(ER_OK, status) << "  Actual Status: " << QCC_StatusText(status);
+                status = msg.Unmarshal(ep, ":88.88");
+                ASSERT_EQ(ER_OK, status) << "  Actual Status: " << QCC_StatusText(status);
+                ++received;
+            }
+            ms[pass] += GetTimestamp64() - start;
+            reads[pass] += stream.reads;
+        }
+        EXPECT_EQ(numMsgs * iterations, received);
+        printf("%s: %u messages/sec, %u read calls per 100 messages\n",
+               buffered ? "Buffered  " : "Unbuffered",
+               (unsigned int)((received * 1000) / (ms[pass] ? ms[pass] : 1)),
+               (reads[pass] * 100) / received);
+    }
+    /* Reading through the buffer takes many messages per read call */
+    EXPECT_LT(reads[1] * 4, reads[0]);
+
+    delete bus;
+}
+
 /*--------------------------FUZZING TEST CODE---------------------------------*/
 static bool fuzzing = false;
 static bool nobig = false;
@@ -1175,6 +1392,26 @@ QStatus MarshalTests()
     } else {
         EXPECT_TRUE(foundExpectedFuzzingStatus(status)) << "Actual Status: " << QCC_StatusText(status) << errString.c_str();
     }
+    /*
+     * More container arrays than the unmarshal arena records inline
+     */
+    if (fuzzing || (status == ER_OK)) {
+        const char* str[] = { "one", "two", "three", "four", "five" };
+        MsgArg inner[20];
+        for (size_t i = 0; i < ArraySize(inner); i++) {
+            inner[i].Set("as", (i % ArraySize(str)) + 1, str);
+        }
+        MsgArg arg;
+        status = arg.Set("aas", ArraySize(inner), inner);
+        if (status == ER_OK) {
+            status = TestMarshal(&arg, 1);
+        }
+    }
+    if (!fuzzing) {
+        EXPECT_EQ(ER_OK, status) << "  Actual Status: " << QCC_StatusText(status) << errString.c_str();
+    } else {
+        EXPECT_TRUE(foundExpectedFuzzingStatus(status)) << "Actual Status: " << QCC_StatusText(status) << errString.c_str();
+    }
     /*
      * Variants
      */
@@ -1386,6 +1623,175 @@ QStatus MarshalTests()
     return status;
 }
 
+TEST(MarshalTest, SwapKernels) {
+    uint8_t src[1024 + 8];
+    uint8_t dst[1024 + 8];
+    for (size_t i = 0; i < sizeof(src); ++i) {
+        src[i] = (uint8_t)(i * 7 + 3);
+    }
+    /* Lengths either side of the vector widths and unaligned buffers */
+    for (size_t num = 0; num < 128; ++num) {
+        for (size_t offset = 0; offset < 8; ++offset) {
+            SwapArray16(dst + offset, src + offset, num);
+            for (size_t i = 0; i < num; ++i) {
+                uint16_t v, w;
+                memcpy(&v, src + offset + i * 2, 2);
+                memcpy(&w, dst + offset + i * 2, 2);
+                ASSERT_EQ(EndianSwap16(v), w) << "num " << num << " offset " << offset;
+            }
+            SwapArray32(dst + offset, src + offset, num);
+            for (size_t i = 0; i < num; ++i) {
+                uint32_t v, w;
+                memcpy(&v, src + offset + i * 4, 4);
+                memcpy(&w, dst + offset + i * 4, 4);
+                ASSERT_EQ(EndianSwap32(v), w) << "num " << num << " offset " << offset;
+            }
+            SwapArray64(dst + offset, src + offset, num);
+            for (size_t i = 0; i < num; ++i) {
+                uint64_t v, w;
+                memcpy(&v, src + offset + i * 8, 8);
+                memcpy(&w, dst + offset + i * 8, 8);
+                ASSERT_EQ(EndianSwap64(v), w) << "num " << num << " offset " << offset;
+            }
+        }
+    }
+}
+
+TEST(MarshalTest, BoolKernel) {
+    uint32_t wire[100];
+    bool bools[100];
+    for (size_t swap = 0; swap < 2; ++swap) {
+        for (size_t num = 0; num < ArraySize(wire); ++num) {
+            for (size_t i = 0; i < num; ++i) {
+                uint32_t b = (i % 3) ? 1 : 0;
+                wire[i] = swap ? EndianSwap32(b) : b;
+            }
+            ASSERT_TRUE(UnpackBoolArray(bools, wire, num, swap == 1));
+            ASSERT_TRUE(UnpackBoolArray(NULL, wire, num, swap == 1));
+            for (size_t i = 0; i < num; ++i) {
+                ASSERT_EQ((i % 3) != 0, bools[i]) << "num " << num << " index " << i;
+            }
+            /* Any value other than 0 or 1 must be rejected wherever it is */
+            for (size_t i = 0; i < num; ++i) {
+                uint32_t saved = wire[i];
+                wire[i] = swap ? EndianSwap32(2) : 0x100;
+                ASSERT_FALSE(UnpackBoolArray(bools, wire, num, swap == 1)) << "num " << num << " index " << i;
+                ASSERT_FALSE(UnpackBoolArray(NULL, wire, num, swap == 1)) << "num " << num << " index " << i;
+                wire[i] = saved;
+            }
+        }
+    }
+}
+
+TEST(MarshalTest, SwappedScalarArrays) {
+    QStatus status;
+    const size_t num = 10000;
+
+    BusAttachment bus("SwappedScalarArrays", false);
+    bus.Start();
+
+    TestPipe stream;
+    TestPipe* pStream = &stream;
+    static const bool falsiness = false;
+    RemoteEndpoint ep(bus, falsiness, String::Empty, pStream);
+
+    uint16_t* q = new uint16_t[num];
+    uint32_t* u = new uint32_t[num];
+    uint64_t* t = new uint64_t[num];
+    bool* b = new bool[num];
+    for (size_t i = 0; i < num; ++i) {
+        q[i] = (uint16_t)(i * 3);
+        u[i] = (uint32_t)(i * 0x10001);
+        t[i] = (uint64_t)i << 33 | i;
+        b[i] = (i & 2) != 0;
+    }
+    MsgArg args[4];
+    size_t numArgs = ArraySize(args);
+    MsgArg::Set(args, numArgs, "aqauatab", num, q, num, u, num, t, num, b);
+
+    /* Marshal in the opposite endianess so both the marshal and unmarshal side must swap */
+    const uint16_t probe = 1;
+    _Message::SetEndianess((*(const uint8_t*)&probe == 1) ? ALLJOYN_BIG_ENDIAN : ALLJOYN_LITTLE_ENDIAN);
+    MyMessage msg(bus);
+    status = msg.MethodCall("a.b.c", "/foo/bar", "foo.bar", "test", args, numArgs);
+    _Message::SetEndianess(0);
+    ASSERT_EQ(ER_OK, status) << "  Actual Status: " << QCC_StatusText(status);
+
+    status = msg.Deliver(ep);
+    ASSERT_EQ(ER_OK, status) << "  Actual Status: " << QCC_StatusText(status);
+    status = msg.Read(ep, ":88.88");
+    ASSERT_EQ(ER_OK, status) << "  Actual Status: " << QCC_StatusText(status);
+    status = msg.Unmarshal(ep, ":88.88");
+    ASSERT_EQ(ER_OK, status) << "  Actual Status: " << QCC_StatusText(status);
+    status = msg.UnmarshalBody();
+    ASSERT_EQ(ER_OK, status) << "  Actual Status: " << QCC_StatusText(status);
+
+    uint16_t* q2;
+    uint32_t* u2;
+    uint64_t* t2;
+    bool* b2;
+    size_t nq, nu, nt, nb;
+    status = msg.GetArgs("aqauatab", &nq, &q2, &nu, &u2, &nt, &t2, &nb, &b2);
+    ASSERT_EQ(ER_OK, status) << "  Actual Status: " << QCC_StatusText(status);
+    ASSERT_EQ(num, nq);
+    ASSERT_EQ(num, nu);
+    ASSERT_EQ(num, nt);
+    ASSERT_EQ(num, nb);
+    EXPECT_EQ(0, memcmp(q, q2, num * sizeof(uint16_t)));
+    EXPECT_EQ(0, memcmp(u, u2, num * sizeof(uint32_t)));
+    EXPECT_EQ(0, memcmp(t, t2, num * sizeof(uint64_t)));
+    for (size_t i = 0; i < num; ++i) {
+        ASSERT_EQ(b[i], b2[i]) << "index " << i;
+    }
+    delete [] q;
+    delete [] u;
+    delete [] t;
+    delete [] b;
+}
+
+TEST(MarshalTest, SwapKernelThroughput) {
+    const size_t num = 1024 * 1024;
+    const uint32_t iterations = 20;
+    uint64_t* src = new uint64_t[num];
+    uint64_t* dst = new uint64_t[num];
+    bool* bools = new bool[num * 2];
+    for (size_t i = 0; i < num; ++i) {
+        src[i] = i & 1;
+    }
+
+    uint64_t start = GetTimestamp64();
+    for (uint32_t n = 0; n < iterations; ++n) {
+        const uint32_t* s = (const uint32_t*)src;
+        uint32_t* d = (uint32_t*)dst;
+        for (size_t i = 0; i < num * 2; ++i) {
+            d[i] = EndianSwap32(s[i]);
+        }
+    }
+    uint64_t scalarMs = GetTimestamp64() - start;
+
+    start = GetTimestamp64();
+    for (uint32_t n = 0; n < iterations; ++n) {
+        SwapArray32(dst, src, num * 2);
+    }
+    uint64_t kernelMs = GetTimestamp64() - start;
+
+    start = GetTimestamp64();
+    for (uint32_t n = 0; n < iterations; ++n) {
+        ASSERT_TRUE(UnpackBoolArray(bools, src, num * 2, false));
+    }
+    uint64_t boolMs = GetTimestamp64() - start;
+
+    size_t mb = (iterations * num * sizeof(uint64_t)) / (1024 * 1024);
+    printf("Swap 32 bit arrays: scalar %u MB/sec, kernel %u MB/sec\n",
+           (unsigned int)((mb * 1000) / (scalarMs ? scalarMs : 1)),
+           (unsigned int)((mb * 1000) / (kernelMs ? kernelMs : 1)));
+    printf("Validate boolean arrays: %u MB/sec\n", (unsigned int)((mb * 1000) / (boolMs ? boolMs : 1)));
+
+    delete [] src;
+    delete [] dst;
+    delete [] bools;
+}
+
 TEST(MarshalTest, noFuzzing) {
     fuzzingBus = new BusAttachment("TestMsgUnPack", false);
     fuzzingBus->Start();
@@ -0,0 +1,201 @@
+/**
+ * @file
+ * Tests for the peer state table.
+ */
+/******************************************************************************
+ * Copyright 2013, Qualcomm Innovation Center, Inc.
+ *
+ *    Licensed under the Apache License, Version 2.0 (the "License");
+ *    you may not use this file except in compliance with the License.
+ *    You may obtain a copy of the License at
+ *
+ *        http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *    Unless required by applicable law or agreed to in writing, software
+ *    distributed under the License is distributed on an "AS IS" BASIS,
+ *    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *    See the License for the specific language governing permissions and
+ *    limitations under the License.
+ ******************************************************************************/
+
+#include <qcc/platform.h>
+
+#include <stdio.h>
+
+#include <qcc/KeyBlob.h>
+#include <qcc/String.h>
+#include <qcc/StringUtil.h>
+#include <qcc/Thread.h>
+#include <qcc/time.h>
+#include <qcc/Util.h>
+
+#include <alljoyn/Status.h>
+
+/* Private files included for unit testing */
+#include <PeerState.h>
+
+#include <gtest/gtest.h>
+
+using namespace qcc;
+using namespace ajn;
+
+TEST(PeerStateTest, LookupDoesNotInsert) {
+    PeerStateTable table;
+    PeerStateTable::Stats stats;
+
+    table.GetStats(stats);
+    /* The group peer is always present */
+    EXPECT_EQ(1U, stats.size);
+
+    PeerState unknown = table.GetPeerState(":1.1", false);
+    EXPECT_FALSE(table.IsKnownPeer(":1.1"));
+    EXPECT_FALSE(table.IsAlias(":1.1", "org.alljoyn.test"));
+    EXPECT_FALSE(table.IsKnownPeer("org.alljoyn.test"));
+
+    PeerState peer = table.GetPeerState(":1.1");
+    EXPECT_TRUE(table.IsKnownPeer(":1.1"));
+    EXPECT_TRUE(peer.iden(table.GetPeerState(":1.1", false)));
+    EXPECT_FALSE(peer.iden(unknown));
+
+    /* An alias shares the peer state of the unique name */
+    PeerState alias = table.GetPeerState(":1.1", "org.alljoyn.test");
+    EXPECT_TRUE(peer.iden(alias));
+    EXPECT_TRUE(table.IsAlias(":1.1", "org.alljoyn.test"));
+
+    table.DelPeerState(":1.1");
+    table.DelPeerState("org.alljoyn.test");
+    EXPECT_FALSE(table.IsKnownPeer(":1.1"));
+
+    table.GetStats(stats);
+    EXPECT_EQ(1U, stats.size);
+    EXPECT_GT(stats.hits, 0U);
+    EXPECT_GT(stats.misses, 0U);
+}
+
+TEST(PeerStateTest, Eviction) {
+    const size_t maxPeers = 64;
+    const uint32_t idleTimeout = 10;
+    PeerStateTable table(maxPeers, idleTimeout);
+    PeerStateTable::Stats stats;
+
+    /* A peer with keys is never evicted */
+    KeyBlob key;
+    key.Rand(16, KeyBlob::AES);
+    table.GetPeerState(":1.0")->SetKey(key, PEER_SESSION_KEY);
+
+    for (uint32_t i = 1; i <= 1000; ++i) {
+        table.GetPeerState(":1." + U32ToString(i));
+    }
+    table.GetStats(stats);
+    EXPECT_GE(maxPeers + 1, stats.size);
+    EXPECT_LT(0U, stats.evictions);
+    EXPECT_TRUE(table.IsKnownPeer(":1.0"));
+    EXPECT_TRUE(table.IsKnownPeer(":1.1000"));
+    EXPECT_FALSE(table.IsKnownPeer(":1.1"));
+
+    /* Aliases count against the same bound */
+    for (uint32_t i = 1; i <= 1000; ++i) {
+        table.GetPeerState(":2." + U32ToString(i), "org.alljoyn.alias" + U32ToString(i));
+    }
+    table.GetStats(stats);
+    EXPECT_GE(maxPeers + 1, stats.size);
+    EXPECT_TRUE(table.IsKnownPeer(":1.0"));
+
+    /* Idle peers without keys are evicted */
+    qcc::Sleep(idleTimeout * 2);
+    table.GetPeerState(":1.1000");
+    table.EvictIdle();
+    table.GetStats(stats);
+    EXPECT_EQ(3U, stats.size);
+    EXPECT_TRUE(table.IsKnownPeer(":1.0"));
+    EXPECT_TRUE(table.IsKnownPeer(":1.1000"));
+    EXPECT_TRUE(table.IsKnownPeer(""));
+}
+
+TEST(PeerStateTest, SerialWindow) {
+    const uint32_t sizes[] = { 128, 1000 };
+
+    for (size_t n = 0; n < ArraySize(sizes); ++n) {
+        PeerState peer;
+        peer->SetSerialWindowSize(sizes[n]);
+        EXPECT_EQ(sizes[n], peer->SerialWindowSize());
+        EXPECT_FALSE(peer->IsValidSerial(0, false, false));
+
+        /* Serial numbers wrap around */
+        uint32_t top = 0xFFFFFF00;
+        EXPECT_TRUE(peer->IsValidSerial(top, false, false));
+        EXPECT_FALSE(peer->IsValidSerial(top, false, false));
+        for (uint32_t i = 1; i < 2 * sizes[n]; ++i) {
+            uint32_t serial = top + i + ((i & 1) ? 1 : -1);
+            if (serial == 0) {
+                continue;
+            }
+            /* Messages arriving out of order inside the window are valid but only once */
+            EXPECT_TRUE(peer->IsValidSerial(serial, false, true)) << "serial " << serial;
+            EXPECT_FALSE(peer->IsValidSerial(serial, false, true)) << "serial " << serial;
+        }
+        top += 2 * sizes[n];
+        EXPECT_TRUE(peer->IsValidSerial(top + 1000, false, false));
+        EXPECT_TRUE(peer->IsValidSerial(top + 1000 - (sizes[n] - 1), false, false));
+        EXPECT_FALSE(peer->IsValidSerial(top + 1000 - sizes[n], false, false));
+    }
+}
+
+TEST(PeerStateTest, TableSerialWindow) {
+    const size_t defaultWindow = _PeerState::DEFAULT_SERIAL_WINDOW;
+    PeerStateTable table;
+    EXPECT_EQ(defaultWindow, table.GetPeerState(":1.1")->SerialWindowSize());
+
+    /* Peers added after the window is set use the new window */
+    table.SetSerialWindowSize(1000);
+    EXPECT_EQ(1000U, table.GetPeerState(":1.2")->SerialWindowSize());
+    EXPECT_EQ(1000U, table.GetPeerState(":1.3", "org.alljoyn.test")->SerialWindowSize());
+    EXPECT_EQ(defaultWindow, table.GetPeerState(":1.1")->SerialWindowSize());
+}
+
+class PeerLookupThread : public Thread {
+  public:
+    PeerLookupThread(PeerStateTable& table, uint32_t first, uint32_t iterations) :
+        Thread("PeerLookup"), table(table), first(first), iterations(iterations) { }
+
+    ThreadReturn STDCALL Run(void* arg)
+    {
+        for (uint32_t i = 0; i < iterations; ++i) {
+            table.GetPeerState(":1." + U32ToString(first + (i % 32)))->IsValidSerial(i + 1, false, false);
+        }
+        return 0;
+    }
+
+    PeerStateTable& table;
+    uint32_t first;
+    uint32_t iterations;
+};
+
+/*
+ * Several threads check serial numbers from different peers the way messages are unmarshaled.
+ */
+TEST(PeerStateTest, ConcurrentLookup) {
+    const uint32_t numThreads = 4;
+    const uint32_t iterations = 50000;
+    PeerStateTable table;
+    PeerLookupThread* threads[numThreads];
+
+    uint64_t start = GetTimestamp64();
+    for (uint32_t i = 0; i < numThreads; ++i) {
+        threads[i] = new PeerLookupThread(table, i * 32, iterations);
+        threads[i]->Start();
+    }
+    for (uint32_t i = 0; i < numThreads; ++i) {
+        threads[i]->Join();
+        delete threads[i];
+    }
+    uint64_t ms = GetTimestamp64() - start;
+
+    PeerStateTable::Stats stats;
+    table.GetStats(stats);
+    EXPECT_EQ(numThreads * 32 + 1, stats.size);
+    EXPECT_EQ((uint64_t)numThreads * iterations, stats.hits + stats.misses);
+    printf("%u threads: %u lookups/sec, hit rate %u%%\n", numThreads,
+           (unsigned int)(((uint64_t)numThreads * iterations * 1000) / (ms ? ms : 1)),
+           (unsigned int)((stats.hits * 100) / (stats.hits + stats.misses)));
+}
@@ -21,13 +21,16 @@
 #include <vector>
 
 #include <qcc/String.h>
+#include <qcc/StringUtil.h>
 #include <qcc/Thread.h>
+#include <qcc/time.h>
 
 #include <alljoyn/BusAttachment.h>
 #include <alljoyn/DBusStd.h>
 #include <alljoyn/AllJoynStd.h>
 #include <alljoyn/BusObject.h>
 #include <alljoyn/MsgArg.h>
+#include <alljoyn/ProxyBusObject.h>
 #include <alljoyn/version.h>
 
 #include <alljoyn/Status.h>
@@ -379,3 +382,108 @@ TEST_F(SessionTest, SessionJoined) {
     " should be the same as " << busB.GetUniqueName().c_str();;
 }
 
+
+class ConcurrentJoinsThread : public Thread {
+  public:
+    ConcurrentJoinsThread(uint32_t id, SessionPort port, const SessionOpts& opts) :
+        Thread("ConcurrentJoins"), bus(("Joiner" + U32ToString(id)).c_str()), port(port), opts(opts), status(ER_FAIL), sessionId(0), ms(0) { }
+
+    ThreadReturn STDCALL Run(void* arg)
+    {
+        uint64_t start = GetTimestamp64();
+        SessionOpts opts = this->opts;
+        status = bus.JoinSession("bus.ConcurrentJoins", port, NULL, sessionId, opts);
+        ms = GetTimestamp64() - start;
+        return 0;
+    }
+
+    BusAttachment bus;
+    SessionPort port;
+    SessionOpts opts;
+    QStatus status;
+    SessionId sessionId;
+    uint64_t ms;
+};
+
+/*
+ * Many clients of the same daemon join the same multipoint session at once. The daemon handles the
+ * joins on a bounded pool of threads so they all complete without running out of threads. Debug
+ * builds of the daemon report the pool statistics on org.alljoyn.Bus.Debug.Session.
+ */
+TEST_F(SessionTest, ConcurrentJoins)
+{
+    const uint32_t numJoiners = 48;
+    SessionOpts opts(SessionOpts::TRAFFIC_MESSAGES, true, SessionOpts::PROXIMITY_ANY, TRANSPORT_ANY);
+    SessionPort port = 28;
+
+    BusAttachment host("ConcurrentJoinsHost");
+    TwoMultipointSessionsSessionPortListener listener;
+    ASSERT_EQ(ER_OK, host.Start());
+    ASSERT_EQ(ER_OK, host.Connect(getConnectArg().c_str()));
+    ASSERT_EQ(ER_OK, host.BindSessionPort(port, opts, listener));
+    ASSERT_EQ(ER_OK, host.RequestName("bus.ConcurrentJoins", DBUS_NAME_FLAG_DO_NOT_QUEUE));
+    ASSERT_EQ(ER_OK, host.AdvertiseName("bus.ConcurrentJoins", TRANSPORT_ANY));
+
+    /* Connect every joiner before any of them starts so a failure here leaves no thread running */
+    vector<ConcurrentJoinsThread*> joiners;
+    bool connected = true;
+    for (uint32_t i = 0; connected && (i < numJoiners); ++i) {
+        joiners.push_back(new ConcurrentJoinsThread(i, port, opts));
+        QStatus status = joiners.back()->bus.Start();
+        if (status == ER_OK) {
+            status = joiners.back()->bus.Connect(getConnectArg().c_str());
+        }
+        EXPECT_EQ(ER_OK, status) << "  Actual Status: " << QCC_StatusText(status);
+        connected = (status == ER_OK);
+    }
+
+    if (connected) {
+        uint64_t start = GetTimestamp64();
+        for (uint32_t i = 0; i < numJoiners; ++i) {
+            joiners[i]->Start();
+        }
+        uint64_t maxMs = 0;
+        for (uint32_t i = 0; i < numJoiners; ++i) {
+            joiners[i]->Join();
+            EXPECT_EQ(ER_OK, joiners[i]->status) << "  Actual Status: " << QCC_StatusText(joiners[i]->status);
+            /* All joiners are members of the one multipoint session */
+            EXPECT_EQ(joiners[0]->sessionId, joiners[i]->sessionId);
+            maxMs = (joiners[i]->ms > maxMs) ? joiners[i]->ms : maxMs;
+        }
+        uint64_t ms = GetTimestamp64() - start;
+        printf("%u concurrent joins took %u ms, slowest join %u ms\n", numJoiners, (unsigned int)ms, (unsigned int)maxMs);
+    }
+
+#ifndef NDEBUG
+    /* Debug builds of the daemon, which the debug build of this test runs against, report the pool statistics */
+    if (connected) {
+        ProxyBusObject debugObj(host, org::alljoyn::Bus::WellKnownName, org::alljoyn::Daemon::Debug::ObjectPath, 0);
+        QStatus status = debugObj.IntrospectRemoteObject();
+        EXPECT_EQ(ER_OK, status) << "  Actual Status: " << QCC_StatusText(status);
+        MsgArg val;
+        if (status == ER_OK) {
+            status = debugObj.GetProperty("org.alljoyn.Bus.Debug.Session", "JoinSessionStats", val);
+            EXPECT_EQ(ER_OK, status) << "  Actual Status: " << QCC_StatusText(status);
+        }
+        uint32_t queued, maxQueued, threads, maxThreads, peakThreads, handled, maxWaitMs;
+        if (status == ER_OK) {
+            status = val.Get("(uuuuuuu)", &queued, &maxQueued, &threads, &maxThreads, &peakThreads, &handled, &maxWaitMs);
+            EXPECT_EQ(ER_OK, status) << "  Actual Status: " << QCC_StatusText(status);
+        }
+        if (status == ER_OK) {
+            printf("JoinSession queue: %u handled, %u peak threads of %u, queue depth %u, longest wait %u ms\n",
+                   handled, peakThreads, maxThreads, maxQueued, maxWaitMs);
+            /* The joins never used more than the maximum number of threads and none were left behind */
+            EXPECT_LE(peakThreads, maxThreads);
+            EXPECT_GE(handled, numJoiners);
+            EXPECT_EQ(0U, queued);
+        }
+    }
+#endif
+
+    for (uint32_t i = 0; i < joiners.size(); ++i) {
+        joiners[i]->bus.Stop();
+        joiners[i]->bus.Join();
+        delete joiners[i];
+    }
+}
@@ -0,0 +1,495 @@
+/**
+ * @file
+ * Tests for sessionless signals. Many clients add sessionless match rules at the same time, which
+ * makes the daemon queue a re-receive of sessionless signals for each of them, and then check they
+ * all receive a sessionless signal and are told when their re-receive is complete. The daemon's
+ * store of sessionless signals is checked through cancelling, replacing and expiring signals.
+ */
+/******************************************************************************
+ * Copyright 2013, Qualcomm Innovation Center, Inc.
+ *
+ *    Licensed under the Apache License, Version 2.0 (the "License");
+ *    you may not use this file except in compliance with the License.
+ *    You may obtain a copy of the License at
+ *
+ *        http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *    Unless required by applicable law or agreed to in writing, software
+ *    distributed under the License is distributed on an "AS IS" BASIS,
+ *    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *    See the License for the specific language governing permissions and
+ *    limitations under the License.
+ ******************************************************************************/
+
+#include <qcc/platform.h>
+
+#include <stdio.h>
+#include <algorithm>
+#include <vector>
+
+#include <qcc/Environ.h>
+#include <qcc/Event.h>
+#include <qcc/Mutex.h>
+#include <qcc/String.h>
+#include <qcc/StringUtil.h>
+#include <qcc/Thread.h>
+#include <qcc/atomic.h>
+#include <qcc/time.h>
+
+#include <alljoyn/AllJoynStd.h>
+#include <alljoyn/BusAttachment.h>
+#include <alljoyn/BusObject.h>
+#include <alljoyn/InterfaceDescription.h>
+#include <alljoyn/MessageReceiver.h>
+
+#include <alljoyn/Status.h>
+
+#include "ajTestCommon.h"
+
+#include <gtest/gtest.h>
+
+using namespace qcc;
+using namespace ajn;
+
+static const char* INTERFACE_NAME = "org.alljoyn.test.SessionlessTest";
+static const char* OBJECT_PATH = "/org/alljoyn/test/SessionlessTest";
+static const uint32_t NUM_CLIENTS = 16;
+static const uint32_t NUM_SIGNALS = 8;
+
+static QStatus CreateTestInterface(BusAttachment& bus, const InterfaceDescription*& iface)
+{
+    InterfaceDescription* intf = NULL;
+    QStatus status = bus.CreateInterface(INTERFACE_NAME, intf, false);
+    if (status == ER_OK) {
+        status = intf->AddSignal("Changed", "u", NULL, 0);
+    }
+    if (status == ER_OK) {
+        intf->Activate();
+        iface = intf;
+    }
+    return status;
+}
+
+class SessionlessSender : public BusObject {
+  public:
+    SessionlessSender(const InterfaceDescription* iface, const char* path = OBJECT_PATH) : BusObject(path), member(iface->GetMember("Changed"))
+    {
+        AddInterface(*iface);
+    }
+
+    QStatus SendChanged(uint32_t value, uint16_t ttl = 0, Message* msg = NULL)
+    {
+        MsgArg arg("u", value);
+        return Signal(NULL, 0, *member, &arg, 1, ttl, ALLJOYN_FLAG_SESSIONLESS, msg);
+    }
+
+  private:
+    const InterfaceDescription::Member* member;
+};
+
+class SessionlessClient : public Thread, public MessageReceiver {
+  public:
+    SessionlessClient(uint32_t id) :
+        Thread("SessionlessClient"), bus(("SessionlessClient" + U32ToString(id)).c_str(), true), status(ER_FAIL), ms(0), received(0) { }
+
+    QStatus Connect()
+    {
+        const InterfaceDescription* iface = NULL;
+        QStatus status = CreateTestInterface(bus, iface);
+        if (status == ER_OK) {
+            status = bus.Start();
+        }
+        if (status == ER_OK) {
+            status = bus.Connect(getConnectArg().c_str());
+        }
+        if (status == ER_OK) {
+            status = bus.RegisterSignalHandler(this, static_cast<MessageReceiver::SignalHandler>(&SessionlessClient::Changed),
+                                               iface->GetMember("Changed"), NULL);
+        }
+        if (status == ER_OK) {
+            const InterfaceDescription* ajIface = bus.GetInterface(org::alljoyn::Bus::InterfaceName);
+            status = bus.RegisterSignalHandler(this, static_cast<MessageReceiver::SignalHandler>(&SessionlessClient::CatchupComplete),
+                                               ajIface->GetMember("SessionlessCatchupComplete"), NULL);
+        }
+        return status;
+    }
+
+    ThreadReturn STDCALL Run(void* arg)
+    {
+        /* Adding the first sessionless rule makes the daemon re-receive sessionless signals for the client */
+        uint64_t start = GetTimestamp64();
+        status = bus.AddMatch("type='signal',sessionless='t'");
+        ms = GetTimestamp64() - start;
+        return 0;
+    }
+
+    void Changed(const InterfaceDescription::Member* member, const char* srcPath, Message& msg)
+    {
+        valuesLock.Lock();
+        values.push_back(msg->GetArg(0)->v_uint32);
+        valuesLock.Unlock();
+        IncrementAndFetch(&received);
+    }
+
+    /* Returns the values received that are at least min, in ascending order */
+    std::vector<uint32_t> GetValues(uint32_t min)
+    {
+        std::vector<uint32_t> sorted;
+        valuesLock.Lock();
+        for (size_t i = 0; i < values.size(); ++i) {
+            if (values[i] >= min) {
+                sorted.push_back(values[i]);
+            }
+        }
+        valuesLock.Unlock();
+        std::sort(sorted.begin(), sorted.end());
+        return sorted;
+    }
+
+    void CatchupComplete(const InterfaceDescription::Member* member, const char* srcPath, Message& msg)
+    {
+        complete.SetEvent();
+    }
+
+    BusAttachment bus;
+    QStatus status;
+    uint64_t ms;
+    volatile int32_t received;
+    Event complete;
+
+  private:
+    Mutex valuesLock;
+    std::vector<uint32_t> values;
+};
+
+/*
+ * Many clients add sessionless match rules at once. Adding the rule must not wait for catchups with
+ * remote daemons to finish.
+ */
+TEST(SessionlessTest, ConcurrentRereceive) {
+    const InterfaceDescription* iface = NULL;
+    BusAttachment service("SessionlessService", true);
+    QStatus status = CreateTestInterface(service, iface);
+    ASSERT_EQ(ER_OK, status) << "  Actual Status: " << QCC_StatusText(status);
+    SessionlessSender sender(iface);
+    ASSERT_EQ(ER_OK, service.RegisterBusObject(sender));
+    ASSERT_EQ(ER_OK, service.Start());
+    ASSERT_EQ(ER_OK, service.Connect(getConnectArg().c_str()));
+
+    /* The first sessionless rule starts discovery of remote sessionless signals */
+    ASSERT_EQ(ER_OK, service.AddMatch("type='signal',sessionless='t'"));
+
+    SessionlessClient* clients[NUM_CLIENTS];
+    for (uint32_t i = 0; i < NUM_CLIENTS; ++i) {
+        clients[i] = new SessionlessClient(i);
+        status = clients[i]->Connect();
+        ASSERT_EQ(ER_OK, status) << "  Actual Status: " << QCC_StatusText(status);
+    }
+    uint64_t start = GetTimestamp64();
+    for (uint32_t i = 0; i < NUM_CLIENTS; ++i) {
+        clients[i]->Start();
+    }
+    uint64_t maxMs = 0;
+    for (uint32_t i = 0; i < NUM_CLIENTS; ++i) {
+        clients[i]->Join();
+        EXPECT_EQ(ER_OK, clients[i]->status) << "  Actual Status: " << QCC_StatusText(clients[i]->status);
+        maxMs = (clients[i]->ms > maxMs) ? clients[i]->ms : maxMs;
+    }
+    uint64_t ms = GetTimestamp64() - start;
+    EXPECT_GT(5000U, ms);
+    printf("%u concurrent rereceive requests took %u ms, slowest AddMatch %u ms\n", NUM_CLIENTS, (unsigned int)ms, (unsigned int)maxMs);
+
+    /* Every client is told its re-receive is complete */
+    for (uint32_t i = 0; i < NUM_CLIENTS; ++i) {
+        status = Event::Wait(clients[i]->complete, 5000);
+        EXPECT_EQ(ER_OK, status) << "  Actual Status: " << QCC_StatusText(status);
+    }
+
+    /* Every client receives sessionless signals sent after its rule was added */
+    Message msg(service);
+    EXPECT_EQ(ER_OK, sender.SendChanged(1, 0, &msg));
+    for (uint32_t i = 0; i < NUM_CLIENTS; ++i) {
+        for (int j = 0; (j < 500) && (clients[i]->received == 0); ++j) {
+            qcc::Sleep(10);
+        }
+        EXPECT_LT(0, clients[i]->received);
+    }
+
+    for (uint32_t i = 0; i < NUM_CLIENTS; ++i) {
+        clients[i]->bus.Stop();
+        clients[i]->bus.Join();
+        delete clients[i];
+    }
+
+    /* Leave nothing in the daemon's store for the tests that cancel signals by serial number */
+    EXPECT_EQ(ER_OK, sender.CancelSessionlessMessage(msg));
+}
+
+/*
+ * Many clients catch up with the sessionless signals of a producer attached to a remote daemon at
+ * once. The catchups for the remote daemon are queued and run one after the other. Every client is
+ * told when its catchup is complete and has re-received every signal by then.
+ *
+ * The producer connects to the daemon at REMOTE_BUS_ADDRESS, which must be able to discover the
+ * daemon at BUS_ADDRESS. The test does nothing if REMOTE_BUS_ADDRESS is not set.
+ */
+TEST(SessionlessTest, ConcurrentRemoteRereceive) {
+    qcc::String remoteConnectArg = Environ::GetAppEnviron()->Find("REMOTE_BUS_ADDRESS");
+    if (remoteConnectArg.empty()) {
+        printf("REMOTE_BUS_ADDRESS is not set, skipping remote rereceive test\n");
+        return;
+    }
+
+    const InterfaceDescription* iface = NULL;
+    BusAttachment producer("SessionlessProducer", true);
+    QStatus status = CreateTestInterface(producer, iface);
+    ASSERT_EQ(ER_OK, status) << "  Actual Status: " << QCC_StatusText(status);
+    /* Each signal is sent from a different object path so the remote daemon keeps all of them */
+    SessionlessSender* senders[NUM_SIGNALS];
+    for (uint32_t i = 0; i < NUM_SIGNALS; ++i) {
+        senders[i] = new SessionlessSender(iface, (qcc::String(OBJECT_PATH) + "/" + U32ToString(i)).c_str());
+        ASSERT_EQ(ER_OK, producer.RegisterBusObject(*senders[i]));
+    }
+    ASSERT_EQ(ER_OK, producer.Start());
+    ASSERT_EQ(ER_OK, producer.Connect(remoteConnectArg.c_str()));
+    std::vector<Message> msgs(NUM_SIGNALS, Message(producer));
+    for (uint32_t i = 0; i < NUM_SIGNALS; ++i) {
+        EXPECT_EQ(ER_OK, senders[i]->SendChanged(i, 0, &msgs[i]));
+    }
+
+    /* The first client's rule starts discovery and receives the signals without a catchup */
+    SessionlessClient first(NUM_CLIENTS);
+    ASSERT_EQ(ER_OK, first.Connect());
+    ASSERT_EQ(ER_OK, first.bus.AddMatch("type='signal',sessionless='t'"));
+    for (int j = 0; (j < 3000) && (first.received < (int32_t)NUM_SIGNALS); ++j) {
+        qcc::Sleep(10);
+    }
+    ASSERT_EQ((int32_t)NUM_SIGNALS, first.received);
+
+    /* Every other client has to catch up with the remote daemon */
+    SessionlessClient* clients[NUM_CLIENTS];
+    for (uint32_t i = 0; i < NUM_CLIENTS; ++i) {
+        clients[i] = new SessionlessClient(i);
+        status = clients[i]->Connect();
+        ASSERT_EQ(ER_OK, status) << "  Actual Status: " << QCC_StatusText(status);
+    }
+    uint64_t start = GetTimestamp64();
+    for (uint32_t i = 0; i < NUM_CLIENTS; ++i) {
+        clients[i]->Start();
+    }
+    for (uint32_t i = 0; i < NUM_CLIENTS; ++i) {
+        clients[i]->Join();
+        EXPECT_EQ(ER_OK, clients[i]->status) << "  Actual Status: " << QCC_StatusText(clients[i]->status);
+    }
+    for (uint32_t i = 0; i < NUM_CLIENTS; ++i) {
+        status = Event::Wait(clients[i]->complete, 30000);
+        EXPECT_EQ(ER_OK, status) << "  Actual Status: " << QCC_StatusText(status);
+
+        /* The re-received signals and the completion signal come from different senders and may be dispatched out of order */
+        for (int j = 0; (j < 100) && (clients[i]->received < (int32_t)NUM_SIGNALS); ++j) {
+            qcc::Sleep(10);
+        }
+        EXPECT_EQ((int32_t)NUM_SIGNALS, clients[i]->received);
+    }
+    uint64_t ms = GetTimestamp64() - start;
+    printf("%u concurrent remote catchups took %u ms\n", NUM_CLIENTS, (unsigned int)ms);
+
+    for (uint32_t i = 0; i < NUM_CLIENTS; ++i) {
+        clients[i]->bus.Stop();
+        clients[i]->bus.Join();
+        delete clients[i];
+    }
+    first.bus.Stop();
+    first.bus.Join();
+
+    /* Leave nothing in the remote daemon's store for later tests */
+    for (uint32_t i = 0; i < NUM_SIGNALS; ++i) {
+        EXPECT_EQ(ER_OK, senders[i]->CancelSessionlessMessage(msgs[i]));
+    }
+    producer.Stop();
+    producer.Join();
+    for (uint32_t i = 0; i < NUM_SIGNALS; ++i) {
+        delete senders[i];
+    }
+}
+
+/*
+ * A stored sessionless signal is cancelled by its serial number, but only by its sender.
+ */
+TEST(SessionlessTest, CancelBySerial) {
+    const InterfaceDescription* iface = NULL;
+    BusAttachment service("SessionlessCancel", true);
+    ASSERT_EQ(ER_OK, CreateTestInterface(service, iface));
+    SessionlessSender sender(iface);
+    ASSERT_EQ(ER_OK, service.RegisterBusObject(sender));
+    ASSERT_EQ(ER_OK, service.Start());
+    ASSERT_EQ(ER_OK, service.Connect(getConnectArg().c_str()));
+
+    const InterfaceDescription* otherIface = NULL;
+    BusAttachment other("SessionlessCancelOther", true);
+    ASSERT_EQ(ER_OK, CreateTestInterface(other, otherIface));
+    SessionlessSender otherSender(otherIface);
+    ASSERT_EQ(ER_OK, other.RegisterBusObject(otherSender));
+    ASSERT_EQ(ER_OK, other.Start());
+    ASSERT_EQ(ER_OK, other.Connect(getConnectArg().c_str()));
+
+    Message msg(service);
+    ASSERT_EQ(ER_OK, sender.SendChanged(1, 0, &msg));
+
+    /* Nobody else may cancel the signal */
+    EXPECT_EQ(ER_BUS_NOT_ALLOWED, otherSender.CancelSessionlessMessage(msg->GetCallSerial()));
+    EXPECT_EQ(ER_BUS_NO_SUCH_MESSAGE, sender.CancelSessionlessMessage(msg->GetCallSerial() + 1000));
+
+    EXPECT_EQ(ER_OK, sender.CancelSessionlessMessage(msg->GetCallSerial()));
+    EXPECT_EQ(ER_BUS_NO_SUCH_MESSAGE, sender.CancelSessionlessMessage(msg->GetCallSerial()));
+
+    other.Stop();
+    other.Join();
+    service.Stop();
+    service.Join();
+}
+
+/*
+ * A sessionless signal replaces the stored signal with the same sender, interface, member and
+ * object path. Signals from other object paths are kept.
+ */
+TEST(SessionlessTest, ReplaceByKey) {
+    const InterfaceDescription* iface = NULL;
+    BusAttachment service("SessionlessReplace", true);
+    ASSERT_EQ(ER_OK, CreateTestInterface(service, iface));
+    SessionlessSender sender(iface);
+    SessionlessSender otherPath(iface, (qcc::String(OBJECT_PATH) + "/other").c_str());
+    ASSERT_EQ(ER_OK, service.RegisterBusObject(sender));
+    ASSERT_EQ(ER_OK, service.RegisterBusObject(otherPath));
+    ASSERT_EQ(ER_OK, service.Start());
+    ASSERT_EQ(ER_OK, service.Connect(getConnectArg().c_str()));
+
+    Message first(service);
+    Message kept(service);
+    Message second(service);
+    ASSERT_EQ(ER_OK, sender.SendChanged(1, 0, &first));
+    ASSERT_EQ(ER_OK, otherPath.SendChanged(2, 0, &kept));
+    ASSERT_EQ(ER_OK, sender.SendChanged(3, 0, &second));
+
+    /* The first signal was replaced so it can no longer be cancelled */
+    EXPECT_EQ(ER_BUS_NO_SUCH_MESSAGE, sender.CancelSessionlessMessage(first->GetCallSerial()));
+    EXPECT_EQ(ER_OK, sender.CancelSessionlessMessage(second->GetCallSerial()));
+    EXPECT_EQ(ER_OK, otherPath.CancelSessionlessMessage(kept->GetCallSerial()));
+
+    service.Stop();
+    service.Join();
+}
+
+/*
+ * Stored sessionless signals expire in order of their expiry time, not the order they were sent.
+ */
+TEST(SessionlessTest, ExpiryOrder) {
+    const InterfaceDescription* iface = NULL;
+    BusAttachment service("SessionlessExpiry", true);
+    ASSERT_EQ(ER_OK, CreateTestInterface(service, iface));
+    SessionlessSender longLived(iface, (qcc::String(OBJECT_PATH) + "/long").c_str());
+    SessionlessSender shortLived(iface, (qcc::String(OBJECT_PATH) + "/short").c_str());
+    SessionlessSender immortal(iface, (qcc::String(OBJECT_PATH) + "/immortal").c_str());
+    ASSERT_EQ(ER_OK, service.RegisterBusObject(longLived));
+    ASSERT_EQ(ER_OK, service.RegisterBusObject(shortLived));
+    ASSERT_EQ(ER_OK, service.RegisterBusObject(immortal));
+    ASSERT_EQ(ER_OK, service.Start());
+    ASSERT_EQ(ER_OK, service.Connect(getConnectArg().c_str()));
+
+    /* Time to live of sessionless signals is in seconds */
+    Message longMsg(service);
+    Message shortMsg(service);
+    Message immortalMsg(service);
+    ASSERT_EQ(ER_OK, longLived.SendChanged(1, 10, &longMsg));
+    ASSERT_EQ(ER_OK, shortLived.SendChanged(2, 1, &shortMsg));
+    ASSERT_EQ(ER_OK, immortal.SendChanged(3, 0, &immortalMsg));
+
+    qcc::Sleep(2500);
+
+    /* Only the signal sent second has expired and been dropped */
+    EXPECT_EQ(ER_BUS_NO_SUCH_MESSAGE, shortLived.CancelSessionlessMessage(shortMsg->GetCallSerial()));
+    EXPECT_EQ(ER_OK, longLived.CancelSessionlessMessage(longMsg->GetCallSerial()));
+    EXPECT_EQ(ER_OK, immortal.CancelSessionlessMessage(immortalMsg->GetCallSerial()));
+
+    service.Stop();
+    service.Join();
+}
+
+/*
+ * A client catching up with a remote daemon asks for the range of change ids half the change id
+ * space behind the last one it saw, which wraps around zero while the remote daemon has stored
+ * fewer than 2^31 signals. The catchup delivers the latest signal for each key and leaves out
+ * cancelled and expired signals.
+ *
+ * The producer connects to the daemon at REMOTE_BUS_ADDRESS. The test does nothing if
+ * REMOTE_BUS_ADDRESS is not set.
+ */
+TEST(SessionlessTest, RemoteRereceiveWrappedRange) {
+    qcc::String remoteConnectArg = Environ::GetAppEnviron()->Find("REMOTE_BUS_ADDRESS");
+    if (remoteConnectArg.empty()) {
+        printf("REMOTE_BUS_ADDRESS is not set, skipping remote wrapped range test\n");
+        return;
+    }
+
+    const InterfaceDescription* iface = NULL;
+    BusAttachment producer("SessionlessWrappedProducer", true);
+    ASSERT_EQ(ER_OK, CreateTestInterface(producer, iface));
+    SessionlessSender replaced(iface, (qcc::String(OBJECT_PATH) + "/replaced").c_str());
+    SessionlessSender cancelled(iface, (qcc::String(OBJECT_PATH) + "/cancelled").c_str());
+    SessionlessSender expired(iface, (qcc::String(OBJECT_PATH) + "/expired").c_str());
+    SessionlessSender kept(iface, (qcc::String(OBJECT_PATH) + "/kept").c_str());
+    ASSERT_EQ(ER_OK, producer.RegisterBusObject(replaced));
+    ASSERT_EQ(ER_OK, producer.RegisterBusObject(cancelled));
+    ASSERT_EQ(ER_OK, producer.RegisterBusObject(expired));
+    ASSERT_EQ(ER_OK, producer.RegisterBusObject(kept));
+    ASSERT_EQ(ER_OK, producer.Start());
+    ASSERT_EQ(ER_OK, producer.Connect(remoteConnectArg.c_str()));
+
+    /* Values from earlier tests may still be stored by the remote daemon so this test's values start at BASE */
+    const uint32_t BASE = 1000;
+    Message cancelledMsg(producer);
+    Message keptMsg(producer);
+    Message replacedMsg(producer);
+    EXPECT_EQ(ER_OK, replaced.SendChanged(BASE + 1));
+    EXPECT_EQ(ER_OK, cancelled.SendChanged(BASE + 2, 0, &cancelledMsg));
+    EXPECT_EQ(ER_OK, expired.SendChanged(BASE + 3, 1));
+    EXPECT_EQ(ER_OK, kept.SendChanged(BASE + 4, 60, &keptMsg));
+    EXPECT_EQ(ER_OK, replaced.SendChanged(BASE + 5, 0, &replacedMsg));
+    EXPECT_EQ(ER_OK, cancelled.CancelSessionlessMessage(cancelledMsg->GetCallSerial()));
+    qcc::Sleep(2500);
+
+    std::vector<uint32_t> expected;
+    expected.push_back(BASE + 4);
+    expected.push_back(BASE + 5);
+
+    /* The first client's rule asks the remote daemon for every signal it has */
+    SessionlessClient first(0);
+    ASSERT_EQ(ER_OK, first.Connect());
+    ASSERT_EQ(ER_OK, first.bus.AddMatch("type='signal',sessionless='t'"));
+    for (int j = 0; (j < 3000) && (first.GetValues(BASE).size() < expected.size()); ++j) {
+        qcc::Sleep(10);
+    }
+    EXPECT_TRUE(expected == first.GetValues(BASE));
+
+    /* The second client catches up with a wrapped range */
+    SessionlessClient second(1);
+    ASSERT_EQ(ER_OK, second.Connect());
+    ASSERT_EQ(ER_OK, second.bus.AddMatch("type='signal',sessionless='t'"));
+    QStatus status = Event::Wait(second.complete, 30000);
+    EXPECT_EQ(ER_OK, status) << "  Actual Status: " << QCC_StatusText(status);
+    for (int j = 0; (j < 100) && (second.GetValues(BASE).size() < expected.size()); ++j) {
+        qcc::Sleep(10);
+    }
+    EXPECT_TRUE(expected == second.GetValues(BASE));
+
+    second.bus.Stop();
+    second.bus.Join();
+    first.bus.Stop();
+    first.bus.Join();
+
+    /* Leave nothing in the remote daemon's store for later runs */
+    EXPECT_EQ(ER_OK, kept.CancelSessionlessMessage(keptMsg));
+    EXPECT_EQ(ER_OK, replaced.CancelSessionlessMessage(replacedMsg));
+    producer.Stop();
+    producer.Join();
+}
@@ -0,0 +1,247 @@
+/**
+ * @file
+ * Tests for the copy-on-write signal table. Compares the cost of looking up signal handlers from
+ * several threads while handlers are being registered with the locked multimap lookup the local
+ * endpoint used before.
+ */
+/******************************************************************************
+ * Copyright 2013, Qualcomm Innovation Center, Inc.
+ *
+ *    Licensed under the Apache License, Version 2.0 (the "License");
+ *    you may not use this file except in compliance with the License.
+ *    You may obtain a copy of the License at
+ *
+ *        http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *    Unless required by applicable law or agreed to in writing, software
+ *    distributed under the License is distributed on an "AS IS" BASIS,
+ *    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *    See the License for the specific language governing permissions and
+ *    limitations under the License.
+ ******************************************************************************/
+
+#include <qcc/platform.h>
+
+#include <stdio.h>
+
+#include <list>
+
+#include <qcc/Mutex.h>
+#include <qcc/String.h>
+#include <qcc/StringUtil.h>
+#include <qcc/Thread.h>
+#include <qcc/Util.h>
+#include <qcc/time.h>
+
+#include <alljoyn/BusAttachment.h>
+#include <alljoyn/InterfaceDescription.h>
+#include <alljoyn/MessageReceiver.h>
+
+#include <alljoyn/Status.h>
+
+/* Private files included for unit testing */
+#include <SignalTable.h>
+
+#include <gtest/gtest.h>
+
+using namespace std;
+using namespace qcc;
+using namespace ajn;
+
+static const char* INTERFACE_NAME = "org.alljoyn.test.SignalTableTest";
+static const uint32_t NUM_SIGNALS = 16;
+static const uint32_t NUM_READERS = 4;
+
+class TestReceiver : public MessageReceiver {
+  public:
+    void Handler(const InterfaceDescription::Member* member, const char* srcPath, Message& msg) { }
+    void OtherHandler(const InterfaceDescription::Member* member, const char* srcPath, Message& msg) { }
+};
+
+static QStatus CreateTestInterface(BusAttachment& bus, const InterfaceDescription*& iface)
+{
+    InterfaceDescription* intf = NULL;
+    QStatus status = bus.CreateInterface(INTERFACE_NAME, intf, false);
+    for (uint32_t i = 0; (status == ER_OK) && (i < NUM_SIGNALS); ++i) {
+        String name = "Signal" + U32ToString(i);
+        status = intf->AddSignal(name.c_str(), "s", NULL, 0);
+    }
+    if (status == ER_OK) {
+        intf->Activate();
+        iface = intf;
+    }
+    return status;
+}
+
+static size_t CountMatches(SignalTable& table, const char* signalName, const char* path)
+{
+    SignalTable::Handlers handlers;
+    table.Find(INTERFACE_NAME, signalName, handlers);
+    size_t count = 0;
+    for (size_t i = 0; i < handlers.Size(); ++i) {
+        if (handlers[i].Matches(path)) {
+            ++count;
+        }
+    }
+    return count;
+}
+
+TEST(SignalTableTest, AddRemove) {
+    const InterfaceDescription* iface = NULL;
+    BusAttachment bus("SignalTableTest", false);
+    QStatus status = CreateTestInterface(bus, iface);
+    ASSERT_EQ(ER_OK, status) << "  Actual Status: " << QCC_StatusText(status);
+
+    const InterfaceDescription::Member* member = iface->GetMember("Signal0");
+    MessageReceiver::SignalHandler handler = static_cast<MessageReceiver::SignalHandler>(&TestReceiver::Handler);
+    MessageReceiver::SignalHandler other = static_cast<MessageReceiver::SignalHandler>(&TestReceiver::OtherHandler);
+    TestReceiver r1;
+    TestReceiver r2;
+    SignalTable table;
+
+    table.Add(&r1, handler, member, "");
+    table.Add(&r1, other, member, "/a");
+    table.Add(&r2, handler, member, "/b");
+    EXPECT_EQ(2U, CountMatches(table, "Signal0", "/a"));
+    EXPECT_EQ(2U, CountMatches(table, "Signal0", "/b"));
+    EXPECT_EQ(1U, CountMatches(table, "Signal0", "/c"));
+    EXPECT_EQ(0U, CountMatches(table, "Signal1", "/a"));
+
+    /* A lookup keeps the handlers it found even if they are removed */
+    SignalTable::Handlers handlers;
+    table.Find(INTERFACE_NAME, "Signal0", handlers);
+    ASSERT_EQ(3U, handlers.Size());
+
+    table.Remove(&r1, other, member, "/a");
+    EXPECT_EQ(1U, CountMatches(table, "Signal0", "/a"));
+    table.Remove(&r2, handler, member, "/a");
+    EXPECT_EQ(1U, CountMatches(table, "Signal0", "/b"));
+    table.RemoveAll(&r1);
+    EXPECT_EQ(1U, CountMatches(table, "Signal0", "/b"));
+    EXPECT_EQ(0U, CountMatches(table, "Signal0", "/c"));
+    table.RemoveAll(&r2);
+    EXPECT_EQ(0U, CountMatches(table, "Signal0", "/b"));
+
+    EXPECT_EQ(3U, handlers.Size());
+    EXPECT_TRUE(handlers[0].object == &r1);
+    EXPECT_TRUE(handlers[1].handler == other);
+    EXPECT_TRUE(handlers[2].object == &r2);
+}
+
+/*
+ * The signal table the local endpoint used before, looked up with the table locked and the
+ * handlers copied to a list.
+ */
+class LockedTable {
+  public:
+    struct Key {
+        String iface;
+        String signalName;
+        Key(const char* iface, const char* signalName) : iface(iface), signalName(signalName) { }
+        bool operator<(const Key& other) const {
+            return (iface < other.iface) || ((iface == other.iface) && (signalName < other.signalName));
+        }
+    };
+
+    void Add(MessageReceiver* receiver, MessageReceiver::SignalHandler handler, const InterfaceDescription::Member* member)
+    {
+        lock.Lock(MUTEX_CONTEXT);
+        table.insert(pair<const Key, SignalTable::Entry>(Key(member->iface->GetName(), member->name.c_str()),
+                                                         SignalTable::Entry(handler, receiver, member, "")));
+        lock.Unlock(MUTEX_CONTEXT);
+    }
+
+    size_t Find(const char* iface, const char* signalName)
+    {
+        list<SignalTable::Entry> callList;
+        lock.Lock(MUTEX_CONTEXT);
+        pair<multimap<Key, SignalTable::Entry>::iterator, multimap<Key, SignalTable::Entry>::iterator> range =
+            table.equal_range(Key(iface, signalName));
+        for (; range.first != range.second; ++range.first) {
+            callList.push_back(range.first->second);
+        }
+        lock.Unlock(MUTEX_CONTEXT);
+        return callList.size();
+    }
+
+  private:
+    Mutex lock;
+    multimap<Key, SignalTable::Entry> table;
+};
+
+class LookupThread : public Thread {
+  public:
+    LookupThread(SignalTable* table, LockedTable* locked, uint32_t iterations) :
+        Thread("SignalLookup"), table(table), locked(locked), iterations(iterations), found(0) { }
+
+    ThreadReturn STDCALL Run(void* arg)
+    {
+        static const char* names[] = { "Signal1", "Signal2", "Signal3", "Signal4" };
+        for (uint32_t i = 0; i < iterations; ++i) {
+            const char* name = names[i % ArraySize(names)];
+            if (table) {
+                found += CountMatches(*table, name, "/a");
+            } else {
+                found += locked->Find(INTERFACE_NAME, name);
+            }
+        }
+        return 0;
+    }
+
+    SignalTable* table;
+    LockedTable* locked;
+    uint32_t iterations;
+    size_t found;
+};
+
+/*
+ * Several threads look up signal handlers while another signal's handlers are registered.
+ */
+TEST(SignalTableTest, ConcurrentLookup) {
+    const uint32_t iterations = 200000;
+    const uint32_t handlersPerSignal = 4;
+    const InterfaceDescription* iface = NULL;
+    BusAttachment bus("SignalTableTest", false);
+    QStatus status = CreateTestInterface(bus, iface);
+    ASSERT_EQ(ER_OK, status) << "  Actual Status: " << QCC_StatusText(status);
+
+    MessageReceiver::SignalHandler handler = static_cast<MessageReceiver::SignalHandler>(&TestReceiver::Handler);
+    TestReceiver receivers[handlersPerSignal];
+    SignalTable table;
+    LockedTable locked;
+    for (uint32_t i = 1; i < NUM_SIGNALS; ++i) {
+        const InterfaceDescription::Member* member = iface->GetMember(("Signal" + U32ToString(i)).c_str());
+        for (uint32_t j = 0; j < handlersPerSignal; ++j) {
+            table.Add(&receivers[j], handler, member, "");
+            locked.Add(&receivers[j], handler, member);
+        }
+    }
+    const InterfaceDescription::Member* churn = iface->GetMember("Signal0");
+
+    uint64_t ms[2];
+    for (size_t p = 0; p < 2; ++p) {
+        LookupThread* threads[NUM_READERS];
+        uint64_t start = GetTimestamp64();
+        for (uint32_t i = 0; i < NUM_READERS; ++i) {
+            threads[i] = new LookupThread(p ? &table : NULL, p ? NULL : &locked, iterations);
+            threads[i]->Start();
+        }
+        for (uint32_t i = 0; i < 100; ++i) {
+            if (p) {
+                table.Add(&receivers[0], handler, churn, "");
+                table.Remove(&receivers[0], handler, churn, "");
+            } else {
+                locked.Add(&receivers[0], handler, churn);
+            }
+        }
+        for (uint32_t i = 0; i < NUM_READERS; ++i) {
+            threads[i]->Join();
+            EXPECT_EQ(iterations * handlersPerSignal, threads[i]->found);
+            delete threads[i];
+        }
+        ms[p] = GetTimestamp64() - start;
+    }
+    printf("%u threads: locked table %u lookups/sec, copy-on-write table %u lookups/sec\n", NUM_READERS,
+           (unsigned int)(((uint64_t)iterations * NUM_READERS * 1000) / (ms[0] ? ms[0] : 1)),
+           (unsigned int)(((uint64_t)iterations * NUM_READERS * 1000) / (ms[1] ? ms[1] : 1)));
+}
@@ -0,0 +1,213 @@
+/**
+ * @file
+ * Tests for the timer wheel and serial number table used to track method call replies. Compares
+ * the cost of registering and completing many outstanding method calls with the std::map and
+ * qcc::Timer the local endpoint used before.
+ */
+/******************************************************************************
+ * Copyright 2013, Qualcomm Innovation Center, Inc.
+ *
+ *    Licensed under the Apache License, Version 2.0 (the "License");
+ *    you may not use this file except in compliance with the License.
+ *    You may obtain a copy of the License at
+ *
+ *        http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *    Unless required by applicable law or agreed to in writing, software
+ *    distributed under the License is distributed on an "AS IS" BASIS,
+ *    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *    See the License for the specific language governing permissions and
+ *    limitations under the License.
+ ******************************************************************************/
+
+#include <qcc/platform.h>
+
+#include <stdio.h>
+
+#include <map>
+#include <vector>
+
+#include <qcc/Mutex.h>
+#include <qcc/Timer.h>
+#include <qcc/Util.h>
+#include <qcc/time.h>
+
+#include <alljoyn/Status.h>
+
+/* Private files included for unit testing */
+#include <SerialTable.h>
+#include <TimerWheel.h>
+
+#include <gtest/gtest.h>
+
+using namespace std;
+using namespace qcc;
+using namespace ajn;
+
+class TestCall : public TimerWheel::Entry {
+  public:
+    TestCall() : serial(0), expires(0) { }
+    uint32_t serial;
+    uint64_t expires;
+};
+
+TEST(TimerWheelTest, SerialTable) {
+    const uint32_t num = 1000;
+    /* Serial numbers wrap around */
+    const uint32_t first = 0xFFFFFF00;
+    vector<TestCall> calls(num);
+    SerialTable<TestCall> table(8);
+
+    for (uint32_t i = 0; i < num; ++i) {
+        calls[i].serial = first + i;
+        table.Insert(calls[i].serial, &calls[i]);
+    }
+    EXPECT_EQ(num, table.Size());
+    for (uint32_t i = 0; i < num; ++i) {
+        EXPECT_EQ(&calls[i], table.Find(first + i));
+    }
+    EXPECT_TRUE(table.Find(first + num) == NULL);
+
+    /* Remove every third call and check the others can still be found */
+    for (uint32_t i = 0; i < num; i += 3) {
+        EXPECT_EQ(&calls[i], table.Remove(first + i));
+    }
+    EXPECT_TRUE(table.Remove(first) == NULL);
+    for (uint32_t i = 0; i < num; ++i) {
+        EXPECT_EQ((i % 3) ? &calls[i] : NULL, table.Find(first + i));
+    }
+
+    vector<TestCall*> all;
+    table.GetAll(all);
+    EXPECT_EQ(table.Size(), all.size());
+
+    table.Clear();
+    EXPECT_EQ(0U, table.Size());
+    EXPECT_TRUE(table.Find(first + 1) == NULL);
+}
+
+TEST(TimerWheelTest, Expiry) {
+    const uint32_t tick = 10;
+    const uint64_t start = 100000;
+    const uint32_t num = 2000;
+    /* A small wheel so timeouts take many turns */
+    TimerWheel wheel(tick, 16);
+    vector<TestCall> calls(num);
+
+    for (uint32_t i = 0; i < num; ++i) {
+        calls[i].serial = i;
+        calls[i].expires = start + (i * 7) % 3000;
+        wheel.Schedule(&calls[i], calls[i].expires, start);
+    }
+    for (uint32_t i = 0; i < num; i += 5) {
+        EXPECT_TRUE(wheel.Cancel(&calls[i]));
+        EXPECT_FALSE(wheel.Cancel(&calls[i]));
+    }
+    EXPECT_EQ(num - (num / 5), wheel.Size());
+
+    size_t fired = 0;
+    for (uint64_t now = start; wheel.Size() > 0; now += 3) {
+        vector<TimerWheel::Entry*> expired;
+        wheel.Advance(now, expired);
+        for (size_t i = 0; i < expired.size(); ++i) {
+            TestCall* call = static_cast<TestCall*>(expired[i]);
+            EXPECT_NE(0U, call->serial % 5);
+            EXPECT_FALSE(call->IsScheduled());
+            /* Expire on the first tick at or after the expiry time */
+            EXPECT_LE(call->expires, now);
+            EXPECT_LT(now, call->expires + tick + 3);
+        }
+        fired += expired.size();
+    }
+    EXPECT_EQ(num - (num / 5), fired);
+
+    /* Everything comes off the wheel when it is shut down */
+    for (uint32_t i = 0; i < num; ++i) {
+        wheel.Schedule(&calls[i], start + 100000, start);
+    }
+    vector<TimerWheel::Entry*> expired;
+    wheel.ExpireAll(expired);
+    EXPECT_EQ(num, expired.size());
+    EXPECT_EQ(0U, wheel.Size());
+}
+
+class NullListener : public AlarmListener {
+  public:
+    void AlarmTriggered(const Alarm& alarm, QStatus reason) { }
+};
+
+/*
+ * Register a batch of outstanding method calls and then complete them all, the way replies to
+ * MethodCallAsync calls are handled by the local endpoint.
+ */
+TEST(TimerWheelTest, OutstandingCalls) {
+    const uint32_t timeout = 25000;
+    const uint32_t outstanding[] = { 1000, 10000, 50000 };
+
+    for (size_t n = 0; n < ArraySize(outstanding); ++n) {
+        uint32_t num = outstanding[n];
+        vector<TestCall> calls(num);
+        Mutex lock;
+        uint64_t ms[2];
+
+        {
+            NullListener listener;
+            AlarmListener* alarmListener = &listener;
+            Timer timer("replyTest", true);
+            map<uint32_t, TestCall*> replyMap;
+            vector<Alarm> alarms;
+            alarms.reserve(num);
+            ASSERT_EQ(ER_OK, timer.Start());
+
+            uint64_t start = GetTimestamp64();
+            for (uint32_t i = 0; i < num; ++i) {
+                uint32_t zero = 0;
+                void* context = &calls[i];
+                alarms.push_back(Alarm(timeout, alarmListener, context, zero));
+                lock.Lock(MUTEX_CONTEXT);
+                replyMap[i + 1] = &calls[i];
+                lock.Unlock(MUTEX_CONTEXT);
+                ASSERT_EQ(ER_OK, timer.AddAlarm(alarms.back()));
+            }
+            for (uint32_t i = 0; i < num; ++i) {
+                lock.Lock(MUTEX_CONTEXT);
+                replyMap.erase(i + 1);
+                lock.Unlock(MUTEX_CONTEXT);
+                timer.RemoveAlarm(alarms[i], false);
+            }
+            ms[0] = GetTimestamp64() - start;
+            timer.Stop();
+            timer.Join();
+        }
+        {
+            TimerWheel wheel(20, 512);
+            SerialTable<TestCall> replyMap;
+
+            uint64_t start = GetTimestamp64();
+            for (uint32_t i = 0; i < num; ++i) {
+                uint64_t now = GetTimestamp64();
+                calls[i].serial = i + 1;
+                calls[i].expires = now + timeout;
+                lock.Lock(MUTEX_CONTEXT);
+                replyMap.Insert(calls[i].serial, &calls[i]);
+                wheel.Schedule(&calls[i], calls[i].expires, now);
+                lock.Unlock(MUTEX_CONTEXT);
+            }
+            for (uint32_t i = 0; i < num; ++i) {
+                lock.Lock(MUTEX_CONTEXT);
+                TestCall* call = replyMap.Remove(i + 1);
+                bool cancelled = (call != NULL) && wheel.Cancel(call);
+                lock.Unlock(MUTEX_CONTEXT);
+                /* Check outside the lock so a failure cannot leave it held */
+                ASSERT_TRUE(call != NULL);
+                EXPECT_TRUE(cancelled);
+            }
+            ms[1] = GetTimestamp64() - start;
+            EXPECT_EQ(0U, wheel.Size());
+            EXPECT_EQ(0U, replyMap.Size());
+        }
+        printf("%u outstanding calls: map and timer %u calls/sec, table and wheel %u calls/sec\n", num,
+               (unsigned int)(((uint64_t)num * 1000) / (ms[0] ? ms[0] : 1)),
+               (unsigned int)(((uint64_t)num * 1000) / (ms[1] ? ms[1] : 1)));
+    }
+}